@@ -203,6 +203,9 @@ macro(ncnn_add_layer class)
             if(NCNN_AVX512FP16)
                 ncnn_add_arch_opt_source(${class} avx512fp16 "-mavx512f -mavx512cd -mavx512bw -mavx512dq -mavx512vl -mfma -mf16c -mavx512fp16")
             endif()
+            if(NCNN_AVX512AMX)
+                ncnn_add_arch_opt_source(${class} avx512amx "-mavx512f -mavx512cd -mavx512bw -mavx512dq -mavx512vl -mfma -mf16c -mavx512vnni -mavx512bf16 -mamx-tile -mamx-int8 -mamx-bf16")
+            endif()
             if(NCNN_AVXVNNI)
                 ncnn_add_arch_opt_source(${class} avxvnni "-mavx2 -mfma -mf16c -mavxvnni")
             endif()
@@ -17,6 +17,8 @@
 #include "gpu.h"
 #include "pipeline.h"
 
+#include <string.h>
+
 #if __ANDROID_API__ >= 26
 #include <android/hardware_buffer.h>
 #endif // __ANDROID_API__ >= 26
@@ -291,6 +293,594 @@ void UnlockedPoolAllocator::fastFree(void* ptr)
     ncnn::fastFree(ptr);
 }
 
+// lock-free primitives for the size class pool allocator
+#if NCNN_THREADS && defined _MSC_VER
+static NCNN_FORCEINLINE void* atomic_load_ptr(void* volatile* addr)
+{
+    return InterlockedCompareExchangePointer(addr, 0, 0);
+}
+
+static NCNN_FORCEINLINE size_t atomic_load_size(volatile size_t* addr)
+{
+#if defined _WIN64
+    return (size_t)InterlockedCompareExchange64((volatile LONG64*)addr, 0, 0);
+#else
+    return (size_t)InterlockedCompareExchange((volatile LONG*)addr, 0, 0);
+#endif
+}
+
+static NCNN_FORCEINLINE void atomic_add_size(volatile size_t* addr, size_t delta)
+{
+#if defined _WIN64
+    InterlockedExchangeAdd64((volatile LONG64*)addr, (LONG64)delta);
+#else
+    InterlockedExchangeAdd((volatile LONG*)addr, (LONG)delta);
+#endif
+}
+#elif NCNN_THREADS && defined __GNUC__ && !(defined __riscv && !defined __riscv_atomic)
+static NCNN_FORCEINLINE void* atomic_load_ptr(void* volatile* addr)
+{
+    return __atomic_load_n(addr, __ATOMIC_ACQUIRE);
+}
+
+static NCNN_FORCEINLINE size_t atomic_load_size(volatile size_t* addr)
+{
+    return __atomic_load_n(addr, __ATOMIC_ACQUIRE);
+}
+
+static NCNN_FORCEINLINE void atomic_add_size(volatile size_t* addr, size_t delta)
+{
+    __atomic_fetch_add(addr, delta, __ATOMIC_RELAXED);
+}
+#else
+// thread-unsafe branch
+static NCNN_FORCEINLINE void* atomic_load_ptr(void* volatile* addr)
+{
+    return *addr;
+}
+
+static NCNN_FORCEINLINE size_t atomic_load_size(volatile size_t* addr)
+{
+    return *addr;
+}
+
+static NCNN_FORCEINLINE void atomic_add_size(volatile size_t* addr, size_t delta)
+{
+    *addr += delta;
+}
+#endif
+
+// freelist head tagged with a generation counter that every pop bumps
+// the compare-and-swap covers both, so a pop never succeeds on a head that was popped and pushed back meanwhile (aba)
+struct SizeClassFreelist
+{
+    void* head;
+    size_t tag;
+};
+
+#if NCNN_THREADS && defined _MSC_VER
+static bool atomic_cas_freelist(SizeClassFreelist* addr, const SizeClassFreelist& expected, const SizeClassFreelist& desired)
+{
+#if defined _WIN64
+    __int64 comparand[2] = {(__int64)expected.head, (__int64)expected.tag};
+    return InterlockedCompareExchange128((volatile __int64*)addr, (__int64)desired.tag, (__int64)desired.head, comparand) == 1;
+#else
+    const __int64 comparand = (__int64)((unsigned __int64)(size_t)expected.head | ((unsigned __int64)expected.tag << 32));
+    const __int64 exchange = (__int64)((unsigned __int64)(size_t)desired.head | ((unsigned __int64)desired.tag << 32));
+    return InterlockedCompareExchange64((volatile __int64*)addr, exchange, comparand) == comparand;
+#endif
+}
+#elif NCNN_THREADS && defined __GNUC__ && ((__SIZEOF_POINTER__ == 8 && (defined __x86_64__ || defined __GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)) || (__SIZEOF_POINTER__ == 4 && defined __GCC_HAVE_SYNC_COMPARE_AND_SWAP_8))
+#if __SIZEOF_POINTER__ == 8
+typedef unsigned __int128 size_class_freelist_word;
+#else
+typedef unsigned long long size_class_freelist_word;
+#endif
+
+// cmpxchg16b is not in the x86_64 baseline, but every cpu ncnn targets has it
+#if defined __x86_64__
+__attribute__((target("cx16")))
+#endif
+static bool atomic_cas_freelist(SizeClassFreelist* addr, const SizeClassFreelist& expected, const SizeClassFreelist& desired)
+{
+    size_class_freelist_word e;
+    size_class_freelist_word d;
+    memcpy(&e, &expected, sizeof(e));
+    memcpy(&d, &desired, sizeof(d));
+    return __sync_bool_compare_and_swap((volatile size_class_freelist_word*)addr, e, d);
+}
+#elif NCNN_THREADS
+// no double-width compare-and-swap on this target, emulate it with one lock
+static Mutex g_freelist_cas_lock;
+
+static bool atomic_cas_freelist(SizeClassFreelist* addr, const SizeClassFreelist& expected, const SizeClassFreelist& desired)
+{
+    MutexLockGuard guard(g_freelist_cas_lock);
+    if (addr->head != expected.head || addr->tag != expected.tag)
+        return false;
+    addr->head = desired.head;
+    addr->tag = desired.tag;
+    return true;
+}
+#else
+// thread-unsafe branch
+static bool atomic_cas_freelist(SizeClassFreelist* addr, const SizeClassFreelist& expected, const SizeClassFreelist& desired)
+{
+    if (addr->head != expected.head || addr->tag != expected.tag)
+        return false;
+    *addr = desired;
+    return true;
+}
+#endif
+
+// the two halves are read separately, a torn snapshot only makes the compare-and-swap fail
+// the tag goes first, a head replaced after it always comes with a newer tag
+static NCNN_FORCEINLINE SizeClassFreelist load_freelist(SizeClassFreelist* addr)
+{
+    SizeClassFreelist freelist;
+    freelist.tag = atomic_load_size((volatile size_t*)&addr->tag);
+    freelist.head = atomic_load_ptr((void* volatile*)&addr->head);
+    return freelist;
+}
+
+// block sizes are 64 and then four geometric steps per power of two
+// so that a block wastes at most 25% of its size
+#define SIZE_CLASS_MIN_SHIFT 6
+#define SIZE_CLASS_MAX_SHIFT 48
+#define SIZE_CLASS_COUNT ((SIZE_CLASS_MAX_SHIFT - SIZE_CLASS_MIN_SHIFT) * 4 + 1)
+
+// max idle blocks of one class in a thread cache
+#define SIZE_CLASS_THREAD_CACHE_DEPTH 16
+
+// return -1 for sizes too large to be pooled
+static int size_to_class(size_t size, size_t* class_size)
+{
+    if (size <= ((size_t)1 << SIZE_CLASS_MIN_SHIFT))
+    {
+        *class_size = (size_t)1 << SIZE_CLASS_MIN_SHIFT;
+        return 0;
+    }
+
+    // 2^e <= size - 1 < 2^(e+1)
+    int e = 0;
+    size_t v = size - 1;
+    while (v >>= 1)
+        e++;
+
+    if (e >= SIZE_CLASS_MAX_SHIFT)
+    {
+        *class_size = size;
+        return -1;
+    }
+
+    const size_t base = (size_t)1 << e;
+    const size_t step = base >> 2;
+    const int k = (int)((size - 1 - base) / step) + 1;
+
+    *class_size = base + k * step;
+    return (e - SIZE_CLASS_MIN_SHIFT) * 4 + k;
+}
+
+// header stored in front of every block
+struct SizeClassBlock
+{
+    SizeClassBlock* next;
+    int size_class;
+    size_t class_size;
+};
+
+// alignSize(sizeof(SizeClassBlock), NCNN_MALLOC_ALIGN), the user data that follows stays aligned
+#define SIZE_CLASS_HEADER_SIZE ((sizeof(SizeClassBlock) + NCNN_MALLOC_ALIGN - 1) / NCNN_MALLOC_ALIGN * NCNN_MALLOC_ALIGN)
+
+// the header must never overlap the user data
+typedef char size_class_header_size_check[(SIZE_CLASS_HEADER_SIZE >= sizeof(SizeClassBlock) && SIZE_CLASS_HEADER_SIZE % NCNN_MALLOC_ALIGN == 0) ? 1 : -1];
+
+class SizeClassPoolAllocatorPrivate;
+
+struct SizeClassThreadCache
+{
+    SizeClassBlock* heads[SIZE_CLASS_COUNT];
+    int depths[SIZE_CLASS_COUNT];
+    size_t bytes;
+
+    // all thread caches of an allocator, for clear and destruction
+    SizeClassThreadCache* next;
+
+    SizeClassPoolAllocatorPrivate* owner;
+};
+
+static NCNN_FORCEINLINE SizeClassBlock* block_from_ptr(void* ptr)
+{
+    return (SizeClassBlock*)((unsigned char*)ptr - SIZE_CLASS_HEADER_SIZE);
+}
+
+static NCNN_FORCEINLINE void* ptr_from_block(SizeClassBlock* block)
+{
+    return (unsigned char*)block + SIZE_CLASS_HEADER_SIZE;
+}
+
+// thread local slot whose value is handed to a destructor when its thread exits
+#if NCNN_THREADS && (defined _WIN32 && !(defined __MINGW32__))
+class ThreadCacheKey
+{
+public:
+    ThreadCacheKey(void(WINAPI* destructor)(void*)) { key = FlsAlloc(destructor); }
+    ~ThreadCacheKey() { FlsFree(key); }
+    void set(void* value) { FlsSetValue(key, value); }
+    void* get() { return FlsGetValue(key); }
+private:
+    DWORD key;
+};
+#define THREAD_CACHE_DESTRUCTOR_API WINAPI
+#elif NCNN_THREADS
+class ThreadCacheKey
+{
+public:
+    ThreadCacheKey(void (*destructor)(void*)) { pthread_key_create(&key, destructor); }
+    ~ThreadCacheKey() { pthread_key_delete(key); }
+    void set(void* value) { pthread_setspecific(key, value); }
+    void* get() { return pthread_getspecific(key); }
+private:
+    pthread_key_t key;
+};
+#define THREAD_CACHE_DESTRUCTOR_API
+#else
+// single thread, the cache lives as long as the allocator
+class ThreadCacheKey
+{
+public:
+    ThreadCacheKey(void (*/*destructor*/)(void*)) { data = 0; }
+    ~ThreadCacheKey() {}
+    void set(void* value) { data = value; }
+    void* get() { return data; }
+private:
+    void* data;
+};
+#define THREAD_CACHE_DESTRUCTOR_API
+#endif
+
+static void THREAD_CACHE_DESTRUCTOR_API destroy_thread_cache(void* ptr);
+
+class SizeClassPoolAllocatorPrivate
+{
+public:
+    SizeClassThreadCache* get_thread_cache();
+
+    // hand the idle blocks of an exiting thread to the shared freelists
+    void retire_thread_cache(SizeClassThreadCache* cache);
+
+    void push(int size_class, SizeClassBlock* first, SizeClassBlock* last);
+    SizeClassBlock* pop(int size_class);
+
+    void release_all();
+
+    // shared freelists, stacks of idle blocks with tagged heads
+    // pushes and pops are lock-free
+    // allocated with NCNN_MALLOC_ALIGN so that the double-width compare-and-swap sees aligned heads
+    SizeClassFreelist* freelists;
+
+    // freed first on destruction, so that no exiting thread retires its cache afterwards
+    ThreadCacheKey* thread_cache_key;
+    Mutex thread_caches_lock;
+    SizeClassThreadCache* thread_caches;
+
+    size_t thread_cache_size;
+
+    volatile size_t hits;
+    volatile size_t misses;
+    volatile size_t bytes_held;
+    int payouts;
+};
+
+static void THREAD_CACHE_DESTRUCTOR_API destroy_thread_cache(void* ptr)
+{
+    SizeClassThreadCache* cache = (SizeClassThreadCache*)ptr;
+    if (!cache)
+        return;
+
+    cache->owner->retire_thread_cache(cache);
+}
+
+SizeClassThreadCache* SizeClassPoolAllocatorPrivate::get_thread_cache()
+{
+    SizeClassThreadCache* cache = (SizeClassThreadCache*)thread_cache_key->get();
+    if (cache)
+        return cache;
+
+    cache = new SizeClassThreadCache;
+    memset(cache, 0, sizeof(SizeClassThreadCache));
+    cache->owner = this;
+
+    thread_caches_lock.lock();
+    cache->next = thread_caches;
+    thread_caches = cache;
+    thread_caches_lock.unlock();
+
+    thread_cache_key->set(cache);
+
+    return cache;
+}
+
+void SizeClassPoolAllocatorPrivate::retire_thread_cache(SizeClassThreadCache* cache)
+{
+    for (int i = 0; i < SIZE_CLASS_COUNT; i++)
+    {
+        SizeClassBlock* first = cache->heads[i];
+        if (!first)
+            continue;
+
+        SizeClassBlock* last = first;
+        while (last->next)
+            last = last->next;
+
+        push(i, first, last);
+    }
+
+    thread_caches_lock.lock();
+
+    SizeClassThreadCache** pcache = &thread_caches;
+    while (*pcache != cache)
+        pcache = &(*pcache)->next;
+    *pcache = cache->next;
+
+    thread_caches_lock.unlock();
+
+    delete cache;
+}
+
+void SizeClassPoolAllocatorPrivate::push(int size_class, SizeClassBlock* first, SizeClassBlock* last)
+{
+    // pushing keeps the tag, a head that changed meanwhile only makes the compare-and-swap retry
+    SizeClassFreelist* freelist = &freelists[size_class];
+    for (;;)
+    {
+        SizeClassFreelist old_head = load_freelist(freelist);
+        last->next = (SizeClassBlock*)old_head.head;
+
+        SizeClassFreelist new_head;
+        new_head.head = first;
+        new_head.tag = old_head.tag;
+        if (atomic_cas_freelist(freelist, old_head, new_head))
+            break;
+    }
+}
+
+SizeClassBlock* SizeClassPoolAllocatorPrivate::pop(int size_class)
+{
+    SizeClassFreelist* freelist = &freelists[size_class];
+    for (;;)
+    {
+        SizeClassFreelist old_head = load_freelist(freelist);
+
+        SizeClassBlock* block = (SizeClassBlock*)old_head.head;
+        if (!block)
+            return 0;
+
+        // blocks are only returned to the system by clear, so next stays readable
+        // even if another thread took the block meanwhile, the bumped tag then fails the compare-and-swap
+        SizeClassFreelist new_head;
+        new_head.head = ((volatile SizeClassBlock*)block)->next;
+        new_head.tag = old_head.tag + 1;
+        if (atomic_cas_freelist(freelist, old_head, new_head))
+            return block;
+    }
+}
+
+void SizeClassPoolAllocatorPrivate::release_all()
+{
+    for (int i = 0; i < SIZE_CLASS_COUNT; i++)
+    {
+        SizeClassBlock* block = 0;
+        for (;;)
+        {
+            SizeClassFreelist old_head = load_freelist(&freelists[i]);
+
+            SizeClassFreelist new_head;
+            new_head.head = 0;
+            new_head.tag = old_head.tag + 1;
+            if (atomic_cas_freelist(&freelists[i], old_head, new_head))
+            {
+                block = (SizeClassBlock*)old_head.head;
+                break;
+            }
+        }
+
+        while (block)
+        {
+            SizeClassBlock* next = block->next;
+            atomic_add_size(&bytes_held, (size_t)0 - block->class_size);
+            ncnn::fastFree(block);
+            block = next;
+        }
+    }
+
+    thread_caches_lock.lock();
+
+    SizeClassThreadCache* cache = thread_caches;
+    for (; cache; cache = cache->next)
+    {
+        for (int i = 0; i < SIZE_CLASS_COUNT; i++)
+        {
+            SizeClassBlock* block = cache->heads[i];
+            while (block)
+            {
+                SizeClassBlock* next = block->next;
+                atomic_add_size(&bytes_held, (size_t)0 - block->class_size);
+                ncnn::fastFree(block);
+                block = next;
+            }
+
+            cache->heads[i] = 0;
+            cache->depths[i] = 0;
+        }
+
+        cache->bytes = 0;
+    }
+
+    thread_caches_lock.unlock();
+}
+
+SizeClassPoolAllocator::SizeClassPoolAllocator()
+    : Allocator(), d(new SizeClassPoolAllocatorPrivate)
+{
+    d->freelists = (SizeClassFreelist*)ncnn::fastMalloc(sizeof(SizeClassFreelist) * SIZE_CLASS_COUNT);
+    for (int i = 0; i < SIZE_CLASS_COUNT; i++)
+    {
+        d->freelists[i].head = 0;
+        d->freelists[i].tag = 0;
+    }
+
+    d->thread_cache_key = new ThreadCacheKey(destroy_thread_cache);
+    d->thread_caches = 0;
+    d->thread_cache_size = 4 * 1024 * 1024;
+
+    d->hits = 0;
+    d->misses = 0;
+    d->bytes_held = 0;
+    d->payouts = 0;
+}
+
+SizeClassPoolAllocator::~SizeClassPoolAllocator()
+{
+    delete d->thread_cache_key;
+
+    clear();
+
+    if (d->payouts != 0)
+    {
+        NCNN_LOGE("FATAL ERROR! size class pool allocator destroyed too early, %d blocks still in use", d->payouts);
+    }
+
+    SizeClassThreadCache* cache = d->thread_caches;
+    while (cache)
+    {
+        SizeClassThreadCache* next = cache->next;
+        delete cache;
+        cache = next;
+    }
+
+    ncnn::fastFree(d->freelists);
+
+    delete d;
+}
+
+SizeClassPoolAllocator::SizeClassPoolAllocator(const SizeClassPoolAllocator&)
+    : d(0)
+{
+}
+
+SizeClassPoolAllocator& SizeClassPoolAllocator::operator=(const SizeClassPoolAllocator&)
+{
+    return *this;
+}
+
+void SizeClassPoolAllocator::set_thread_cache_size(size_t size)
+{
+    d->thread_cache_size = size;
+}
+
+void SizeClassPoolAllocator::clear()
+{
+    d->release_all();
+}
+
+size_t SizeClassPoolAllocator::hits() const
+{
+    return d->hits;
+}
+
+size_t SizeClassPoolAllocator::misses() const
+{
+    return d->misses;
+}
+
+size_t SizeClassPoolAllocator::bytes_held() const
+{
+    return d->bytes_held;
+}
+
+void* SizeClassPoolAllocator::fastMalloc(size_t size)
+{
+    size_t class_size = 0;
+    const int size_class = size_to_class(size, &class_size);
+
+    NCNN_XADD(&d->payouts, 1);
+
+    if (size_class != -1)
+    {
+        // thread cache first
+        SizeClassThreadCache* cache = d->get_thread_cache();
+        SizeClassBlock* block = cache->heads[size_class];
+        if (block)
+        {
+            cache->heads[size_class] = block->next;
+            cache->depths[size_class]--;
+            cache->bytes -= class_size;
+
+            atomic_add_size(&d->bytes_held, (size_t)0 - class_size);
+            atomic_add_size(&d->hits, 1);
+            return ptr_from_block(block);
+        }
+
+        block = d->pop(size_class);
+        if (block)
+        {
+            atomic_add_size(&d->bytes_held, (size_t)0 - class_size);
+            atomic_add_size(&d->hits, 1);
+            return ptr_from_block(block);
+        }
+    }
+
+    atomic_add_size(&d->misses, 1);
+
+    // new
+    SizeClassBlock* block = (SizeClassBlock*)ncnn::fastMalloc(SIZE_CLASS_HEADER_SIZE + class_size);
+    if (!block)
+    {
+        NCNN_XADD(&d->payouts, -1);
+        return 0;
+    }
+
+    block->next = 0;
+    block->size_class = size_class;
+    block->class_size = class_size;
+
+    return ptr_from_block(block);
+}
+
+void SizeClassPoolAllocator::fastFree(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    NCNN_XADD(&d->payouts, -1);
+
+    SizeClassBlock* block = block_from_ptr(ptr);
+    const int size_class = block->size_class;
+    const size_t class_size = block->class_size;
+
+    if (size_class == -1)
+    {
+        ncnn::fastFree(block);
+        return;
+    }
+
+    atomic_add_size(&d->bytes_held, class_size);
+
+    SizeClassThreadCache* cache = d->get_thread_cache();
+    if (cache->depths[size_class] < SIZE_CLASS_THREAD_CACHE_DEPTH && cache->bytes + class_size <= d->thread_cache_size)
+    {
+        block->next = cache->heads[size_class];
+        cache->heads[size_class] = block;
+        cache->depths[size_class]++;
+        cache->bytes += class_size;
+        return;
+    }
+
+    block->next = 0;
+    d->push(size_class, block, block);
+}
+
 #if NCNN_VULKAN
 VkAllocator::VkAllocator(const VulkanDevice* _vkdev)
     : vkdev(_vkdev)
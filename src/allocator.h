@@ -212,6 +212,41 @@ private:
     UnlockedPoolAllocatorPrivate* const d;
 };
 
+class SizeClassPoolAllocatorPrivate;
+class NCNN_EXPORT SizeClassPoolAllocator : public Allocator
+{
+public:
+    SizeClassPoolAllocator();
+    ~SizeClassPoolAllocator();
+
+    // max bytes of idle blocks each thread keeps for itself
+    // blocks beyond go to the freelists shared by all threads
+    // and so do the cached ones of a thread when it exits
+    // default 4M
+    void set_thread_cache_size(size_t size);
+
+    // release all idle blocks immediately, including those cached by other threads
+    // every thread using this allocator must be idle meanwhile
+    void clear();
+
+    // allocations served from idle blocks
+    size_t hits() const;
+    // allocations that went to the system allocator
+    size_t misses() const;
+    // bytes of idle blocks kept for reuse
+    size_t bytes_held() const;
+
+    virtual void* fastMalloc(size_t size);
+    virtual void fastFree(void* ptr);
+
+private:
+    SizeClassPoolAllocator(const SizeClassPoolAllocator&);
+    SizeClassPoolAllocator& operator=(const SizeClassPoolAllocator&);
+
+private:
+    SizeClassPoolAllocatorPrivate* const d;
+};
+
 #if NCNN_VULKAN
 
 class VulkanDevice;
@@ -30,6 +30,10 @@
 #include <stdio.h>
 #endif // NCNN_BENCHMARK
 
+#if NCNN_STDIO
+#include <stdio.h>
+#endif // NCNN_STDIO
+
 namespace ncnn {
 
 double get_current_time()
@@ -49,6 +53,220 @@ double get_current_time()
 #endif // _WIN32
 }
 
+LayerProfile::LayerProfile()
+{
+    layer_index = -1;
+    typeindex = -1;
+    start = 0;
+    end = 0;
+    thread = 0;
+    kernel = 0;
+    bytes_allocated = 0;
+}
+
+class ProfilerPrivate
+{
+public:
+    Mutex lock;
+    std::vector<LayerProfile> records;
+
+    // thread number + 1 of the recording thread
+    ThreadLocalStorage thread_key;
+    int thread_count;
+};
+
+Profiler::Profiler()
+    : d(new ProfilerPrivate)
+{
+    d->thread_count = 0;
+}
+
+Profiler::~Profiler()
+{
+    delete d;
+}
+
+Profiler::Profiler(const Profiler&)
+    : d(0)
+{
+}
+
+Profiler& Profiler::operator=(const Profiler&)
+{
+    return *this;
+}
+
+void Profiler::record(const LayerProfile& profile)
+{
+    d->lock.lock();
+
+    size_t thread = (size_t)d->thread_key.get();
+    if (thread == 0)
+    {
+        thread = ++d->thread_count;
+        d->thread_key.set((void*)thread);
+    }
+
+    d->records.push_back(profile);
+    d->records[d->records.size() - 1].thread = (int)thread - 1;
+
+    d->lock.unlock();
+}
+
+void Profiler::clear()
+{
+    d->lock.lock();
+    d->records.clear();
+    d->lock.unlock();
+}
+
+std::vector<LayerProfile> Profiler::records() const
+{
+    d->lock.lock();
+    std::vector<LayerProfile> records = d->records;
+    d->lock.unlock();
+
+    return records;
+}
+
+#if NCNN_STDIO
+static void fprint_json_string(FILE* fp, const char* str)
+{
+    fprintf(fp, "\"");
+    for (const char* p = str; *p; p++)
+    {
+        const unsigned char ch = (unsigned char)*p;
+        if (ch == '"' || ch == '\\')
+            fprintf(fp, "\\%c", ch);
+        else if (ch < 0x20)
+            fprintf(fp, "\\u%04x", ch);
+        else
+            fprintf(fp, "%c", ch);
+    }
+    fprintf(fp, "\"");
+}
+
+static void fprint_json_shapes(FILE* fp, const std::vector<Mat>& shapes)
+{
+    fprintf(fp, "[");
+    for (size_t i = 0; i < shapes.size(); i++)
+    {
+        const Mat& m = shapes[i];
+        fprintf(fp, "%s{\"dims\":%d,\"w\":%d,\"h\":%d,\"d\":%d,\"c\":%d,\"elempack\":%d,\"elemsize\":%d}", i == 0 ? "" : ",", m.dims, m.w, m.h, m.d, m.c, m.elempack, (int)m.elemsize);
+    }
+    fprintf(fp, "]");
+}
+
+static void fprint_json_conversions(FILE* fp, const std::vector<LayoutConversion>& conversions)
+{
+    fprintf(fp, "[");
+    for (size_t i = 0; i < conversions.size(); i++)
+    {
+        const LayoutConversion& c = conversions[i];
+        fprintf(fp, "%s{\"bottom\":%d,\"from_elembits\":%d,\"from_elempack\":%d,\"to_elembits\":%d,\"to_elempack\":%d}", i == 0 ? "" : ",", c.bottom, c.from_elembits, c.from_elempack, c.to_elembits, c.to_elempack);
+    }
+    fprintf(fp, "]");
+}
+
+static void fprint_json_layer(FILE* fp, const LayerProfile& p)
+{
+    fprintf(fp, "\"index\":%d,\"typeindex\":%d", p.layer_index, p.typeindex);
+#if NCNN_STRING
+    fprintf(fp, ",\"type\":");
+    fprint_json_string(fp, p.type.c_str());
+    fprintf(fp, ",\"name\":");
+    fprint_json_string(fp, p.name.c_str());
+#endif // NCNN_STRING
+    fprintf(fp, ",\"kernel\":");
+    fprint_json_string(fp, p.kernel ? p.kernel : "");
+    fprintf(fp, ",\"bottoms\":");
+    fprint_json_shapes(fp, p.bottom_shapes);
+    fprintf(fp, ",\"tops\":");
+    fprint_json_shapes(fp, p.top_shapes);
+    fprintf(fp, ",\"bytes_allocated\":%llu", (unsigned long long)p.bytes_allocated);
+    fprintf(fp, ",\"conversions\":");
+    fprint_json_conversions(fp, p.conversions);
+}
+
+static double get_records_origin(const std::vector<LayerProfile>& records)
+{
+    double origin = records.empty() ? 0 : records[0].start;
+    for (size_t i = 1; i < records.size(); i++)
+    {
+        if (records[i].start < origin)
+            origin = records[i].start;
+    }
+
+    return origin;
+}
+
+int Profiler::save_json(const char* path) const
+{
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+    {
+        NCNN_LOGE("fopen %s failed", path);
+        return -1;
+    }
+
+    const std::vector<LayerProfile> records = this->records();
+    const double origin = get_records_origin(records);
+
+    fprintf(fp, "[\n");
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const LayerProfile& p = records[i];
+
+        fprintf(fp, "{");
+        fprint_json_layer(fp, p);
+        fprintf(fp, ",\"start_ms\":%.3f,\"time_ms\":%.3f,\"thread\":%d}%s\n", p.start - origin, p.end - p.start, p.thread, i + 1 == records.size() ? "" : ",");
+    }
+    fprintf(fp, "]\n");
+
+    fclose(fp);
+
+    return 0;
+}
+
+int Profiler::save_chrome_trace(const char* path) const
+{
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+    {
+        NCNN_LOGE("fopen %s failed", path);
+        return -1;
+    }
+
+    const std::vector<LayerProfile> records = this->records();
+    const double origin = get_records_origin(records);
+
+    // complete events with timestamps in us
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const LayerProfile& p = records[i];
+
+        fprintf(fp, "{\"name\":");
+#if NCNN_STRING
+        fprint_json_string(fp, p.name.empty() ? p.type.c_str() : p.name.c_str());
+        fprintf(fp, ",\"cat\":");
+        fprint_json_string(fp, p.type.c_str());
+#else
+        fprintf(fp, "\"%d\",\"cat\":\"%d\"", p.layer_index, p.typeindex);
+#endif // NCNN_STRING
+        fprintf(fp, ",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", p.thread, (p.start - origin) * 1000, (p.end - p.start) * 1000);
+        fprintf(fp, ",\"args\":{");
+        fprint_json_layer(fp, p);
+        fprintf(fp, "}}%s\n", i + 1 == records.size() ? "" : ",");
+    }
+    fprintf(fp, "]}\n");
+
+    fclose(fp);
+
+    return 0;
+}
+#endif // NCNN_STDIO
+
 #if NCNN_BENCHMARK
 
 void benchmark(const Layer* layer, double start, double end)
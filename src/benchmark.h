@@ -24,6 +24,90 @@ namespace ncnn {
 // get now timestamp in ms
 NCNN_EXPORT double get_current_time();
 
+// bottom blob converted before layer forward
+class NCNN_EXPORT LayoutConversion
+{
+public:
+    // index into the bottoms of the layer
+    int bottom;
+
+    int from_elembits;
+    int from_elempack;
+    int to_elembits;
+    int to_elempack;
+};
+
+// one layer forward recorded by Profiler
+class NCNN_EXPORT LayerProfile
+{
+public:
+    LayerProfile();
+
+    int layer_index;
+    int typeindex;
+#if NCNN_STRING
+    std::string type;
+    std::string name;
+#endif // NCNN_STRING
+
+    // wall clock in ms from get_current_time()
+    double start;
+    double end;
+
+    // recording thread, numbered from 0 in order of first record
+    int thread;
+
+    // kernel path chosen by the layer, null if the layer does not tell
+    const char* kernel;
+
+    // blob shapes, mat headers without data
+    std::vector<Mat> bottom_shapes;
+    std::vector<Mat> top_shapes;
+
+    // blob memory allocated for top blobs and layout conversions
+    // workspace memory is not counted
+    size_t bytes_allocated;
+
+    std::vector<LayoutConversion> conversions;
+};
+
+// runtime per-layer profiler, attach to Extractor with set_profiler
+// recording is thread-safe, one profiler may be shared by many extractors
+class ProfilerPrivate;
+class NCNN_EXPORT Profiler
+{
+public:
+    Profiler();
+    ~Profiler();
+
+    // append one record
+    void record(const LayerProfile& profile);
+
+    // drop all records
+    void clear();
+
+    // copy of the records so far
+    std::vector<LayerProfile> records() const;
+
+#if NCNN_STDIO
+    // write records as a json array
+    // return 0 if success
+    int save_json(const char* path) const;
+
+    // write records in chrome trace event format
+    // open with chrome://tracing or perfetto
+    // return 0 if success
+    int save_chrome_trace(const char* path) const;
+#endif // NCNN_STDIO
+
+private:
+    Profiler(const Profiler&);
+    Profiler& operator=(const Profiler&);
+
+private:
+    ProfilerPrivate* const d;
+};
+
 #if NCNN_BENCHMARK
 
 NCNN_EXPORT void benchmark(const Layer* layer, double start, double end);
@@ -915,6 +915,73 @@ static int get_cpu_support_x86_avx512_fp16()
     return cpu_info[3] & (1u << 23);
 }
 
+#if NCNN_AVX512AMX
+static int get_cpu_support_x86_amx(unsigned int feature_bit)
+{
+    unsigned int cpu_info[4] = {0};
+    x86_cpuid(0, cpu_info);
+
+    int nIds = cpu_info[0];
+    if (nIds < 7)
+        return 0;
+
+    x86_cpuid(1, cpu_info);
+    // check AVX XSAVE OSXSAVE
+    if (!(cpu_info[2] & (1u << 28)) || !(cpu_info[2] & (1u << 26)) || !(cpu_info[2] & (1u << 27)))
+        return 0;
+
+    // check avx512 and amx tile XSAVE enabled by kernel
+    if ((x86_get_xcr0() & 0x600e6) != 0x600e6)
+        return 0;
+
+    x86_cpuid_sublevel(7, 0, cpu_info);
+    // check AMX-TILE
+    if (!(cpu_info[3] & (1u << 24)) || !(cpu_info[3] & (1u << feature_bit)))
+        return 0;
+
+    return 1;
+}
+
+#if defined __ANDROID__ || defined __linux__
+static int request_x86_amx_permission()
+{
+    // linux keeps the tile data state disabled until the process requests it
+    const int ARCH_REQ_XCOMP_PERM = 0x1023;
+    const int XFEATURE_XTILEDATA = 18;
+    return syscall(SYS_arch_prctl, ARCH_REQ_XCOMP_PERM, XFEATURE_XTILEDATA) == 0 ? 1 : 0;
+}
+#endif
+#endif // NCNN_AVX512AMX
+
+static int get_cpu_support_x86_amx_int8()
+{
+#if NCNN_AVX512AMX
+    return get_cpu_support_x86_amx(25);
+#else
+    return 0;
+#endif
+}
+
+static int get_cpu_support_x86_amx_bf16()
+{
+#if NCNN_AVX512AMX
+    return get_cpu_support_x86_amx(22);
+#else
+    return 0;
+#endif
+}
+
+// requested once when the first amx kernel is picked instead of at library load
+static int get_x86_amx_permission()
+{
+#if NCNN_AVX512AMX && (defined __ANDROID__ || defined __linux__)
+    static int permission = request_x86_amx_permission();
+    return permission;
+#else
+    return 1;
+#endif
+}
+
 static int g_cpu_support_x86_avx = get_cpu_support_x86_avx();
 static int g_cpu_support_x86_fma = get_cpu_support_x86_fma();
 static int g_cpu_support_x86_xop = get_cpu_support_x86_xop();
@@ -925,6 +992,8 @@ static int g_cpu_support_x86_avx512 = get_cpu_support_x86_avx512();
 static int g_cpu_support_x86_avx512_vnni = get_cpu_support_x86_avx512_vnni();
 static int g_cpu_support_x86_avx512_bf16 = get_cpu_support_x86_avx512_bf16();
 static int g_cpu_support_x86_avx512_fp16 = get_cpu_support_x86_avx512_fp16();
+static int g_cpu_support_x86_amx_int8 = get_cpu_support_x86_amx_int8();
+static int g_cpu_support_x86_amx_bf16 = get_cpu_support_x86_amx_bf16();
 #else  // defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
 static const int g_cpu_support_x86_avx = 0;
 static const int g_cpu_support_x86_fma = 0;
@@ -936,6 +1005,13 @@ static const int g_cpu_support_x86_avx512 = 0;
 static const int g_cpu_support_x86_avx512_vnni = 0;
 static const int g_cpu_support_x86_avx512_bf16 = 0;
 static const int g_cpu_support_x86_avx512_fp16 = 0;
+static const int g_cpu_support_x86_amx_int8 = 0;
+static const int g_cpu_support_x86_amx_bf16 = 0;
+
+static int get_x86_amx_permission()
+{
+    return 0;
+}
 #endif // defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
 
 int cpu_support_x86_avx()
@@ -988,6 +1064,16 @@ int cpu_support_x86_avx512_fp16()
     return g_cpu_support_x86_avx512_fp16;
 }
 
+int cpu_support_x86_amx_int8()
+{
+    return g_cpu_support_x86_amx_int8 && get_x86_amx_permission();
+}
+
+int cpu_support_x86_amx_bf16()
+{
+    return g_cpu_support_x86_amx_bf16 && get_x86_amx_permission();
+}
+
 int cpu_support_mips_msa()
 {
 #if defined __ANDROID__ || defined __linux__
@@ -1520,7 +1606,7 @@ int get_omp_thread_num()
 
 int get_kmp_blocktime()
 {
-#if defined(_OPENMP) && __clang__
+#if defined(_OPENMP) && (__clang__ || NCNN_SIMPLEOMP)
     return kmp_get_blocktime();
 #else
     return 0;
@@ -1529,7 +1615,7 @@ int get_kmp_blocktime()
 
 void set_kmp_blocktime(int time_ms)
 {
-#if defined(_OPENMP) && __clang__
+#if defined(_OPENMP) && (__clang__ || NCNN_SIMPLEOMP)
     kmp_set_blocktime(time_ms);
 #else
     (void)time_ms;
@@ -92,6 +92,10 @@ NCNN_EXPORT int cpu_support_x86_avx512_vnni();
 NCNN_EXPORT int cpu_support_x86_avx512_bf16();
 // avx512_fp16 = x86 avx512 fp16
 NCNN_EXPORT int cpu_support_x86_avx512_fp16();
+// amx_int8 = x86 amx tile + amx int8
+NCNN_EXPORT int cpu_support_x86_amx_int8();
+// amx_bf16 = x86 amx tile + amx bf16
+NCNN_EXPORT int cpu_support_x86_amx_bf16();
 
 // msa = mips mas
 NCNN_EXPORT int cpu_support_mips_msa();
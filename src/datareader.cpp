@@ -16,6 +16,20 @@
 
 #include <string.h>
 
+#if NCNN_STDIO
+#if defined _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#endif // NCNN_STDIO
+
 namespace ncnn {
 
 DataReader::DataReader()
@@ -85,6 +99,134 @@ size_t DataReaderFromStdio::read(void* buf, size_t size) const
 {
     return fread(buf, 1, size, d->fp);
 }
+
+class DataReaderFromMmapPrivate
+{
+public:
+    DataReaderFromMmapPrivate()
+        : data(0), size(0), offset(0)
+    {
+    }
+    unsigned char* data;
+    size_t size;
+    mutable size_t offset;
+};
+
+DataReaderFromMmap::DataReaderFromMmap(const char* filepath)
+    : DataReader(), d(new DataReaderFromMmapPrivate)
+{
+#if defined _WIN32
+    HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        NCNN_LOGE("open %s failed", filepath);
+        return;
+    }
+
+    LARGE_INTEGER filesize;
+    if (!GetFileSizeEx(file, &filesize) || filesize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return;
+    }
+
+    // the mapping object is kept alive by the view
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        NCNN_LOGE("CreateFileMapping %s failed", filepath);
+        return;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+    {
+        NCNN_LOGE("MapViewOfFile %s failed", filepath);
+        return;
+    }
+
+    d->data = (unsigned char*)data;
+    d->size = (size_t)filesize.QuadPart;
+#else
+    int fd = open(filepath, O_RDONLY);
+    if (fd == -1)
+    {
+        NCNN_LOGE("open %s failed", filepath);
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return;
+    }
+
+    // private writable mapping, pages stay shared with the page cache until written
+    void* data = mmap(0, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        NCNN_LOGE("mmap %s failed", filepath);
+        return;
+    }
+
+    d->data = (unsigned char*)data;
+    d->size = (size_t)st.st_size;
+#endif
+}
+
+DataReaderFromMmap::~DataReaderFromMmap()
+{
+    if (d->data)
+    {
+#if defined _WIN32
+        UnmapViewOfFile(d->data);
+#else
+        munmap(d->data, d->size);
+#endif
+    }
+
+    delete d;
+}
+
+DataReaderFromMmap::DataReaderFromMmap(const DataReaderFromMmap&)
+    : d(0)
+{
+}
+
+DataReaderFromMmap& DataReaderFromMmap::operator=(const DataReaderFromMmap&)
+{
+    return *this;
+}
+
+bool DataReaderFromMmap::mapped() const
+{
+    return d->data != 0;
+}
+
+size_t DataReaderFromMmap::read(void* buf, size_t size) const
+{
+    size_t remain = d->size - d->offset;
+    if (size > remain)
+        size = remain;
+
+    memcpy(buf, d->data + d->offset, size);
+    d->offset += size;
+    return size;
+}
+
+size_t DataReaderFromMmap::reference(size_t size, const void** buf) const
+{
+    if (size > d->size - d->offset)
+        return 0;
+
+    *buf = d->data + d->offset;
+    d->offset += size;
+    return size;
+}
 #endif // NCNN_STDIO
 
 class DataReaderFromMemoryPrivate
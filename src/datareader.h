@@ -70,6 +70,32 @@ private:
 private:
     DataReaderFromStdioPrivate* const d;
 };
+
+class DataReaderFromMmapPrivate;
+class NCNN_EXPORT DataReaderFromMmap : public DataReader
+{
+public:
+    // map the whole file copy-on-write
+    // referenced data points into the mapping and stays valid until the reader is destroyed
+    // so the reader must outlive the net loaded from it
+    // weights are referenced at their file offsets, which are only 4-byte aligned
+    // the file must not be truncated or rewritten while mapped, touching a lost page raises SIGBUS
+    explicit DataReaderFromMmap(const char* filepath);
+    virtual ~DataReaderFromMmap();
+
+    // return true if the file has been mapped
+    bool mapped() const;
+
+    virtual size_t read(void* buf, size_t size) const;
+    virtual size_t reference(size_t size, const void** buf) const;
+
+private:
+    DataReaderFromMmap(const DataReaderFromMmap&);
+    DataReaderFromMmap& operator=(const DataReaderFromMmap&);
+
+private:
+    DataReaderFromMmapPrivate* const d;
+};
 #endif // NCNN_STDIO
 
 class DataReaderFromMemoryPrivate;
@@ -52,6 +52,8 @@ Layer::Layer()
 
     support_reserved_00 = false;
 
+    state_count = 0;
+
     typeindex = -1;
 
 #if NCNN_VULKAN
@@ -198,6 +200,51 @@ int Layer::forward_inplace(VkImageMat& /*bottom_top_blob*/, VkCompute& /*cmd*/,
 }
 #endif // NCNN_VULKAN
 
+int Layer::save_pipeline(std::vector<Mat>& /*pipeline_data*/) const
+{
+    return -1;
+}
+
+int Layer::load_pipeline(const std::vector<Mat>& /*pipeline_data*/, const Option& /*opt*/)
+{
+    return -1;
+}
+
+int Layer::forward_batch(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    top_blobs.resize(bottom_blobs.size());
+    for (size_t i = 0; i < bottom_blobs.size(); i++)
+    {
+        int ret = forward(bottom_blobs[i], top_blobs[i], opt);
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+int Layer::forward_batch(const std::vector<std::vector<Mat> >& bottom_blobs, std::vector<std::vector<Mat> >& top_blobs, const Option& opt) const
+{
+    for (size_t i = 0; i < bottom_blobs.size(); i++)
+    {
+        int ret = forward(bottom_blobs[i], top_blobs[i], opt);
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+const char* Layer::kernel_path(const Mat& /*bottom_blob*/, const Option& /*opt*/) const
+{
+    return 0;
+}
+
+int Layer::trim_states(std::vector<Mat>& /*states*/, int /*len*/) const
+{
+    return -1;
+}
+
 #include "layer_registry.h"
 
 static const int layer_registry_entry_count = sizeof(layer_registry) / sizeof(layer_registry_entry);
@@ -96,10 +96,12 @@ public:
     bool support_reserved_7;
     bool support_reserved_8;
     bool support_reserved_9;
-    bool support_reserved_10;
-    bool support_reserved_11;
-    bool support_reserved_12;
-    bool support_reserved_13;
+
+    // number of state blobs carried from one forward to the next of the same extractor
+    // they follow the graph blobs in bottom_blobs and top_blobs
+    // and the bottom ones are empty mats on the first forward
+    // occupies the storage of the former support_reserved_10 to support_reserved_13
+    int state_count;
 
 public:
     // implement inference
@@ -143,6 +145,40 @@ public:
     const VulkanDevice* vkdev;
 #endif // NCNN_VULKAN
 
+public:
+    // the virtuals below come after all the others so that the vtable slots of layers
+    // built against older headers keep their offsets, append new ones at the end
+
+    // export the transformed weights made by create_pipeline for the cpu pipeline cache
+    // return 0 if success, non-zero if the layer has nothing to cache
+    virtual int save_pipeline(std::vector<Mat>& pipeline_data) const;
+
+    // setup from transformed weights exported by save_pipeline instead of create_pipeline
+    // return 0 if success, non-zero to fall back to create_pipeline
+    virtual int load_pipeline(const std::vector<Mat>& pipeline_data, const Option& opt);
+
+    // implement batched inference for one_blob_only layer
+    // bottom_blobs and top_blobs hold one mat for each sample
+    // the default implementation runs forward on each sample in turn
+    // return 0 if success
+    virtual int forward_batch(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
+
+    // implement batched inference for layer with multiple blobs or states
+    // bottom_blobs and top_blobs hold the blob list of each sample, top lists are sized by the caller
+    // the default implementation runs forward on each sample in turn
+    // return 0 if success
+    virtual int forward_batch(const std::vector<std::vector<Mat> >& bottom_blobs, std::vector<std::vector<Mat> >& top_blobs, const Option& opt) const;
+
+    // name of the kernel forward runs on this input, for profiling
+    // bottom_blob is the first bottom blob after layout conversion
+    // return null if the layer has nothing to tell
+    virtual const char* kernel_path(const Mat& bottom_blob, const Option& opt) const;
+
+    // keep the first len steps of the state blobs produced by forward
+    // for rolling back an incremental decoder
+    // return 0 if success
+    virtual int trim_states(std::vector<Mat>& states, int len) const;
+
 public:
     // custom user data
     void* userdata;
@@ -926,7 +926,7 @@ int GRU_arm::forward_fp16s(const std::vector<Mat>& bottom_blobs, std::vector<Mat
 
     Mat hidden;
     Allocator* hidden_allocator = top_blobs.size() == 2 ? opt.blob_allocator : opt.workspace_allocator;
-    if (bottom_blobs.size() == 2)
+    if (bottom_blobs.size() == 2 && !bottom_blobs[1].empty())
     {
         Option opt_cast = opt;
         opt_cast.blob_allocator = hidden_allocator;
@@ -1060,7 +1060,7 @@ int GRU_arm::forward_fp16sa(const std::vector<Mat>& bottom_blobs, std::vector<Ma
 
     Mat hidden;
     Allocator* hidden_allocator = top_blobs.size() == 2 ? opt.blob_allocator : opt.workspace_allocator;
-    if (bottom_blobs.size() == 2)
+    if (bottom_blobs.size() == 2 && !bottom_blobs[1].empty())
     {
         Option opt_cast = opt;
         opt_cast.blob_allocator = hidden_allocator;
@@ -33,6 +33,31 @@ MultiHeadAttention_arm::MultiHeadAttention_arm()
 
 int MultiHeadAttention_arm::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
 {
+    if (kv_cache)
+    {
+        // the carried xk and xv states follow the inputs in the reference layout,
+        // run the reference implementation on unpacked inputs
+        Option opt_unpack = opt;
+        opt_unpack.blob_allocator = opt.workspace_allocator;
+
+        std::vector<Mat> bottom_blobs_unpacked(bottom_blobs.size());
+        for (size_t i = 0; i < bottom_blobs.size(); i++)
+        {
+            // the states are empty on the first step
+            if (bottom_blobs[i].empty() || bottom_blobs[i].elempack == 1)
+            {
+                bottom_blobs_unpacked[i] = bottom_blobs[i];
+                continue;
+            }
+
+            convert_packing(bottom_blobs[i], bottom_blobs_unpacked[i], 1, opt_unpack);
+            if (bottom_blobs_unpacked[i].empty())
+                return -100;
+        }
+
+        return MultiHeadAttention::forward(bottom_blobs_unpacked, top_blobs, opt);
+    }
+
     const Mat& q_blob = bottom_blobs[0];
     const Mat& k_blob = bottom_blobs.size() == 1 ? q_blob : bottom_blobs[1];
     const Mat& v_blob = bottom_blobs.size() == 1 ? q_blob : bottom_blobs[2];
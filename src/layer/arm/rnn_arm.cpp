@@ -413,7 +413,7 @@ int RNN_arm::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top
 
     Mat hidden;
     Allocator* hidden_allocator = top_blobs.size() == 2 ? opt.blob_allocator : opt.workspace_allocator;
-    if (bottom_blobs.size() == 2)
+    if (bottom_blobs.size() == 2 && !bottom_blobs[1].empty())
     {
         hidden = bottom_blobs[1].clone(hidden_allocator);
     }
@@ -804,7 +804,7 @@ int RNN_arm::forward_bf16s(const std::vector<Mat>& bottom_blobs, std::vector<Mat
 
     Mat hidden;
     Allocator* hidden_allocator = top_blobs.size() == 2 ? opt.blob_allocator : opt.workspace_allocator;
-    if (bottom_blobs.size() == 2)
+    if (bottom_blobs.size() == 2 && !bottom_blobs[1].empty())
     {
         Option opt_cast = opt;
         opt_cast.blob_allocator = hidden_allocator;
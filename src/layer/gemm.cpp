@@ -28,14 +28,46 @@ int Gemm::load_param(const ParamDict& pd)
     beta = pd.get(1, 1.f);
     transA = pd.get(2, 0);
     transB = pd.get(3, 0);
+    constantA = pd.get(4, 0);
+    constantB = pd.get(5, 0);
+    constantM = pd.get(7, 0);
+    constantN = pd.get(8, 0);
+    constantK = pd.get(9, 0);
+    output_N1M = pd.get(11, 0);
+    output_elempack = pd.get(12, 0);
+
+    return 0;
+}
+
+int Gemm::load_model(const ModelBin& mb)
+{
+    if (constantA == 1)
+    {
+        if (transA == 0)
+            A_data = mb.load(constantK, constantM, 0);
+        else
+            A_data = mb.load(constantM, constantK, 0);
+        if (A_data.empty())
+            return -100;
+    }
+
+    if (constantB == 1)
+    {
+        if (transB == 0)
+            B_data = mb.load(constantN, constantK, 0);
+        else
+            B_data = mb.load(constantK, constantN, 0);
+        if (B_data.empty())
+            return -100;
+    }
 
     return 0;
 }
 
 int Gemm::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
 {
-    const Mat& A0 = bottom_blobs[0];
-    const Mat& B0 = bottom_blobs[1];
+    const Mat& A0 = constantA ? A_data : bottom_blobs[0];
+    const Mat& B0 = constantB ? B_data : bottom_blobs[constantA ? 0 : 1];
 
     size_t elemsize = A0.elemsize;
 
@@ -83,13 +115,14 @@ int Gemm::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_bl
     int K = A.w; // assert A.w == B.w
     int N = B.h;
 
-    bool has_C = bottom_blobs.size() == 3;
+    const size_t C_index = (constantA ? 0 : 1) + (constantB ? 0 : 1);
+    bool has_C = bottom_blobs.size() == C_index + 1;
 
     const float* ptrC = 0;
     int broadcast_type_C = 0;
     if (has_C)
     {
-        const Mat& C = bottom_blobs[2];
+        const Mat& C = bottom_blobs[C_index];
 
         ptrC = C;
 
@@ -126,16 +159,21 @@ int Gemm::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_bl
         }
     }
 
+    // output_elempack only tells the optimized implementations how to pack the rows
     Mat& top_blob = top_blobs[0];
-    top_blob.create(N, M, elemsize, opt.blob_allocator);
+    if (output_N1M)
+        top_blob.create(N, 1, M, elemsize, opt.blob_allocator);
+    else
+        top_blob.create(N, M, elemsize, opt.blob_allocator);
     if (top_blob.empty())
         return -100;
 
-    float* outptr = top_blob;
     for (int i = 0; i < M; i++)
     {
         const float* ptrA = A.row(i);
 
+        float* outptr = output_N1M ? top_blob.channel(i) : top_blob.row(i);
+
         for (int j = 0; j < N; j++)
         {
             const float* ptrB = B.row(j);
@@ -26,6 +26,8 @@ public:
 
     virtual int load_param(const ParamDict& pd);
 
+    virtual int load_model(const ModelBin& mb);
+
     virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
 
 public:
@@ -33,6 +35,22 @@ public:
     float beta;
     int transA;
     int transB;
+
+    int constantA;
+    int constantB;
+    int constantM;
+    int constantN;
+    int constantK;
+
+    // output as N x 1 x M with the rows packed by output_elempack
+    int output_N1M;
+    int output_elempack;
+
+    // constant A, M x K when transA == 0, K x M when transA == 1
+    Mat A_data;
+
+    // constant B, K x N when transB == 0, N x K when transB == 1
+    Mat B_data;
 };
 
 } // namespace ncnn
@@ -29,6 +29,18 @@ int LSTM::load_param(const ParamDict& pd)
     num_output = pd.get(0, 0);
     weight_data_size = pd.get(1, 0);
     direction = pd.get(2, 0);
+    streaming = pd.get(10, 0);
+
+    // a reverse pass needs the frames of the later chunks
+    if (streaming && direction != 0)
+    {
+        NCNN_LOGE("LSTM streaming supports forward direction only");
+        return -1;
+    }
+
+    // the extractor carries hidden and cell across calls
+    state_count = streaming ? 2 : 0;
+
     return 0;
 }
 
@@ -239,7 +251,8 @@ int LSTM::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_bl
     Mat hidden;
     Mat cell;
     Allocator* hidden_cell_allocator = top_blobs.size() == 3 ? opt.blob_allocator : opt.workspace_allocator;
-    if (bottom_blobs.size() == 3)
+    // carried states are empty on the first forward of a stream
+    if (bottom_blobs.size() == 3 && !bottom_blobs[1].empty())
     {
         hidden = bottom_blobs[1].clone(hidden_cell_allocator);
         cell = bottom_blobs[2].clone(hidden_cell_allocator);
@@ -15,6 +15,7 @@
 #include "multiheadattention.h"
 
 #include <float.h>
+#include <string.h>
 
 namespace ncnn {
 
@@ -27,6 +28,10 @@ int MultiHeadAttention::load_param(const ParamDict& pd)
     embed_dim = pd.get(0, 0);
     num_head = pd.get(1, 1);
     weight_data_size = pd.get(2, 0);
+    kv_cache = pd.get(3, 0);
+
+    // the projected k and v of all past positions
+    state_count = kv_cache ? 2 : 0;
 
     return 0;
 }
@@ -71,120 +76,128 @@ int MultiHeadAttention::load_model(const ModelBin& mb)
 // refers to https://pytorch.org/docs/stable/generated/torch.nn.MultiheadAttention.html
 int MultiHeadAttention::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
 {
+    // in kv cache mode the cached xk and xv follow q k v
+    const int input_count = (int)bottom_blobs.size() - (kv_cache ? 2 : 0);
+
     const Mat& q_blob = bottom_blobs[0];
-    const Mat& k_blob = bottom_blobs.size() == 1 ? q_blob : bottom_blobs[1];
-    const Mat& v_blob = bottom_blobs.size() == 1 ? q_blob : bottom_blobs[2];
+    const Mat& k_blob = input_count == 1 ? q_blob : bottom_blobs[1];
+    const Mat& v_blob = input_count == 1 ? q_blob : bottom_blobs[2];
 
-    const int seqlen = q_blob.h;
+    const int src_seqlen = q_blob.h;
+    const int past_seqlen = kv_cache ? bottom_blobs[input_count].h : 0;
+    const int dst_seqlen = past_seqlen + k_blob.h;
     const int embed_dim_per_head = embed_dim / num_head;
 
     Mat& top_blob = top_blobs[0];
-    top_blob.create(embed_dim, seqlen, 4u, opt.blob_allocator);
+    top_blob.create(embed_dim, src_seqlen, 4u, opt.blob_allocator);
     if (top_blob.empty())
         return -1;
 
-    Mat xq(embed_dim_per_head, seqlen, num_head, 4u, opt.workspace_allocator);
-    Mat xk(embed_dim_per_head, seqlen, num_head, 4u, opt.workspace_allocator);
-    Mat xv(seqlen, embed_dim_per_head, num_head, 4u, opt.workspace_allocator);
+    // xk and xv of all positions, the cached past ones first
+    // they become the new cache in kv cache mode
+    Mat xk;
+    Mat xv;
+    if (kv_cache)
+    {
+        if (grow_kv_cache(bottom_blobs[input_count], dst_seqlen, xk) != 0 || grow_kv_cache(bottom_blobs[input_count + 1], dst_seqlen, xv) != 0)
+            return -100;
+    }
+    else
+    {
+        xk.create(embed_dim, dst_seqlen, 4u, opt.workspace_allocator);
+        xv.create(embed_dim, dst_seqlen, 4u, opt.workspace_allocator);
+        if (xk.empty() || xv.empty())
+            return -100;
+    }
+
+    Mat xq(embed_dim_per_head, src_seqlen, num_head, 4u, opt.workspace_allocator);
 
-    Mat xqk(seqlen, seqlen, num_head, 4u, opt.workspace_allocator);
+    Mat xqk(dst_seqlen, src_seqlen, num_head, 4u, opt.workspace_allocator);
 
-    Mat xqkv(embed_dim_per_head, num_head, seqlen, 4u, opt.workspace_allocator);
+    Mat xqkv(embed_dim_per_head, num_head, src_seqlen, 4u, opt.workspace_allocator);
 
     const float inv_sqrt_embed_dim_per_head = 1.f / sqrt(embed_dim_per_head);
 
+    // xk = affine(k)
+    // xv = affine(v)
     #pragma omp parallel for num_threads(opt.num_threads)
-    for (int q = 0; q < num_head; q++)
+    for (int i = past_seqlen; i < dst_seqlen; i++)
     {
-        // xq = affine(q) * inv_sqrt_embed_dim_per_head
+        float* outptr_k = xk.row(i);
+        float* outptr_v = xv.row(i);
+
+        for (int j = 0; j < embed_dim; j++)
         {
-            Mat outm = xq.channel(q);
+            const float* ptr = k_blob.row(i - past_seqlen);
+            const float* kptr = (const float*)k_weight_data + embed_dim * j;
 
-            for (int i = 0; i < seqlen; i++)
+            float sum = k_bias_data[j];
+            for (int k = 0; k < embed_dim; k++)
             {
-                float* outptr = outm.row(i);
-
-                for (int j = 0; j < embed_dim_per_head; j++)
-                {
-                    const float* ptr = q_blob.row(i);
-                    const float* kptr = (const float*)q_weight_data + embed_dim * (q * embed_dim_per_head + j);
-
-                    float sum = q_bias_data[q * embed_dim_per_head + j];
-                    for (int k = 0; k < embed_dim; k++)
-                    {
-                        sum += *ptr++ * *kptr++;
-                    }
-
-                    outptr[j] = sum * inv_sqrt_embed_dim_per_head;
-                }
+                sum += *ptr++ * *kptr++;
             }
+
+            outptr_k[j] = sum;
         }
 
-        // xk = affine(k)
+        for (int j = 0; j < embed_dim; j++)
         {
-            Mat outm = xk.channel(q);
+            const float* ptr = v_blob.row(i - past_seqlen);
+            const float* kptr = (const float*)v_weight_data + embed_dim * j;
 
-            for (int i = 0; i < seqlen; i++)
+            float sum = v_bias_data[j];
+            for (int k = 0; k < embed_dim; k++)
             {
-                float* outptr = outm.row(i);
-
-                for (int j = 0; j < embed_dim_per_head; j++)
-                {
-                    const float* ptr = k_blob.row(i);
-                    const float* kptr = (const float*)k_weight_data + embed_dim * (q * embed_dim_per_head + j);
-
-                    float sum = k_bias_data[q * embed_dim_per_head + j];
-                    for (int k = 0; k < embed_dim; k++)
-                    {
-                        sum += *ptr++ * *kptr++;
-                    }
-
-                    outptr[j] = sum;
-                }
+                sum += *ptr++ * *kptr++;
             }
+
+            outptr_v[j] = sum;
         }
+    }
 
-        // xv = affine(v)
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < num_head; q++)
+    {
+        // xq = affine(q) * inv_sqrt_embed_dim_per_head
         {
-            Mat outm = xv.channel(q);
+            Mat outm = xq.channel(q);
 
-            for (int i = 0; i < embed_dim_per_head; i++)
+            for (int i = 0; i < src_seqlen; i++)
             {
-                for (int j = 0; j < seqlen; j++)
+                float* outptr = outm.row(i);
+
+                for (int j = 0; j < embed_dim_per_head; j++)
                 {
-                    const float* ptr = v_blob.row(j);
-                    const float* kptr = (const float*)v_weight_data + embed_dim * (q * embed_dim_per_head + i);
+                    const float* ptr = q_blob.row(i);
+                    const float* kptr = (const float*)q_weight_data + embed_dim * (q * embed_dim_per_head + j);
 
-                    float sum = v_bias_data[q * embed_dim_per_head + i];
+                    float sum = q_bias_data[q * embed_dim_per_head + j];
                     for (int k = 0; k < embed_dim; k++)
                     {
                         sum += *ptr++ * *kptr++;
                     }
 
-                    float* outptr = outm.row(i);
-
-                    outptr[j] = sum;
+                    outptr[j] = sum * inv_sqrt_embed_dim_per_head;
                 }
             }
         }
 
         // xqk = xq * xk
-        // xq  (embed_dim_per_head, seqlen)
-        // xk  (embed_dim_per_head, seqlen)
+        // xq  (embed_dim_per_head, src_seqlen)
+        // xk  (embed_dim, dst_seqlen)
         {
             const Mat xqm = xq.channel(q);
-            const Mat xkm = xk.channel(q);
 
             Mat outm = xqk.channel(q);
 
-            for (int i = 0; i < seqlen; i++)
+            for (int i = 0; i < src_seqlen; i++)
             {
                 float* outptr = outm.row(i);
 
-                for (int j = 0; j < seqlen; j++)
+                for (int j = 0; j < dst_seqlen; j++)
                 {
                     const float* qptr = xqm.row(i);
-                    const float* kptr = xkm.row(j);
+                    const float* kptr = xk.row(j) + q * embed_dim_per_head;
 
                     float sum = 0.f;
                     for (int k = 0; k < embed_dim_per_head; k++)
@@ -198,54 +211,60 @@ int MultiHeadAttention::forward(const std::vector<Mat>& bottom_blobs, std::vecto
         }
 
         // softmax(xqk)
+        // causal in kv cache mode, query i attends to the keys up to its own position past_seqlen + i
         {
             Mat outm = xqk.channel(q);
 
-            for (int i = 0; i < seqlen; i++)
+            for (int i = 0; i < src_seqlen; i++)
             {
                 float* ptr = outm.row(i);
 
+                const int kv_len = kv_cache ? std::min(dst_seqlen, past_seqlen + i + 1) : dst_seqlen;
+
                 float max = -FLT_MAX;
-                for (int j = 0; j < seqlen; j++)
+                for (int j = 0; j < kv_len; j++)
                 {
                     max = std::max(max, ptr[j]);
                 }
 
                 float sum = 0.f;
-                for (int j = 0; j < seqlen; j++)
+                for (int j = 0; j < kv_len; j++)
                 {
                     ptr[j] = (float)(exp(ptr[j] - max));
                     sum += ptr[j];
                 }
 
-                for (int j = 0; j < seqlen; j++)
+                for (int j = 0; j < kv_len; j++)
                 {
                     ptr[j] /= sum;
                 }
+
+                for (int j = kv_len; j < dst_seqlen; j++)
+                {
+                    ptr[j] = 0.f;
+                }
             }
         }
 
         // xqkv = xqk * xv
-        // xqk (seqlen, seqlen)
-        // xv  (seqlen, embed_dim_per_head)
-        // out (embed_dim_per_head, num_head, seqlen)
+        // xqk (dst_seqlen, src_seqlen)
+        // xv  (embed_dim, dst_seqlen)
+        // out (embed_dim_per_head, num_head, src_seqlen)
         {
             const Mat xqkm = xqk.channel(q);
-            const Mat xvm = xv.channel(q);
 
-            for (int i = 0; i < seqlen; i++)
+            for (int i = 0; i < src_seqlen; i++)
             {
                 float* outptr = xqkv.channel(i).row(q);
 
                 for (int j = 0; j < embed_dim_per_head; j++)
                 {
                     const float* qkptr = xqkm.row(i);
-                    const float* vptr = xvm.row(j);
 
                     float sum = 0.f;
-                    for (int k = 0; k < seqlen; k++)
+                    for (int k = 0; k < dst_seqlen; k++)
                     {
-                        sum += *qkptr++ * *vptr++;
+                        sum += *qkptr++ * xv.row(k)[q * embed_dim_per_head + j];
                     }
 
                     outptr[j] = sum;
@@ -255,9 +274,9 @@ int MultiHeadAttention::forward(const std::vector<Mat>& bottom_blobs, std::vecto
     }
 
     // out = affine(xqkv)
-    // xqkv  (embed_dim, seqlen)
+    // xqkv  (embed_dim, src_seqlen)
     #pragma omp parallel for num_threads(opt.num_threads)
-    for (int i = 0; i < seqlen; i++)
+    for (int i = 0; i < src_seqlen; i++)
     {
         float* outptr = top_blob.row(i);
 
@@ -276,6 +295,63 @@ int MultiHeadAttention::forward(const std::vector<Mat>& bottom_blobs, std::vecto
         }
     }
 
+    if (kv_cache)
+    {
+        top_blobs[1] = xk;
+        top_blobs[2] = xv;
+    }
+
+    return 0;
+}
+
+int MultiHeadAttention::trim_states(std::vector<Mat>& states, int len) const
+{
+    // states are xk and xv, one row per position
+    for (size_t i = 0; i < states.size(); i++)
+    {
+        Mat& m = states[i];
+        if (m.h <= len)
+            continue;
+
+        if (len <= 0)
+        {
+            m.release();
+            continue;
+        }
+
+        // the dropped rows become spare capacity for the next positions
+        m.h = len;
+    }
+
+    return 0;
+}
+
+int MultiHeadAttention::grow_kv_cache(const Mat& past, int dst_seqlen, Mat& cache) const
+{
+    // the extractor owns its states exclusively, so the spare rows can be written in place
+    if (!past.empty() && past.refcount && (size_t)embed_dim * dst_seqlen <= past.cstep)
+    {
+        cache = past;
+        cache.h = dst_seqlen;
+        return 0;
+    }
+
+    const int past_seqlen = past.empty() ? 0 : past.h;
+    const int capacity = std::max(dst_seqlen, past.empty() ? 0 : (int)(past.cstep / embed_dim) * 2);
+
+    // states outlive the inference, keep them on the default allocator
+    Mat m(embed_dim, capacity, 4u, (Allocator*)0);
+    if (m.empty())
+        return -100;
+
+    if (past_seqlen > 0)
+    {
+        memcpy(m, past, embed_dim * past_seqlen * sizeof(float));
+    }
+
+    // cstep keeps the capacity
+    cache = m;
+    cache.h = dst_seqlen;
     return 0;
 }
 
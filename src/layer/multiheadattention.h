@@ -30,10 +30,18 @@ public:
 
     virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
 
+    virtual int trim_states(std::vector<Mat>& states, int len) const;
+
+protected:
+    // make cache hold dst_seqlen rows of embed_dim with the past rows first
+    // the spare rows of past are filled in place and the capacity doubles when it runs out
+    int grow_kv_cache(const Mat& past, int dst_seqlen, Mat& cache) const;
+
 public:
     int embed_dim;
     int num_head;
     int weight_data_size;
+    int kv_cache;
 
     Mat q_weight_data;
     Mat q_bias_data;
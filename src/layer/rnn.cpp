@@ -29,6 +29,18 @@ int RNN::load_param(const ParamDict& pd)
     num_output = pd.get(0, 0);
     weight_data_size = pd.get(1, 0);
     direction = pd.get(2, 0);
+    streaming = pd.get(10, 0);
+
+    // a reverse pass needs the frames of the later chunks
+    if (streaming && direction != 0)
+    {
+        NCNN_LOGE("RNN streaming supports forward direction only");
+        return -1;
+    }
+
+    // the extractor carries hidden across calls
+    state_count = streaming ? 1 : 0;
+
     return 0;
 }
 
@@ -176,7 +188,8 @@ int RNN::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blo
 
     Mat hidden;
     Allocator* hidden_allocator = top_blobs.size() == 2 ? opt.blob_allocator : opt.workspace_allocator;
-    if (bottom_blobs.size() == 2)
+    // carried states are empty on the first forward of a stream
+    if (bottom_blobs.size() == 2 && !bottom_blobs[1].empty())
     {
         hidden = bottom_blobs[1].clone(hidden_allocator);
     }
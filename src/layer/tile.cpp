@@ -143,9 +143,9 @@ int Tile::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) cons
         if (outdims == 4)
             top_blob.create(w * repeat_w, h * repeat_h, d * repeat_d, channels * repeat_c, elemsize, opt.blob_allocator);
     }
-    else // all ones
+    else // all ones or repeat d only
     {
-        if (repeats_num == 0 || dims == repeats_num)
+        if ((repeats_num == 0 || dims == repeats_num) && repeat_w == 1 && repeat_h == 1 && repeat_d == 1)
         {
             top_blob = bottom_blob;
             return 0;
@@ -0,0 +1,207 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#include "convolution3d_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX__
+#include <immintrin.h>
+#endif
+#endif // __SSE2__
+
+#include "x86_activation.h"
+#include "x86_usability.h"
+
+namespace ncnn {
+
+#include "convolution_sgemm.h"
+
+#if __SSE2__
+#include "convolution_sgemm_pack4.h"
+#include "convolution_sgemm_pack1to4.h"
+#include "convolution_sgemm_pack4to1.h"
+
+#if __AVX__
+#include "convolution_sgemm_pack8.h"
+#include "convolution_sgemm_pack4to8.h"
+#include "convolution_sgemm_pack1to8.h"
+#include "convolution_sgemm_pack8to4.h"
+#include "convolution_sgemm_pack8to1.h"
+
+#if __AVX512F__
+#include "convolution_sgemm_pack16.h"
+#include "convolution_sgemm_pack8to16.h"
+#include "convolution_sgemm_pack4to16.h"
+#include "convolution_sgemm_pack1to16.h"
+#include "convolution_sgemm_pack16to8.h"
+#include "convolution_sgemm_pack16to4.h"
+#include "convolution_sgemm_pack16to1.h"
+#endif // __AVX512F__
+#endif // __AVX__
+#endif // __SSE2__
+
+#include "convolution_sgemm_packed.h"
+
+Convolution3D_x86::Convolution3D_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+
+    activation = 0;
+}
+
+int Convolution3D_x86::create_pipeline(const Option& opt)
+{
+    activation = create_activation_layer(activation_type, activation_params, opt);
+
+    const int maxk = kernel_w * kernel_h * kernel_d;
+    const int num_input = weight_data_size / maxk / num_output;
+
+    int elempack = 1;
+    int out_elempack = 1;
+#if __SSE2__
+    if (opt.use_packing_layout)
+    {
+#if __AVX512F__
+        elempack = num_input % 16 == 0 ? 16 : num_input % 8 == 0 ? 8 : num_input % 4 == 0 ? 4 : 1;
+        out_elempack = num_output % 16 == 0 ? 16 : num_output % 8 == 0 ? 8 : num_output % 4 == 0 ? 4 : 1;
+#elif __AVX__
+        elempack = num_input % 8 == 0 ? 8 : num_input % 4 == 0 ? 4 : 1;
+        out_elempack = num_output % 8 == 0 ? 8 : num_output % 4 == 0 ? 4 : 1;
+#else
+        elempack = num_input % 4 == 0 ? 4 : 1;
+        out_elempack = num_output % 4 == 0 ? 4 : 1;
+#endif
+    }
+#endif // __SSE2__
+
+    // the volumetric taps flatten into maxk, the same layout the 2d im2col kernels expect
+    convolution_im2col_sgemm_transform_kernel_packed_sse(weight_data, weight_data_tm, num_input, num_output, maxk, elempack, out_elempack);
+
+    if (opt.lightmode)
+    {
+        weight_data.release();
+    }
+
+    return 0;
+}
+
+int Convolution3D_x86::destroy_pipeline(const Option& opt)
+{
+    if (activation)
+    {
+        activation->destroy_pipeline(opt);
+        delete activation;
+        activation = 0;
+    }
+
+    return 0;
+}
+
+int Convolution3D_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    size_t elemsize = bottom_blob.elemsize;
+    int elempack = bottom_blob.elempack;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+    const int kernel_extent_d = dilation_d * (kernel_d - 1) + 1;
+
+    Mat bottom_blob_bordered;
+    make_padding(bottom_blob, bottom_blob_bordered, opt);
+    if (bottom_blob_bordered.empty())
+        return -100;
+
+    const int w = bottom_blob_bordered.w;
+    const int h = bottom_blob_bordered.h;
+    const int d = bottom_blob_bordered.d;
+    const int channels = bottom_blob_bordered.c;
+
+    const int outw = (w - kernel_extent_w) / stride_w + 1;
+    const int outh = (h - kernel_extent_h) / stride_h + 1;
+    const int outd = (d - kernel_extent_d) / stride_d + 1;
+    int out_elempack = 1;
+#if __SSE2__
+    if (opt.use_packing_layout)
+    {
+#if __AVX512F__
+        out_elempack = num_output % 16 == 0 ? 16 : num_output % 8 == 0 ? 8 : num_output % 4 == 0 ? 4 : 1;
+#elif __AVX__
+        out_elempack = num_output % 8 == 0 ? 8 : num_output % 4 == 0 ? 4 : 1;
+#else
+        out_elempack = num_output % 4 == 0 ? 4 : 1;
+#endif
+    }
+#endif // __SSE2__
+    size_t out_elemsize = elemsize / elempack * out_elempack;
+
+    top_blob.create(outw, outh, outd, num_output / out_elempack, out_elemsize, out_elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const int size = outw * outh * outd;
+    const int maxk = kernel_w * kernel_h * kernel_d;
+
+    if (maxk == 1 && stride_w == 1 && stride_h == 1 && stride_d == 1)
+    {
+        // pointwise, every channel already is one im2col row
+        Mat bottom_im2col(size, 1, channels, bottom_blob_bordered.data, elemsize, elempack);
+        bottom_im2col.cstep = bottom_blob_bordered.cstep;
+
+        im2col_sgemm_packed_sse(bottom_im2col, top_blob, weight_data_tm, bias_data, opt);
+    }
+    else
+    {
+        // im2col a few output depths at a time so that the columns stay in cache for the sgemm
+        const int plane = outw * outh;
+        const size_t plane_im2col_size = (size_t)plane * maxk * channels * elemsize;
+        const int nn_outd = std::max(std::min((int)(1024 * 1024 / plane_im2col_size), outd), 1);
+
+        Mat bottom_im2col(plane * nn_outd, maxk, channels, elemsize, elempack, opt.workspace_allocator);
+        if (bottom_im2col.empty())
+            return -100;
+
+        for (int z = 0; z < outd; z += nn_outd)
+        {
+            const int outd1 = std::min(z + nn_outd, outd);
+
+            Mat bottom_im2col_z = bottom_im2col;
+            if (outd1 - z != nn_outd)
+            {
+                bottom_im2col_z = Mat(plane * (outd1 - z), maxk, channels, bottom_im2col.data, elemsize, elempack);
+                bottom_im2col_z.cstep = bottom_im2col.cstep;
+            }
+
+            convolution_im2col_3d_packed_sse(bottom_blob_bordered, bottom_im2col_z, outw, outh, z, outd1, kernel_w, kernel_h, kernel_d, dilation_w, dilation_h, dilation_d, stride_w, stride_h, stride_d, opt);
+
+            // the output depths written by this chunk
+            Mat top_blob_z(plane * (outd1 - z), 1, top_blob.c, (float*)top_blob.data + (size_t)plane * z * out_elempack, out_elemsize, out_elempack);
+            top_blob_z.cstep = top_blob.cstep;
+
+            im2col_sgemm_packed_sse(bottom_im2col_z, top_blob_z, weight_data_tm, bias_data, opt);
+        }
+    }
+
+    if (activation)
+    {
+        activation->forward_inplace(top_blob, opt);
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -12,13 +12,13 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
-#if !(__AVX512VNNI__ || __AVXVNNI__ || __AVX2__ || __XOP__)
+#if !(__AVX512VNNI__ || __AVXVNNI__ || __XOP__)
 #if NCNN_RUNTIME_CPU && NCNN_AVX512VNNI && __AVX512F__ && !__AVX512VNNI__
 void conv3x3s1_winograd43_transform_kernel_pack8to4_int8_sse_avx512vnni(const Mat& kernel, Mat& kernel_tm_pack8, int inch, int outch, const Option& opt);
 void conv3x3s1_winograd43_pack8to4_int8_sse_avx512vnni(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel, const Option& opt);
 #endif
 
-#if NCNN_RUNTIME_CPU && NCNN_AVXVNNI && __AVX2__ && !__AVXVNNI__
+#if NCNN_RUNTIME_CPU && NCNN_AVXVNNI && __AVX__ && !__AVXVNNI__
 void conv3x3s1_winograd43_transform_kernel_pack8to4_int8_sse_avxvnni(const Mat& kernel, Mat& kernel_tm_pack8, int inch, int outch, const Option& opt);
 void conv3x3s1_winograd43_pack8to4_int8_sse_avxvnni(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel, const Option& opt);
 #endif
@@ -28,7 +28,7 @@ void conv3x3s1_winograd43_transform_kernel_pack8to4_int8_sse_avx2(const Mat& ker
 void conv3x3s1_winograd43_pack8to4_int8_sse_avx2(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel, const Option& opt);
 #endif
 
-#if NCNN_RUNTIME_CPU && NCNN_XOP && __SSE2__ && !__XOP__
+#if NCNN_RUNTIME_CPU && NCNN_XOP && __SSE2__ && !__AVX2__ && !__XOP__
 void conv3x3s1_winograd43_transform_kernel_pack8to4_int8_sse_xop(const Mat& kernel, Mat& kernel_tm_pack8, int inch, int outch, const Option& opt);
 void conv3x3s1_winograd43_pack8to4_int8_sse_xop(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel, const Option& opt);
 #endif
@@ -36,7 +36,7 @@ void conv3x3s1_winograd43_pack8to4_int8_sse_xop(const Mat& bottom_blob, Mat& top
 
 static void conv3x3s1_winograd43_transform_kernel_pack8to4_int8_sse(const Mat& kernel, Mat& kernel_tm_pack8, int inch, int outch, const Option& opt)
 {
-#if !(__AVX512VNNI__ || __AVXVNNI__ || __AVX2__ || __XOP__)
+#if !(__AVX512VNNI__ || __AVXVNNI__ || __XOP__)
 #if NCNN_RUNTIME_CPU && NCNN_AVX512VNNI && __AVX512F__ && !__AVX512VNNI__
     if (ncnn::cpu_support_x86_avx512_vnni())
     {
@@ -45,7 +45,7 @@ static void conv3x3s1_winograd43_transform_kernel_pack8to4_int8_sse(const Mat& k
     }
 #endif
 
-#if NCNN_RUNTIME_CPU && NCNN_AVXVNNI && __AVX2__ && !__AVXVNNI__
+#if NCNN_RUNTIME_CPU && NCNN_AVXVNNI && __AVX__ && !__AVXVNNI__
     if (ncnn::cpu_support_x86_avx_vnni())
     {
         conv3x3s1_winograd43_transform_kernel_pack8to4_int8_sse_avxvnni(kernel, kernel_tm_pack8, inch, outch, opt);
@@ -61,7 +61,7 @@ static void conv3x3s1_winograd43_transform_kernel_pack8to4_int8_sse(const Mat& k
     }
 #endif
 
-#if NCNN_RUNTIME_CPU && NCNN_XOP && __SSE2__ && !__XOP__
+#if NCNN_RUNTIME_CPU && NCNN_XOP && __SSE2__ && !__AVX2__ && !__XOP__
     if (ncnn::cpu_support_x86_xop())
     {
         conv3x3s1_winograd43_transform_kernel_pack8to4_int8_sse_xop(kernel, kernel_tm_pack8, inch, outch, opt);
@@ -119,10 +119,39 @@ static void conv3x3s1_winograd43_transform_kernel_pack8to4_int8_sse(const Mat& k
 
     // interleave
     // src = 36-inch-outch
+#if __AVX512F__
+    // dst = 16b-2a-4a-inch/8a-36-outch/16b
+    kernel_tm_pack8.create(16 * inch, 36, outch / 16 + (outch % 16) / 4, (size_t)2u);
+#else
     // dst = 4b-8a-inch/8a-36-outch/4b
     kernel_tm_pack8.create(inch / 8, 36, outch / 4, (size_t)2u * 32, 32);
+#endif
 
     int q = 0;
+#if __AVX512F__
+    for (; q + 15 < outch; q += 16)
+    {
+        Mat g0 = kernel_tm_pack8.channel(q / 16);
+
+        for (int k = 0; k < 36; k++)
+        {
+            short* g00 = g0.row<short>(k);
+
+            for (int p = 0; p + 7 < inch; p += 8)
+            {
+                for (int i = 0; i < 4; i++)
+                {
+                    for (int j = 0; j < 16; j++)
+                    {
+                        g00[0] = kernel_tm.channel(q + j).row<const short>(p + i * 2)[k];
+                        g00[1] = kernel_tm.channel(q + j).row<const short>(p + i * 2 + 1)[k];
+                        g00 += 2;
+                    }
+                }
+            }
+        }
+    }
+#endif // __AVX512F__
     for (; q + 3 < outch; q += 4)
     {
         const Mat k0 = kernel_tm.channel(q);
@@ -130,7 +159,11 @@ static void conv3x3s1_winograd43_transform_kernel_pack8to4_int8_sse(const Mat& k
         const Mat k2 = kernel_tm.channel(q + 2);
         const Mat k3 = kernel_tm.channel(q + 3);
 
+#if __AVX512F__
+        Mat kernel_tm = kernel_tm_pack8.channel(q / 16 + (q % 16) / 4);
+#else
         Mat kernel_tm = kernel_tm_pack8.channel(q / 4);
+#endif
 
         for (int k = 0; k < 36; k++)
         {
@@ -185,7 +218,7 @@ static void conv3x3s1_winograd43_transform_kernel_pack8to4_int8_sse(const Mat& k
 
 static void conv3x3s1_winograd43_pack8to4_int8_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Option& opt)
 {
-#if !(__AVX512VNNI__ || __AVXVNNI__ || __AVX2__ || __XOP__)
+#if !(__AVX512VNNI__ || __AVXVNNI__ || __XOP__)
 #if NCNN_RUNTIME_CPU && NCNN_AVX512VNNI && __AVX512F__ && !__AVX512VNNI__
     if (ncnn::cpu_support_x86_avx512_vnni())
     {
@@ -194,7 +227,7 @@ static void conv3x3s1_winograd43_pack8to4_int8_sse(const Mat& bottom_blob, Mat&
     }
 #endif
 
-#if NCNN_RUNTIME_CPU && NCNN_AVXVNNI && __AVX2__ && !__AVXVNNI__
+#if NCNN_RUNTIME_CPU && NCNN_AVXVNNI && __AVX__ && !__AVXVNNI__
     if (ncnn::cpu_support_x86_avx_vnni())
     {
         conv3x3s1_winograd43_pack8to4_int8_sse_avxvnni(bottom_blob, top_blob, kernel_tm, opt);
@@ -210,7 +243,7 @@ static void conv3x3s1_winograd43_pack8to4_int8_sse(const Mat& bottom_blob, Mat&
     }
 #endif
 
-#if NCNN_RUNTIME_CPU && NCNN_XOP && __SSE2__ && !__XOP__
+#if NCNN_RUNTIME_CPU && NCNN_XOP && __SSE2__ && !__AVX2__ && !__XOP__
     if (ncnn::cpu_support_x86_xop())
     {
         conv3x3s1_winograd43_pack8to4_int8_sse_xop(bottom_blob, top_blob, kernel_tm, opt);
@@ -462,12 +495,217 @@ static void conv3x3s1_winograd43_pack8to4_int8_sse(const Mat& bottom_blob, Mat&
 
         top_blob_tm.create(tiles, 36, outch, 4u * 4, 4, opt.workspace_allocator);
 
+        int remain_outch_start = 0;
+
+#if __AVX512F__
+        // 16 output channels share one pass over the transformed input
+        int nn_outch = outch / 4;
+
         #pragma omp parallel for num_threads(opt.num_threads)
-        for (int p = 0; p < outch; p++)
+        for (int pp = 0; pp < nn_outch; pp++)
+        {
+            const int p = pp * 4;
+
+            const Mat kernel0_tm = kernel_tm.channel(pp);
+
+            for (int r = 0; r < 36; r++)
+            {
+                const Mat bb2 = bottom_blob_tm2.channel(r);
+
+                int* output0_tm = top_blob_tm.channel(p).row<int>(r);
+                int* output1_tm = top_blob_tm.channel(p + 1).row<int>(r);
+                int* output2_tm = top_blob_tm.channel(p + 2).row<int>(r);
+                int* output3_tm = top_blob_tm.channel(p + 3).row<int>(r);
+
+                int i = 0;
+                for (; i + 7 < tiles; i += 8)
+                {
+                    const int* r0 = bb2.row<const int>(i / 4);
+                    const int* r1 = bb2.row<const int>(i / 4 + 1);
+                    const short* k0 = kernel0_tm.row<const short>(r);
+
+                    __m512i _sum0 = _mm512_setzero_si512();
+                    __m512i _sum1 = _mm512_setzero_si512();
+                    __m512i _sum2 = _mm512_setzero_si512();
+                    __m512i _sum3 = _mm512_setzero_si512();
+                    __m512i _sum4 = _mm512_setzero_si512();
+                    __m512i _sum5 = _mm512_setzero_si512();
+                    __m512i _sum6 = _mm512_setzero_si512();
+                    __m512i _sum7 = _mm512_setzero_si512();
+
+                    for (int j = 0; j < inch; j++)
+                    {
+                        for (int k = 0; k < 4; k++)
+                        {
+                            __m512i _w = _mm512_loadu_si512((const __m512i*)k0);
+
+                            _sum0 = _mm512_comp_dpwssd_epi32(_sum0, _w, _mm512_set1_epi32(r0[k]));
+                            _sum1 = _mm512_comp_dpwssd_epi32(_sum1, _w, _mm512_set1_epi32(r0[4 + k]));
+                            _sum2 = _mm512_comp_dpwssd_epi32(_sum2, _w, _mm512_set1_epi32(r0[8 + k]));
+                            _sum3 = _mm512_comp_dpwssd_epi32(_sum3, _w, _mm512_set1_epi32(r0[12 + k]));
+                            _sum4 = _mm512_comp_dpwssd_epi32(_sum4, _w, _mm512_set1_epi32(r1[k]));
+                            _sum5 = _mm512_comp_dpwssd_epi32(_sum5, _w, _mm512_set1_epi32(r1[4 + k]));
+                            _sum6 = _mm512_comp_dpwssd_epi32(_sum6, _w, _mm512_set1_epi32(r1[8 + k]));
+                            _sum7 = _mm512_comp_dpwssd_epi32(_sum7, _w, _mm512_set1_epi32(r1[12 + k]));
+
+                            k0 += 32;
+                        }
+
+                        r0 += 16;
+                        r1 += 16;
+                    }
+
+                    // transpose 4x4 of 128bit lanes, tile-major to pack4 output
+                    __m512i _tmp0 = _mm512_shuffle_i32x4(_sum0, _sum1, _MM_SHUFFLE(1, 0, 1, 0));
+                    __m512i _tmp1 = _mm512_shuffle_i32x4(_sum2, _sum3, _MM_SHUFFLE(1, 0, 1, 0));
+                    __m512i _tmp2 = _mm512_shuffle_i32x4(_sum0, _sum1, _MM_SHUFFLE(3, 2, 3, 2));
+                    __m512i _tmp3 = _mm512_shuffle_i32x4(_sum2, _sum3, _MM_SHUFFLE(3, 2, 3, 2));
+                    __m512i _tmp4 = _mm512_shuffle_i32x4(_sum4, _sum5, _MM_SHUFFLE(1, 0, 1, 0));
+                    __m512i _tmp5 = _mm512_shuffle_i32x4(_sum6, _sum7, _MM_SHUFFLE(1, 0, 1, 0));
+                    __m512i _tmp6 = _mm512_shuffle_i32x4(_sum4, _sum5, _MM_SHUFFLE(3, 2, 3, 2));
+                    __m512i _tmp7 = _mm512_shuffle_i32x4(_sum6, _sum7, _MM_SHUFFLE(3, 2, 3, 2));
+
+                    _mm512_storeu_si512((__m512i*)(output0_tm), _mm512_shuffle_i32x4(_tmp0, _tmp1, _MM_SHUFFLE(2, 0, 2, 0)));
+                    _mm512_storeu_si512((__m512i*)(output1_tm), _mm512_shuffle_i32x4(_tmp0, _tmp1, _MM_SHUFFLE(3, 1, 3, 1)));
+                    _mm512_storeu_si512((__m512i*)(output2_tm), _mm512_shuffle_i32x4(_tmp2, _tmp3, _MM_SHUFFLE(2, 0, 2, 0)));
+                    _mm512_storeu_si512((__m512i*)(output3_tm), _mm512_shuffle_i32x4(_tmp2, _tmp3, _MM_SHUFFLE(3, 1, 3, 1)));
+                    _mm512_storeu_si512((__m512i*)(output0_tm + 16), _mm512_shuffle_i32x4(_tmp4, _tmp5, _MM_SHUFFLE(2, 0, 2, 0)));
+                    _mm512_storeu_si512((__m512i*)(output1_tm + 16), _mm512_shuffle_i32x4(_tmp4, _tmp5, _MM_SHUFFLE(3, 1, 3, 1)));
+                    _mm512_storeu_si512((__m512i*)(output2_tm + 16), _mm512_shuffle_i32x4(_tmp6, _tmp7, _MM_SHUFFLE(2, 0, 2, 0)));
+                    _mm512_storeu_si512((__m512i*)(output3_tm + 16), _mm512_shuffle_i32x4(_tmp6, _tmp7, _MM_SHUFFLE(3, 1, 3, 1)));
+
+                    output0_tm += 32;
+                    output1_tm += 32;
+                    output2_tm += 32;
+                    output3_tm += 32;
+                }
+                for (; i + 3 < tiles; i += 4)
+                {
+                    const int* r0 = bb2.row<const int>(i / 4);
+                    const short* k0 = kernel0_tm.row<const short>(r);
+
+                    __m512i _sum0 = _mm512_setzero_si512();
+                    __m512i _sum1 = _mm512_setzero_si512();
+                    __m512i _sum2 = _mm512_setzero_si512();
+                    __m512i _sum3 = _mm512_setzero_si512();
+
+                    for (int j = 0; j < inch; j++)
+                    {
+                        for (int k = 0; k < 4; k++)
+                        {
+                            __m512i _w = _mm512_loadu_si512((const __m512i*)k0);
+
+                            _sum0 = _mm512_comp_dpwssd_epi32(_sum0, _w, _mm512_set1_epi32(r0[k]));
+                            _sum1 = _mm512_comp_dpwssd_epi32(_sum1, _w, _mm512_set1_epi32(r0[4 + k]));
+                            _sum2 = _mm512_comp_dpwssd_epi32(_sum2, _w, _mm512_set1_epi32(r0[8 + k]));
+                            _sum3 = _mm512_comp_dpwssd_epi32(_sum3, _w, _mm512_set1_epi32(r0[12 + k]));
+
+                            k0 += 32;
+                        }
+
+                        r0 += 16;
+                    }
+
+                    __m512i _tmp0 = _mm512_shuffle_i32x4(_sum0, _sum1, _MM_SHUFFLE(1, 0, 1, 0));
+                    __m512i _tmp1 = _mm512_shuffle_i32x4(_sum2, _sum3, _MM_SHUFFLE(1, 0, 1, 0));
+                    __m512i _tmp2 = _mm512_shuffle_i32x4(_sum0, _sum1, _MM_SHUFFLE(3, 2, 3, 2));
+                    __m512i _tmp3 = _mm512_shuffle_i32x4(_sum2, _sum3, _MM_SHUFFLE(3, 2, 3, 2));
+
+                    _mm512_storeu_si512((__m512i*)(output0_tm), _mm512_shuffle_i32x4(_tmp0, _tmp1, _MM_SHUFFLE(2, 0, 2, 0)));
+                    _mm512_storeu_si512((__m512i*)(output1_tm), _mm512_shuffle_i32x4(_tmp0, _tmp1, _MM_SHUFFLE(3, 1, 3, 1)));
+                    _mm512_storeu_si512((__m512i*)(output2_tm), _mm512_shuffle_i32x4(_tmp2, _tmp3, _MM_SHUFFLE(2, 0, 2, 0)));
+                    _mm512_storeu_si512((__m512i*)(output3_tm), _mm512_shuffle_i32x4(_tmp2, _tmp3, _MM_SHUFFLE(3, 1, 3, 1)));
+
+                    output0_tm += 16;
+                    output1_tm += 16;
+                    output2_tm += 16;
+                    output3_tm += 16;
+                }
+                for (; i + 1 < tiles; i += 2)
+                {
+                    const int* r0 = bb2.row<const int>(i / 4 + (i % 4) / 2);
+                    const short* k0 = kernel0_tm.row<const short>(r);
+
+                    __m512i _sum0 = _mm512_setzero_si512();
+                    __m512i _sum1 = _mm512_setzero_si512();
+
+                    for (int j = 0; j < inch; j++)
+                    {
+                        for (int k = 0; k < 4; k++)
+                        {
+                            __m512i _w = _mm512_loadu_si512((const __m512i*)k0);
+
+                            _sum0 = _mm512_comp_dpwssd_epi32(_sum0, _w, _mm512_set1_epi32(r0[k]));
+                            _sum1 = _mm512_comp_dpwssd_epi32(_sum1, _w, _mm512_set1_epi32(r0[4 + k]));
+
+                            k0 += 32;
+                        }
+
+                        r0 += 8;
+                    }
+
+                    __m512i _tmp0 = _mm512_shuffle_i32x4(_sum0, _sum1, _MM_SHUFFLE(1, 0, 1, 0));
+                    __m512i _tmp1 = _mm512_shuffle_i32x4(_sum0, _sum1, _MM_SHUFFLE(3, 2, 3, 2));
+                    _tmp0 = _mm512_shuffle_i32x4(_tmp0, _tmp0, _MM_SHUFFLE(3, 1, 2, 0));
+                    _tmp1 = _mm512_shuffle_i32x4(_tmp1, _tmp1, _MM_SHUFFLE(3, 1, 2, 0));
+
+                    _mm256_storeu_si256((__m256i*)output0_tm, _mm512_castsi512_si256(_tmp0));
+                    _mm256_storeu_si256((__m256i*)output1_tm, _mm512_extracti32x8_epi32(_tmp0, 1));
+                    _mm256_storeu_si256((__m256i*)output2_tm, _mm512_castsi512_si256(_tmp1));
+                    _mm256_storeu_si256((__m256i*)output3_tm, _mm512_extracti32x8_epi32(_tmp1, 1));
+
+                    output0_tm += 8;
+                    output1_tm += 8;
+                    output2_tm += 8;
+                    output3_tm += 8;
+                }
+                for (; i < tiles; i++)
+                {
+                    const int* r0 = bb2.row<const int>(i / 4 + (i % 4) / 2 + i % 2);
+                    const short* k0 = kernel0_tm.row<const short>(r);
+
+                    __m512i _sum0 = _mm512_setzero_si512();
+
+                    for (int j = 0; j < inch; j++)
+                    {
+                        for (int k = 0; k < 4; k++)
+                        {
+                            __m512i _w = _mm512_loadu_si512((const __m512i*)k0);
+
+                            _sum0 = _mm512_comp_dpwssd_epi32(_sum0, _w, _mm512_set1_epi32(r0[k]));
+
+                            k0 += 32;
+                        }
+
+                        r0 += 4;
+                    }
+
+                    _mm_storeu_si128((__m128i*)output0_tm, _mm512_extracti32x4_epi32(_sum0, 0));
+                    _mm_storeu_si128((__m128i*)output1_tm, _mm512_extracti32x4_epi32(_sum0, 1));
+                    _mm_storeu_si128((__m128i*)output2_tm, _mm512_extracti32x4_epi32(_sum0, 2));
+                    _mm_storeu_si128((__m128i*)output3_tm, _mm512_extracti32x4_epi32(_sum0, 3));
+
+                    output0_tm += 4;
+                    output1_tm += 4;
+                    output2_tm += 4;
+                    output3_tm += 4;
+                }
+            }
+        }
+
+        remain_outch_start = nn_outch * 4;
+#endif // __AVX512F__
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int p = remain_outch_start; p < outch; p++)
         {
             int* output0_tm = top_blob_tm.channel(p);
 
+#if __AVX512F__
+            const Mat kernel0_tm = kernel_tm.channel(p / 4 + p % 4);
+#else
             const Mat kernel0_tm = kernel_tm.channel(p);
+#endif
 
             for (int r = 0; r < 36; r++)
             {
@@ -0,0 +1,201 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// im2col + amx int8 tile gemm
+// rows are output pixels, columns are output channels
+// k runs over inch/elempack, maxk, elempack so that packed input copies 8 bytes at a time
+
+#if NCNN_RUNTIME_CPU && NCNN_AVX512AMX && __AVX512F__ && !__AMX_INT8__
+int convolution_im2col_gemm_int8_amx_avx512amx(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, int kernel_w, int kernel_h, int dilation_w, int dilation_h, int stride_w, int stride_h, const Option& opt);
+#endif
+
+static bool convolution_int8_support_amx()
+{
+#if __AMX_INT8__
+    return true;
+#elif NCNN_RUNTIME_CPU && NCNN_AVX512AMX && __AVX512F__
+    return ncnn::cpu_support_x86_amx_int8();
+#else
+    return false;
+#endif
+}
+
+static void convolution_im2col_gemm_transform_kernel_int8_amx(const Mat& _kernel, Mat& kernel_tm, int inch, int outch, int kernel_w, int kernel_h, int elempack)
+{
+    const int maxk = kernel_w * kernel_h;
+    const int K = inch * maxk;
+
+    const int nn_K = (K + 63) / 64;
+    const int nn_N = (outch + 15) / 16;
+
+    // src = maxk-inch-outch
+    // dst = 4k-16n-16k-nn_K-outch/16
+    Mat kernel = _kernel.reshape(maxk, inch, outch);
+    kernel_tm.create(1024 * nn_K, nn_N, (size_t)1u);
+
+    memset(kernel_tm.data, 0, kernel_tm.total() * kernel_tm.elemsize);
+
+    for (int n = 0; n < outch; n++)
+    {
+        signed char* g0 = kernel_tm.row<signed char>(n / 16) + (n % 16) * 4;
+
+        for (int k = 0; k < K; k++)
+        {
+            const int q = k / (maxk * elempack);
+            const int tap = k % (maxk * elempack) / elempack;
+            const int ic = q * elempack + k % elempack;
+
+            g0[(k / 64) * 1024 + (k % 64) / 4 * 64 + k % 4] = kernel.channel(n).row<const signed char>(ic)[tap];
+        }
+    }
+}
+
+static int convolution_im2col_gemm_int8_amx(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, int kernel_w, int kernel_h, int dilation_w, int dilation_h, int stride_w, int stride_h, const Option& opt)
+{
+#if NCNN_RUNTIME_CPU && NCNN_AVX512AMX && __AVX512F__ && !__AMX_INT8__
+    if (ncnn::cpu_support_x86_amx_int8())
+    {
+        return convolution_im2col_gemm_int8_amx_avx512amx(bottom_blob, top_blob, kernel_tm, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, opt);
+    }
+#endif
+
+#if __AMX_INT8__
+    const int inch = bottom_blob.c;
+    const int elempack = bottom_blob.elempack;
+
+    const int outw = top_blob.w;
+    const int outh = top_blob.h;
+    const int outch = top_blob.c;
+    const int out_elempack = top_blob.elempack;
+
+    const int size = outw * outh;
+    const int maxk = kernel_w * kernel_h;
+    const int K = inch * elempack * maxk;
+
+    const int nn_M = (size + 15) / 16;
+    const int nn_N = kernel_tm.h;
+    const int nn_K = (K + 63) / 64;
+
+    // im2col straight into the blocked A tiles
+    Mat AT(1024 * nn_K, nn_M, (size_t)1u, opt.workspace_allocator);
+    if (AT.empty())
+        return -100;
+
+    const int w = bottom_blob.w;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int mb = 0; mb < nn_M; mb++)
+    {
+        signed char* pA = AT.row<signed char>(mb);
+
+        memset(pA, 0, 1024 * nn_K);
+
+        const int max_r = std::min(16, size - mb * 16);
+
+        // offset of the first tap of every output pixel in this strip
+        int offsets[16];
+        for (int r = 0; r < max_r; r++)
+        {
+            const int i = (mb * 16 + r) / outw;
+            const int j = (mb * 16 + r) % outw;
+
+            offsets[r] = i * stride_h * w + j * stride_w;
+        }
+
+        for (int q = 0; q < inch; q++)
+        {
+            for (int u = 0; u < kernel_h; u++)
+            {
+                for (int v = 0; v < kernel_w; v++)
+                {
+                    const int t = q * maxk + u * kernel_w + v;
+                    const int tap_offset = u * dilation_h * w + v * dilation_w;
+
+                    if (elempack == 8)
+                    {
+                        const int64_t* sptr = (const int64_t*)bottom_blob.channel(q) + tap_offset;
+                        int64_t* pp = (int64_t*)(pA + (t / 8) * 1024 + (t % 8) * 8);
+
+                        for (int r = 0; r < max_r; r++)
+                        {
+                            pp[r * 8] = sptr[offsets[r]];
+                        }
+                    }
+                    else
+                    {
+                        const signed char* sptr = (const signed char*)bottom_blob.channel(q) + tap_offset;
+                        signed char* pp = pA + (t / 64) * 1024 + t % 64;
+
+                        for (int r = 0; r < max_r; r++)
+                        {
+                            pp[r * 64] = sptr[offsets[r]];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    const int ldc = nn_N * 16;
+
+    Mat C(ldc, nn_M * 16, (size_t)4u, opt.workspace_allocator);
+    if (C.empty())
+        return -100;
+
+    amx_gemm_int8(AT, kernel_tm, C, nn_M, nn_N, nn_K, ldc, opt.num_threads);
+
+    // scatter the pixel-major result into the packed top channels
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p = 0; p < outch; p++)
+    {
+        int* outptr = top_blob.channel(p);
+
+        const int* cptr = (const int*)C + p * out_elempack;
+
+        if (out_elempack == 4)
+        {
+            for (int i = 0; i < size; i++)
+            {
+                _mm_storeu_si128((__m128i*)outptr, _mm_loadu_si128((const __m128i*)cptr));
+                outptr += 4;
+                cptr += ldc;
+            }
+        }
+        else
+        {
+            for (int i = 0; i < size; i++)
+            {
+                outptr[0] = cptr[0];
+                outptr += 1;
+                cptr += ldc;
+            }
+        }
+    }
+
+    return 0;
+#else // __AMX_INT8__
+    // unreachable, convolution_int8_support_amx() guards the caller
+    (void)bottom_blob;
+    (void)top_blob;
+    (void)kernel_tm;
+    (void)kernel_w;
+    (void)kernel_h;
+    (void)dilation_w;
+    (void)dilation_h;
+    (void)stride_w;
+    (void)stride_h;
+    (void)opt;
+    return -1;
+#endif // __AMX_INT8__
+}
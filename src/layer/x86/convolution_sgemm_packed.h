@@ -0,0 +1,285 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// elempack dispatch over the im2col sgemm kernels, include after all convolution_sgemm*.h
+// the kernels only see maxk taps per input channel, so 1d and 3d layers reuse them as is
+
+static void convolution_im2col_sgemm_transform_kernel_packed_sse(const Mat& kernel, Mat& kernel_tm, int inch, int outch, int maxk, int elempack, int out_elempack)
+{
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    if (elempack == 16 && out_elempack == 16)
+        convolution_im2col_sgemm_transform_kernel_pack16_avx512(kernel, kernel_tm, inch, outch, maxk, 1);
+    if (elempack == 8 && out_elempack == 16)
+        convolution_im2col_sgemm_transform_kernel_pack8to16_avx512(kernel, kernel_tm, inch, outch, maxk, 1);
+    if (elempack == 4 && out_elempack == 16)
+        convolution_im2col_sgemm_transform_kernel_pack4to16_avx512(kernel, kernel_tm, inch, outch, maxk, 1);
+    if (elempack == 1 && out_elempack == 16)
+        convolution_im2col_sgemm_transform_kernel_pack1to16_avx512(kernel, kernel_tm, inch, outch, maxk, 1);
+    if (elempack == 16 && out_elempack == 8)
+        convolution_im2col_sgemm_transform_kernel_pack16to8_avx512(kernel, kernel_tm, inch, outch, maxk, 1);
+    if (elempack == 16 && out_elempack == 4)
+        convolution_im2col_sgemm_transform_kernel_pack16to4_avx512(kernel, kernel_tm, inch, outch, maxk, 1);
+    if (elempack == 16 && out_elempack == 1)
+        convolution_im2col_sgemm_transform_kernel_pack16to1_avx512(kernel, kernel_tm, inch, outch, maxk, 1);
+#endif // __AVX512F__
+
+    if (elempack == 8 && out_elempack == 8)
+        convolution_im2col_sgemm_transform_kernel_pack8_avx(kernel, kernel_tm, inch, outch, maxk, 1);
+    if (elempack == 4 && out_elempack == 8)
+        convolution_im2col_sgemm_transform_kernel_pack4to8_avx(kernel, kernel_tm, inch, outch, maxk, 1);
+    if (elempack == 1 && out_elempack == 8)
+        convolution_im2col_sgemm_transform_kernel_pack1to8_avx(kernel, kernel_tm, inch, outch, maxk, 1);
+    if (elempack == 8 && out_elempack == 4)
+        convolution_im2col_sgemm_transform_kernel_pack8to4_avx(kernel, kernel_tm, inch, outch, maxk, 1);
+    if (elempack == 8 && out_elempack == 1)
+        convolution_im2col_sgemm_transform_kernel_pack8to1_avx(kernel, kernel_tm, inch, outch, maxk, 1);
+#endif // __AVX__
+
+    if (elempack == 4 && out_elempack == 4)
+        convolution_im2col_sgemm_transform_kernel_pack4_sse(kernel, kernel_tm, inch, outch, maxk, 1);
+    if (elempack == 1 && out_elempack == 4)
+        convolution_im2col_sgemm_transform_kernel_pack1to4_sse(kernel, kernel_tm, inch, outch, maxk, 1);
+    if (elempack == 4 && out_elempack == 1)
+        convolution_im2col_sgemm_transform_kernel_pack4to1_sse(kernel, kernel_tm, inch, outch, maxk, 1);
+#endif // __SSE2__
+
+    if (elempack == 1 && out_elempack == 1)
+        convolution_im2col_sgemm_transform_kernel_sse(kernel, kernel_tm, inch, outch, maxk, 1);
+}
+
+static void im2col_sgemm_packed_sse(const Mat& bottom_im2col, Mat& top_blob, const Mat& kernel_tm, const Mat& bias, const Option& opt)
+{
+    const int elempack = bottom_im2col.elempack;
+    const int out_elempack = top_blob.elempack;
+
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    if (elempack == 16 && out_elempack == 16)
+        im2col_sgemm_pack16_avx512(bottom_im2col, top_blob, kernel_tm, bias, opt);
+    if (elempack == 8 && out_elempack == 16)
+        im2col_sgemm_pack8to16_avx512(bottom_im2col, top_blob, kernel_tm, bias, opt);
+    if (elempack == 4 && out_elempack == 16)
+        im2col_sgemm_pack4to16_avx512(bottom_im2col, top_blob, kernel_tm, bias, opt);
+    if (elempack == 1 && out_elempack == 16)
+        im2col_sgemm_pack1to16_avx512(bottom_im2col, top_blob, kernel_tm, bias, opt);
+    if (elempack == 16 && out_elempack == 8)
+        im2col_sgemm_pack16to8_avx512(bottom_im2col, top_blob, kernel_tm, bias, opt);
+    if (elempack == 16 && out_elempack == 4)
+        im2col_sgemm_pack16to4_avx512(bottom_im2col, top_blob, kernel_tm, bias, opt);
+    if (elempack == 16 && out_elempack == 1)
+        im2col_sgemm_pack16to1_avx512(bottom_im2col, top_blob, kernel_tm, bias, opt);
+#endif // __AVX512F__
+
+    if (elempack == 8 && out_elempack == 8)
+        im2col_sgemm_pack8_avx(bottom_im2col, top_blob, kernel_tm, bias, opt);
+    if (elempack == 4 && out_elempack == 8)
+        im2col_sgemm_pack4to8_avx(bottom_im2col, top_blob, kernel_tm, bias, opt);
+    if (elempack == 1 && out_elempack == 8)
+        im2col_sgemm_pack1to8_avx(bottom_im2col, top_blob, kernel_tm, bias, opt);
+    if (elempack == 8 && out_elempack == 4)
+        im2col_sgemm_pack8to4_avx(bottom_im2col, top_blob, kernel_tm, bias, opt);
+    if (elempack == 8 && out_elempack == 1)
+        im2col_sgemm_pack8to1_avx(bottom_im2col, top_blob, kernel_tm, bias, opt);
+#endif // __AVX__
+
+    if (elempack == 4 && out_elempack == 4)
+        im2col_sgemm_pack4_sse(bottom_im2col, top_blob, kernel_tm, bias, opt);
+    if (elempack == 1 && out_elempack == 4)
+        im2col_sgemm_pack1to4_sse(bottom_im2col, top_blob, kernel_tm, bias, opt);
+    if (elempack == 4 && out_elempack == 1)
+        im2col_sgemm_pack4to1_sse(bottom_im2col, top_blob, kernel_tm, bias, opt);
+#endif // __SSE2__
+
+    if (elempack == 1 && out_elempack == 1)
+        im2col_sgemm_sse(bottom_im2col, top_blob, kernel_tm, bias, opt);
+}
+
+// deconvolution as sgemm, col holds one channel per (tap, output packed channel) pair
+// with the tap outermost, scatter them back onto the strided and dilated output positions
+static void deconvolution_col2im_packed_sse(const Mat& col, Mat& top_blob, const Mat& bias_data, int w, int h, int d, int kernel_w, int kernel_h, int kernel_d, int dilation_w, int dilation_h, int dilation_d, int stride_w, int stride_h, int stride_d, const Option& opt)
+{
+    const int outw = top_blob.w;
+    const int outh = top_blob.dims == 2 ? 1 : top_blob.h;
+    const int outch = top_blob.dims == 2 ? top_blob.h : top_blob.c;
+    const int out_elempack = top_blob.elempack;
+
+    const int outsize = outw * outh * (top_blob.dims == 4 ? top_blob.d : 1);
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p = 0; p < outch; p++)
+    {
+        float* outptr = top_blob.dims == 2 ? top_blob.row(p) : top_blob.channel(p);
+
+        if (bias_data.empty())
+        {
+            memset(outptr, 0, outsize * out_elempack * sizeof(float));
+        }
+        else
+        {
+            const float* bias = (const float*)bias_data + p * out_elempack;
+            for (int i = 0; i < outsize; i++)
+            {
+                for (int e = 0; e < out_elempack; e++)
+                {
+                    outptr[i * out_elempack + e] = bias[e];
+                }
+            }
+        }
+
+        for (int z = 0; z < kernel_d; z++)
+        {
+            for (int y = 0; y < kernel_h; y++)
+            {
+                for (int x = 0; x < kernel_w; x++)
+                {
+                    const int k = (z * kernel_h + y) * kernel_w + x;
+                    const float* cptr = col.channel(k * outch + p);
+
+                    for (int i = 0; i < d; i++)
+                    {
+                        for (int j = 0; j < h; j++)
+                        {
+                            float* sptr = outptr + (((size_t)(i * stride_d + z * dilation_d) * outh + j * stride_h + y * dilation_h) * outw + x * dilation_w) * out_elempack;
+
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+                            if (out_elempack == 16)
+                            {
+                                for (int l = 0; l < w; l++)
+                                {
+                                    float* ptr = sptr + l * stride_w * 16;
+                                    _mm512_storeu_ps(ptr, _mm512_add_ps(_mm512_loadu_ps(ptr), _mm512_loadu_ps(cptr)));
+                                    cptr += 16;
+                                }
+                                continue;
+                            }
+#endif // __AVX512F__
+                            if (out_elempack == 8)
+                            {
+                                for (int l = 0; l < w; l++)
+                                {
+                                    float* ptr = sptr + l * stride_w * 8;
+                                    _mm256_storeu_ps(ptr, _mm256_add_ps(_mm256_loadu_ps(ptr), _mm256_loadu_ps(cptr)));
+                                    cptr += 8;
+                                }
+                                continue;
+                            }
+#endif // __AVX__
+                            if (out_elempack == 4)
+                            {
+                                for (int l = 0; l < w; l++)
+                                {
+                                    float* ptr = sptr + l * stride_w * 4;
+                                    _mm_storeu_ps(ptr, _mm_add_ps(_mm_loadu_ps(ptr), _mm_loadu_ps(cptr)));
+                                    cptr += 4;
+                                }
+                                continue;
+                            }
+#endif // __SSE2__
+                            for (int l = 0; l < w; l++)
+                            {
+                                sptr[l * stride_w] += cptr[0];
+                                cptr += 1;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// volumetric im2col of the output depths [outd0, outd1) into (outw * outh * (outd1 - outd0), maxk, inch)
+// with the taps ordered depth-row-column
+static void convolution_im2col_3d_packed_sse(const Mat& bottom_blob, Mat& bottom_im2col, int outw, int outh, int outd0, int outd1, int kernel_w, int kernel_h, int kernel_d, int dilation_w, int dilation_h, int dilation_d, int stride_w, int stride_h, int stride_d, const Option& opt)
+{
+    const int w = bottom_blob.w;
+    const int h = bottom_blob.h;
+    const int inch = bottom_blob.c;
+    const int elempack = bottom_blob.elempack;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p = 0; p < inch; p++)
+    {
+        const float* img = bottom_blob.channel(p);
+        float* ptr = bottom_im2col.channel(p);
+
+        for (int z = 0; z < kernel_d; z++)
+        {
+            for (int y = 0; y < kernel_h; y++)
+            {
+                for (int x = 0; x < kernel_w; x++)
+                {
+                    for (int i = outd0; i < outd1; i++)
+                    {
+                        for (int j = 0; j < outh; j++)
+                        {
+                            const float* sptr = img + (((size_t)(i * stride_d + z * dilation_d) * h + j * stride_h + y * dilation_h) * w + x * dilation_w) * elempack;
+
+                            if (stride_w == 1)
+                            {
+                                memcpy(ptr, sptr, outw * elempack * sizeof(float));
+                                ptr += outw * elempack;
+                                continue;
+                            }
+
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+                            if (elempack == 16)
+                            {
+                                for (int l = 0; l < outw; l++)
+                                {
+                                    _mm512_storeu_ps(ptr, _mm512_loadu_ps(sptr + l * stride_w * 16));
+                                    ptr += 16;
+                                }
+                                continue;
+                            }
+#endif // __AVX512F__
+                            if (elempack == 8)
+                            {
+                                for (int l = 0; l < outw; l++)
+                                {
+                                    _mm256_storeu_ps(ptr, _mm256_loadu_ps(sptr + l * stride_w * 8));
+                                    ptr += 8;
+                                }
+                                continue;
+                            }
+#endif // __AVX__
+                            if (elempack == 4)
+                            {
+                                for (int l = 0; l < outw; l++)
+                                {
+                                    _mm_storeu_ps(ptr, _mm_loadu_ps(sptr + l * stride_w * 4));
+                                    ptr += 4;
+                                }
+                                continue;
+                            }
+#endif // __SSE2__
+                            for (int l = 0; l < outw; l++)
+                            {
+                                ptr[0] = sptr[l * stride_w];
+                                ptr += 1;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -24,6 +24,7 @@
 #endif // __SSE4_1__
 #endif // __SSE2__
 #include "x86_activation.h"
+#include "x86_amx.h"
 #include "x86_usability.h"
 
 #include "benchmark.h"
@@ -44,6 +45,7 @@ namespace ncnn {
 #include "convolution_1x1_int8.h"
 #include "convolution_3x3_int8.h"
 #include "convolution_int8.h"
+#include "convolution_im2col_gemm_int8_amx.h"
 #endif // NCNN_INT8
 
 #if __SSE2__
@@ -134,6 +136,85 @@ namespace ncnn {
 #endif // __AVX__
 #endif // __SSE2__
 
+#if NCNN_INT8
+// amx tiles take over every shape that would otherwise run a 1x1 or im2col int8 sgemm
+static bool convolution_int8_use_amx(int kernel_w, int kernel_h, int dilation_w, int dilation_h, int stride_w, int stride_h, const Option& opt)
+{
+    if (!convolution_int8_support_amx())
+        return false;
+
+    // winograd still does a quarter of the multiplications
+    if (opt.use_winograd_convolution && kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
+        return false;
+
+    if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == stride_h && (stride_w == 1 || stride_w == 2))
+        return true;
+
+    return opt.use_sgemm_convolution;
+}
+
+// the int8 kernels forward_int8_x86 picks from
+enum ConvolutionInt8Kernel
+{
+    CONVOLUTION_INT8_IM2COL_GEMM_AMX,
+    CONVOLUTION_INT8_CONV1X1S1_SGEMM,
+    CONVOLUTION_INT8_CONV1X1S2_SGEMM,
+    CONVOLUTION_INT8_CONV3X3S1,
+    CONVOLUTION_INT8_CONV3X3S2,
+    CONVOLUTION_INT8_CONV7X7S2,
+    CONVOLUTION_INT8_WINOGRAD43,
+    CONVOLUTION_INT8_WINOGRAD23,
+    CONVOLUTION_INT8_IM2COL_SGEMM,
+    CONVOLUTION_INT8_PACKED
+};
+
+// elempack is the packing of the quantized input and out_elempack the one of the int32 output
+// forward_int8_x86 dispatches on it and kernel_path reports it
+static int convolution_int8_kernel(int elempack, int out_elempack, int num_input, int num_output, int kernel_w, int kernel_h, int dilation_w, int dilation_h, int stride_w, int stride_h, const Option& opt)
+{
+    if (convolution_int8_use_amx(kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, opt))
+        return CONVOLUTION_INT8_IM2COL_GEMM_AMX;
+
+    const bool dilation1 = dilation_w == 1 && dilation_h == 1;
+
+    if (kernel_w == 1 && kernel_h == 1 && dilation1 && stride_w == 1 && stride_h == 1)
+        return CONVOLUTION_INT8_CONV1X1S1_SGEMM;
+
+    if (kernel_w == 1 && kernel_h == 1 && dilation1 && stride_w == 2 && stride_h == 2)
+        return CONVOLUTION_INT8_CONV1X1S2_SGEMM;
+
+    if (elempack == 8)
+    {
+        if (opt.use_winograd_convolution && opt.use_winograd43_convolution && kernel_w == 3 && kernel_h == 3 && dilation1 && stride_w == 1 && stride_h == 1)
+            return CONVOLUTION_INT8_WINOGRAD43;
+    }
+
+    if (elempack == 1 && out_elempack == 4)
+    {
+        if (kernel_w == 3 && kernel_h == 3 && dilation1 && stride_w == 1 && stride_h == 1)
+            return CONVOLUTION_INT8_CONV3X3S1;
+
+        if (kernel_w == 3 && kernel_h == 3 && dilation1 && stride_w == 2 && stride_h == 2)
+            return CONVOLUTION_INT8_CONV3X3S2;
+
+        if (kernel_w == 7 && kernel_h == 7 && dilation1 && stride_w == 2 && stride_h == 2)
+            return CONVOLUTION_INT8_CONV7X7S2;
+    }
+
+    if (elempack == 1 && out_elempack == 1)
+    {
+        if (opt.use_winograd_convolution && opt.use_winograd23_convolution && kernel_w == 3 && kernel_h == 3 && dilation1 && stride_w == 1 && stride_h == 1 && num_input >= 16 && num_output >= 16)
+            return CONVOLUTION_INT8_WINOGRAD23;
+    }
+
+    // TODO better condition && num_input >= 8 && num_output >= 8
+    if (opt.use_sgemm_convolution)
+        return CONVOLUTION_INT8_IM2COL_SGEMM;
+
+    return CONVOLUTION_INT8_PACKED;
+}
+#endif // NCNN_INT8
+
 Convolution_x86::Convolution_x86()
 {
 #if __SSE2__
@@ -142,6 +223,7 @@ Convolution_x86::Convolution_x86()
 
     activation = 0;
     convolution_dilation1 = 0;
+    gemm = 0;
 }
 
 static void convolution_transform_kernel_packed_sse(const Mat& weight_data, Mat& weight_data_tm, int num_input, int num_output, int kernel_w, int kernel_h, int elempack, int out_elempack)
@@ -194,6 +276,28 @@ int Convolution_x86::create_pipeline(const Option& opt)
     }
 #endif
 
+    // winograd still does fewer multiplications than the gemm paths below
+    const bool prefer_winograd = opt.use_winograd_convolution && kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1;
+
+#if NCNN_BF16 && NCNN_AVX512BF16 && __AVX512F__
+    if (cpu_support_x86_avx512_bf16() && opt.use_bf16_storage && !prefer_winograd)
+    {
+        return create_pipeline_gemm(opt);
+    }
+#endif
+
+#if NCNN_F16C
+    if (cpu_support_x86_f16c() && opt.use_fp16_weight_storage && !prefer_winograd)
+    {
+        // fp16 weight panels for the shapes that would take the 1x1 or im2col sgemm kernels
+        const bool is_1x1 = kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && ((stride_w == 1 && stride_h == 1) || (stride_w == 2 && stride_h == 2));
+        if (is_1x1 || opt.use_sgemm_convolution)
+        {
+            return create_pipeline_gemm(opt);
+        }
+    }
+#endif
+
     int kernel_size = kernel_w * kernel_h;
     int num_input = weight_data_size / kernel_size / num_output;
 
@@ -732,6 +836,80 @@ int Convolution_x86::destroy_pipeline(const Option& opt)
         convolution_dilation1 = 0;
     }
 
+    if (gemm)
+    {
+        gemm->destroy_pipeline(opt);
+        delete gemm;
+        gemm = 0;
+    }
+
+    return 0;
+}
+
+int Convolution_x86::save_pipeline(std::vector<Mat>& pipeline_data) const
+{
+    // the dilation and gemm paths keep their weights in a sub layer
+    if (dynamic_weight || convolution_dilation1 || gemm)
+        return -1;
+
+    pipeline_data.resize(6);
+    pipeline_data[0] = weight_data_tm;
+    pipeline_data[1] = weight_sgemm_data;
+    pipeline_data[2] = weight_winograd23_data;
+    pipeline_data[3] = weight_winograd43_data;
+    pipeline_data[4] = weight_winograd63_data;
+#if NCNN_INT8
+    pipeline_data[5] = scale_in_data;
+#endif
+
+    return 0;
+}
+
+int Convolution_x86::load_pipeline(const std::vector<Mat>& pipeline_data, const Option& opt)
+{
+    if (dynamic_weight || pipeline_data.size() != 6)
+        return -1;
+
+#if NCNN_INT8
+    if (opt.use_int8_inference && int8_scale_term)
+    {
+        // runtime quantization derives the weight scales in create_pipeline
+        if (weight_data.elemsize != (size_t)1u)
+            return -1;
+    }
+    else
+#endif
+    {
+        if (!opt.use_packing_layout && kernel_w == kernel_h && dilation_w != 1 && dilation_h == dilation_w && stride_w == 1 && stride_h == 1)
+            return -1;
+
+#if NCNN_BF16 && NCNN_AVX512BF16 && __AVX512F__
+        if (cpu_support_x86_avx512_bf16() && opt.use_bf16_storage)
+            return -1;
+#endif
+
+#if NCNN_F16C
+        if (cpu_support_x86_f16c() && opt.use_fp16_weight_storage)
+            return -1;
+#endif
+    }
+
+    activation = create_activation_layer(activation_type, activation_params, opt);
+
+    weight_data_tm = pipeline_data[0];
+    weight_sgemm_data = pipeline_data[1];
+    weight_winograd23_data = pipeline_data[2];
+    weight_winograd43_data = pipeline_data[3];
+    weight_winograd63_data = pipeline_data[4];
+#if NCNN_INT8
+    scale_in_data = pipeline_data[5];
+#endif
+
+    if (opt.lightmode)
+    {
+        weight_data.release();
+    }
+
     return 0;
 }
 
@@ -784,6 +962,11 @@ int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option
         return 0;
     }
 
+    if (gemm)
+    {
+        return forward_gemm(bottom_blob, top_blob, opt);
+    }
+
     int w = bottom_blob.w;
     int h = bottom_blob.h;
     int channels = bottom_blob.c;
@@ -1717,6 +1900,349 @@ int Convolution_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<M
     return 0;
 }
 
+int Convolution_x86::forward_batch(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    const int batch = (int)bottom_blobs.size();
+    if (batch < 2)
+        return Layer::forward_batch(bottom_blobs, top_blobs, opt);
+
+    const Mat& bottom_blob = bottom_blobs[0];
+
+    const int w = bottom_blob.w;
+    const int h = bottom_blob.h;
+    const int channels = bottom_blob.c;
+    const size_t elemsize = bottom_blob.elemsize;
+    const int elempack = bottom_blob.elempack;
+
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    // samples are stacked along height with zero rows in between standing for the vertical padding
+    // one sample then starts every (h + pad_top + pad_bottom) / stride_h output rows
+    const int gap = pad_top + pad_bottom;
+
+    bool stackable = bottom_blob.dims == 3 && pad_left >= 0 && pad_right >= 0 && pad_top >= 0 && pad_bottom >= 0 && pad_value == 0.f;
+    stackable = stackable && h + gap >= kernel_extent_h && (h + gap) % stride_h == 0;
+
+    // only worth it when streaming the weights dominates streaming the activations
+    stackable = stackable && (size_t)weight_data_size * sizeof(float) >= (size_t)w * h * channels * elemsize;
+
+    for (int b = 1; b < batch && stackable; b++)
+    {
+        const Mat& m = bottom_blobs[b];
+        stackable = m.dims == 3 && m.w == w && m.h == h && m.c == channels && m.elemsize == elemsize && m.elempack == elempack;
+    }
+
+    if (!stackable)
+        return Layer::forward_batch(bottom_blobs, top_blobs, opt);
+
+    const int stacked_h = h * batch + gap * (batch - 1);
+
+    Mat bottom_blob_stacked(w, stacked_h, channels, elemsize, elempack, opt.workspace_allocator);
+    if (bottom_blob_stacked.empty())
+        return -100;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < channels; q++)
+    {
+        unsigned char* outptr = bottom_blob_stacked.channel(q);
+
+        for (int b = 0; b < batch; b++)
+        {
+            const unsigned char* ptr = bottom_blobs[b].channel(q);
+
+            memcpy(outptr, ptr, w * h * elemsize);
+            outptr += w * h * elemsize;
+
+            if (b + 1 < batch)
+            {
+                memset(outptr, 0, w * gap * elemsize);
+                outptr += w * gap * elemsize;
+            }
+        }
+    }
+
+    Option opt_ws = opt;
+    opt_ws.blob_allocator = opt.workspace_allocator;
+
+    Mat top_blob_stacked;
+    int ret = forward(bottom_blob_stacked, top_blob_stacked, opt_ws);
+    if (ret != 0)
+        return ret;
+
+    const int outw = top_blob_stacked.w;
+    const int outh = (h + gap - kernel_extent_h) / stride_h + 1;
+    const int out_channels = top_blob_stacked.c;
+    const size_t out_elemsize = top_blob_stacked.elemsize;
+    const int out_elempack = top_blob_stacked.elempack;
+    const int out_stride = (h + gap) / stride_h;
+
+    top_blobs.resize(batch);
+    for (int b = 0; b < batch; b++)
+    {
+        Mat& top_blob = top_blobs[b];
+        top_blob.create(outw, outh, out_channels, out_elemsize, out_elempack, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q = 0; q < out_channels; q++)
+        {
+            const unsigned char* ptr = top_blob_stacked.channel(q).row<const unsigned char>(b * out_stride);
+            unsigned char* outptr = top_blob.channel(q);
+
+            memcpy(outptr, ptr, outw * outh * out_elemsize);
+        }
+    }
+
+    return 0;
+}
+
+const char* Convolution_x86::kernel_path(const Mat& bottom_blob, const Option& opt) const
+{
+#if NCNN_INT8
+    if (opt.use_int8_inference && int8_scale_term)
+    {
+        const int maxk = kernel_w * kernel_h;
+        const int num_input = weight_data_size / maxk / num_output;
+
+        // the packing forward_int8_x86 sees after quantizing a float input
+        int elempack = bottom_blob.elempack;
+        int out_elempack = 1;
+#if __SSE2__
+        if (bottom_blob.elembits() != 8)
+        {
+            elempack = opt.use_packing_layout && bottom_blob.c * bottom_blob.elempack % 8 == 0 ? 8 : 1;
+        }
+        if (opt.use_packing_layout)
+        {
+            out_elempack = num_output % 4 == 0 ? 4 : 1;
+        }
+#else
+        elempack = 1;
+#endif // __SSE2__
+
+        switch (convolution_int8_kernel(elempack, out_elempack, num_input, num_output, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, opt))
+        {
+        case CONVOLUTION_INT8_IM2COL_GEMM_AMX:
+            return "im2col_gemm_int8_amx";
+        case CONVOLUTION_INT8_CONV1X1S1_SGEMM:
+            return "conv1x1s1_sgemm_int8";
+        case CONVOLUTION_INT8_CONV1X1S2_SGEMM:
+            return "conv1x1s2_sgemm_int8";
+        case CONVOLUTION_INT8_CONV3X3S1:
+            return "conv3x3s1_int8";
+        case CONVOLUTION_INT8_CONV3X3S2:
+            return "conv3x3s2_int8";
+        case CONVOLUTION_INT8_CONV7X7S2:
+            return "conv7x7s2_int8";
+        case CONVOLUTION_INT8_WINOGRAD43:
+            return "winograd43_int8";
+        case CONVOLUTION_INT8_WINOGRAD23:
+            return "winograd23_int8";
+        case CONVOLUTION_INT8_IM2COL_SGEMM:
+            return "im2col_sgemm_int8";
+        default:
+            return "packed_int8";
+        }
+    }
+#else
+    (void)bottom_blob;
+    (void)opt;
+#endif
+
+    if (dynamic_weight)
+        return "dynamic";
+
+    if (convolution_dilation1)
+        return "dilation";
+
+    if (gemm)
+    {
+#if NCNN_BF16 && NCNN_AVX512BF16 && __AVX512F__
+        if (cpu_support_x86_avx512_bf16() && opt.use_bf16_storage)
+            return "im2col_gemm_bf16s";
+#endif
+        return "im2col_gemm_fp16s";
+    }
+
+    // create_pipeline only transforms the weights for the kernel it picked
+    if (!weight_winograd63_data.empty())
+        return "winograd63";
+    if (!weight_winograd43_data.empty())
+        return "winograd43";
+    if (!weight_winograd23_data.empty())
+        return "winograd23";
+
+    if (!weight_sgemm_data.empty())
+    {
+        if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
+            return "conv1x1s1_sgemm";
+        if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == 2 && stride_h == 2)
+            return "conv1x1s2_sgemm";
+
+        return "im2col_sgemm";
+    }
+
+    return "packed";
+}
+
+int Convolution_x86::create_pipeline_gemm(const Option& opt)
+{
+    const int maxk = kernel_w * kernel_h;
+    const int num_input = weight_data_size / maxk / num_output;
+
+    int out_elempack = 1;
+#if __SSE2__
+    if (opt.use_packing_layout)
+    {
+#if __AVX512F__
+        out_elempack = num_output % 16 == 0 ? 16 : num_output % 8 == 0 ? 8 : num_output % 4 == 0 ? 4 : 1;
+#elif __AVX__
+        out_elempack = num_output % 8 == 0 ? 8 : num_output % 4 == 0 ? 4 : 1;
+#else
+        out_elempack = num_output % 4 == 0 ? 4 : 1;
+#endif
+    }
+#endif // __SSE2__
+
+    // top = weight * im2col, weight is num_output rows of num_input * maxk
+    // the gemm writes the packed output channels as they are laid out in the top blob
+    gemm = ncnn::create_layer(ncnn::LayerType::Gemm);
+
+    ncnn::ParamDict pd;
+    pd.set(0, 1.f);               // alpha
+    pd.set(1, 1.f);               // beta
+    pd.set(2, 0);                 // transA
+    pd.set(3, 0);                 // transB
+    pd.set(4, 1);                 // constantA
+    pd.set(7, num_output);        // constantM
+    pd.set(9, num_input * maxk);  // constantK
+    pd.set(11, 1);                // output_N1M
+    pd.set(12, out_elempack);     // output_elempack
+
+    gemm->load_param(pd);
+
+    Mat weights[1];
+    weights[0] = weight_data.reshape(num_input * maxk, num_output);
+
+    gemm->load_model(ModelBinFromMatArray(weights));
+
+    gemm->create_pipeline(opt);
+
+    if (opt.lightmode)
+    {
+        weight_data.release();
+    }
+
+    return 0;
+}
+
+int Convolution_x86::forward_gemm(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    Option opt_ws = opt;
+    opt_ws.blob_allocator = opt.workspace_allocator;
+
+    Mat bottom_blob_bordered;
+    make_padding(bottom_blob, bottom_blob_bordered, opt_ws);
+    if (bottom_blob_bordered.empty())
+        return -100;
+
+    Mat bottom_blob_unpacked;
+    convert_packing(bottom_blob_bordered, bottom_blob_unpacked, 1, opt_ws);
+    if (bottom_blob_unpacked.empty())
+        return -100;
+
+    const int w = bottom_blob_unpacked.w;
+    const int h = bottom_blob_unpacked.h;
+    const int channels = bottom_blob_unpacked.c;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    const int outw = (w - kernel_extent_w) / stride_w + 1;
+    const int outh = (h - kernel_extent_h) / stride_h + 1;
+    const int size = outw * outh;
+    const int maxk = kernel_w * kernel_h;
+
+    // im2col, one row per input channel and kernel tap
+    Mat bottom_im2col;
+    if (kernel_w == 1 && kernel_h == 1 && stride_w == 1 && stride_h == 1)
+    {
+        bottom_im2col = bottom_blob_unpacked.reshape(size, channels, opt.workspace_allocator);
+    }
+    else
+    {
+        bottom_im2col.create(size, channels * maxk, 4u, opt.workspace_allocator);
+        if (bottom_im2col.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int p = 0; p < channels; p++)
+        {
+            const Mat img = bottom_blob_unpacked.channel(p);
+            float* ptr = bottom_im2col.row(p * maxk);
+
+            for (int u = 0; u < kernel_h; u++)
+            {
+                for (int v = 0; v < kernel_w; v++)
+                {
+                    for (int i = 0; i < outh; i++)
+                    {
+                        const float* sptr = img.row(dilation_h * u + stride_h * i) + dilation_w * v;
+
+                        for (int j = 0; j < outw; j++)
+                        {
+                            ptr[0] = sptr[stride_w * j];
+                            ptr += 1;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (bottom_im2col.empty())
+        return -100;
+
+    std::vector<Mat> gemm_bottom_blobs(bias_term ? 2 : 1);
+    gemm_bottom_blobs[0] = bottom_im2col;
+    if (bias_term)
+        gemm_bottom_blobs[1] = bias_data.reshape(1, num_output);
+
+    int out_elempack = 1;
+#if __SSE2__
+    if (opt.use_packing_layout)
+    {
+#if __AVX512F__
+        out_elempack = num_output % 16 == 0 ? 16 : num_output % 8 == 0 ? 8 : num_output % 4 == 0 ? 4 : 1;
+#elif __AVX__
+        out_elempack = num_output % 8 == 0 ? 8 : num_output % 4 == 0 ? 4 : 1;
+#else
+        out_elempack = num_output % 4 == 0 ? 4 : 1;
+#endif
+    }
+#endif // __SSE2__
+
+    top_blob.create(outw, outh, num_output / out_elempack, (size_t)4u * out_elempack, out_elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    // outw * outh x 1 x num_output is the top blob with its spatial dims folded
+    // the gemm finds it already allocated and writes in place, which keeps grouped convolution writing into its channel range
+    std::vector<Mat> gemm_top_blobs(1);
+    gemm_top_blobs[0] = top_blob.reshape(size, 1, top_blob.c);
+
+    int ret = gemm->forward(gemm_bottom_blobs, gemm_top_blobs, opt);
+    if (ret != 0)
+        return ret;
+
+    if (activation)
+    {
+        activation->forward_inplace(top_blob, opt);
+    }
+
+    return 0;
+}
+
 #if NCNN_INT8
 static void convolution_transform_kernel_packed_int8_sse(const Mat& weight_data, Mat& weight_data_tm, int num_input, int num_output, int kernel_w, int kernel_h, int elempack, int out_elempack)
 {
@@ -1769,8 +2295,14 @@ int Convolution_x86::create_pipeline_int8_x86(const Option& opt)
     }
 #endif // __SSE2__
 
+    const bool use_amx = convolution_int8_use_amx(kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, opt);
+    if (use_amx)
+    {
+        convolution_im2col_gemm_transform_kernel_int8_amx(weight_data, weight_sgemm_data, num_input, num_output, kernel_w, kernel_h, elempack);
+    }
+
 #if __SSE2__
-    if (elempack == 8 && out_elempack == 4)
+    if (!use_amx && elempack == 8 && out_elempack == 4)
     {
         if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
         {
@@ -1794,7 +2326,7 @@ int Convolution_x86::create_pipeline_int8_x86(const Option& opt)
         }
     }
 
-    if (elempack == 1 && out_elempack == 4)
+    if (!use_amx && elempack == 1 && out_elempack == 4)
     {
         if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
         {
@@ -1826,7 +2358,7 @@ int Convolution_x86::create_pipeline_int8_x86(const Option& opt)
         }
     }
 
-    if (elempack == 8 && out_elempack == 1)
+    if (!use_amx && elempack == 8 && out_elempack == 1)
     {
         if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
         {
@@ -1851,7 +2383,7 @@ int Convolution_x86::create_pipeline_int8_x86(const Option& opt)
     }
 #endif // __SSE2__
 
-    if (elempack == 1 && out_elempack == 1)
+    if (!use_amx && elempack == 1 && out_elempack == 1)
     {
         if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
         {
@@ -1961,22 +2493,32 @@ int Convolution_x86::forward_int8_x86(const Mat& bottom_blob, Mat& top_blob, con
     if (top_blob_int32.empty())
         return -100;
 
+    const int kernel = convolution_int8_kernel(elempack, out_elempack_int32, num_input, num_output, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, opt);
+
+    const bool use_amx = kernel == CONVOLUTION_INT8_IM2COL_GEMM_AMX;
+    if (use_amx)
+    {
+        int ret = convolution_im2col_gemm_int8_amx(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, opt);
+        if (ret != 0)
+            return ret;
+    }
+
 #if __SSE2__
-    if (elempack == 8 && out_elempack_int32 == 4)
+    if (!use_amx && elempack == 8 && out_elempack_int32 == 4)
     {
-        if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
+        if (kernel == CONVOLUTION_INT8_CONV1X1S1_SGEMM)
         {
             conv1x1s1_sgemm_pack8to4_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, opt);
         }
-        else if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == 2 && stride_h == 2)
+        else if (kernel == CONVOLUTION_INT8_CONV1X1S2_SGEMM)
         {
             conv1x1s2_sgemm_pack8to4_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, opt);
         }
-        else if (opt.use_winograd_convolution && opt.use_winograd43_convolution && kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
+        else if (kernel == CONVOLUTION_INT8_WINOGRAD43)
         {
             conv3x3s1_winograd43_pack8to4_int8_sse(bottom_blob_bordered, top_blob_int32, weight_winograd43_data, opt);
         }
-        else if (opt.use_sgemm_convolution)
+        else if (kernel == CONVOLUTION_INT8_IM2COL_SGEMM)
         {
             convolution_im2col_sgemm_pack8to4_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, opt);
         }
@@ -1986,29 +2528,29 @@ int Convolution_x86::forward_int8_x86(const Mat& bottom_blob, Mat& top_blob, con
         }
     }
 
-    if (elempack == 1 && out_elempack_int32 == 4)
+    if (!use_amx && elempack == 1 && out_elempack_int32 == 4)
     {
-        if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
+        if (kernel == CONVOLUTION_INT8_CONV1X1S1_SGEMM)
         {
             conv1x1s1_sgemm_pack1to4_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, opt);
         }
-        else if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == 2 && stride_h == 2)
+        else if (kernel == CONVOLUTION_INT8_CONV1X1S2_SGEMM)
         {
             conv1x1s2_sgemm_pack1to4_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, opt);
         }
-        else if (kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
+        else if (kernel == CONVOLUTION_INT8_CONV3X3S1)
         {
             conv3x3s1_pack1to4_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, opt);
         }
-        else if (kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && stride_w == 2 && stride_h == 2)
+        else if (kernel == CONVOLUTION_INT8_CONV3X3S2)
         {
             conv3x3s2_pack1to4_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, opt);
         }
-        else if (kernel_w == 7 && kernel_h == 7 && dilation_w == 1 && dilation_h == 1 && stride_w == 2 && stride_h == 2)
+        else if (kernel == CONVOLUTION_INT8_CONV7X7S2)
         {
             conv7x7s2_pack1to4_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, opt);
         }
-        else if (opt.use_sgemm_convolution) // TODO better condition && num_input >= 8 && num_output >= 8)
+        else if (kernel == CONVOLUTION_INT8_IM2COL_SGEMM)
         {
             convolution_im2col_sgemm_pack1to4_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, opt);
         }
@@ -2018,21 +2560,21 @@ int Convolution_x86::forward_int8_x86(const Mat& bottom_blob, Mat& top_blob, con
         }
     }
 
-    if (elempack == 8 && out_elempack_int32 == 1)
+    if (!use_amx && elempack == 8 && out_elempack_int32 == 1)
     {
-        if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
+        if (kernel == CONVOLUTION_INT8_CONV1X1S1_SGEMM)
         {
             conv1x1s1_sgemm_pack8to1_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, opt);
         }
-        else if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == 2 && stride_h == 2)
+        else if (kernel == CONVOLUTION_INT8_CONV1X1S2_SGEMM)
         {
             conv1x1s2_sgemm_pack8to1_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, opt);
         }
-        else if (opt.use_winograd_convolution && opt.use_winograd43_convolution && kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
+        else if (kernel == CONVOLUTION_INT8_WINOGRAD43)
         {
             conv3x3s1_winograd43_pack8to1_int8_sse(bottom_blob_bordered, top_blob_int32, weight_winograd43_data, opt);
         }
-        else if (opt.use_sgemm_convolution) // TODO better condition && num_input >= 8 && num_output >= 8)
+        else if (kernel == CONVOLUTION_INT8_IM2COL_SGEMM)
         {
             convolution_im2col_sgemm_pack8to1_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, opt);
         }
@@ -2043,22 +2585,22 @@ int Convolution_x86::forward_int8_x86(const Mat& bottom_blob, Mat& top_blob, con
     }
 #endif // __SSE2__
 
-    if (elempack == 1 && out_elempack_int32 == 1)
+    if (!use_amx && elempack == 1 && out_elempack_int32 == 1)
     {
-        if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
+        if (kernel == CONVOLUTION_INT8_CONV1X1S1_SGEMM)
         {
             conv1x1s1_sgemm_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, opt);
         }
-        else if (kernel_w == 1 && kernel_h == 1 && dilation_w == 1 && dilation_h == 1 && stride_w == 2 && stride_h == 2)
+        else if (kernel == CONVOLUTION_INT8_CONV1X1S2_SGEMM)
         {
             conv1x1s2_sgemm_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, opt);
         }
-        else if (opt.use_winograd_convolution && opt.use_winograd23_convolution && kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1 && num_input >= 16 && num_output >= 16)
+        else if (kernel == CONVOLUTION_INT8_WINOGRAD23)
         {
             conv3x3s1_winograd23_int8_sse(bottom_blob_bordered, top_blob_int32, weight_winograd23_data, opt);
             // conv3x3s1_winograd43_int8_sse(bottom_blob_bordered, top_blob_int32, weight_winograd43_data, opt);
         }
-        else if (opt.use_sgemm_convolution)
+        else if (kernel == CONVOLUTION_INT8_IM2COL_SGEMM)
         {
             convolution_im2col_sgemm_int8_sse(bottom_blob_bordered, top_blob_int32, weight_sgemm_data, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, opt);
         }
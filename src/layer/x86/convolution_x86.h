@@ -27,11 +27,20 @@ public:
     virtual int create_pipeline(const Option& opt);
     virtual int destroy_pipeline(const Option& opt);
 
+    virtual int save_pipeline(std::vector<Mat>& pipeline_data) const;
+    virtual int load_pipeline(const std::vector<Mat>& pipeline_data, const Option& opt);
+
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
 
     virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
 
+    virtual int forward_batch(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
+
+    virtual const char* kernel_path(const Mat& bottom_blob, const Option& opt) const;
+
 protected:
+    int create_pipeline_gemm(const Option& opt);
+    int forward_gemm(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
 #if NCNN_INT8
     int create_pipeline_int8_x86(const Option& opt);
     int forward_int8_x86(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
@@ -50,6 +59,9 @@ public:
     // forwardDilation
     Layer* convolution_dilation1;
 
+    // bf16 dot product and fp16 weight paths keep the weights packed in a gemm
+    Layer* gemm;
+
 #if NCNN_INT8
     Mat scale_in_data;
 #endif
@@ -0,0 +1,129 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#include "convolutiondepthwise3d_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX__
+#include <immintrin.h>
+#endif
+#endif // __SSE2__
+
+#include "x86_activation.h"
+#include "x86_usability.h"
+
+namespace ncnn {
+
+#include "convolutiondepthwise_packed.h"
+
+ConvolutionDepthWise3D_x86::ConvolutionDepthWise3D_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+int ConvolutionDepthWise3D_x86::create_pipeline(const Option& opt)
+{
+    const int maxk = kernel_w * kernel_h * kernel_d;
+    int channels = (weight_data_size / group) / maxk / (num_output / group) * group;
+
+    // depth-wise
+    if (channels == group && group == num_output)
+    {
+        convolutiondepthwise_transform_kernel_packed_sse(weight_data, weight_data_tm, group, maxk);
+
+        if (opt.lightmode)
+        {
+            weight_data.release();
+        }
+    }
+
+    return 0;
+}
+
+int ConvolutionDepthWise3D_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    if (weight_data_tm.empty())
+    {
+        // group convolution
+        Option opt_pack = opt;
+        opt_pack.blob_allocator = opt.workspace_allocator;
+
+        Mat bottom_blob_unpacked;
+        convert_packing(bottom_blob, bottom_blob_unpacked, 1, opt_pack);
+        if (bottom_blob_unpacked.empty())
+            return -100;
+
+        return ConvolutionDepthWise3D::forward(bottom_blob_unpacked, top_blob, opt);
+    }
+
+    size_t elemsize = bottom_blob.elemsize;
+    int elempack = bottom_blob.elempack;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+    const int kernel_extent_d = dilation_d * (kernel_d - 1) + 1;
+
+    Mat bottom_blob_bordered;
+    make_padding(bottom_blob, bottom_blob_bordered, opt);
+    if (bottom_blob_bordered.empty())
+        return -100;
+
+    const int w = bottom_blob_bordered.w;
+    const int h = bottom_blob_bordered.h;
+    const int d = bottom_blob_bordered.d;
+
+    const int outw = (w - kernel_extent_w) / stride_w + 1;
+    const int outh = (h - kernel_extent_h) / stride_h + 1;
+    const int outd = (d - kernel_extent_d) / stride_d + 1;
+
+    top_blob.create(outw, outh, outd, bottom_blob_bordered.c, elemsize, elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const int maxk = kernel_w * kernel_h * kernel_d;
+
+    // kernel offsets
+    std::vector<int> _space_ofs(maxk);
+    int* space_ofs = &_space_ofs[0];
+    {
+        int p1 = 0;
+        int p2 = 0;
+        int gap0 = w * dilation_h - kernel_w * dilation_w;
+        int gap1 = h * w * dilation_d - w * kernel_h * dilation_h;
+        for (int z = 0; z < kernel_d; z++)
+        {
+            for (int i = 0; i < kernel_h; i++)
+            {
+                for (int j = 0; j < kernel_w; j++)
+                {
+                    space_ofs[p1] = p2;
+                    p1++;
+                    p2 += dilation_w;
+                }
+                p2 += gap0;
+            }
+            p2 += gap1;
+        }
+    }
+
+    convolutiondepthwise_packed_sse(bottom_blob_bordered, top_blob, weight_data_tm, bias_data, space_ofs, maxk, stride_w, stride_h, stride_d, activation_type, activation_params, opt);
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,288 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+// direct depthwise kernels shared by the 1d and 3d depthwise layers
+// 1d blobs are (w, channels) and 3d blobs are (w, h, d, channels), space_ofs counts pixels
+
+// src = kw-kh-kd-group
+// dst = group-kw-kh-kd, one packed load of any elempack fetches the taps of consecutive channels
+static void convolutiondepthwise_transform_kernel_packed_sse(const Mat& weight_data, Mat& weight_data_tm, int group, int maxk)
+{
+    weight_data_tm.create(maxk * group);
+
+    const float* p = weight_data;
+    float* pt = weight_data_tm;
+
+    for (int g = 0; g < group; g++)
+    {
+        for (int k = 0; k < maxk; k++)
+        {
+            pt[k * group + g] = p[g * maxk + k];
+        }
+    }
+}
+
+static void convolutiondepthwise_packed_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& weight_data_tm, const Mat& bias_data, const int* space_ofs, int maxk, int stride_w, int stride_h, int stride_d, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    const int dims = bottom_blob.dims;
+    const int w = bottom_blob.w;
+    const int h = dims == 2 ? 1 : bottom_blob.h;
+    const int channels = dims == 2 ? bottom_blob.h : bottom_blob.c;
+    const int elempack = bottom_blob.elempack;
+
+    const int outw = top_blob.w;
+    const int outh = dims == 2 ? 1 : top_blob.h;
+    const int outd = dims == 2 ? 1 : top_blob.d;
+
+    const int group = channels * elempack;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int g = 0; g < channels; g++)
+    {
+        const float* ptr = dims == 2 ? bottom_blob.row(g) : bottom_blob.channel(g);
+        float* outptr = dims == 2 ? top_blob.row(g) : top_blob.channel(g);
+
+        const float* kptr = (const float*)weight_data_tm + g * elempack;
+        const float* bias = bias_data.empty() ? 0 : (const float*)bias_data + g * elempack;
+
+        for (int z = 0; z < outd; z++)
+        {
+            for (int i = 0; i < outh; i++)
+            {
+                const float* sptr0 = ptr + ((size_t)z * stride_d * h + i * stride_h) * w * elempack;
+
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+                if (elempack == 16)
+                {
+                    __m512 _bias = bias ? _mm512_loadu_ps(bias) : _mm512_setzero_ps();
+
+                    for (int j = 0; j < outw; j++)
+                    {
+                        const float* sptr = sptr0 + j * stride_w * 16;
+
+                        __m512 _sum = _bias;
+                        for (int k = 0; k < maxk; k++)
+                        {
+                            __m512 _val = _mm512_loadu_ps(sptr + space_ofs[k] * 16);
+                            __m512 _w = _mm512_loadu_ps(kptr + k * group);
+                            _sum = _mm512_fmadd_ps(_val, _w, _sum);
+                        }
+
+                        _mm512_storeu_ps(outptr, activation_avx512(_sum, activation_type, activation_params));
+                        outptr += 16;
+                    }
+                    continue;
+                }
+#endif // __AVX512F__
+                if (elempack == 8)
+                {
+                    __m256 _bias = bias ? _mm256_loadu_ps(bias) : _mm256_setzero_ps();
+
+                    for (int j = 0; j < outw; j++)
+                    {
+                        const float* sptr = sptr0 + j * stride_w * 8;
+
+                        __m256 _sum = _bias;
+                        for (int k = 0; k < maxk; k++)
+                        {
+                            __m256 _val = _mm256_loadu_ps(sptr + space_ofs[k] * 8);
+                            __m256 _w = _mm256_loadu_ps(kptr + k * group);
+                            _sum = _mm256_comp_fmadd_ps(_val, _w, _sum);
+                        }
+
+                        _mm256_storeu_ps(outptr, activation_avx(_sum, activation_type, activation_params));
+                        outptr += 8;
+                    }
+                    continue;
+                }
+#endif // __AVX__
+                if (elempack == 4)
+                {
+                    __m128 _bias = bias ? _mm_loadu_ps(bias) : _mm_setzero_ps();
+
+                    for (int j = 0; j < outw; j++)
+                    {
+                        const float* sptr = sptr0 + j * stride_w * 4;
+
+                        __m128 _sum = _bias;
+                        for (int k = 0; k < maxk; k++)
+                        {
+                            __m128 _val = _mm_loadu_ps(sptr + space_ofs[k] * 4);
+                            __m128 _w = _mm_loadu_ps(kptr + k * group);
+                            _sum = _mm_comp_fmadd_ps(_val, _w, _sum);
+                        }
+
+                        _mm_storeu_ps(outptr, activation_sse(_sum, activation_type, activation_params));
+                        outptr += 4;
+                    }
+                    continue;
+                }
+#endif // __SSE2__
+                for (int j = 0; j < outw; j++)
+                {
+                    const float* sptr = sptr0 + j * stride_w;
+
+                    float sum = bias ? bias[0] : 0.f;
+                    for (int k = 0; k < maxk; k++)
+                    {
+                        sum += sptr[space_ofs[k]] * kptr[k * group];
+                    }
+
+                    *outptr++ = activation_ss(sum, activation_type, activation_params);
+                }
+            }
+        }
+    }
+}
+
+static void deconvolutiondepthwise_packed_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& weight_data_tm, const Mat& bias_data, const int* space_ofs, int maxk, int stride_w, int stride_h, int stride_d, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    const int dims = bottom_blob.dims;
+    const int w = bottom_blob.w;
+    const int h = dims == 2 ? 1 : bottom_blob.h;
+    const int d = dims == 2 ? 1 : bottom_blob.d;
+    const int channels = dims == 2 ? bottom_blob.h : bottom_blob.c;
+    const int elempack = bottom_blob.elempack;
+
+    const int outw = top_blob.w;
+    const int outh = dims == 2 ? 1 : top_blob.h;
+    const int outsize = outw * outh * (dims == 2 ? 1 : top_blob.d);
+
+    const int group = channels * elempack;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int g = 0; g < channels; g++)
+    {
+        const float* ptr = dims == 2 ? bottom_blob.row(g) : bottom_blob.channel(g);
+        float* outptr = dims == 2 ? top_blob.row(g) : top_blob.channel(g);
+
+        const float* kptr = (const float*)weight_data_tm + g * elempack;
+        const float* bias = bias_data.empty() ? 0 : (const float*)bias_data + g * elempack;
+
+        for (int i = 0; i < outsize; i++)
+        {
+            for (int e = 0; e < elempack; e++)
+            {
+                outptr[i * elempack + e] = bias ? bias[e] : 0.f;
+            }
+        }
+
+        // scatter every input pixel onto the strided output positions it touches
+        for (int z = 0; z < d; z++)
+        {
+            for (int i = 0; i < h; i++)
+            {
+                float* outptr0 = outptr + ((size_t)z * stride_d * outh + i * stride_h) * outw * elempack;
+
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+                if (elempack == 16)
+                {
+                    for (int j = 0; j < w; j++)
+                    {
+                        float* sptr = outptr0 + j * stride_w * 16;
+
+                        __m512 _val = _mm512_loadu_ps(ptr);
+                        for (int k = 0; k < maxk; k++)
+                        {
+                            float* optr = sptr + space_ofs[k] * 16;
+                            __m512 _w = _mm512_loadu_ps(kptr + k * group);
+                            _mm512_storeu_ps(optr, _mm512_fmadd_ps(_val, _w, _mm512_loadu_ps(optr)));
+                        }
+                        ptr += 16;
+                    }
+                    continue;
+                }
+#endif // __AVX512F__
+                if (elempack == 8)
+                {
+                    for (int j = 0; j < w; j++)
+                    {
+                        float* sptr = outptr0 + j * stride_w * 8;
+
+                        __m256 _val = _mm256_loadu_ps(ptr);
+                        for (int k = 0; k < maxk; k++)
+                        {
+                            float* optr = sptr + space_ofs[k] * 8;
+                            __m256 _w = _mm256_loadu_ps(kptr + k * group);
+                            _mm256_storeu_ps(optr, _mm256_comp_fmadd_ps(_val, _w, _mm256_loadu_ps(optr)));
+                        }
+                        ptr += 8;
+                    }
+                    continue;
+                }
+#endif // __AVX__
+                if (elempack == 4)
+                {
+                    for (int j = 0; j < w; j++)
+                    {
+                        float* sptr = outptr0 + j * stride_w * 4;
+
+                        __m128 _val = _mm_loadu_ps(ptr);
+                        for (int k = 0; k < maxk; k++)
+                        {
+                            float* optr = sptr + space_ofs[k] * 4;
+                            __m128 _w = _mm_loadu_ps(kptr + k * group);
+                            _mm_storeu_ps(optr, _mm_comp_fmadd_ps(_val, _w, _mm_loadu_ps(optr)));
+                        }
+                        ptr += 4;
+                    }
+                    continue;
+                }
+#endif // __SSE2__
+                for (int j = 0; j < w; j++)
+                {
+                    float* sptr = outptr0 + j * stride_w;
+
+                    const float val = *ptr++;
+                    for (int k = 0; k < maxk; k++)
+                    {
+                        sptr[space_ofs[k]] += val * kptr[k * group];
+                    }
+                }
+            }
+        }
+
+        if (activation_type == 0)
+            continue;
+
+        int i = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+        for (; i + 15 < outsize * elempack; i += 16)
+        {
+            _mm512_storeu_ps(outptr + i, activation_avx512(_mm512_loadu_ps(outptr + i), activation_type, activation_params));
+        }
+#endif // __AVX512F__
+        for (; i + 7 < outsize * elempack; i += 8)
+        {
+            _mm256_storeu_ps(outptr + i, activation_avx(_mm256_loadu_ps(outptr + i), activation_type, activation_params));
+        }
+#endif // __AVX__
+        for (; i + 3 < outsize * elempack; i += 4)
+        {
+            _mm_storeu_ps(outptr + i, activation_sse(_mm_loadu_ps(outptr + i), activation_type, activation_params));
+        }
+#endif // __SSE2__
+        for (; i < outsize * elempack; i++)
+        {
+            outptr[i] = activation_ss(outptr[i], activation_type, activation_params);
+        }
+    }
+}
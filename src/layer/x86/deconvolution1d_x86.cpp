@@ -0,0 +1,212 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#include "deconvolution1d_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX__
+#include <immintrin.h>
+#endif
+#endif // __SSE2__
+
+#include "x86_activation.h"
+#include "x86_usability.h"
+
+namespace ncnn {
+
+#include "convolution_sgemm.h"
+
+#if __SSE2__
+#include "convolution_sgemm_pack4.h"
+#include "convolution_sgemm_pack1to4.h"
+#include "convolution_sgemm_pack4to1.h"
+
+#if __AVX__
+#include "convolution_sgemm_pack8.h"
+#include "convolution_sgemm_pack4to8.h"
+#include "convolution_sgemm_pack1to8.h"
+#include "convolution_sgemm_pack8to4.h"
+#include "convolution_sgemm_pack8to1.h"
+
+#if __AVX512F__
+#include "convolution_sgemm_pack16.h"
+#include "convolution_sgemm_pack8to16.h"
+#include "convolution_sgemm_pack4to16.h"
+#include "convolution_sgemm_pack1to16.h"
+#include "convolution_sgemm_pack16to8.h"
+#include "convolution_sgemm_pack16to4.h"
+#include "convolution_sgemm_pack16to1.h"
+#endif // __AVX512F__
+#endif // __AVX__
+#endif // __SSE2__
+
+#include "convolution_sgemm_packed.h"
+
+Deconvolution1D_x86::Deconvolution1D_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+
+    activation = 0;
+}
+
+int Deconvolution1D_x86::create_pipeline(const Option& opt)
+{
+    activation = create_activation_layer(activation_type, activation_params, opt);
+
+    const int maxk = kernel_w;
+    const int num_input = weight_data_size / maxk / num_output;
+
+    int elempack = 1;
+    int out_elempack = 1;
+#if __SSE2__
+    if (opt.use_packing_layout)
+    {
+#if __AVX512F__
+        elempack = num_input % 16 == 0 ? 16 : num_input % 8 == 0 ? 8 : num_input % 4 == 0 ? 4 : 1;
+        out_elempack = num_output % 16 == 0 ? 16 : num_output % 8 == 0 ? 8 : num_output % 4 == 0 ? 4 : 1;
+#elif __AVX__
+        elempack = num_input % 8 == 0 ? 8 : num_input % 4 == 0 ? 4 : 1;
+        out_elempack = num_output % 8 == 0 ? 8 : num_output % 4 == 0 ? 4 : 1;
+#else
+        elempack = num_input % 4 == 0 ? 4 : 1;
+        out_elempack = num_output % 4 == 0 ? 4 : 1;
+#endif
+    }
+#endif // __SSE2__
+
+    // src = k-inch-outch
+    // dst = inch-outch-k, every tap becomes num_output rows of a 1x1 convolution
+    Mat weight_data_r(num_input * num_output * maxk);
+    {
+        const float* p = weight_data;
+        float* pt = weight_data_r;
+
+        for (int o = 0; o < num_output; o++)
+        {
+            for (int q = 0; q < num_input; q++)
+            {
+                for (int k = 0; k < maxk; k++)
+                {
+                    pt[(k * num_output + o) * num_input + q] = p[k];
+                }
+
+                p += maxk;
+            }
+        }
+    }
+
+    convolution_im2col_sgemm_transform_kernel_packed_sse(weight_data_r, weight_data_tm, num_input, maxk * num_output, 1, elempack, out_elempack);
+
+    if (opt.lightmode)
+    {
+        weight_data.release();
+    }
+
+    return 0;
+}
+
+int Deconvolution1D_x86::destroy_pipeline(const Option& opt)
+{
+    if (activation)
+    {
+        activation->destroy_pipeline(opt);
+        delete activation;
+        activation = 0;
+    }
+
+    return 0;
+}
+
+int Deconvolution1D_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    const int w = bottom_blob.w;
+    const int h = bottom_blob.h;
+    size_t elemsize = bottom_blob.elemsize;
+    int elempack = bottom_blob.elempack;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+
+    int outw = (w - 1) * stride_w + kernel_extent_w + output_pad_right;
+    int out_elempack = 1;
+#if __SSE2__
+    if (opt.use_packing_layout)
+    {
+#if __AVX512F__
+        out_elempack = num_output % 16 == 0 ? 16 : num_output % 8 == 0 ? 8 : num_output % 4 == 0 ? 4 : 1;
+#elif __AVX__
+        out_elempack = num_output % 8 == 0 ? 8 : num_output % 4 == 0 ? 4 : 1;
+#else
+        out_elempack = num_output % 4 == 0 ? 4 : 1;
+#endif
+    }
+#endif // __SSE2__
+    size_t out_elemsize = elemsize / elempack * out_elempack;
+
+    Mat top_blob_bordered;
+    if (pad_left > 0 || pad_right > 0 || output_w > 0)
+    {
+        top_blob_bordered.create(outw, num_output / out_elempack, out_elemsize, out_elempack, opt.workspace_allocator);
+    }
+    else
+    {
+        top_blob_bordered = top_blob;
+        top_blob_bordered.create(outw, num_output / out_elempack, out_elemsize, out_elempack, opt.blob_allocator);
+    }
+    if (top_blob_bordered.empty())
+        return -100;
+
+    const int maxk = kernel_w;
+
+    // every input row is one im2col channel of a 1x1 convolution
+    Mat bottom_im2col(w, 1, h, bottom_blob.data, elemsize, elempack);
+    bottom_im2col.cstep = w;
+
+    Mat col(w, 1, maxk * num_output / out_elempack, out_elemsize, out_elempack, opt.workspace_allocator);
+    if (col.empty())
+        return -100;
+
+    im2col_sgemm_packed_sse(bottom_im2col, col, weight_data_tm, Mat(), opt);
+
+    deconvolution_col2im_packed_sse(col, top_blob_bordered, bias_data, w, 1, 1, kernel_w, 1, 1, dilation_w, 1, 1, stride_w, 1, 1, opt);
+
+    if (activation)
+    {
+        activation->forward_inplace(top_blob_bordered, opt);
+    }
+
+    if (top_blob_bordered.elempack == 1)
+    {
+        cut_padding(top_blob_bordered, top_blob, opt);
+        if (top_blob.empty())
+            return -100;
+    }
+    else
+    {
+        // the crop takes h as unpacked rows, view the packed rows as channels so that only w is cut
+        Mat top_blob_cut;
+        cut_padding(top_blob_bordered.reshape(outw, 1, top_blob_bordered.h), top_blob_cut, opt);
+        if (top_blob_cut.empty())
+            return -100;
+
+        top_blob = top_blob_cut.reshape(top_blob_cut.w, top_blob_cut.c);
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,127 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#include "deconvolutiondepthwise1d_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX__
+#include <immintrin.h>
+#endif
+#endif // __SSE2__
+
+#include "x86_activation.h"
+#include "x86_usability.h"
+
+namespace ncnn {
+
+#include "convolutiondepthwise_packed.h"
+
+DeconvolutionDepthWise1D_x86::DeconvolutionDepthWise1D_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+int DeconvolutionDepthWise1D_x86::create_pipeline(const Option& opt)
+{
+    const int maxk = kernel_w;
+    int channels = (weight_data_size / group) / maxk / (num_output / group) * group;
+
+    // depth-wise
+    if (channels == group && group == num_output)
+    {
+        convolutiondepthwise_transform_kernel_packed_sse(weight_data, weight_data_tm, group, maxk);
+
+        if (opt.lightmode)
+        {
+            weight_data.release();
+        }
+    }
+
+    return 0;
+}
+
+int DeconvolutionDepthWise1D_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    if (weight_data_tm.empty())
+    {
+        // group deconvolution
+        Option opt_pack = opt;
+        opt_pack.blob_allocator = opt.workspace_allocator;
+
+        Mat bottom_blob_unpacked;
+        convert_packing(bottom_blob, bottom_blob_unpacked, 1, opt_pack);
+        if (bottom_blob_unpacked.empty())
+            return -100;
+
+        return DeconvolutionDepthWise1D::forward(bottom_blob_unpacked, top_blob, opt);
+    }
+
+    int w = bottom_blob.w;
+    size_t elemsize = bottom_blob.elemsize;
+    int elempack = bottom_blob.elempack;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+
+    int outw = (w - 1) * stride_w + kernel_extent_w + output_pad_right;
+
+    Mat top_blob_bordered;
+    if (pad_left > 0 || pad_right > 0 || output_w > 0)
+    {
+        top_blob_bordered.create(outw, bottom_blob.h, elemsize, elempack, opt.workspace_allocator);
+    }
+    else
+    {
+        top_blob_bordered = top_blob;
+        top_blob_bordered.create(outw, bottom_blob.h, elemsize, elempack, opt.blob_allocator);
+    }
+    if (top_blob_bordered.empty())
+        return -100;
+
+    const int maxk = kernel_w;
+
+    // kernel offsets
+    std::vector<int> _space_ofs(maxk);
+    int* space_ofs = &_space_ofs[0];
+    for (int k = 0; k < maxk; k++)
+    {
+        space_ofs[k] = k * dilation_w;
+    }
+
+    deconvolutiondepthwise_packed_sse(bottom_blob, top_blob_bordered, weight_data_tm, bias_data, space_ofs, maxk, stride_w, 1, 1, activation_type, activation_params, opt);
+
+    if (top_blob_bordered.elempack == 1)
+    {
+        cut_padding(top_blob_bordered, top_blob, opt);
+        if (top_blob.empty())
+            return -100;
+    }
+    else
+    {
+        // the crop takes h as unpacked rows, view the packed rows as channels so that only w is cut
+        Mat top_blob_cut;
+        cut_padding(top_blob_bordered.reshape(outw, 1, top_blob_bordered.h), top_blob_cut, opt);
+        if (top_blob_cut.empty())
+            return -100;
+
+        top_blob = top_blob_cut.reshape(top_blob_cut.w, top_blob_cut.c);
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -222,8 +222,10 @@ int DeformableConv2D_x86::forward(const std::vector<Mat>& bottom_blobs, std::vec
     // call InnerProduct
     inner_product->forward(im2col, output, opt);
     ncnn::Mat output_t;
-    // call Permute
-    permute->forward(output, output_t, opt);
+    // call Permute, the reshape below expects the transposed result unpacked
+    Option opt_unpacked = opt;
+    opt_unpacked.use_packing_layout = false;
+    permute->forward(output, output_t, opt_unpacked);
     output_t = output_t.reshape(out_w, out_h, num_output);
     top_blobs[0] = output_t;
     return 0;
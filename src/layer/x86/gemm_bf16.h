@@ -0,0 +1,679 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// bf16 dot product gemm
+// A and B tiles hold bf16 pairs adjacent along k so that one vdpbf16ps consumes two k steps
+// odd k tails are padded with zero
+
+#if NCNN_RUNTIME_CPU && NCNN_AVX512BF16 && __AVX512F__ && !__AVX512BF16__
+void gemm_tile_bf16_avx512bf16(const unsigned short* AT_tile, const unsigned short* BT_tile, float* topT, int max_ii, int max_jj, int max_kk, int out_hstep, bool k_begin);
+#endif
+
+#if NCNN_RUNTIME_CPU && NCNN_AVX512AMX && __AVX512F__ && !__AMX_BF16__
+void gemm_tile_bf16_amx_avx512amx(const unsigned short* AT_tile, const unsigned short* BT_tile, float* topT, int max_ii, int max_jj, int max_kk, int out_hstep, bool k_begin);
+#endif
+
+static bool gemm_support_bf16_compute()
+{
+#if __AVX512BF16__
+    return true;
+#elif NCNN_RUNTIME_CPU && NCNN_AVX512BF16 && __AVX512F__
+    return ncnn::cpu_support_x86_avx512_bf16();
+#else
+    return false;
+#endif
+}
+
+// amx bf16 implies avx512 bf16, the tails of the tile kernel run on vdpbf16ps
+static bool gemm_support_amx_bf16()
+{
+#if __AMX_BF16__
+    return true;
+#elif NCNN_RUNTIME_CPU && NCNN_AVX512AMX && __AVX512F__
+    return ncnn::cpu_support_x86_amx_bf16() && ncnn::cpu_support_x86_avx512_bf16();
+#else
+    return false;
+#endif
+}
+
+static NCNN_FORCEINLINE unsigned short float32_to_bfloat16_rne(float value)
+{
+    // round to nearest even like vcvtneps2bf16, truncation would bias every product towards zero
+    union
+    {
+        unsigned int u;
+        float f;
+    } tmp;
+    tmp.f = value;
+    tmp.u += 0x7fff + ((tmp.u >> 16) & 1);
+    return tmp.u >> 16;
+}
+
+static NCNN_FORCEINLINE unsigned short gemm_load_bf16(const Mat& m, int y, int x)
+{
+    return m.elembits() == 16 ? m.row<const unsigned short>(y)[x] : float32_to_bfloat16_rne(m.row(y)[x]);
+}
+
+static void pack_A_tile_bf16(const Mat& A, unsigned short* pp, int i, int max_ii, int k, int max_kk, int transA)
+{
+    // 8 rows interleaved along k pairs, then the remaining rows one by one
+    const int max_kk2 = (max_kk + 1) / 2 * 2;
+
+    int ii = 0;
+    for (; ii + 7 < max_ii; ii += 8)
+    {
+        for (int kk = 0; kk < max_kk2; kk += 2)
+        {
+            for (int r = 0; r < 8; r++)
+            {
+                const int y = i + ii + r;
+
+                pp[0] = transA == 0 ? gemm_load_bf16(A, y, k + kk) : gemm_load_bf16(A, k + kk, y);
+                pp[1] = kk + 1 == max_kk ? 0 : transA == 0 ? gemm_load_bf16(A, y, k + kk + 1) : gemm_load_bf16(A, k + kk + 1, y);
+                pp += 2;
+            }
+        }
+    }
+    for (; ii < max_ii; ii++)
+    {
+        const int y = i + ii;
+
+        for (int kk = 0; kk < max_kk; kk++)
+        {
+            pp[kk] = transA == 0 ? gemm_load_bf16(A, y, k + kk) : gemm_load_bf16(A, k + kk, y);
+        }
+        if (max_kk2 != max_kk)
+        {
+            pp[max_kk] = 0;
+        }
+
+        pp += max_kk2;
+    }
+}
+
+static void pack_A_tile_bf16_amx(const Mat& A, unsigned short* pp, int i, int max_ii, int k, int max_kk, int transA)
+{
+    // plain rows for the amx A tiles, k padded to 32 and rows padded to 16 with zero
+    const int max_kk32 = (max_kk + 31) / 32 * 32;
+    const int max_ii16 = (max_ii + 15) / 16 * 16;
+
+    for (int ii = 0; ii < max_ii16; ii++)
+    {
+        const int y = i + ii;
+
+        int kk = 0;
+        if (ii < max_ii && transA == 0 && A.elembits() == 16)
+        {
+            memcpy(pp, A.row<const unsigned short>(y) + k, max_kk * sizeof(unsigned short));
+            kk = max_kk;
+        }
+        else if (ii < max_ii && transA == 0)
+        {
+            const float* ptr = A.row(y) + k;
+            for (; kk < max_kk; kk++)
+            {
+                pp[kk] = float32_to_bfloat16_rne(ptr[kk]);
+            }
+        }
+        else if (ii < max_ii)
+        {
+            for (; kk < max_kk; kk++)
+            {
+                pp[kk] = gemm_load_bf16(A, k + kk, y);
+            }
+        }
+        for (; kk < max_kk32; kk++)
+        {
+            pp[kk] = 0;
+        }
+
+        pp += max_kk32;
+    }
+}
+
+static void pack_B_panel_bf16(const Mat& B, unsigned short* pp, int j, int width, int k, int max_kk, int transB)
+{
+    const int max_kk2 = (max_kk + 1) / 2 * 2;
+
+    for (int kk = 0; kk < max_kk2; kk += 2)
+    {
+        for (int w = 0; w < width; w++)
+        {
+            const int x = j + w;
+
+            pp[0] = transB == 0 ? gemm_load_bf16(B, k + kk, x) : gemm_load_bf16(B, x, k + kk);
+            pp[1] = kk + 1 == max_kk ? 0 : transB == 0 ? gemm_load_bf16(B, k + kk + 1, x) : gemm_load_bf16(B, x, k + kk + 1);
+            pp += 2;
+        }
+    }
+}
+
+static void pack_B_tile_bf16(const Mat& B, unsigned short* pp, int j, int max_jj, int k, int max_kk, int transB)
+{
+    const int max_kk2 = (max_kk + 1) / 2 * 2;
+
+    int jj = 0;
+    for (; jj + 15 < max_jj; jj += 16)
+    {
+        pack_B_panel_bf16(B, pp, j + jj, 16, k, max_kk, transB);
+        pp += 16 * max_kk2;
+    }
+    for (; jj + 7 < max_jj; jj += 8)
+    {
+        pack_B_panel_bf16(B, pp, j + jj, 8, k, max_kk, transB);
+        pp += 8 * max_kk2;
+    }
+    for (; jj + 3 < max_jj; jj += 4)
+    {
+        pack_B_panel_bf16(B, pp, j + jj, 4, k, max_kk, transB);
+        pp += 4 * max_kk2;
+    }
+    for (; jj < max_jj; jj++)
+    {
+        pack_B_panel_bf16(B, pp, j + jj, 1, k, max_kk, transB);
+        pp += max_kk2;
+    }
+}
+
+static void gemm_tile_bf16(const unsigned short* AT_tile, const unsigned short* BT_tile, float* topT, int max_ii, int max_jj, int max_kk, int out_hstep, bool k_begin)
+{
+#if NCNN_RUNTIME_CPU && NCNN_AVX512BF16 && __AVX512F__ && !__AVX512BF16__
+    if (ncnn::cpu_support_x86_avx512_bf16())
+    {
+        gemm_tile_bf16_avx512bf16(AT_tile, BT_tile, topT, max_ii, max_jj, max_kk, out_hstep, k_begin);
+        return;
+    }
+#endif
+
+#if __AVX512BF16__
+    const int max_kk2 = (max_kk + 1) / 2 * 2;
+
+    const unsigned short* pAT = AT_tile;
+
+    int ii = 0;
+    for (; ii + 7 < max_ii; ii += 8)
+    {
+        float* outptr0 = topT + ii * out_hstep;
+
+        const unsigned short* pB = BT_tile;
+
+        int jj = 0;
+        for (; jj + 15 < max_jj; jj += 16)
+        {
+            float* outptr = outptr0 + jj;
+
+            const int* pA = (const int*)pAT;
+
+            __m512 _sum0;
+            __m512 _sum1;
+            __m512 _sum2;
+            __m512 _sum3;
+            __m512 _sum4;
+            __m512 _sum5;
+            __m512 _sum6;
+            __m512 _sum7;
+
+            if (k_begin)
+            {
+                _sum0 = _mm512_setzero_ps();
+                _sum1 = _mm512_setzero_ps();
+                _sum2 = _mm512_setzero_ps();
+                _sum3 = _mm512_setzero_ps();
+                _sum4 = _mm512_setzero_ps();
+                _sum5 = _mm512_setzero_ps();
+                _sum6 = _mm512_setzero_ps();
+                _sum7 = _mm512_setzero_ps();
+            }
+            else
+            {
+                _sum0 = _mm512_loadu_ps(outptr);
+                _sum1 = _mm512_loadu_ps(outptr + out_hstep);
+                _sum2 = _mm512_loadu_ps(outptr + out_hstep * 2);
+                _sum3 = _mm512_loadu_ps(outptr + out_hstep * 3);
+                _sum4 = _mm512_loadu_ps(outptr + out_hstep * 4);
+                _sum5 = _mm512_loadu_ps(outptr + out_hstep * 5);
+                _sum6 = _mm512_loadu_ps(outptr + out_hstep * 6);
+                _sum7 = _mm512_loadu_ps(outptr + out_hstep * 7);
+            }
+
+            for (int kk = 0; kk < max_kk2; kk += 2)
+            {
+                __m512bh _b = (__m512bh)_mm512_loadu_si512((const __m512i*)pB);
+
+                _sum0 = _mm512_dpbf16_ps(_sum0, (__m512bh)_mm512_set1_epi32(pA[0]), _b);
+                _sum1 = _mm512_dpbf16_ps(_sum1, (__m512bh)_mm512_set1_epi32(pA[1]), _b);
+                _sum2 = _mm512_dpbf16_ps(_sum2, (__m512bh)_mm512_set1_epi32(pA[2]), _b);
+                _sum3 = _mm512_dpbf16_ps(_sum3, (__m512bh)_mm512_set1_epi32(pA[3]), _b);
+                _sum4 = _mm512_dpbf16_ps(_sum4, (__m512bh)_mm512_set1_epi32(pA[4]), _b);
+                _sum5 = _mm512_dpbf16_ps(_sum5, (__m512bh)_mm512_set1_epi32(pA[5]), _b);
+                _sum6 = _mm512_dpbf16_ps(_sum6, (__m512bh)_mm512_set1_epi32(pA[6]), _b);
+                _sum7 = _mm512_dpbf16_ps(_sum7, (__m512bh)_mm512_set1_epi32(pA[7]), _b);
+
+                pA += 8;
+                pB += 32;
+            }
+
+            _mm512_storeu_ps(outptr, _sum0);
+            _mm512_storeu_ps(outptr + out_hstep, _sum1);
+            _mm512_storeu_ps(outptr + out_hstep * 2, _sum2);
+            _mm512_storeu_ps(outptr + out_hstep * 3, _sum3);
+            _mm512_storeu_ps(outptr + out_hstep * 4, _sum4);
+            _mm512_storeu_ps(outptr + out_hstep * 5, _sum5);
+            _mm512_storeu_ps(outptr + out_hstep * 6, _sum6);
+            _mm512_storeu_ps(outptr + out_hstep * 7, _sum7);
+        }
+        for (; jj + 7 < max_jj; jj += 8)
+        {
+            float* outptr = outptr0 + jj;
+
+            const int* pA = (const int*)pAT;
+
+            __m256 _sum[8];
+            for (int r = 0; r < 8; r++)
+            {
+                _sum[r] = k_begin ? _mm256_setzero_ps() : _mm256_loadu_ps(outptr + out_hstep * r);
+            }
+
+            for (int kk = 0; kk < max_kk2; kk += 2)
+            {
+                __m256bh _b = (__m256bh)_mm256_loadu_si256((const __m256i*)pB);
+
+                for (int r = 0; r < 8; r++)
+                {
+                    _sum[r] = _mm256_dpbf16_ps(_sum[r], (__m256bh)_mm256_set1_epi32(pA[r]), _b);
+                }
+
+                pA += 8;
+                pB += 16;
+            }
+
+            for (int r = 0; r < 8; r++)
+            {
+                _mm256_storeu_ps(outptr + out_hstep * r, _sum[r]);
+            }
+        }
+        for (; jj + 3 < max_jj; jj += 4)
+        {
+            float* outptr = outptr0 + jj;
+
+            const int* pA = (const int*)pAT;
+
+            __m128 _sum[8];
+            for (int r = 0; r < 8; r++)
+            {
+                _sum[r] = k_begin ? _mm_setzero_ps() : _mm_loadu_ps(outptr + out_hstep * r);
+            }
+
+            for (int kk = 0; kk < max_kk2; kk += 2)
+            {
+                __m128bh _b = (__m128bh)_mm_loadu_si128((const __m128i*)pB);
+
+                for (int r = 0; r < 8; r++)
+                {
+                    _sum[r] = _mm_dpbf16_ps(_sum[r], (__m128bh)_mm_set1_epi32(pA[r]), _b);
+                }
+
+                pA += 8;
+                pB += 8;
+            }
+
+            for (int r = 0; r < 8; r++)
+            {
+                _mm_storeu_ps(outptr + out_hstep * r, _sum[r]);
+            }
+        }
+        for (; jj < max_jj; jj++)
+        {
+            float* outptr = outptr0 + jj;
+
+            const unsigned short* pA = pAT;
+
+            float sum[8];
+            for (int r = 0; r < 8; r++)
+            {
+                sum[r] = k_begin ? 0.f : outptr[out_hstep * r];
+            }
+
+            for (int kk = 0; kk < max_kk2; kk += 2)
+            {
+                const float b0 = bfloat16_to_float32(pB[0]);
+                const float b1 = bfloat16_to_float32(pB[1]);
+
+                for (int r = 0; r < 8; r++)
+                {
+                    sum[r] += bfloat16_to_float32(pA[r * 2]) * b0 + bfloat16_to_float32(pA[r * 2 + 1]) * b1;
+                }
+
+                pA += 16;
+                pB += 2;
+            }
+
+            for (int r = 0; r < 8; r++)
+            {
+                outptr[out_hstep * r] = sum[r];
+            }
+        }
+
+        pAT += 8 * max_kk2;
+    }
+    for (; ii < max_ii; ii++)
+    {
+        float* outptr0 = topT + ii * out_hstep;
+
+        const unsigned short* pB = BT_tile;
+
+        int jj = 0;
+        for (; jj + 15 < max_jj; jj += 16)
+        {
+            const int* pA = (const int*)pAT;
+
+            // two accumulators hide the vdpbf16ps latency
+            __m512 _sum0 = k_begin ? _mm512_setzero_ps() : _mm512_loadu_ps(outptr0 + jj);
+            __m512 _sum1 = _mm512_setzero_ps();
+
+            int kk = 0;
+            for (; kk + 3 < max_kk2; kk += 4)
+            {
+                _sum0 = _mm512_dpbf16_ps(_sum0, (__m512bh)_mm512_set1_epi32(pA[0]), (__m512bh)_mm512_loadu_si512((const __m512i*)pB));
+                _sum1 = _mm512_dpbf16_ps(_sum1, (__m512bh)_mm512_set1_epi32(pA[1]), (__m512bh)_mm512_loadu_si512((const __m512i*)(pB + 32)));
+
+                pA += 2;
+                pB += 64;
+            }
+            for (; kk < max_kk2; kk += 2)
+            {
+                _sum0 = _mm512_dpbf16_ps(_sum0, (__m512bh)_mm512_set1_epi32(pA[0]), (__m512bh)_mm512_loadu_si512((const __m512i*)pB));
+
+                pA += 1;
+                pB += 32;
+            }
+
+            _mm512_storeu_ps(outptr0 + jj, _mm512_add_ps(_sum0, _sum1));
+        }
+        for (; jj + 7 < max_jj; jj += 8)
+        {
+            const int* pA = (const int*)pAT;
+
+            __m256 _sum = k_begin ? _mm256_setzero_ps() : _mm256_loadu_ps(outptr0 + jj);
+
+            for (int kk = 0; kk < max_kk2; kk += 2)
+            {
+                _sum = _mm256_dpbf16_ps(_sum, (__m256bh)_mm256_set1_epi32(pA[0]), (__m256bh)_mm256_loadu_si256((const __m256i*)pB));
+
+                pA += 1;
+                pB += 16;
+            }
+
+            _mm256_storeu_ps(outptr0 + jj, _sum);
+        }
+        for (; jj + 3 < max_jj; jj += 4)
+        {
+            const int* pA = (const int*)pAT;
+
+            __m128 _sum = k_begin ? _mm_setzero_ps() : _mm_loadu_ps(outptr0 + jj);
+
+            for (int kk = 0; kk < max_kk2; kk += 2)
+            {
+                _sum = _mm_dpbf16_ps(_sum, (__m128bh)_mm_set1_epi32(pA[0]), (__m128bh)_mm_loadu_si128((const __m128i*)pB));
+
+                pA += 1;
+                pB += 8;
+            }
+
+            _mm_storeu_ps(outptr0 + jj, _sum);
+        }
+        for (; jj < max_jj; jj++)
+        {
+            const unsigned short* pA = pAT;
+
+            float sum = k_begin ? 0.f : outptr0[jj];
+
+            for (int kk = 0; kk < max_kk2; kk++)
+            {
+                sum += bfloat16_to_float32(pA[kk]) * bfloat16_to_float32(pB[kk]);
+            }
+
+            pB += max_kk2;
+
+            outptr0[jj] = sum;
+        }
+
+        pAT += max_kk2;
+    }
+#else // __AVX512BF16__
+    // unreachable, gemm_support_bf16_compute() guards the caller
+    (void)AT_tile;
+    (void)BT_tile;
+    (void)topT;
+    (void)max_ii;
+    (void)max_jj;
+    (void)max_kk;
+    (void)out_hstep;
+    (void)k_begin;
+#endif // __AVX512BF16__
+}
+
+static void gemm_tile_bf16_amx(const unsigned short* AT_tile, const unsigned short* BT_tile, float* topT, int max_ii, int max_jj, int max_kk, int out_hstep, bool k_begin)
+{
+#if NCNN_RUNTIME_CPU && NCNN_AVX512AMX && __AVX512F__ && !__AMX_BF16__
+    if (ncnn::cpu_support_x86_amx_bf16())
+    {
+        gemm_tile_bf16_amx_avx512amx(AT_tile, BT_tile, topT, max_ii, max_jj, max_kk, out_hstep, k_begin);
+        return;
+    }
+#endif
+
+#if __AMX_BF16__
+    // AT_tile comes from pack_A_tile_bf16_amx, BT_tile keeps the pack_B_tile_bf16 panels
+    // a 16 wide B panel is already a sequence of 16 k pair x 16 n tiles
+    const int max_kk2 = (max_kk + 1) / 2 * 2;
+    const int max_kk32 = (max_kk + 31) / 32 * 32;
+    const int nn_kk = max_kk32 / 32;
+
+    // the last B tile reads only the remaining k pairs, the rest of it stays zero
+    const int tail_kk2 = max_kk2 - (nn_kk - 1) * 32;
+
+    const int max_jj16 = max_jj / 16 * 16;
+
+    // C tiles touching the row tail go through a 16 row buffer
+    float tmp[2][2][256];
+    unsigned short B_tail[2][512];
+    memset(B_tail, 0, sizeof(B_tail));
+
+    amx_tile_config_16x64();
+
+    for (int ii = 0; ii < max_ii; ii += 32)
+    {
+        const bool has_m1 = ii + 16 < max_ii;
+
+        const int max_r0 = std::min(16, max_ii - ii);
+        const int max_r1 = has_m1 ? std::min(16, max_ii - ii - 16) : 0;
+
+        const unsigned short* pA0 = AT_tile + ii * max_kk32;
+        const unsigned short* pA1 = pA0 + 16 * max_kk32;
+
+        for (int jj = 0; jj < max_jj16; jj += 32)
+        {
+            const bool has_n1 = jj + 16 < max_jj16;
+
+            float* c[2][2];
+            int c_stride[2][2];
+            for (int a = 0; a < 2; a++)
+            {
+                const int max_r = a == 0 ? max_r0 : max_r1;
+
+                for (int b = 0; b < 2; b++)
+                {
+                    float* outptr = topT + (ii + a * 16) * out_hstep + jj + b * 16;
+
+                    if (max_r == 16)
+                    {
+                        c[a][b] = outptr;
+                        c_stride[a][b] = out_hstep * 4;
+                        continue;
+                    }
+
+                    c[a][b] = tmp[a][b];
+                    c_stride[a][b] = 64;
+
+                    if (!k_begin && (b == 0 || has_n1))
+                    {
+                        for (int r = 0; r < max_r; r++)
+                        {
+                            memcpy(tmp[a][b] + r * 16, outptr + r * out_hstep, 64);
+                        }
+                    }
+                }
+            }
+
+            if (k_begin)
+            {
+                _tile_zero(0);
+                _tile_zero(1);
+                _tile_zero(2);
+                _tile_zero(3);
+            }
+            else
+            {
+                _tile_loadd(0, c[0][0], c_stride[0][0]);
+                if (has_n1) _tile_loadd(1, c[0][1], c_stride[0][1]);
+                if (has_m1) _tile_loadd(2, c[1][0], c_stride[1][0]);
+                if (has_m1 && has_n1) _tile_loadd(3, c[1][1], c_stride[1][1]);
+            }
+
+            const unsigned short* pB0 = BT_tile + jj * max_kk2;
+            const unsigned short* pB1 = pB0 + 16 * max_kk2;
+
+            for (int q = 0; q < nn_kk; q++)
+            {
+                const unsigned short* pB0q = pB0 + q * 512;
+                const unsigned short* pB1q = pB1 + q * 512;
+
+                if (q == nn_kk - 1 && tail_kk2 != 32)
+                {
+                    memcpy(B_tail[0], pB0q, tail_kk2 * 16 * sizeof(unsigned short));
+                    pB0q = B_tail[0];
+                    if (has_n1)
+                    {
+                        memcpy(B_tail[1], pB1q, tail_kk2 * 16 * sizeof(unsigned short));
+                        pB1q = B_tail[1];
+                    }
+                }
+
+                _tile_loadd(4, pA0 + q * 32, max_kk32 * 2);
+                _tile_loadd(6, pB0q, 64);
+                _tile_dpbf16ps(0, 4, 6);
+                if (has_n1)
+                {
+                    _tile_loadd(7, pB1q, 64);
+                    _tile_dpbf16ps(1, 4, 7);
+                }
+                if (has_m1)
+                {
+                    _tile_loadd(5, pA1 + q * 32, max_kk32 * 2);
+                    _tile_dpbf16ps(2, 5, 6);
+                    if (has_n1)
+                        _tile_dpbf16ps(3, 5, 7);
+                }
+            }
+
+            _tile_stored(0, c[0][0], c_stride[0][0]);
+            if (has_n1) _tile_stored(1, c[0][1], c_stride[0][1]);
+            if (has_m1) _tile_stored(2, c[1][0], c_stride[1][0]);
+            if (has_m1 && has_n1) _tile_stored(3, c[1][1], c_stride[1][1]);
+
+            for (int a = 0; a < (has_m1 ? 2 : 1); a++)
+            {
+                const int max_r = a == 0 ? max_r0 : max_r1;
+                if (max_r == 16)
+                    continue;
+
+                for (int b = 0; b < (has_n1 ? 2 : 1); b++)
+                {
+                    float* outptr = topT + (ii + a * 16) * out_hstep + jj + b * 16;
+
+                    for (int r = 0; r < max_r; r++)
+                    {
+                        memcpy(outptr + r * out_hstep, tmp[a][b] + r * 16, 64);
+                    }
+                }
+            }
+        }
+    }
+
+    _tile_release();
+
+    // remaining columns of the 8, 4 and 1 wide panels
+    for (int ii = 0; ii < max_ii; ii++)
+    {
+        const int* pA = (const int*)(AT_tile + ii * max_kk32);
+        float* outptr = topT + ii * out_hstep;
+
+        const unsigned short* pB = BT_tile + max_jj16 * max_kk2;
+
+        int jj = max_jj16;
+        for (; jj + 7 < max_jj; jj += 8)
+        {
+            __m256 _sum = k_begin ? _mm256_setzero_ps() : _mm256_loadu_ps(outptr + jj);
+
+            for (int kk = 0; kk < max_kk2; kk += 2)
+            {
+                _sum = _mm256_dpbf16_ps(_sum, (__m256bh)_mm256_set1_epi32(pA[kk / 2]), (__m256bh)_mm256_loadu_si256((const __m256i*)(pB + kk * 8)));
+            }
+
+            _mm256_storeu_ps(outptr + jj, _sum);
+
+            pB += 8 * max_kk2;
+        }
+        for (; jj + 3 < max_jj; jj += 4)
+        {
+            __m128 _sum = k_begin ? _mm_setzero_ps() : _mm_loadu_ps(outptr + jj);
+
+            for (int kk = 0; kk < max_kk2; kk += 2)
+            {
+                _sum = _mm_dpbf16_ps(_sum, (__m128bh)_mm_set1_epi32(pA[kk / 2]), (__m128bh)_mm_loadu_si128((const __m128i*)(pB + kk * 4)));
+            }
+
+            _mm_storeu_ps(outptr + jj, _sum);
+
+            pB += 4 * max_kk2;
+        }
+        for (; jj < max_jj; jj++)
+        {
+            const unsigned short* pA1 = (const unsigned short*)pA;
+
+            float sum = k_begin ? 0.f : outptr[jj];
+
+            for (int kk = 0; kk < max_kk2; kk++)
+            {
+                sum += bfloat16_to_float32(pA1[kk]) * bfloat16_to_float32(pB[kk]);
+            }
+
+            outptr[jj] = sum;
+
+            pB += max_kk2;
+        }
+    }
+#else // __AMX_BF16__
+    // unreachable, gemm_support_amx_bf16() guards the caller
+    (void)AT_tile;
+    (void)BT_tile;
+    (void)topT;
+    (void)max_ii;
+    (void)max_jj;
+    (void)max_kk;
+    (void)out_hstep;
+    (void)k_begin;
+#endif // __AMX_BF16__
+}
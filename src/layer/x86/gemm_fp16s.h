@@ -0,0 +1,51 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#if NCNN_RUNTIME_CPU && NCNN_F16C && __AVX__ && !__F16C__
+void unpack_tile_fp16s_f16c(const unsigned short* tile, float* pp, int size);
+#endif
+
+// expand one fp16 A or B tile to fp32 right before the tile kernel streams over it
+static void unpack_tile_fp16s(const unsigned short* tile, float* pp, int size)
+{
+#if NCNN_RUNTIME_CPU && NCNN_F16C && __AVX__ && !__F16C__
+    if (ncnn::cpu_support_x86_f16c())
+    {
+        unpack_tile_fp16s_f16c(tile, pp, size);
+        return;
+    }
+#endif
+
+    int i = 0;
+#if __F16C__
+#if __AVX512F__
+    for (; i + 15 < size; i += 16)
+    {
+        _mm512_storeu_ps(pp, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)tile)));
+        tile += 16;
+        pp += 16;
+    }
+#endif // __AVX512F__
+    for (; i + 7 < size; i += 8)
+    {
+        _mm256_storeu_ps(pp, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)tile)));
+        tile += 8;
+        pp += 8;
+    }
+#endif // __F16C__
+    for (; i < size; i++)
+    {
+        *pp++ = float16_to_float32(*tile++);
+    }
+}
@@ -0,0 +1,1632 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "gemm_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX__
+#include <immintrin.h>
+#endif
+#endif // __SSE2__
+
+#include "x86_amx.h"
+#include "x86_usability.h"
+
+#include "cpu.h"
+
+namespace ncnn {
+
+#if NCNN_BF16
+#include "gemm_bf16.h"
+#endif
+
+#if NCNN_F16C
+#include "gemm_fp16s.h"
+#endif
+
+Gemm_x86::Gemm_x86()
+{
+#if NCNN_BF16
+    support_bf16_storage = true;
+#endif
+
+    AT_data_fp16 = false;
+    BT_data_fp16 = false;
+}
+
+static void get_optimal_tile_nk(int N, int K, int& TILE_N, int& TILE_K)
+{
+    // a TILE_K x TILE_N panel of B stays hot in L2 while every M tile streams over it
+    const int nn_K = (K + 255) / 256;
+    TILE_K = (K + nn_K - 1) / nn_K;
+
+    const int nn_N = (N + 127) / 128;
+    TILE_N = (N + nn_N - 1) / nn_N;
+    TILE_N = (TILE_N + 15) / 16 * 16;
+}
+
+static void get_optimal_tile_m(int M, int nn_N, int num_threads, int& TILE_M)
+{
+    int nn_M = (M + 63) / 64;
+
+    // split M further when the tiles can not keep all threads busy
+    if (nn_M * nn_N < num_threads)
+        nn_M = (num_threads + nn_N - 1) / nn_N;
+
+    TILE_M = (M + nn_M - 1) / nn_M;
+    TILE_M = (TILE_M + 7) / 8 * 8;
+}
+
+static void get_constant_tile_m(int M, int& TILE_M)
+{
+    // constant A is packed before N and the thread count are known
+    get_optimal_tile_m(M, 1, 1, TILE_M);
+}
+
+#if NCNN_BF16
+static void pack_A_tile_bf16s(const Mat& A, float* pp, int i, int max_ii, int k, int max_kk, int transA)
+{
+    int ii = 0;
+    for (; ii + 7 < max_ii; ii += 8)
+    {
+        for (int kk = 0; kk < max_kk; kk++)
+        {
+            for (int r = 0; r < 8; r++)
+            {
+                const unsigned short* p0 = transA == 0 ? A.row<const unsigned short>(i + ii + r) + k + kk : A.row<const unsigned short>(k + kk) + i + ii + r;
+                pp[r] = bfloat16_to_float32(p0[0]);
+            }
+
+            pp += 8;
+        }
+    }
+    for (; ii < max_ii; ii++)
+    {
+        for (int kk = 0; kk < max_kk; kk++)
+        {
+            const unsigned short* p0 = transA == 0 ? A.row<const unsigned short>(i + ii) + k + kk : A.row<const unsigned short>(k + kk) + i + ii;
+            pp[kk] = bfloat16_to_float32(p0[0]);
+        }
+
+        pp += max_kk;
+    }
+}
+
+static void pack_B_panel_bf16s(const Mat& B, float* pp, int j, int width, int k, int max_kk, int transB)
+{
+    for (int kk = 0; kk < max_kk; kk++)
+    {
+        for (int w = 0; w < width; w++)
+        {
+            const unsigned short* p0 = transB == 0 ? B.row<const unsigned short>(k + kk) + j + w : B.row<const unsigned short>(j + w) + k + kk;
+            pp[w] = bfloat16_to_float32(p0[0]);
+        }
+
+        pp += width;
+    }
+}
+#endif // NCNN_BF16
+
+static void pack_A_tile(const Mat& A, float* pp, int i, int max_ii, int k, int max_kk, int transA)
+{
+#if NCNN_BF16
+    if (A.elembits() == 16)
+    {
+        // bf16 storage is widened to fp32 while packing
+        pack_A_tile_bf16s(A, pp, i, max_ii, k, max_kk, transA);
+        return;
+    }
+#endif // NCNN_BF16
+
+    // 8 rows interleaved along k, then the remaining rows one by one
+    int ii = 0;
+    for (; ii + 7 < max_ii; ii += 8)
+    {
+        if (transA == 0)
+        {
+            const float* p0 = A.row(i + ii) + k;
+            const float* p1 = A.row(i + ii + 1) + k;
+            const float* p2 = A.row(i + ii + 2) + k;
+            const float* p3 = A.row(i + ii + 3) + k;
+            const float* p4 = A.row(i + ii + 4) + k;
+            const float* p5 = A.row(i + ii + 5) + k;
+            const float* p6 = A.row(i + ii + 6) + k;
+            const float* p7 = A.row(i + ii + 7) + k;
+
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                pp[0] = p0[kk];
+                pp[1] = p1[kk];
+                pp[2] = p2[kk];
+                pp[3] = p3[kk];
+                pp[4] = p4[kk];
+                pp[5] = p5[kk];
+                pp[6] = p6[kk];
+                pp[7] = p7[kk];
+                pp += 8;
+            }
+        }
+        else
+        {
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                const float* p0 = A.row(k + kk) + i + ii;
+
+                pp[0] = p0[0];
+                pp[1] = p0[1];
+                pp[2] = p0[2];
+                pp[3] = p0[3];
+                pp[4] = p0[4];
+                pp[5] = p0[5];
+                pp[6] = p0[6];
+                pp[7] = p0[7];
+                pp += 8;
+            }
+        }
+    }
+    for (; ii < max_ii; ii++)
+    {
+        if (transA == 0)
+        {
+            const float* p0 = A.row(i + ii) + k;
+
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                pp[kk] = p0[kk];
+            }
+        }
+        else
+        {
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                pp[kk] = A.row(k + kk)[i + ii];
+            }
+        }
+
+        pp += max_kk;
+    }
+}
+
+static void pack_B_panel(const Mat& B, float* pp, int j, int width, int k, int max_kk, int transB)
+{
+#if NCNN_BF16
+    if (B.elembits() == 16)
+    {
+        pack_B_panel_bf16s(B, pp, j, width, k, max_kk, transB);
+        return;
+    }
+#endif // NCNN_BF16
+
+    if (transB == 0)
+    {
+        for (int kk = 0; kk < max_kk; kk++)
+        {
+            const float* p0 = B.row(k + kk) + j;
+
+            for (int w = 0; w < width; w++)
+            {
+                pp[w] = p0[w];
+            }
+
+            pp += width;
+        }
+    }
+    else
+    {
+        const float* p[16];
+        for (int w = 0; w < width; w++)
+        {
+            p[w] = B.row(j + w) + k;
+        }
+
+        // transpose width x width blocks in registers
+        int kk = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+        if (width == 16)
+        {
+            for (; kk + 15 < max_kk; kk += 16)
+            {
+                __m512 _r0 = _mm512_loadu_ps(p[0] + kk);
+                __m512 _r1 = _mm512_loadu_ps(p[1] + kk);
+                __m512 _r2 = _mm512_loadu_ps(p[2] + kk);
+                __m512 _r3 = _mm512_loadu_ps(p[3] + kk);
+                __m512 _r4 = _mm512_loadu_ps(p[4] + kk);
+                __m512 _r5 = _mm512_loadu_ps(p[5] + kk);
+                __m512 _r6 = _mm512_loadu_ps(p[6] + kk);
+                __m512 _r7 = _mm512_loadu_ps(p[7] + kk);
+                __m512 _r8 = _mm512_loadu_ps(p[8] + kk);
+                __m512 _r9 = _mm512_loadu_ps(p[9] + kk);
+                __m512 _ra = _mm512_loadu_ps(p[10] + kk);
+                __m512 _rb = _mm512_loadu_ps(p[11] + kk);
+                __m512 _rc = _mm512_loadu_ps(p[12] + kk);
+                __m512 _rd = _mm512_loadu_ps(p[13] + kk);
+                __m512 _re = _mm512_loadu_ps(p[14] + kk);
+                __m512 _rf = _mm512_loadu_ps(p[15] + kk);
+                transpose16_ps(_r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8, _r9, _ra, _rb, _rc, _rd, _re, _rf);
+                _mm512_storeu_ps(pp, _r0);
+                _mm512_storeu_ps(pp + 16, _r1);
+                _mm512_storeu_ps(pp + 16 * 2, _r2);
+                _mm512_storeu_ps(pp + 16 * 3, _r3);
+                _mm512_storeu_ps(pp + 16 * 4, _r4);
+                _mm512_storeu_ps(pp + 16 * 5, _r5);
+                _mm512_storeu_ps(pp + 16 * 6, _r6);
+                _mm512_storeu_ps(pp + 16 * 7, _r7);
+                _mm512_storeu_ps(pp + 16 * 8, _r8);
+                _mm512_storeu_ps(pp + 16 * 9, _r9);
+                _mm512_storeu_ps(pp + 16 * 10, _ra);
+                _mm512_storeu_ps(pp + 16 * 11, _rb);
+                _mm512_storeu_ps(pp + 16 * 12, _rc);
+                _mm512_storeu_ps(pp + 16 * 13, _rd);
+                _mm512_storeu_ps(pp + 16 * 14, _re);
+                _mm512_storeu_ps(pp + 16 * 15, _rf);
+                pp += 256;
+            }
+        }
+#endif // __AVX512F__
+        if (width == 8)
+        {
+            for (; kk + 7 < max_kk; kk += 8)
+            {
+                __m256 _r0 = _mm256_loadu_ps(p[0] + kk);
+                __m256 _r1 = _mm256_loadu_ps(p[1] + kk);
+                __m256 _r2 = _mm256_loadu_ps(p[2] + kk);
+                __m256 _r3 = _mm256_loadu_ps(p[3] + kk);
+                __m256 _r4 = _mm256_loadu_ps(p[4] + kk);
+                __m256 _r5 = _mm256_loadu_ps(p[5] + kk);
+                __m256 _r6 = _mm256_loadu_ps(p[6] + kk);
+                __m256 _r7 = _mm256_loadu_ps(p[7] + kk);
+                transpose8_ps(_r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);
+                _mm256_storeu_ps(pp, _r0);
+                _mm256_storeu_ps(pp + 8, _r1);
+                _mm256_storeu_ps(pp + 8 * 2, _r2);
+                _mm256_storeu_ps(pp + 8 * 3, _r3);
+                _mm256_storeu_ps(pp + 8 * 4, _r4);
+                _mm256_storeu_ps(pp + 8 * 5, _r5);
+                _mm256_storeu_ps(pp + 8 * 6, _r6);
+                _mm256_storeu_ps(pp + 8 * 7, _r7);
+                pp += 64;
+            }
+        }
+#endif // __AVX__
+        if (width == 4)
+        {
+            for (; kk + 3 < max_kk; kk += 4)
+            {
+                __m128 _r0 = _mm_loadu_ps(p[0] + kk);
+                __m128 _r1 = _mm_loadu_ps(p[1] + kk);
+                __m128 _r2 = _mm_loadu_ps(p[2] + kk);
+                __m128 _r3 = _mm_loadu_ps(p[3] + kk);
+                _MM_TRANSPOSE4_PS(_r0, _r1, _r2, _r3);
+                _mm_storeu_ps(pp, _r0);
+                _mm_storeu_ps(pp + 4, _r1);
+                _mm_storeu_ps(pp + 8, _r2);
+                _mm_storeu_ps(pp + 12, _r3);
+                pp += 16;
+            }
+        }
+#endif // __SSE2__
+        for (; kk < max_kk; kk++)
+        {
+            for (int w = 0; w < width; w++)
+            {
+                pp[w] = p[w][kk];
+            }
+
+            pp += width;
+        }
+    }
+}
+
+static void pack_B_tile(const Mat& B, float* pp, int j, int max_jj, int k, int max_kk, int transB)
+{
+    // panels as wide as the vector register, narrower panels for the tail
+    int jj = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    for (; jj + 15 < max_jj; jj += 16)
+    {
+        pack_B_panel(B, pp, j + jj, 16, k, max_kk, transB);
+        pp += 16 * max_kk;
+    }
+#endif // __AVX512F__
+    for (; jj + 7 < max_jj; jj += 8)
+    {
+        pack_B_panel(B, pp, j + jj, 8, k, max_kk, transB);
+        pp += 8 * max_kk;
+    }
+#endif // __AVX__
+    for (; jj + 3 < max_jj; jj += 4)
+    {
+        pack_B_panel(B, pp, j + jj, 4, k, max_kk, transB);
+        pp += 4 * max_kk;
+    }
+#endif // __SSE2__
+    for (; jj < max_jj; jj++)
+    {
+        pack_B_panel(B, pp, j + jj, 1, k, max_kk, transB);
+        pp += max_kk;
+    }
+}
+
+static void gemm_tile(const float* AT_tile, const float* BT_tile, float* topT, int max_ii, int max_jj, int max_kk, int out_hstep, bool k_begin)
+{
+    const float* pAT = AT_tile;
+
+    int ii = 0;
+    for (; ii + 7 < max_ii; ii += 8)
+    {
+        float* outptr0 = topT + ii * out_hstep;
+
+        const float* pB = BT_tile;
+
+        int jj = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+        for (; jj + 31 < max_jj; jj += 32)
+        {
+            // two adjacent 16 wide panels share every broadcast of A
+            float* outptr = outptr0 + jj;
+
+            const float* pA = pAT;
+            const float* pB0 = pB;
+            const float* pB1 = pB + 16 * max_kk;
+
+            __m512 _sum00;
+            __m512 _sum01;
+            __m512 _sum10;
+            __m512 _sum11;
+            __m512 _sum20;
+            __m512 _sum21;
+            __m512 _sum30;
+            __m512 _sum31;
+            __m512 _sum40;
+            __m512 _sum41;
+            __m512 _sum50;
+            __m512 _sum51;
+            __m512 _sum60;
+            __m512 _sum61;
+            __m512 _sum70;
+            __m512 _sum71;
+
+            if (k_begin)
+            {
+                _sum00 = _mm512_setzero_ps();
+                _sum01 = _mm512_setzero_ps();
+                _sum10 = _mm512_setzero_ps();
+                _sum11 = _mm512_setzero_ps();
+                _sum20 = _mm512_setzero_ps();
+                _sum21 = _mm512_setzero_ps();
+                _sum30 = _mm512_setzero_ps();
+                _sum31 = _mm512_setzero_ps();
+                _sum40 = _mm512_setzero_ps();
+                _sum41 = _mm512_setzero_ps();
+                _sum50 = _mm512_setzero_ps();
+                _sum51 = _mm512_setzero_ps();
+                _sum60 = _mm512_setzero_ps();
+                _sum61 = _mm512_setzero_ps();
+                _sum70 = _mm512_setzero_ps();
+                _sum71 = _mm512_setzero_ps();
+            }
+            else
+            {
+                _sum00 = _mm512_loadu_ps(outptr);
+                _sum01 = _mm512_loadu_ps(outptr + 16);
+                _sum10 = _mm512_loadu_ps(outptr + out_hstep);
+                _sum11 = _mm512_loadu_ps(outptr + out_hstep + 16);
+                _sum20 = _mm512_loadu_ps(outptr + out_hstep * 2);
+                _sum21 = _mm512_loadu_ps(outptr + out_hstep * 2 + 16);
+                _sum30 = _mm512_loadu_ps(outptr + out_hstep * 3);
+                _sum31 = _mm512_loadu_ps(outptr + out_hstep * 3 + 16);
+                _sum40 = _mm512_loadu_ps(outptr + out_hstep * 4);
+                _sum41 = _mm512_loadu_ps(outptr + out_hstep * 4 + 16);
+                _sum50 = _mm512_loadu_ps(outptr + out_hstep * 5);
+                _sum51 = _mm512_loadu_ps(outptr + out_hstep * 5 + 16);
+                _sum60 = _mm512_loadu_ps(outptr + out_hstep * 6);
+                _sum61 = _mm512_loadu_ps(outptr + out_hstep * 6 + 16);
+                _sum70 = _mm512_loadu_ps(outptr + out_hstep * 7);
+                _sum71 = _mm512_loadu_ps(outptr + out_hstep * 7 + 16);
+            }
+
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                __m512 _b0 = _mm512_loadu_ps(pB0);
+                __m512 _b1 = _mm512_loadu_ps(pB1);
+
+                __m512 _a0 = _mm512_set1_ps(pA[0]);
+                __m512 _a1 = _mm512_set1_ps(pA[1]);
+                __m512 _a2 = _mm512_set1_ps(pA[2]);
+                __m512 _a3 = _mm512_set1_ps(pA[3]);
+                _sum00 = _mm512_fmadd_ps(_a0, _b0, _sum00);
+                _sum01 = _mm512_fmadd_ps(_a0, _b1, _sum01);
+                _sum10 = _mm512_fmadd_ps(_a1, _b0, _sum10);
+                _sum11 = _mm512_fmadd_ps(_a1, _b1, _sum11);
+                _sum20 = _mm512_fmadd_ps(_a2, _b0, _sum20);
+                _sum21 = _mm512_fmadd_ps(_a2, _b1, _sum21);
+                _sum30 = _mm512_fmadd_ps(_a3, _b0, _sum30);
+                _sum31 = _mm512_fmadd_ps(_a3, _b1, _sum31);
+
+                __m512 _a4 = _mm512_set1_ps(pA[4]);
+                __m512 _a5 = _mm512_set1_ps(pA[5]);
+                __m512 _a6 = _mm512_set1_ps(pA[6]);
+                __m512 _a7 = _mm512_set1_ps(pA[7]);
+                _sum40 = _mm512_fmadd_ps(_a4, _b0, _sum40);
+                _sum41 = _mm512_fmadd_ps(_a4, _b1, _sum41);
+                _sum50 = _mm512_fmadd_ps(_a5, _b0, _sum50);
+                _sum51 = _mm512_fmadd_ps(_a5, _b1, _sum51);
+                _sum60 = _mm512_fmadd_ps(_a6, _b0, _sum60);
+                _sum61 = _mm512_fmadd_ps(_a6, _b1, _sum61);
+                _sum70 = _mm512_fmadd_ps(_a7, _b0, _sum70);
+                _sum71 = _mm512_fmadd_ps(_a7, _b1, _sum71);
+
+                pA += 8;
+                pB0 += 16;
+                pB1 += 16;
+            }
+
+            _mm512_storeu_ps(outptr, _sum00);
+            _mm512_storeu_ps(outptr + 16, _sum01);
+            _mm512_storeu_ps(outptr + out_hstep, _sum10);
+            _mm512_storeu_ps(outptr + out_hstep + 16, _sum11);
+            _mm512_storeu_ps(outptr + out_hstep * 2, _sum20);
+            _mm512_storeu_ps(outptr + out_hstep * 2 + 16, _sum21);
+            _mm512_storeu_ps(outptr + out_hstep * 3, _sum30);
+            _mm512_storeu_ps(outptr + out_hstep * 3 + 16, _sum31);
+            _mm512_storeu_ps(outptr + out_hstep * 4, _sum40);
+            _mm512_storeu_ps(outptr + out_hstep * 4 + 16, _sum41);
+            _mm512_storeu_ps(outptr + out_hstep * 5, _sum50);
+            _mm512_storeu_ps(outptr + out_hstep * 5 + 16, _sum51);
+            _mm512_storeu_ps(outptr + out_hstep * 6, _sum60);
+            _mm512_storeu_ps(outptr + out_hstep * 6 + 16, _sum61);
+            _mm512_storeu_ps(outptr + out_hstep * 7, _sum70);
+            _mm512_storeu_ps(outptr + out_hstep * 7 + 16, _sum71);
+
+            pB += 32 * max_kk;
+        }
+        for (; jj + 15 < max_jj; jj += 16)
+        {
+            float* outptr = outptr0 + jj;
+
+            const float* pA = pAT;
+
+            __m512 _sum0;
+            __m512 _sum1;
+            __m512 _sum2;
+            __m512 _sum3;
+            __m512 _sum4;
+            __m512 _sum5;
+            __m512 _sum6;
+            __m512 _sum7;
+
+            if (k_begin)
+            {
+                _sum0 = _mm512_setzero_ps();
+                _sum1 = _mm512_setzero_ps();
+                _sum2 = _mm512_setzero_ps();
+                _sum3 = _mm512_setzero_ps();
+                _sum4 = _mm512_setzero_ps();
+                _sum5 = _mm512_setzero_ps();
+                _sum6 = _mm512_setzero_ps();
+                _sum7 = _mm512_setzero_ps();
+            }
+            else
+            {
+                _sum0 = _mm512_loadu_ps(outptr);
+                _sum1 = _mm512_loadu_ps(outptr + out_hstep);
+                _sum2 = _mm512_loadu_ps(outptr + out_hstep * 2);
+                _sum3 = _mm512_loadu_ps(outptr + out_hstep * 3);
+                _sum4 = _mm512_loadu_ps(outptr + out_hstep * 4);
+                _sum5 = _mm512_loadu_ps(outptr + out_hstep * 5);
+                _sum6 = _mm512_loadu_ps(outptr + out_hstep * 6);
+                _sum7 = _mm512_loadu_ps(outptr + out_hstep * 7);
+            }
+
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                __m512 _b = _mm512_loadu_ps(pB);
+
+                _sum0 = _mm512_fmadd_ps(_mm512_set1_ps(pA[0]), _b, _sum0);
+                _sum1 = _mm512_fmadd_ps(_mm512_set1_ps(pA[1]), _b, _sum1);
+                _sum2 = _mm512_fmadd_ps(_mm512_set1_ps(pA[2]), _b, _sum2);
+                _sum3 = _mm512_fmadd_ps(_mm512_set1_ps(pA[3]), _b, _sum3);
+                _sum4 = _mm512_fmadd_ps(_mm512_set1_ps(pA[4]), _b, _sum4);
+                _sum5 = _mm512_fmadd_ps(_mm512_set1_ps(pA[5]), _b, _sum5);
+                _sum6 = _mm512_fmadd_ps(_mm512_set1_ps(pA[6]), _b, _sum6);
+                _sum7 = _mm512_fmadd_ps(_mm512_set1_ps(pA[7]), _b, _sum7);
+
+                pA += 8;
+                pB += 16;
+            }
+
+            _mm512_storeu_ps(outptr, _sum0);
+            _mm512_storeu_ps(outptr + out_hstep, _sum1);
+            _mm512_storeu_ps(outptr + out_hstep * 2, _sum2);
+            _mm512_storeu_ps(outptr + out_hstep * 3, _sum3);
+            _mm512_storeu_ps(outptr + out_hstep * 4, _sum4);
+            _mm512_storeu_ps(outptr + out_hstep * 5, _sum5);
+            _mm512_storeu_ps(outptr + out_hstep * 6, _sum6);
+            _mm512_storeu_ps(outptr + out_hstep * 7, _sum7);
+        }
+#endif // __AVX512F__
+        for (; jj + 7 < max_jj; jj += 8)
+        {
+            float* outptr = outptr0 + jj;
+
+            const float* pA = pAT;
+
+            __m256 _sum0;
+            __m256 _sum1;
+            __m256 _sum2;
+            __m256 _sum3;
+            __m256 _sum4;
+            __m256 _sum5;
+            __m256 _sum6;
+            __m256 _sum7;
+
+            if (k_begin)
+            {
+                _sum0 = _mm256_setzero_ps();
+                _sum1 = _mm256_setzero_ps();
+                _sum2 = _mm256_setzero_ps();
+                _sum3 = _mm256_setzero_ps();
+                _sum4 = _mm256_setzero_ps();
+                _sum5 = _mm256_setzero_ps();
+                _sum6 = _mm256_setzero_ps();
+                _sum7 = _mm256_setzero_ps();
+            }
+            else
+            {
+                _sum0 = _mm256_loadu_ps(outptr);
+                _sum1 = _mm256_loadu_ps(outptr + out_hstep);
+                _sum2 = _mm256_loadu_ps(outptr + out_hstep * 2);
+                _sum3 = _mm256_loadu_ps(outptr + out_hstep * 3);
+                _sum4 = _mm256_loadu_ps(outptr + out_hstep * 4);
+                _sum5 = _mm256_loadu_ps(outptr + out_hstep * 5);
+                _sum6 = _mm256_loadu_ps(outptr + out_hstep * 6);
+                _sum7 = _mm256_loadu_ps(outptr + out_hstep * 7);
+            }
+
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                __m256 _b = _mm256_loadu_ps(pB);
+
+                _sum0 = _mm256_comp_fmadd_ps(_mm256_broadcast_ss(pA), _b, _sum0);
+                _sum1 = _mm256_comp_fmadd_ps(_mm256_broadcast_ss(pA + 1), _b, _sum1);
+                _sum2 = _mm256_comp_fmadd_ps(_mm256_broadcast_ss(pA + 2), _b, _sum2);
+                _sum3 = _mm256_comp_fmadd_ps(_mm256_broadcast_ss(pA + 3), _b, _sum3);
+                _sum4 = _mm256_comp_fmadd_ps(_mm256_broadcast_ss(pA + 4), _b, _sum4);
+                _sum5 = _mm256_comp_fmadd_ps(_mm256_broadcast_ss(pA + 5), _b, _sum5);
+                _sum6 = _mm256_comp_fmadd_ps(_mm256_broadcast_ss(pA + 6), _b, _sum6);
+                _sum7 = _mm256_comp_fmadd_ps(_mm256_broadcast_ss(pA + 7), _b, _sum7);
+
+                pA += 8;
+                pB += 8;
+            }
+
+            _mm256_storeu_ps(outptr, _sum0);
+            _mm256_storeu_ps(outptr + out_hstep, _sum1);
+            _mm256_storeu_ps(outptr + out_hstep * 2, _sum2);
+            _mm256_storeu_ps(outptr + out_hstep * 3, _sum3);
+            _mm256_storeu_ps(outptr + out_hstep * 4, _sum4);
+            _mm256_storeu_ps(outptr + out_hstep * 5, _sum5);
+            _mm256_storeu_ps(outptr + out_hstep * 6, _sum6);
+            _mm256_storeu_ps(outptr + out_hstep * 7, _sum7);
+        }
+#endif // __AVX__
+        for (; jj + 3 < max_jj; jj += 4)
+        {
+            float* outptr = outptr0 + jj;
+
+            const float* pA = pAT;
+
+            __m128 _sum0;
+            __m128 _sum1;
+            __m128 _sum2;
+            __m128 _sum3;
+            __m128 _sum4;
+            __m128 _sum5;
+            __m128 _sum6;
+            __m128 _sum7;
+
+            if (k_begin)
+            {
+                _sum0 = _mm_setzero_ps();
+                _sum1 = _mm_setzero_ps();
+                _sum2 = _mm_setzero_ps();
+                _sum3 = _mm_setzero_ps();
+                _sum4 = _mm_setzero_ps();
+                _sum5 = _mm_setzero_ps();
+                _sum6 = _mm_setzero_ps();
+                _sum7 = _mm_setzero_ps();
+            }
+            else
+            {
+                _sum0 = _mm_loadu_ps(outptr);
+                _sum1 = _mm_loadu_ps(outptr + out_hstep);
+                _sum2 = _mm_loadu_ps(outptr + out_hstep * 2);
+                _sum3 = _mm_loadu_ps(outptr + out_hstep * 3);
+                _sum4 = _mm_loadu_ps(outptr + out_hstep * 4);
+                _sum5 = _mm_loadu_ps(outptr + out_hstep * 5);
+                _sum6 = _mm_loadu_ps(outptr + out_hstep * 6);
+                _sum7 = _mm_loadu_ps(outptr + out_hstep * 7);
+            }
+
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                __m128 _b = _mm_loadu_ps(pB);
+
+                _sum0 = _mm_comp_fmadd_ps(_mm_set1_ps(pA[0]), _b, _sum0);
+                _sum1 = _mm_comp_fmadd_ps(_mm_set1_ps(pA[1]), _b, _sum1);
+                _sum2 = _mm_comp_fmadd_ps(_mm_set1_ps(pA[2]), _b, _sum2);
+                _sum3 = _mm_comp_fmadd_ps(_mm_set1_ps(pA[3]), _b, _sum3);
+                _sum4 = _mm_comp_fmadd_ps(_mm_set1_ps(pA[4]), _b, _sum4);
+                _sum5 = _mm_comp_fmadd_ps(_mm_set1_ps(pA[5]), _b, _sum5);
+                _sum6 = _mm_comp_fmadd_ps(_mm_set1_ps(pA[6]), _b, _sum6);
+                _sum7 = _mm_comp_fmadd_ps(_mm_set1_ps(pA[7]), _b, _sum7);
+
+                pA += 8;
+                pB += 4;
+            }
+
+            _mm_storeu_ps(outptr, _sum0);
+            _mm_storeu_ps(outptr + out_hstep, _sum1);
+            _mm_storeu_ps(outptr + out_hstep * 2, _sum2);
+            _mm_storeu_ps(outptr + out_hstep * 3, _sum3);
+            _mm_storeu_ps(outptr + out_hstep * 4, _sum4);
+            _mm_storeu_ps(outptr + out_hstep * 5, _sum5);
+            _mm_storeu_ps(outptr + out_hstep * 6, _sum6);
+            _mm_storeu_ps(outptr + out_hstep * 7, _sum7);
+        }
+#endif // __SSE2__
+        for (; jj < max_jj; jj++)
+        {
+            float* outptr = outptr0 + jj;
+
+            const float* pA = pAT;
+
+            float sum[8];
+            for (int r = 0; r < 8; r++)
+            {
+                sum[r] = k_begin ? 0.f : outptr[out_hstep * r];
+            }
+
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                const float b = pB[0];
+
+                for (int r = 0; r < 8; r++)
+                {
+                    sum[r] += pA[r] * b;
+                }
+
+                pA += 8;
+                pB += 1;
+            }
+
+            for (int r = 0; r < 8; r++)
+            {
+                outptr[out_hstep * r] = sum[r];
+            }
+        }
+
+        pAT += 8 * max_kk;
+    }
+    for (; ii < max_ii; ii++)
+    {
+        float* outptr0 = topT + ii * out_hstep;
+
+        const float* pB = BT_tile;
+
+        int jj = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+        for (; jj + 15 < max_jj; jj += 16)
+        {
+            const float* pA = pAT;
+
+            __m512 _sum = k_begin ? _mm512_setzero_ps() : _mm512_loadu_ps(outptr0 + jj);
+
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                _sum = _mm512_fmadd_ps(_mm512_set1_ps(pA[0]), _mm512_loadu_ps(pB), _sum);
+
+                pA += 1;
+                pB += 16;
+            }
+
+            _mm512_storeu_ps(outptr0 + jj, _sum);
+        }
+#endif // __AVX512F__
+        for (; jj + 7 < max_jj; jj += 8)
+        {
+            const float* pA = pAT;
+
+            __m256 _sum = k_begin ? _mm256_setzero_ps() : _mm256_loadu_ps(outptr0 + jj);
+
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                _sum = _mm256_comp_fmadd_ps(_mm256_broadcast_ss(pA), _mm256_loadu_ps(pB), _sum);
+
+                pA += 1;
+                pB += 8;
+            }
+
+            _mm256_storeu_ps(outptr0 + jj, _sum);
+        }
+#endif // __AVX__
+        for (; jj + 3 < max_jj; jj += 4)
+        {
+            const float* pA = pAT;
+
+            __m128 _sum = k_begin ? _mm_setzero_ps() : _mm_loadu_ps(outptr0 + jj);
+
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                _sum = _mm_comp_fmadd_ps(_mm_set1_ps(pA[0]), _mm_loadu_ps(pB), _sum);
+
+                pA += 1;
+                pB += 4;
+            }
+
+            _mm_storeu_ps(outptr0 + jj, _sum);
+        }
+#endif // __SSE2__
+        for (; jj < max_jj; jj++)
+        {
+            const float* pA = pAT;
+
+            float sum = k_begin ? 0.f : outptr0[jj];
+
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                sum += pA[kk] * pB[kk];
+            }
+
+            pB += max_kk;
+
+            outptr0[jj] = sum;
+        }
+
+        pAT += max_kk;
+    }
+}
+
+static float dot_product(const float* a, const float* b, int size)
+{
+    int i = 0;
+    float sum = 0.f;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    __m512 _sum_avx512 = _mm512_setzero_ps();
+    for (; i + 15 < size; i += 16)
+    {
+        _sum_avx512 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), _sum_avx512);
+    }
+    sum += _mm512_comp_reduce_add_ps(_sum_avx512);
+#endif // __AVX512F__
+    __m256 _sum_avx = _mm256_setzero_ps();
+    for (; i + 7 < size; i += 8)
+    {
+        _sum_avx = _mm256_comp_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), _sum_avx);
+    }
+    sum += _mm256_reduce_add_ps(_sum_avx);
+#endif // __AVX__
+    __m128 _sum = _mm_setzero_ps();
+    for (; i + 3 < size; i += 4)
+    {
+        _sum = _mm_comp_fmadd_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i), _sum);
+    }
+    sum += _mm_reduce_add_ps(_sum);
+#endif // __SSE2__
+    for (; i < size; i++)
+    {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+}
+
+static void axpy(float* y, const float* x, float a, int size)
+{
+    int i = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    __m512 _a_avx512 = _mm512_set1_ps(a);
+    for (; i + 15 < size; i += 16)
+    {
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(_a_avx512, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+    }
+#endif // __AVX512F__
+    __m256 _a_avx = _mm256_set1_ps(a);
+    for (; i + 7 < size; i += 8)
+    {
+        _mm256_storeu_ps(y + i, _mm256_comp_fmadd_ps(_a_avx, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+#endif // __AVX__
+    __m128 _a = _mm_set1_ps(a);
+    for (; i + 3 < size; i += 4)
+    {
+        _mm_storeu_ps(y + i, _mm_comp_fmadd_ps(_a, _mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+    }
+#endif // __SSE2__
+    for (; i < size; i++)
+    {
+        y[i] += a * x[i];
+    }
+}
+
+static void gemm_small_m(const float* AT, const Mat& B, float* topT, int M, int N, int K, int transB, const Option& opt)
+{
+    // B is streamed once straight from the blob, packing it would cost as much as the product
+    if (transB == 0)
+    {
+        const int nn_N = (N + 63) / 64;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int ppj = 0; ppj < nn_N; ppj++)
+        {
+            const int j = ppj * 64;
+            const int max_jj = std::min(N - j, 64);
+
+            for (int ii = 0; ii < M; ii++)
+            {
+                float* outptr = topT + ii * N + j;
+                for (int jj = 0; jj < max_jj; jj++)
+                {
+                    outptr[jj] = 0.f;
+                }
+            }
+
+            for (int kk = 0; kk < K; kk++)
+            {
+                const float* pB = B.row(kk) + j;
+
+                for (int ii = 0; ii < M; ii++)
+                {
+                    axpy(topT + ii * N + j, pB, AT[ii * K + kk], max_jj);
+                }
+            }
+        }
+    }
+    else
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int jj = 0; jj < N; jj++)
+        {
+            const float* pB = B.row(jj);
+
+            for (int ii = 0; ii < M; ii++)
+            {
+                topT[ii * N + jj] = dot_product(AT + ii * K, pB, K);
+            }
+        }
+    }
+}
+
+static void transform_output_tile(const float* topT, Mat& top_blob, const Mat& C, int broadcast_type_C, int i, int max_ii, int j, int max_jj, int out_hstep, float alpha, float beta)
+{
+    const bool has_C = !C.empty();
+
+    // output rows are interleaved by elempack, the N1M output steps over channels instead of rows
+    const int out_elempack = top_blob.elempack;
+    const size_t out_rowstep = (top_blob.dims == 3 ? top_blob.cstep : (size_t)top_blob.w) * out_elempack;
+
+    for (int ii = 0; ii < max_ii; ii++)
+    {
+        const float* pp = topT + ii * out_hstep;
+        const size_t out_offset = (i + ii) / out_elempack * out_rowstep + (size_t)j * out_elempack + (i + ii) % out_elempack;
+        // C is either a row slice or a scalar for this output row
+        const float* pC = 0;
+        float c = 0.f;
+        if (has_C)
+        {
+            if (broadcast_type_C == 0)
+                c = C[0];
+            if (broadcast_type_C == 1 || broadcast_type_C == 2)
+                c = C[i + ii];
+            if (broadcast_type_C == 3)
+                pC = (const float*)C + (i + ii) * top_blob.w + j;
+            if (broadcast_type_C == 4)
+                pC = (const float*)C + j;
+        }
+
+#if NCNN_BF16
+        if (top_blob.elembits() == 16)
+        {
+            unsigned short* outptr = (unsigned short*)top_blob.data + out_offset;
+
+            for (int jj = 0; jj < max_jj; jj++)
+            {
+                const float v = pC ? (pp[jj] + pC[jj] * beta) * alpha : (pp[jj] + c * beta) * alpha;
+                outptr[jj * out_elempack] = float32_to_bfloat16(v);
+            }
+
+            continue;
+        }
+#endif // NCNN_BF16
+
+        float* outptr = (float*)top_blob.data + out_offset;
+
+        if (out_elempack != 1)
+        {
+            for (int jj = 0; jj < max_jj; jj++)
+            {
+                outptr[jj * out_elempack] = pC ? (pp[jj] + pC[jj] * beta) * alpha : (pp[jj] + c * beta) * alpha;
+            }
+
+            continue;
+        }
+
+        int jj = 0;
+        if (pC)
+        {
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+            __m512 _alpha_avx512 = _mm512_set1_ps(alpha);
+            __m512 _beta_avx512 = _mm512_set1_ps(beta);
+            for (; jj + 15 < max_jj; jj += 16)
+            {
+                __m512 _p = _mm512_fmadd_ps(_mm512_loadu_ps(pC + jj), _beta_avx512, _mm512_loadu_ps(pp + jj));
+                _mm512_storeu_ps(outptr + jj, _mm512_mul_ps(_p, _alpha_avx512));
+            }
+#endif // __AVX512F__
+            __m256 _alpha_avx = _mm256_set1_ps(alpha);
+            __m256 _beta_avx = _mm256_set1_ps(beta);
+            for (; jj + 7 < max_jj; jj += 8)
+            {
+                __m256 _p = _mm256_comp_fmadd_ps(_mm256_loadu_ps(pC + jj), _beta_avx, _mm256_loadu_ps(pp + jj));
+                _mm256_storeu_ps(outptr + jj, _mm256_mul_ps(_p, _alpha_avx));
+            }
+#endif // __AVX__
+            __m128 _alpha = _mm_set1_ps(alpha);
+            __m128 _beta = _mm_set1_ps(beta);
+            for (; jj + 3 < max_jj; jj += 4)
+            {
+                __m128 _p = _mm_comp_fmadd_ps(_mm_loadu_ps(pC + jj), _beta, _mm_loadu_ps(pp + jj));
+                _mm_storeu_ps(outptr + jj, _mm_mul_ps(_p, _alpha));
+            }
+#endif // __SSE2__
+            for (; jj < max_jj; jj++)
+            {
+                outptr[jj] = (pp[jj] + pC[jj] * beta) * alpha;
+            }
+        }
+        else
+        {
+            const float cb = c * beta;
+
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+            __m512 _alpha_avx512 = _mm512_set1_ps(alpha);
+            __m512 _cb_avx512 = _mm512_set1_ps(cb);
+            for (; jj + 15 < max_jj; jj += 16)
+            {
+                __m512 _p = _mm512_add_ps(_mm512_loadu_ps(pp + jj), _cb_avx512);
+                _mm512_storeu_ps(outptr + jj, _mm512_mul_ps(_p, _alpha_avx512));
+            }
+#endif // __AVX512F__
+            __m256 _alpha_avx = _mm256_set1_ps(alpha);
+            __m256 _cb_avx = _mm256_set1_ps(cb);
+            for (; jj + 7 < max_jj; jj += 8)
+            {
+                __m256 _p = _mm256_add_ps(_mm256_loadu_ps(pp + jj), _cb_avx);
+                _mm256_storeu_ps(outptr + jj, _mm256_mul_ps(_p, _alpha_avx));
+            }
+#endif // __AVX__
+            __m128 _alpha = _mm_set1_ps(alpha);
+            __m128 _cb = _mm_set1_ps(cb);
+            for (; jj + 3 < max_jj; jj += 4)
+            {
+                __m128 _p = _mm_add_ps(_mm_loadu_ps(pp + jj), _cb);
+                _mm_storeu_ps(outptr + jj, _mm_mul_ps(_p, _alpha));
+            }
+#endif // __SSE2__
+            for (; jj < max_jj; jj++)
+            {
+                outptr[jj] = (pp[jj] + cb) * alpha;
+            }
+        }
+    }
+}
+
+static int pack_A(const Mat& A, Mat& AT, int M, int K, int TILE_M, int TILE_K, int transA, bool use_bf16_compute, bool use_amx_bf16, const Option& opt, Allocator* allocator)
+{
+    const int nn_M = (M + TILE_M - 1) / TILE_M;
+    const int nn_K = (K + TILE_K - 1) / TILE_K;
+
+    // bf16 tiles pad k to pairs, amx A tiles pad rows to 16 and k to 32
+    const int TILE_K2 = use_bf16_compute ? (TILE_K + 1) / 2 * 2 : TILE_K;
+    const int TILE_MK_A = use_amx_bf16 ? (TILE_M + 15) / 16 * 16 * ((TILE_K + 31) / 32 * 32) : TILE_M * TILE_K2;
+
+    AT.create(TILE_MK_A, nn_K, nn_M, use_bf16_compute ? 2u : 4u, allocator);
+    if (AT.empty())
+        return -100;
+
+    const int nn_MK = nn_M * nn_K;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int ppik = 0; ppik < nn_MK; ppik++)
+    {
+        const int ppi = ppik / nn_K;
+        const int ppk = ppik % nn_K;
+
+        const int i = ppi * TILE_M;
+        const int k = ppk * TILE_K;
+
+        const int max_ii = std::min(M - i, TILE_M);
+        const int max_kk = std::min(K - k, TILE_K);
+
+#if NCNN_BF16
+        if (use_amx_bf16)
+        {
+            pack_A_tile_bf16_amx(A, AT.channel(ppi).row<unsigned short>(ppk), i, max_ii, k, max_kk, transA);
+            continue;
+        }
+
+        if (use_bf16_compute)
+        {
+            pack_A_tile_bf16(A, AT.channel(ppi).row<unsigned short>(ppk), i, max_ii, k, max_kk, transA);
+            continue;
+        }
+#endif
+
+        pack_A_tile(A, AT.channel(ppi).row(ppk), i, max_ii, k, max_kk, transA);
+    }
+
+    return 0;
+}
+
+static int pack_B(const Mat& B, Mat& BT, int N, int K, int transB, const Option& opt, Allocator* allocator)
+{
+    int TILE_N;
+    int TILE_K;
+    get_optimal_tile_nk(N, K, TILE_N, TILE_K);
+
+    const int nn_N = (N + TILE_N - 1) / TILE_N;
+    const int nn_K = (K + TILE_K - 1) / TILE_K;
+
+    BT.create(TILE_N * TILE_K, nn_K, nn_N, 4u, allocator);
+    if (BT.empty())
+        return -100;
+
+    const int nn_NK = nn_N * nn_K;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int ppjk = 0; ppjk < nn_NK; ppjk++)
+    {
+        const int ppj = ppjk / nn_K;
+        const int ppk = ppjk % nn_K;
+
+        const int j = ppj * TILE_N;
+        const int k = ppk * TILE_K;
+
+        const int max_jj = std::min(N - j, TILE_N);
+        const int max_kk = std::min(K - k, TILE_K);
+
+        pack_B_tile(B, BT.channel(ppj).row(ppk), j, max_jj, k, max_kk, transB);
+    }
+
+    return 0;
+}
+
+#if NCNN_BF16
+static int pack_B_bf16(const Mat& B, Mat& BT, int N, int K, int transB, const Option& opt, Allocator* allocator)
+{
+    int TILE_N;
+    int TILE_K;
+    get_optimal_tile_nk(N, K, TILE_N, TILE_K);
+
+    const int nn_N = (N + TILE_N - 1) / TILE_N;
+    const int nn_K = (K + TILE_K - 1) / TILE_K;
+
+    const int TILE_K2 = (TILE_K + 1) / 2 * 2;
+
+    BT.create(TILE_N * TILE_K2, nn_K, nn_N, 2u, allocator);
+    if (BT.empty())
+        return -100;
+
+    const int nn_NK = nn_N * nn_K;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int ppjk = 0; ppjk < nn_NK; ppjk++)
+    {
+        const int ppj = ppjk / nn_K;
+        const int ppk = ppjk % nn_K;
+
+        const int j = ppj * TILE_N;
+        const int k = ppk * TILE_K;
+
+        const int max_jj = std::min(N - j, TILE_N);
+        const int max_kk = std::min(K - k, TILE_K);
+
+        pack_B_tile_bf16(B, BT.channel(ppj).row<unsigned short>(ppk), j, max_jj, k, max_kk, transB);
+    }
+
+    return 0;
+}
+#endif // NCNN_BF16
+
+#if NCNN_F16C
+static int pack_B_fp16s(const Mat& B, Mat& BT, int N, int K, int transB, const Option& opt)
+{
+    Mat BT_fp32;
+    int ret = pack_B(B, BT_fp32, N, K, transB, opt, (Allocator*)0);
+    if (ret != 0)
+        return ret;
+
+    // same panel layout, the tiles are expanded back to fp32 in forward
+    Option opt_cast = opt;
+    opt_cast.blob_allocator = 0;
+
+    cast_float32_to_float16(BT_fp32, BT, opt_cast);
+    if (BT.empty())
+        return -100;
+
+    return 0;
+}
+
+static int pack_A_fp16s(const Mat& A, Mat& AT, int M, int K, int TILE_M, int TILE_K, int transA, const Option& opt)
+{
+    Mat AT_fp32;
+    int ret = pack_A(A, AT_fp32, M, K, TILE_M, TILE_K, transA, false, false, opt, (Allocator*)0);
+    if (ret != 0)
+        return ret;
+
+    Option opt_cast = opt;
+    opt_cast.blob_allocator = 0;
+
+    cast_float32_to_float16(AT_fp32, AT, opt_cast);
+    if (AT.empty())
+        return -100;
+
+    return 0;
+}
+#endif // NCNN_F16C
+
+static bool gemm_use_fp16_weight_storage(const Option& opt)
+{
+#if NCNN_BF16
+    if (opt.use_bf16_storage && gemm_support_bf16_compute())
+        return false;
+#endif
+
+#if NCNN_F16C
+    return opt.use_fp16_weight_storage && cpu_support_x86_f16c();
+#else
+    (void)opt;
+    return false;
+#endif
+}
+
+static int pack_constant_A(const Mat& A_data, Mat& AT_data, bool& AT_data_fp16, int M, int K, int transA, const Option& opt)
+{
+    int TILE_M;
+    get_constant_tile_m(M, TILE_M);
+
+    // TILE_K depends on K alone, so it matches whatever B comes in
+    int TILE_N;
+    int TILE_K;
+    get_optimal_tile_nk(1, K, TILE_N, TILE_K);
+
+#if NCNN_BF16
+    if (opt.use_bf16_storage && gemm_support_bf16_compute())
+        return pack_A(A_data, AT_data, M, K, TILE_M, TILE_K, transA, true, gemm_support_amx_bf16(), opt, (Allocator*)0);
+#endif // NCNN_BF16
+
+#if NCNN_F16C
+    if (gemm_use_fp16_weight_storage(opt))
+    {
+        AT_data_fp16 = true;
+        return pack_A_fp16s(A_data, AT_data, M, K, TILE_M, TILE_K, transA, opt);
+    }
+#endif // NCNN_F16C
+
+    return pack_A(A_data, AT_data, M, K, TILE_M, TILE_K, transA, false, false, opt, (Allocator*)0);
+}
+
+int Gemm_x86::create_pipeline(const Option& opt)
+{
+    if (constantA)
+    {
+        int ret = pack_constant_A(A_data, AT_data, AT_data_fp16, constantM, constantK, transA, opt);
+        if (ret != 0)
+            return ret;
+
+        if (opt.lightmode)
+        {
+            A_data.release();
+        }
+    }
+
+#if NCNN_BF16
+    if (constantB && opt.use_bf16_storage && gemm_support_bf16_compute())
+    {
+        // bf16 panels halve the weight traffic and feed vdpbf16ps directly
+        int ret = pack_B_bf16(B_data, BT_data, constantN, constantK, transB, opt, (Allocator*)0);
+        if (ret != 0)
+            return ret;
+
+        if (opt.lightmode)
+        {
+            B_data.release();
+        }
+
+        return 0;
+    }
+#endif // NCNN_BF16
+
+#if NCNN_F16C
+    if (constantB && gemm_use_fp16_weight_storage(opt))
+    {
+        int ret = pack_B_fp16s(B_data, BT_data, constantN, constantK, transB, opt);
+        if (ret != 0)
+            return ret;
+
+        BT_data_fp16 = true;
+
+        if (opt.lightmode)
+        {
+            B_data.release();
+        }
+
+        return 0;
+    }
+#endif // NCNN_F16C
+
+    if (constantB)
+    {
+        int ret = pack_B(B_data, BT_data, constantN, constantK, transB, opt, (Allocator*)0);
+        if (ret != 0)
+            return ret;
+
+        if (opt.lightmode)
+        {
+            B_data.release();
+        }
+    }
+
+    return 0;
+}
+
+int Gemm_x86::destroy_pipeline(const Option& /*opt*/)
+{
+    AT_data.release();
+    BT_data.release();
+    AT_data_fp16 = false;
+    BT_data_fp16 = false;
+
+    return 0;
+}
+
+int Gemm_x86::save_pipeline(std::vector<Mat>& pipeline_data) const
+{
+    if (!constantA && !constantB)
+        return -1;
+
+    // the constant A tiles first, then the constant B panels
+    pipeline_data.clear();
+    if (constantA)
+        pipeline_data.push_back(AT_data);
+    if (constantB)
+        pipeline_data.push_back(BT_data);
+
+    return 0;
+}
+
+int Gemm_x86::load_pipeline(const std::vector<Mat>& pipeline_data, const Option& opt)
+{
+    const size_t constant_count = (constantA ? 1 : 0) + (constantB ? 1 : 0);
+    if (constant_count == 0 || pipeline_data.size() != constant_count)
+        return -1;
+
+    size_t index = 0;
+    if (constantA)
+    {
+        AT_data = pipeline_data[index++];
+        AT_data_fp16 = AT_data.elemsize == 2u && gemm_use_fp16_weight_storage(opt);
+    }
+    if (constantB)
+    {
+        BT_data = pipeline_data[index++];
+        BT_data_fp16 = BT_data.elemsize == 2u && gemm_use_fp16_weight_storage(opt);
+    }
+
+    if (opt.lightmode)
+    {
+        A_data.release();
+        B_data.release();
+    }
+
+    return 0;
+}
+
+int Gemm_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    const Mat& A = constantA ? A_data : bottom_blobs[0];
+    const Mat& B = constantB ? B_data : bottom_blobs[constantA ? 0 : 1];
+
+    // the constant operands may be released already, take their shape from the params
+    const int M = constantA ? constantM : transA ? A.w : A.h;
+    const int K = constantA ? constantK : transA ? A.h : A.w; // assert K == constantK when constantB
+    const int N = constantB ? constantN : transB ? B.h : B.w;
+
+    const size_t C_index = (constantA ? 0 : 1) + (constantB ? 0 : 1);
+
+    Mat C;
+    int broadcast_type_C = 0;
+    if (bottom_blobs.size() == C_index + 1)
+    {
+        C = bottom_blobs[C_index];
+
+#if NCNN_BF16
+        if (C.elembits() == 16)
+        {
+            Option opt_ws = opt;
+            opt_ws.blob_allocator = opt.workspace_allocator;
+
+            Mat C_fp32;
+            cast_bfloat16_to_float32(C, C_fp32, opt_ws);
+            if (C_fp32.empty())
+                return -100;
+
+            C = C_fp32;
+        }
+#endif // NCNN_BF16
+
+        if (C.dims == 1 && C.w == 1)
+        {
+            // scalar
+            broadcast_type_C = 0;
+        }
+        if (C.dims == 1 && C.w == M)
+        {
+            // M
+            // auto broadcast from h to w is the ncnn-style convention
+            broadcast_type_C = 1;
+        }
+        if (C.dims == 1 && C.w == N)
+        {
+            // N
+            broadcast_type_C = 4;
+        }
+        if (C.dims == 2 && C.w == 1 && C.h == M)
+        {
+            // Mx1
+            broadcast_type_C = 2;
+        }
+        if (C.dims == 2 && C.w == N && C.h == M)
+        {
+            // MxN
+            broadcast_type_C = 3;
+        }
+        if (C.dims == 2 && C.w == N && C.h == 1)
+        {
+            // 1xN
+            broadcast_type_C = 4;
+        }
+    }
+
+    // bf16 storage in, bf16 storage out
+    const size_t out_elemsize = (constantA ? B : A).elembits() == 16 ? 2u : 4u;
+
+    const int out_elempack = output_elempack > 1 && M % output_elempack == 0 ? output_elempack : 1;
+
+    Mat& top_blob = top_blobs[0];
+    if (output_N1M)
+        top_blob.create(N, 1, M / out_elempack, out_elemsize * out_elempack, out_elempack, opt.blob_allocator);
+    else
+        top_blob.create(N, M / out_elempack, out_elemsize * out_elempack, out_elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    if (K == 0)
+    {
+        // empty product leaves only the C term
+        Mat zeros(N, 1, 4u, opt.workspace_allocator);
+        if (zeros.empty())
+            return -100;
+
+        zeros.fill(0.f);
+
+        for (int i = 0; i < M; i++)
+        {
+            transform_output_tile(zeros, top_blob, C, broadcast_type_C, i, 1, 0, N, N, alpha, beta);
+        }
+
+        return 0;
+    }
+
+#if NCNN_BF16
+    // bf16 packed constant A or B always goes through the dot product kernel, the fp32 operand is rounded while packing
+    const bool use_bf16_compute = constantA ? AT_data.elemsize == 2u && !AT_data_fp16 : constantB ? BT_data.elemsize == 2u && !BT_data_fp16 : A.elembits() == 16 && gemm_support_bf16_compute();
+    const bool use_amx_bf16 = use_bf16_compute && gemm_support_amx_bf16();
+#else
+    const bool use_bf16_compute = false;
+    const bool use_amx_bf16 = false;
+#endif
+
+    if (M < 8 && !constantA && !constantB)
+    {
+        // too few rows to amortize packing B, go through A rows directly
+        Mat AT(K, M, 4u, opt.workspace_allocator);
+        Mat topT(N, M, 4u, opt.workspace_allocator);
+        if (AT.empty() || topT.empty())
+            return -100;
+
+        pack_A_tile(A, AT, 0, M, 0, K, transA);
+
+        Mat B = bottom_blobs[1];
+#if NCNN_BF16
+        if (B.elembits() == 16)
+        {
+            Option opt_ws = opt;
+            opt_ws.blob_allocator = opt.workspace_allocator;
+
+            Mat B_fp32;
+            cast_bfloat16_to_float32(B, B_fp32, opt_ws);
+            if (B_fp32.empty())
+                return -100;
+
+            B = B_fp32;
+        }
+#endif // NCNN_BF16
+
+        gemm_small_m(AT, B, topT, M, N, K, transB, opt);
+
+        transform_output_tile(topT, top_blob, C, broadcast_type_C, 0, M, 0, N, N, alpha, beta);
+
+        return 0;
+    }
+
+    int TILE_N;
+    int TILE_K;
+    get_optimal_tile_nk(N, K, TILE_N, TILE_K);
+
+    const int nn_N = (N + TILE_N - 1) / TILE_N;
+    const int nn_K = (K + TILE_K - 1) / TILE_K;
+
+    int TILE_M;
+    if (constantA)
+        get_constant_tile_m(M, TILE_M);
+    else
+        get_optimal_tile_m(M, nn_N, opt.num_threads, TILE_M);
+
+    const int nn_M = (M + TILE_M - 1) / TILE_M;
+
+    Mat AT;
+    if (constantA)
+    {
+        AT = AT_data;
+    }
+    else
+    {
+        int ret = pack_A(A, AT, M, K, TILE_M, TILE_K, transA, use_bf16_compute, use_amx_bf16, opt, opt.workspace_allocator);
+        if (ret != 0)
+            return ret;
+    }
+
+    Mat BT;
+    if (constantB)
+    {
+        BT = BT_data;
+    }
+    else
+    {
+#if NCNN_BF16
+        int ret = use_bf16_compute ? pack_B_bf16(B, BT, N, K, transB, opt, opt.workspace_allocator) : pack_B(B, BT, N, K, transB, opt, opt.workspace_allocator);
+#else
+        int ret = pack_B(B, BT, N, K, transB, opt, opt.workspace_allocator);
+#endif
+        if (ret != 0)
+            return ret;
+    }
+
+    // per-thread accumulator tile carried across the k blocks
+    Mat topT(TILE_N * TILE_M, 1, opt.num_threads, 4u, opt.workspace_allocator);
+    if (topT.empty())
+        return -100;
+
+    // per-thread fp32 copy of the fp16 A and B tiles in use
+    const bool use_fp16_A = constantA && AT_data_fp16;
+    const bool use_fp16_B = constantB && BT_data_fp16;
+
+    Mat AT_unpacked;
+    if (use_fp16_A)
+    {
+        AT_unpacked.create(TILE_M * TILE_K, 1, opt.num_threads, 4u, opt.workspace_allocator);
+        if (AT_unpacked.empty())
+            return -100;
+    }
+
+    Mat BT_unpacked;
+    if (use_fp16_B)
+    {
+        BT_unpacked.create(TILE_N * TILE_K, 1, opt.num_threads, 4u, opt.workspace_allocator);
+        if (BT_unpacked.empty())
+            return -100;
+    }
+
+    const int nn_MN = nn_M * nn_N;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int ppij = 0; ppij < nn_MN; ppij++)
+    {
+        const int ppi = ppij / nn_N;
+        const int ppj = ppij % nn_N;
+
+        const int i = ppi * TILE_M;
+        const int j = ppj * TILE_N;
+
+        const int max_ii = std::min(M - i, TILE_M);
+        const int max_jj = std::min(N - j, TILE_N);
+
+        float* topT_tile = topT.channel(get_omp_thread_num());
+
+        for (int ppk = 0; ppk < nn_K; ppk++)
+        {
+            const int k = ppk * TILE_K;
+            const int max_kk = std::min(K - k, TILE_K);
+
+#if NCNN_BF16
+            if (use_amx_bf16)
+            {
+                gemm_tile_bf16_amx(AT.channel(ppi).row<const unsigned short>(ppk), BT.channel(ppj).row<const unsigned short>(ppk), topT_tile, max_ii, max_jj, max_kk, TILE_N, ppk == 0);
+                continue;
+            }
+
+            if (use_bf16_compute)
+            {
+                gemm_tile_bf16(AT.channel(ppi).row<const unsigned short>(ppk), BT.channel(ppj).row<const unsigned short>(ppk), topT_tile, max_ii, max_jj, max_kk, TILE_N, ppk == 0);
+                continue;
+            }
+#endif
+
+            const float* AT_tile = AT.channel(ppi).row(ppk);
+            const float* BT_tile = BT.channel(ppj).row(ppk);
+
+#if NCNN_F16C
+            if (use_fp16_A)
+            {
+                float* AT_tile_fp32 = AT_unpacked.channel(get_omp_thread_num());
+                unpack_tile_fp16s(AT.channel(ppi).row<const unsigned short>(ppk), AT_tile_fp32, max_ii * max_kk);
+                AT_tile = AT_tile_fp32;
+            }
+
+            if (use_fp16_B)
+            {
+                float* BT_tile_fp32 = BT_unpacked.channel(get_omp_thread_num());
+                unpack_tile_fp16s(BT.channel(ppj).row<const unsigned short>(ppk), BT_tile_fp32, max_jj * max_kk);
+                BT_tile = BT_tile_fp32;
+            }
+#endif
+
+            gemm_tile(AT_tile, BT_tile, topT_tile, max_ii, max_jj, max_kk, TILE_N, ppk == 0);
+        }
+
+        transform_output_tile(topT_tile, top_blob, C, broadcast_type_C, i, max_ii, j, max_jj, TILE_N, alpha, beta);
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
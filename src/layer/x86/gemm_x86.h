@@ -0,0 +1,49 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef LAYER_GEMM_X86_H
+#define LAYER_GEMM_X86_H
+
+#include "gemm.h"
+
+namespace ncnn {
+
+class Gemm_x86 : virtual public Gemm
+{
+public:
+    Gemm_x86();
+
+    virtual int create_pipeline(const Option& opt);
+    virtual int destroy_pipeline(const Option& opt);
+
+    virtual int save_pipeline(std::vector<Mat>& pipeline_data) const;
+    virtual int load_pipeline(const std::vector<Mat>& pipeline_data, const Option& opt);
+
+    virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
+
+public:
+    // constant A packed into TILE_M x TILE_K tiles
+    Mat AT_data;
+
+    // constant B packed into TILE_N x TILE_K panels
+    Mat BT_data;
+
+    // AT_data and BT_data hold fp16 tiles with use_fp16_weight_storage
+    bool AT_data_fp16;
+    bool BT_data_fp16;
+};
+
+} // namespace ncnn
+
+#endif // LAYER_GEMM_X86_H
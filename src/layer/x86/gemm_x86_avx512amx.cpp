@@ -0,0 +1,28 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "cpu.h"
+#include "mat.h"
+#include "x86_amx.h"
+
+namespace ncnn {
+
+#include "gemm_bf16.h"
+
+void gemm_tile_bf16_amx_avx512amx(const unsigned short* AT_tile, const unsigned short* BT_tile, float* topT, int max_ii, int max_jj, int max_kk, int out_hstep, bool k_begin)
+{
+    gemm_tile_bf16_amx(AT_tile, BT_tile, topT, max_ii, max_jj, max_kk, out_hstep, k_begin);
+}
+
+} // namespace ncnn
@@ -0,0 +1,98 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "groupnorm_x86.h"
+
+#include "x86_norm.h"
+
+#include <math.h>
+
+namespace ncnn {
+
+GroupNorm_x86::GroupNorm_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+int GroupNorm_x86::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
+{
+    // x = (x - mean) / sqrt(var + eps) * gamma + beta
+
+    const int w = bottom_top_blob.w;
+    const int h = bottom_top_blob.h;
+    const int c = bottom_top_blob.c;
+    const int elempack = bottom_top_blob.elempack;
+    const int size = w * h;
+
+    const int channels_per_group = channels / group;
+
+    // a group may start or end in the middle of a packed channel,
+    // so gather per channel statistics first and scatter per channel scale and bias back
+    Mat mean(channels, (size_t)4u, opt.workspace_allocator);
+    Mat m2(channels, (size_t)4u, opt.workspace_allocator);
+    Mat a(channels, (size_t)4u, opt.workspace_allocator);
+    Mat b(channels, (size_t)4u, opt.workspace_allocator);
+    if (mean.empty() || m2.empty() || a.empty() || b.empty())
+        return -100;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < c; q++)
+    {
+        const float* ptr = bottom_top_blob.channel(q);
+
+        norm_channel_stats(ptr, elempack, size, (float*)mean + q * elempack, (float*)m2 + q * elempack);
+    }
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int g = 0; g < group; g++)
+    {
+        const int q0 = g * channels_per_group;
+
+        float group_mean;
+        float group_m2;
+        norm_merge_stats((const float*)mean + q0, (const float*)m2 + q0, channels_per_group, size, group_mean, group_m2);
+
+        const float var = group_m2 / (channels_per_group * size);
+        const float inv_std = static_cast<float>(1.f / sqrt(var + eps));
+
+        // fold the normalization and the affine into one multiply-add
+        for (int q = q0; q < q0 + channels_per_group; q++)
+        {
+            if (affine)
+            {
+                a[q] = gamma_data[q] * inv_std;
+                b[q] = -group_mean * a[q] + beta_data[q];
+            }
+            else
+            {
+                a[q] = inv_std;
+                b[q] = -group_mean * inv_std;
+            }
+        }
+    }
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < c; q++)
+    {
+        float* ptr = bottom_top_blob.channel(q);
+
+        norm_apply(ptr, ptr, elempack, size, (const float*)a + q * elempack, (const float*)b + q * elempack);
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
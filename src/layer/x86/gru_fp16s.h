@@ -0,0 +1,236 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#if NCNN_RUNTIME_CPU && NCNN_F16C && __AVX__ && !__F16C__
+void gru_fp16s_f16c(const Mat& gates_x, Mat& top_blob, int dr, int reverse, const unsigned short* weight_hc_packed, const float* bias_bn, float* hidden_state, int num_output, const Option& opt);
+#endif
+
+#if __F16C__
+// outputs q .. max_q of one timestep, weights in fp16
+// gx          precomputed R U N input projections with bias
+// hidden_prev hidden state of the previous timestep
+static void gru_fp16s_block(const unsigned short* kptr, const float* gx, const float* bias_bn, const float* hidden_prev, float* outptr, int num_output, int q, int max_q)
+{
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    for (; q + 15 < max_q; q += 16)
+    {
+        __m512 _sum_r0 = _mm512_setzero_ps();
+        __m512 _sum_u0 = _mm512_setzero_ps();
+        __m512 _sum_n0 = _mm512_setzero_ps();
+        __m512 _sum_r1 = _mm512_setzero_ps();
+        __m512 _sum_u1 = _mm512_setzero_ps();
+        __m512 _sum_n1 = _mm512_setzero_ps();
+
+        int i = 0;
+        for (; i + 1 < num_output; i += 2)
+        {
+            __m512 _h0 = _mm512_set1_ps(hidden_prev[i]);
+            __m512 _h1 = _mm512_set1_ps(hidden_prev[i + 1]);
+            _sum_r0 = _mm512_fmadd_ps(_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)kptr)), _h0, _sum_r0);
+            _sum_u0 = _mm512_fmadd_ps(_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(kptr + 16))), _h0, _sum_u0);
+            _sum_n0 = _mm512_fmadd_ps(_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(kptr + 32))), _h0, _sum_n0);
+            _sum_r1 = _mm512_fmadd_ps(_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(kptr + 48))), _h1, _sum_r1);
+            _sum_u1 = _mm512_fmadd_ps(_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(kptr + 64))), _h1, _sum_u1);
+            _sum_n1 = _mm512_fmadd_ps(_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(kptr + 80))), _h1, _sum_n1);
+            kptr += 96;
+        }
+        for (; i < num_output; i++)
+        {
+            __m512 _h0 = _mm512_set1_ps(hidden_prev[i]);
+            _sum_r0 = _mm512_fmadd_ps(_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)kptr)), _h0, _sum_r0);
+            _sum_u0 = _mm512_fmadd_ps(_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(kptr + 16))), _h0, _sum_u0);
+            _sum_n0 = _mm512_fmadd_ps(_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(kptr + 32))), _h0, _sum_n0);
+            kptr += 48;
+        }
+        _sum_r0 = _mm512_add_ps(_sum_r0, _sum_r1);
+        _sum_u0 = _mm512_add_ps(_sum_u0, _sum_u1);
+        _sum_n0 = _mm512_add_ps(_sum_n0, _sum_n1);
+
+        // R = sigmoid(gx_r + W_hr * h)
+        // U = sigmoid(gx_u + W_hu * h)
+        // N = tanh(gx_n + R * (bias_bn + W_hn * h))
+        // H = (1 - U) * N + U * h = N + U * (h - N)
+        __m512 _R = sigmoid_avx512(_mm512_add_ps(_mm512_loadu_ps(gx + q), _sum_r0));
+        __m512 _U = sigmoid_avx512(_mm512_add_ps(_mm512_loadu_ps(gx + num_output + q), _sum_u0));
+        __m512 _N = tanh_avx512(_mm512_fmadd_ps(_R, _mm512_add_ps(_mm512_loadu_ps(bias_bn + q), _sum_n0), _mm512_loadu_ps(gx + num_output * 2 + q)));
+        __m512 _H = _mm512_fmadd_ps(_U, _mm512_sub_ps(_mm512_loadu_ps(hidden_prev + q), _N), _N);
+        _mm512_storeu_ps(outptr + q, _H);
+    }
+#endif // __AVX512F__
+    for (; q + 7 < max_q; q += 8)
+    {
+        __m256 _sum_r0 = _mm256_setzero_ps();
+        __m256 _sum_u0 = _mm256_setzero_ps();
+        __m256 _sum_n0 = _mm256_setzero_ps();
+        __m256 _sum_r1 = _mm256_setzero_ps();
+        __m256 _sum_u1 = _mm256_setzero_ps();
+        __m256 _sum_n1 = _mm256_setzero_ps();
+
+        int i = 0;
+        for (; i + 1 < num_output; i += 2)
+        {
+            __m256 _h0 = _mm256_set1_ps(hidden_prev[i]);
+            __m256 _h1 = _mm256_set1_ps(hidden_prev[i + 1]);
+            _sum_r0 = _mm256_comp_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)kptr)), _h0, _sum_r0);
+            _sum_u0 = _mm256_comp_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(kptr + 8))), _h0, _sum_u0);
+            _sum_n0 = _mm256_comp_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(kptr + 16))), _h0, _sum_n0);
+            _sum_r1 = _mm256_comp_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(kptr + 24))), _h1, _sum_r1);
+            _sum_u1 = _mm256_comp_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(kptr + 32))), _h1, _sum_u1);
+            _sum_n1 = _mm256_comp_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(kptr + 40))), _h1, _sum_n1);
+            kptr += 48;
+        }
+        for (; i < num_output; i++)
+        {
+            __m256 _h0 = _mm256_set1_ps(hidden_prev[i]);
+            _sum_r0 = _mm256_comp_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)kptr)), _h0, _sum_r0);
+            _sum_u0 = _mm256_comp_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(kptr + 8))), _h0, _sum_u0);
+            _sum_n0 = _mm256_comp_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(kptr + 16))), _h0, _sum_n0);
+            kptr += 24;
+        }
+        _sum_r0 = _mm256_add_ps(_sum_r0, _sum_r1);
+        _sum_u0 = _mm256_add_ps(_sum_u0, _sum_u1);
+        _sum_n0 = _mm256_add_ps(_sum_n0, _sum_n1);
+
+        __m256 _R = sigmoid_avx(_mm256_add_ps(_mm256_loadu_ps(gx + q), _sum_r0));
+        __m256 _U = sigmoid_avx(_mm256_add_ps(_mm256_loadu_ps(gx + num_output + q), _sum_u0));
+        __m256 _N = tanh_avx(_mm256_comp_fmadd_ps(_R, _mm256_add_ps(_mm256_loadu_ps(bias_bn + q), _sum_n0), _mm256_loadu_ps(gx + num_output * 2 + q)));
+        __m256 _H = _mm256_comp_fmadd_ps(_U, _mm256_sub_ps(_mm256_loadu_ps(hidden_prev + q), _N), _N);
+        _mm256_storeu_ps(outptr + q, _H);
+    }
+#endif // __AVX__
+    for (; q + 3 < max_q; q += 4)
+    {
+        __m128 _sum_r0 = _mm_setzero_ps();
+        __m128 _sum_u0 = _mm_setzero_ps();
+        __m128 _sum_n0 = _mm_setzero_ps();
+        __m128 _sum_r1 = _mm_setzero_ps();
+        __m128 _sum_u1 = _mm_setzero_ps();
+        __m128 _sum_n1 = _mm_setzero_ps();
+
+        int i = 0;
+        for (; i + 1 < num_output; i += 2)
+        {
+            __m128 _h0 = _mm_set1_ps(hidden_prev[i]);
+            __m128 _h1 = _mm_set1_ps(hidden_prev[i + 1]);
+            _sum_r0 = _mm_comp_fmadd_ps(_mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)kptr)), _h0, _sum_r0);
+            _sum_u0 = _mm_comp_fmadd_ps(_mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)(kptr + 4))), _h0, _sum_u0);
+            _sum_n0 = _mm_comp_fmadd_ps(_mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)(kptr + 8))), _h0, _sum_n0);
+            _sum_r1 = _mm_comp_fmadd_ps(_mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)(kptr + 12))), _h1, _sum_r1);
+            _sum_u1 = _mm_comp_fmadd_ps(_mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)(kptr + 16))), _h1, _sum_u1);
+            _sum_n1 = _mm_comp_fmadd_ps(_mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)(kptr + 20))), _h1, _sum_n1);
+            kptr += 24;
+        }
+        for (; i < num_output; i++)
+        {
+            __m128 _h0 = _mm_set1_ps(hidden_prev[i]);
+            _sum_r0 = _mm_comp_fmadd_ps(_mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)kptr)), _h0, _sum_r0);
+            _sum_u0 = _mm_comp_fmadd_ps(_mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)(kptr + 4))), _h0, _sum_u0);
+            _sum_n0 = _mm_comp_fmadd_ps(_mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)(kptr + 8))), _h0, _sum_n0);
+            kptr += 12;
+        }
+        _sum_r0 = _mm_add_ps(_sum_r0, _sum_r1);
+        _sum_u0 = _mm_add_ps(_sum_u0, _sum_u1);
+        _sum_n0 = _mm_add_ps(_sum_n0, _sum_n1);
+
+        __m128 _R = sigmoid_sse(_mm_add_ps(_mm_loadu_ps(gx + q), _sum_r0));
+        __m128 _U = sigmoid_sse(_mm_add_ps(_mm_loadu_ps(gx + num_output + q), _sum_u0));
+        __m128 _N = tanh_sse(_mm_comp_fmadd_ps(_R, _mm_add_ps(_mm_loadu_ps(bias_bn + q), _sum_n0), _mm_loadu_ps(gx + num_output * 2 + q)));
+        __m128 _H = _mm_comp_fmadd_ps(_U, _mm_sub_ps(_mm_loadu_ps(hidden_prev + q), _N), _N);
+        _mm_storeu_ps(outptr + q, _H);
+    }
+#endif // __SSE2__
+    for (; q < max_q; q++)
+    {
+        float sum_r = 0.f;
+        float sum_u = 0.f;
+        float sum_n = 0.f;
+
+        for (int i = 0; i < num_output; i++)
+        {
+            const float h = hidden_prev[i];
+            sum_r += float16_to_float32(kptr[0]) * h;
+            sum_u += float16_to_float32(kptr[1]) * h;
+            sum_n += float16_to_float32(kptr[2]) * h;
+            kptr += 3;
+        }
+
+        const float R = 1.f / (1.f + expf(-(gx[q] + sum_r)));
+        const float U = 1.f / (1.f + expf(-(gx[num_output + q] + sum_u)));
+        const float N = tanhf(gx[num_output * 2 + q] + R * (bias_bn[q] + sum_n));
+        outptr[q] = N + U * (hidden_prev[q] - N);
+    }
+}
+#endif // __F16C__
+
+// gates_x      (num_output * 3 * num_directions, T)
+// top_blob     (num_output * num_directions, T), this direction writes at offset dr * num_output
+// hidden_state initial hidden state in, last hidden state out
+static void gru_fp16s(const Mat& gates_x, Mat& top_blob, int dr, int reverse, const unsigned short* weight_hc_packed, const float* bias_bn, float* hidden_state, int num_output, const Option& opt)
+{
+#if NCNN_RUNTIME_CPU && NCNN_F16C && __AVX__ && !__F16C__
+    if (ncnn::cpu_support_x86_f16c())
+    {
+        gru_fp16s_f16c(gates_x, top_blob, dr, reverse, weight_hc_packed, bias_bn, hidden_state, num_output, opt);
+        return;
+    }
+#endif
+
+#if __F16C__
+    const int T = top_blob.h;
+
+#if __AVX512F__
+    const int block_size = 16;
+#else
+    const int block_size = 8;
+#endif
+    const int nn_block = (num_output + block_size - 1) / block_size;
+
+    for (int t = 0; t < T; t++)
+    {
+        const int ti = reverse ? T - 1 - t : t;
+
+        // the previous hidden state is the previous output row
+        const float* hidden_prev = t == 0 ? hidden_state : top_blob.row(reverse ? ti + 1 : ti - 1) + num_output * dr;
+
+        const float* gx = gates_x.row(ti) + num_output * 3 * dr;
+        float* outptr = top_blob.row(ti) + num_output * dr;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int bb = 0; bb < nn_block; bb++)
+        {
+            const int q = bb * block_size;
+            const int max_q = std::min(q + block_size, num_output);
+
+            gru_fp16s_block(weight_hc_packed + q * num_output * 3, gx, bias_bn, hidden_prev, outptr, num_output, q, max_q);
+        }
+    }
+
+    if (T > 0)
+    {
+        memcpy(hidden_state, top_blob.row(reverse ? 0 : T - 1) + num_output * dr, num_output * sizeof(float));
+    }
+#else  // __F16C__
+    (void)gates_x;
+    (void)top_blob;
+    (void)dr;
+    (void)reverse;
+    (void)weight_hc_packed;
+    (void)bias_bn;
+    (void)hidden_state;
+    (void)num_output;
+    (void)opt;
+#endif // __F16C__
+}
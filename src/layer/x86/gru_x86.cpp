@@ -0,0 +1,731 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "gru_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX__
+#include <immintrin.h>
+#endif
+#endif // __SSE2__
+
+#include "x86_activation.h"
+#include "x86_usability.h"
+
+#include "layer_type.h"
+
+#include "cpu.h"
+
+#include <math.h>
+
+namespace ncnn {
+
+#if NCNN_F16C
+#include "gru_fp16s.h"
+#endif
+
+GRU_x86::GRU_x86()
+{
+    one_blob_only = false;
+    support_inplace = false;
+
+    gemm_xc = 0;
+    gemm_hc[0] = 0;
+    gemm_hc[1] = 0;
+}
+
+// the widest output block the recurrent kernel handles at once
+static int gru_block_size()
+{
+#if __AVX512F__
+    return 16;
+#elif __AVX__
+    return 8;
+#elif __SSE2__
+    return 4;
+#else
+    return 1;
+#endif
+}
+
+// interleave the R U N rows of weight_hc so that one block of outputs reads
+// its three gates for hidden element i from a single contiguous run
+// block q starts at q * num_output * 3 whatever its width
+static void gru_transform_weight_hc(const Mat& weight_hc, float* pp, int num_output)
+{
+    int q = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    for (; q + 15 < num_output; q += 16)
+    {
+        for (int i = 0; i < num_output; i++)
+        {
+            for (int g = 0; g < 3; g++)
+            {
+                for (int k = 0; k < 16; k++)
+                {
+                    *pp++ = weight_hc.row(num_output * g + q + k)[i];
+                }
+            }
+        }
+    }
+#endif // __AVX512F__
+    for (; q + 7 < num_output; q += 8)
+    {
+        for (int i = 0; i < num_output; i++)
+        {
+            for (int g = 0; g < 3; g++)
+            {
+                for (int k = 0; k < 8; k++)
+                {
+                    *pp++ = weight_hc.row(num_output * g + q + k)[i];
+                }
+            }
+        }
+    }
+#endif // __AVX__
+    for (; q + 3 < num_output; q += 4)
+    {
+        for (int i = 0; i < num_output; i++)
+        {
+            for (int g = 0; g < 3; g++)
+            {
+                for (int k = 0; k < 4; k++)
+                {
+                    *pp++ = weight_hc.row(num_output * g + q + k)[i];
+                }
+            }
+        }
+    }
+#endif // __SSE2__
+    for (; q < num_output; q++)
+    {
+        for (int i = 0; i < num_output; i++)
+        {
+            for (int g = 0; g < 3; g++)
+            {
+                *pp++ = weight_hc.row(num_output * g + q)[i];
+            }
+        }
+    }
+}
+
+int GRU_x86::create_pipeline(const Option& opt)
+{
+    const int num_directions = direction == 2 ? 2 : 1;
+    const int size = weight_data_size / num_directions / num_output / 3;
+
+    // keep the gate gemms in fp32, the recurrence accumulates their rounding over every timestep
+    Option opt_gemm = opt;
+    opt_gemm.use_bf16_storage = false;
+
+    // gates_x = x * weight_xc^T + bias
+    // both directions share one gemm over the whole sequence
+    {
+        Mat weight_xc_data_packed(size, num_output * 3 * num_directions);
+        bias_xc_data_packed.create(num_output * 3 * num_directions);
+        if (weight_xc_data_packed.empty() || bias_xc_data_packed.empty())
+            return -100;
+
+        for (int dr = 0; dr < num_directions; dr++)
+        {
+            // rows R U N
+            memcpy(weight_xc_data_packed.row(num_output * 3 * dr), weight_xc_data.channel(dr), size * num_output * 3 * sizeof(float));
+
+            // bias R U WN, bias BN is applied inside the reset gate
+            memcpy((float*)bias_xc_data_packed + num_output * 3 * dr, bias_c_data.channel(dr), num_output * 3 * sizeof(float));
+        }
+
+        gemm_xc = ncnn::create_layer(ncnn::LayerType::Gemm);
+
+        ncnn::ParamDict pd;
+        pd.set(0, 1.f);                             // alpha
+        pd.set(1, 1.f);                             // beta
+        pd.set(2, 0);                               // transA
+        pd.set(3, 1);                               // transB
+        pd.set(5, 1);                               // constantB
+        pd.set(8, num_output * 3 * num_directions); // constantN
+        pd.set(9, size);                            // constantK
+
+        gemm_xc->load_param(pd);
+
+        Mat weights[1];
+        weights[0] = weight_xc_data_packed;
+
+        gemm_xc->load_model(ModelBinFromMatArray(weights));
+
+        gemm_xc->create_pipeline(opt_gemm);
+    }
+
+    Mat weight_hc_data_packed_fp32(num_output * 3 * num_output, num_directions);
+    if (weight_hc_data_packed_fp32.empty())
+        return -100;
+
+    for (int dr = 0; dr < num_directions; dr++)
+    {
+        gru_transform_weight_hc(weight_hc_data.channel(dr), weight_hc_data_packed_fp32.row(dr), num_output);
+    }
+
+#if NCNN_F16C
+    if (cpu_support_x86_f16c() && opt.use_fp16_storage)
+    {
+        // the recurrent weights are read once per timestep, halve that traffic
+        cast_float32_to_float16(weight_hc_data_packed_fp32, weight_hc_data_packed, opt);
+        if (weight_hc_data_packed.empty())
+            return -100;
+    }
+    else
+#endif
+    {
+        weight_hc_data_packed = weight_hc_data_packed_fp32;
+    }
+
+    if (streaming)
+    {
+        // batched streams step together, their hidden states form the rows of A
+        // gates_h = h * weight_hc^T + (0, 0, bias BN)
+        bias_hc_data_packed.create(num_output * 3, num_directions);
+        if (bias_hc_data_packed.empty())
+            return -100;
+
+        bias_hc_data_packed.fill(0.f);
+
+        for (int dr = 0; dr < num_directions; dr++)
+        {
+            memcpy(bias_hc_data_packed.row(dr) + num_output * 2, bias_c_data.channel(dr).row(3), num_output * sizeof(float));
+
+            gemm_hc[dr] = ncnn::create_layer(ncnn::LayerType::Gemm);
+
+            ncnn::ParamDict pd;
+            pd.set(0, 1.f);            // alpha
+            pd.set(1, 1.f);            // beta
+            pd.set(2, 0);              // transA
+            pd.set(3, 1);              // transB
+            pd.set(5, 1);              // constantB
+            pd.set(8, num_output * 3); // constantN
+            pd.set(9, num_output);     // constantK
+
+            gemm_hc[dr]->load_param(pd);
+
+            Mat weights[1];
+            weights[0] = weight_hc_data.channel(dr).clone();
+
+            gemm_hc[dr]->load_model(ModelBinFromMatArray(weights));
+
+            gemm_hc[dr]->create_pipeline(opt_gemm);
+        }
+    }
+
+    if (opt.lightmode)
+    {
+        weight_xc_data.release();
+        weight_hc_data.release();
+    }
+
+    return 0;
+}
+
+int GRU_x86::destroy_pipeline(const Option& opt)
+{
+    if (gemm_xc)
+    {
+        gemm_xc->destroy_pipeline(opt);
+        delete gemm_xc;
+        gemm_xc = 0;
+    }
+
+    for (int dr = 0; dr < 2; dr++)
+    {
+        if (gemm_hc[dr])
+        {
+            gemm_hc[dr]->destroy_pipeline(opt);
+            delete gemm_hc[dr];
+            gemm_hc[dr] = 0;
+        }
+    }
+
+    return 0;
+}
+
+// outputs q .. max_q of one timestep
+// gx          precomputed R U N input projections with bias
+// hidden_prev hidden state of the previous timestep
+static void gru_x86_block(const float* kptr, const float* gx, const float* bias_bn, const float* hidden_prev, float* outptr, int num_output, int q, int max_q)
+{
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    for (; q + 15 < max_q; q += 16)
+    {
+        __m512 _sum_r0 = _mm512_setzero_ps();
+        __m512 _sum_u0 = _mm512_setzero_ps();
+        __m512 _sum_n0 = _mm512_setzero_ps();
+        __m512 _sum_r1 = _mm512_setzero_ps();
+        __m512 _sum_u1 = _mm512_setzero_ps();
+        __m512 _sum_n1 = _mm512_setzero_ps();
+
+        int i = 0;
+        for (; i + 1 < num_output; i += 2)
+        {
+            __m512 _h0 = _mm512_set1_ps(hidden_prev[i]);
+            __m512 _h1 = _mm512_set1_ps(hidden_prev[i + 1]);
+            _sum_r0 = _mm512_fmadd_ps(_mm512_loadu_ps(kptr), _h0, _sum_r0);
+            _sum_u0 = _mm512_fmadd_ps(_mm512_loadu_ps(kptr + 16), _h0, _sum_u0);
+            _sum_n0 = _mm512_fmadd_ps(_mm512_loadu_ps(kptr + 32), _h0, _sum_n0);
+            _sum_r1 = _mm512_fmadd_ps(_mm512_loadu_ps(kptr + 48), _h1, _sum_r1);
+            _sum_u1 = _mm512_fmadd_ps(_mm512_loadu_ps(kptr + 64), _h1, _sum_u1);
+            _sum_n1 = _mm512_fmadd_ps(_mm512_loadu_ps(kptr + 80), _h1, _sum_n1);
+            kptr += 96;
+        }
+        for (; i < num_output; i++)
+        {
+            __m512 _h0 = _mm512_set1_ps(hidden_prev[i]);
+            _sum_r0 = _mm512_fmadd_ps(_mm512_loadu_ps(kptr), _h0, _sum_r0);
+            _sum_u0 = _mm512_fmadd_ps(_mm512_loadu_ps(kptr + 16), _h0, _sum_u0);
+            _sum_n0 = _mm512_fmadd_ps(_mm512_loadu_ps(kptr + 32), _h0, _sum_n0);
+            kptr += 48;
+        }
+        _sum_r0 = _mm512_add_ps(_sum_r0, _sum_r1);
+        _sum_u0 = _mm512_add_ps(_sum_u0, _sum_u1);
+        _sum_n0 = _mm512_add_ps(_sum_n0, _sum_n1);
+
+        // R = sigmoid(gx_r + W_hr * h)
+        // U = sigmoid(gx_u + W_hu * h)
+        // N = tanh(gx_n + R * (bias_bn + W_hn * h))
+        // H = (1 - U) * N + U * h = N + U * (h - N)
+        __m512 _R = sigmoid_avx512(_mm512_add_ps(_mm512_loadu_ps(gx + q), _sum_r0));
+        __m512 _U = sigmoid_avx512(_mm512_add_ps(_mm512_loadu_ps(gx + num_output + q), _sum_u0));
+        __m512 _N = tanh_avx512(_mm512_fmadd_ps(_R, _mm512_add_ps(_mm512_loadu_ps(bias_bn + q), _sum_n0), _mm512_loadu_ps(gx + num_output * 2 + q)));
+        __m512 _H = _mm512_fmadd_ps(_U, _mm512_sub_ps(_mm512_loadu_ps(hidden_prev + q), _N), _N);
+        _mm512_storeu_ps(outptr + q, _H);
+    }
+#endif // __AVX512F__
+    for (; q + 7 < max_q; q += 8)
+    {
+        __m256 _sum_r0 = _mm256_setzero_ps();
+        __m256 _sum_u0 = _mm256_setzero_ps();
+        __m256 _sum_n0 = _mm256_setzero_ps();
+        __m256 _sum_r1 = _mm256_setzero_ps();
+        __m256 _sum_u1 = _mm256_setzero_ps();
+        __m256 _sum_n1 = _mm256_setzero_ps();
+
+        int i = 0;
+        for (; i + 1 < num_output; i += 2)
+        {
+            __m256 _h0 = _mm256_set1_ps(hidden_prev[i]);
+            __m256 _h1 = _mm256_set1_ps(hidden_prev[i + 1]);
+            _sum_r0 = _mm256_comp_fmadd_ps(_mm256_loadu_ps(kptr), _h0, _sum_r0);
+            _sum_u0 = _mm256_comp_fmadd_ps(_mm256_loadu_ps(kptr + 8), _h0, _sum_u0);
+            _sum_n0 = _mm256_comp_fmadd_ps(_mm256_loadu_ps(kptr + 16), _h0, _sum_n0);
+            _sum_r1 = _mm256_comp_fmadd_ps(_mm256_loadu_ps(kptr + 24), _h1, _sum_r1);
+            _sum_u1 = _mm256_comp_fmadd_ps(_mm256_loadu_ps(kptr + 32), _h1, _sum_u1);
+            _sum_n1 = _mm256_comp_fmadd_ps(_mm256_loadu_ps(kptr + 40), _h1, _sum_n1);
+            kptr += 48;
+        }
+        for (; i < num_output; i++)
+        {
+            __m256 _h0 = _mm256_set1_ps(hidden_prev[i]);
+            _sum_r0 = _mm256_comp_fmadd_ps(_mm256_loadu_ps(kptr), _h0, _sum_r0);
+            _sum_u0 = _mm256_comp_fmadd_ps(_mm256_loadu_ps(kptr + 8), _h0, _sum_u0);
+            _sum_n0 = _mm256_comp_fmadd_ps(_mm256_loadu_ps(kptr + 16), _h0, _sum_n0);
+            kptr += 24;
+        }
+        _sum_r0 = _mm256_add_ps(_sum_r0, _sum_r1);
+        _sum_u0 = _mm256_add_ps(_sum_u0, _sum_u1);
+        _sum_n0 = _mm256_add_ps(_sum_n0, _sum_n1);
+
+        __m256 _R = sigmoid_avx(_mm256_add_ps(_mm256_loadu_ps(gx + q), _sum_r0));
+        __m256 _U = sigmoid_avx(_mm256_add_ps(_mm256_loadu_ps(gx + num_output + q), _sum_u0));
+        __m256 _N = tanh_avx(_mm256_comp_fmadd_ps(_R, _mm256_add_ps(_mm256_loadu_ps(bias_bn + q), _sum_n0), _mm256_loadu_ps(gx + num_output * 2 + q)));
+        __m256 _H = _mm256_comp_fmadd_ps(_U, _mm256_sub_ps(_mm256_loadu_ps(hidden_prev + q), _N), _N);
+        _mm256_storeu_ps(outptr + q, _H);
+    }
+#endif // __AVX__
+    for (; q + 3 < max_q; q += 4)
+    {
+        __m128 _sum_r0 = _mm_setzero_ps();
+        __m128 _sum_u0 = _mm_setzero_ps();
+        __m128 _sum_n0 = _mm_setzero_ps();
+        __m128 _sum_r1 = _mm_setzero_ps();
+        __m128 _sum_u1 = _mm_setzero_ps();
+        __m128 _sum_n1 = _mm_setzero_ps();
+
+        int i = 0;
+        for (; i + 1 < num_output; i += 2)
+        {
+            __m128 _h0 = _mm_set1_ps(hidden_prev[i]);
+            __m128 _h1 = _mm_set1_ps(hidden_prev[i + 1]);
+            _sum_r0 = _mm_comp_fmadd_ps(_mm_loadu_ps(kptr), _h0, _sum_r0);
+            _sum_u0 = _mm_comp_fmadd_ps(_mm_loadu_ps(kptr + 4), _h0, _sum_u0);
+            _sum_n0 = _mm_comp_fmadd_ps(_mm_loadu_ps(kptr + 8), _h0, _sum_n0);
+            _sum_r1 = _mm_comp_fmadd_ps(_mm_loadu_ps(kptr + 12), _h1, _sum_r1);
+            _sum_u1 = _mm_comp_fmadd_ps(_mm_loadu_ps(kptr + 16), _h1, _sum_u1);
+            _sum_n1 = _mm_comp_fmadd_ps(_mm_loadu_ps(kptr + 20), _h1, _sum_n1);
+            kptr += 24;
+        }
+        for (; i < num_output; i++)
+        {
+            __m128 _h0 = _mm_set1_ps(hidden_prev[i]);
+            _sum_r0 = _mm_comp_fmadd_ps(_mm_loadu_ps(kptr), _h0, _sum_r0);
+            _sum_u0 = _mm_comp_fmadd_ps(_mm_loadu_ps(kptr + 4), _h0, _sum_u0);
+            _sum_n0 = _mm_comp_fmadd_ps(_mm_loadu_ps(kptr + 8), _h0, _sum_n0);
+            kptr += 12;
+        }
+        _sum_r0 = _mm_add_ps(_sum_r0, _sum_r1);
+        _sum_u0 = _mm_add_ps(_sum_u0, _sum_u1);
+        _sum_n0 = _mm_add_ps(_sum_n0, _sum_n1);
+
+        __m128 _R = sigmoid_sse(_mm_add_ps(_mm_loadu_ps(gx + q), _sum_r0));
+        __m128 _U = sigmoid_sse(_mm_add_ps(_mm_loadu_ps(gx + num_output + q), _sum_u0));
+        __m128 _N = tanh_sse(_mm_comp_fmadd_ps(_R, _mm_add_ps(_mm_loadu_ps(bias_bn + q), _sum_n0), _mm_loadu_ps(gx + num_output * 2 + q)));
+        __m128 _H = _mm_comp_fmadd_ps(_U, _mm_sub_ps(_mm_loadu_ps(hidden_prev + q), _N), _N);
+        _mm_storeu_ps(outptr + q, _H);
+    }
+#endif // __SSE2__
+    for (; q < max_q; q++)
+    {
+        float sum_r = 0.f;
+        float sum_u = 0.f;
+        float sum_n = 0.f;
+
+        for (int i = 0; i < num_output; i++)
+        {
+            const float h = hidden_prev[i];
+            sum_r += kptr[0] * h;
+            sum_u += kptr[1] * h;
+            sum_n += kptr[2] * h;
+            kptr += 3;
+        }
+
+        const float R = 1.f / (1.f + expf(-(gx[q] + sum_r)));
+        const float U = 1.f / (1.f + expf(-(gx[num_output + q] + sum_u)));
+        const float N = tanhf(gx[num_output * 2 + q] + R * (bias_bn[q] + sum_n));
+        outptr[q] = N + U * (hidden_prev[q] - N);
+    }
+}
+
+// gates_x      (num_output * 3 * num_directions, T)
+// top_blob     (num_output * num_directions, T), this direction writes at offset dr * num_output
+// hidden_state initial hidden state in, last hidden state out
+static void gru_x86(const Mat& gates_x, Mat& top_blob, int dr, int reverse, const float* weight_hc_packed, const float* bias_bn, float* hidden_state, int num_output, const Option& opt)
+{
+    const int T = top_blob.h;
+
+    const int block_size = gru_block_size();
+    const int nn_block = (num_output + block_size - 1) / block_size;
+
+    for (int t = 0; t < T; t++)
+    {
+        const int ti = reverse ? T - 1 - t : t;
+
+        // the previous hidden state is the previous output row
+        const float* hidden_prev = t == 0 ? hidden_state : top_blob.row(reverse ? ti + 1 : ti - 1) + num_output * dr;
+
+        const float* gx = gates_x.row(ti) + num_output * 3 * dr;
+        float* outptr = top_blob.row(ti) + num_output * dr;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int bb = 0; bb < nn_block; bb++)
+        {
+            const int q = bb * block_size;
+            const int max_q = std::min(q + block_size, num_output);
+
+            gru_x86_block(weight_hc_packed + q * num_output * 3, gx, bias_bn, hidden_prev, outptr, num_output, q, max_q);
+        }
+    }
+
+    if (T > 0)
+    {
+        memcpy(hidden_state, top_blob.row(reverse ? 0 : T - 1) + num_output * dr, num_output * sizeof(float));
+    }
+}
+
+// gates of one stream from precomputed input and recurrent projections
+// gx     R U N input projections with bias
+// gh     R U N recurrent projections, bias BN included
+// hidden updated in place
+static void gru_x86_gates(const float* gx, const float* gh, float* hidden, int num_output)
+{
+    const float* gx_r = gx;
+    const float* gx_u = gx + num_output;
+    const float* gx_n = gx + num_output * 2;
+    const float* gh_r = gh;
+    const float* gh_u = gh + num_output;
+    const float* gh_n = gh + num_output * 2;
+
+    int q = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    for (; q + 15 < num_output; q += 16)
+    {
+        __m512 _R = sigmoid_avx512(_mm512_add_ps(_mm512_loadu_ps(gx_r + q), _mm512_loadu_ps(gh_r + q)));
+        __m512 _U = sigmoid_avx512(_mm512_add_ps(_mm512_loadu_ps(gx_u + q), _mm512_loadu_ps(gh_u + q)));
+        __m512 _N = tanh_avx512(_mm512_fmadd_ps(_R, _mm512_loadu_ps(gh_n + q), _mm512_loadu_ps(gx_n + q)));
+        __m512 _H = _mm512_fmadd_ps(_U, _mm512_sub_ps(_mm512_loadu_ps(hidden + q), _N), _N);
+        _mm512_storeu_ps(hidden + q, _H);
+    }
+#endif // __AVX512F__
+    for (; q + 7 < num_output; q += 8)
+    {
+        __m256 _R = sigmoid_avx(_mm256_add_ps(_mm256_loadu_ps(gx_r + q), _mm256_loadu_ps(gh_r + q)));
+        __m256 _U = sigmoid_avx(_mm256_add_ps(_mm256_loadu_ps(gx_u + q), _mm256_loadu_ps(gh_u + q)));
+        __m256 _N = tanh_avx(_mm256_comp_fmadd_ps(_R, _mm256_loadu_ps(gh_n + q), _mm256_loadu_ps(gx_n + q)));
+        __m256 _H = _mm256_comp_fmadd_ps(_U, _mm256_sub_ps(_mm256_loadu_ps(hidden + q), _N), _N);
+        _mm256_storeu_ps(hidden + q, _H);
+    }
+#endif // __AVX__
+    for (; q + 3 < num_output; q += 4)
+    {
+        __m128 _R = sigmoid_sse(_mm_add_ps(_mm_loadu_ps(gx_r + q), _mm_loadu_ps(gh_r + q)));
+        __m128 _U = sigmoid_sse(_mm_add_ps(_mm_loadu_ps(gx_u + q), _mm_loadu_ps(gh_u + q)));
+        __m128 _N = tanh_sse(_mm_comp_fmadd_ps(_R, _mm_loadu_ps(gh_n + q), _mm_loadu_ps(gx_n + q)));
+        __m128 _H = _mm_comp_fmadd_ps(_U, _mm_sub_ps(_mm_loadu_ps(hidden + q), _N), _N);
+        _mm_storeu_ps(hidden + q, _H);
+    }
+#endif // __SSE2__
+    for (; q < num_output; q++)
+    {
+        const float R = 1.f / (1.f + expf(-(gx_r[q] + gh_r[q])));
+        const float U = 1.f / (1.f + expf(-(gx_u[q] + gh_u[q])));
+        const float N = tanhf(gx_n[q] + R * gh_n[q]);
+        hidden[q] = N + U * (hidden[q] - N);
+    }
+}
+
+int GRU_x86::forward_hidden(const Mat& bottom_blob, Mat& top_blob, Mat& hidden, const Option& opt) const
+{
+    const int T = bottom_blob.h;
+    const int num_directions = direction == 2 ? 2 : 1;
+
+    top_blob.create(num_output * num_directions, T, 4u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    Option opt_ws = opt;
+    opt_ws.blob_allocator = opt.workspace_allocator;
+
+    // input projections of every timestep in one gemm
+    // gates_x  (num_output * 3 * num_directions, T)
+    Mat gates_x;
+    {
+        std::vector<Mat> bottoms(2);
+        bottoms[0] = bottom_blob;
+        bottoms[1] = bias_xc_data_packed;
+
+        std::vector<Mat> tops(1);
+        int ret = gemm_xc->forward(bottoms, tops, opt_ws);
+        if (ret != 0)
+            return ret;
+
+        gates_x = tops[0];
+    }
+
+    for (int dr = 0; dr < num_directions; dr++)
+    {
+        const int reverse = direction == 2 ? dr : direction;
+        const float* bias_bn = bias_c_data.channel(dr).row(3);
+        float* hidden_state = hidden.row(dr);
+
+#if NCNN_F16C
+        if (weight_hc_data_packed.elemsize == 2u)
+        {
+            gru_fp16s(gates_x, top_blob, dr, reverse, weight_hc_data_packed.row<const unsigned short>(dr), bias_bn, hidden_state, num_output, opt);
+            continue;
+        }
+#endif
+
+        gru_x86(gates_x, top_blob, dr, reverse, weight_hc_data_packed.row(dr), bias_bn, hidden_state, num_output, opt);
+    }
+
+    return 0;
+}
+
+int GRU_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    const int num_directions = direction == 2 ? 2 : 1;
+
+    // initial hidden state
+    Mat hidden(num_output, num_directions, 4u, opt.workspace_allocator);
+    if (hidden.empty())
+        return -100;
+    hidden.fill(0.f);
+
+    return forward_hidden(bottom_blob, top_blob, hidden, opt);
+}
+
+int GRU_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    const Mat& bottom_blob = bottom_blobs[0];
+    const int num_directions = direction == 2 ? 2 : 1;
+
+    Mat hidden;
+    Allocator* hidden_allocator = top_blobs.size() == 2 ? opt.blob_allocator : opt.workspace_allocator;
+    if (bottom_blobs.size() == 2 && !bottom_blobs[1].empty())
+    {
+        hidden = bottom_blobs[1].clone(hidden_allocator);
+    }
+    else
+    {
+        hidden.create(num_output, num_directions, 4u, hidden_allocator);
+        if (hidden.empty())
+            return -100;
+        hidden.fill(0.f);
+    }
+
+    int ret = forward_hidden(bottom_blob, top_blobs[0], hidden, opt);
+    if (ret != 0)
+        return ret;
+
+    if (top_blobs.size() == 2)
+    {
+        top_blobs[1] = hidden;
+    }
+
+    return 0;
+}
+
+int GRU_x86::forward_batch(const std::vector<std::vector<Mat> >& bottom_blobs, std::vector<std::vector<Mat> >& top_blobs, const Option& opt) const
+{
+    const int batch = (int)bottom_blobs.size();
+    const int size = bottom_blobs[0][0].w;
+    const int T = bottom_blobs[0][0].h;
+    const int num_directions = direction == 2 ? 2 : 1;
+    const bool has_hidden = bottom_blobs[0].size() == 2 && !bottom_blobs[0][1].empty();
+
+    // streams of the same length step in lockstep, anything else runs one by one
+    bool lockstep = gemm_hc[0] && batch > 1;
+    for (int b = 0; b < batch && lockstep; b++)
+    {
+        const Mat& bottom_blob = bottom_blobs[b][0];
+        const bool has_hidden_b = bottom_blobs[b].size() == 2 && !bottom_blobs[b][1].empty();
+
+        if (bottom_blob.w != size || bottom_blob.h != T || bottom_blob.dims != 2 || has_hidden_b != has_hidden)
+            lockstep = false;
+    }
+
+    if (!lockstep)
+        return Layer::forward_batch(bottom_blobs, top_blobs, opt);
+
+    Option opt_ws = opt;
+    opt_ws.blob_allocator = opt.workspace_allocator;
+
+    // input projections of every timestep of every stream in one gemm
+    // gates_x  (num_output * 3 * num_directions, T * batch)
+    Mat gates_x;
+    {
+        Mat bottom_blob_all(size, T * batch, 4u, opt.workspace_allocator);
+        if (bottom_blob_all.empty())
+            return -100;
+
+        for (int b = 0; b < batch; b++)
+        {
+            memcpy(bottom_blob_all.row(T * b), bottom_blobs[b][0], size * T * sizeof(float));
+        }
+
+        std::vector<Mat> bottoms(2);
+        bottoms[0] = bottom_blob_all;
+        bottoms[1] = bias_xc_data_packed;
+
+        std::vector<Mat> tops(1);
+        int ret = gemm_xc->forward(bottoms, tops, opt_ws);
+        if (ret != 0)
+            return ret;
+
+        gates_x = tops[0];
+    }
+
+    // one hidden row per stream
+    Mat hidden_all(num_output, batch, num_directions, 4u, opt.workspace_allocator);
+    if (hidden_all.empty())
+        return -100;
+
+    for (int dr = 0; dr < num_directions; dr++)
+    {
+        for (int b = 0; b < batch; b++)
+        {
+            if (has_hidden)
+                memcpy(hidden_all.channel(dr).row(b), bottom_blobs[b][1].row(dr), num_output * sizeof(float));
+            else
+                memset(hidden_all.channel(dr).row(b), 0, num_output * sizeof(float));
+        }
+    }
+
+    for (int b = 0; b < batch; b++)
+    {
+        top_blobs[b][0].create(num_output * num_directions, T, 4u, opt.blob_allocator);
+        if (top_blobs[b][0].empty())
+            return -100;
+    }
+
+    Mat gates_h(num_output * 3, batch, 4u, opt.workspace_allocator);
+    if (gates_h.empty())
+        return -100;
+
+    for (int dr = 0; dr < num_directions; dr++)
+    {
+        const int reverse = direction == 2 ? dr : direction;
+        Mat hidden = hidden_all.channel(dr);
+
+        for (int t = 0; t < T; t++)
+        {
+            const int ti = reverse ? T - 1 - t : t;
+
+            // recurrent projections of all streams with one pass over weight_hc
+            std::vector<Mat> bottoms(2);
+            bottoms[0] = hidden;
+            bottoms[1] = Mat(num_output * 3, (void*)bias_hc_data_packed.row(dr));
+
+            std::vector<Mat> tops(1);
+            tops[0] = gates_h;
+            int ret = gemm_hc[dr]->forward(bottoms, tops, opt_ws);
+            if (ret != 0)
+                return ret;
+
+            const Mat& gates_h_t = tops[0];
+
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int b = 0; b < batch; b++)
+            {
+                float* hidden_ptr = hidden.row(b);
+
+                gru_x86_gates(gates_x.row(T * b + ti) + num_output * 3 * dr, gates_h_t.row(b), hidden_ptr, num_output);
+
+                memcpy(top_blobs[b][0].row(ti) + num_output * dr, hidden_ptr, num_output * sizeof(float));
+            }
+        }
+    }
+
+    for (int b = 0; b < batch; b++)
+    {
+        if (top_blobs[b].size() != 2)
+            continue;
+
+        Mat& hidden_b = top_blobs[b][1];
+        hidden_b.create(num_output, num_directions, 4u, opt.blob_allocator);
+        if (hidden_b.empty())
+            return -100;
+
+        for (int dr = 0; dr < num_directions; dr++)
+        {
+            memcpy(hidden_b.row(dr), hidden_all.channel(dr).row(b), num_output * sizeof(float));
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
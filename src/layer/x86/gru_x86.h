@@ -0,0 +1,55 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef LAYER_GRU_X86_H
+#define LAYER_GRU_X86_H
+
+#include "gru.h"
+
+namespace ncnn {
+
+class GRU_x86 : virtual public GRU
+{
+public:
+    GRU_x86();
+
+    virtual int create_pipeline(const Option& opt);
+    virtual int destroy_pipeline(const Option& opt);
+
+    virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+
+    virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
+
+    virtual int forward_batch(const std::vector<std::vector<Mat> >& bottom_blobs, std::vector<std::vector<Mat> >& top_blobs, const Option& opt) const;
+
+protected:
+    int forward_hidden(const Mat& bottom_blob, Mat& top_blob, Mat& hidden, const Option& opt) const;
+
+public:
+    // input projection of all timesteps and directions
+    Layer* gemm_xc;
+    Mat bias_xc_data_packed;
+
+    // recurrent weights interleaved R U N per output block
+    // stored as fp16 when use_fp16_storage
+    Mat weight_hc_data_packed;
+
+    // recurrent projection of a batch of streams, created in streaming mode
+    Layer* gemm_hc[2];
+    Mat bias_hc_data_packed;
+};
+
+} // namespace ncnn
+
+#endif // LAYER_GRU_X86_H
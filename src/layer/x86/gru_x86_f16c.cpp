@@ -0,0 +1,36 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "gru_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX__
+#include <immintrin.h>
+#endif
+#endif // __SSE2__
+
+#include "x86_activation.h"
+#include "x86_usability.h"
+
+namespace ncnn {
+
+#include "gru_fp16s.h"
+
+void gru_fp16s_f16c(const Mat& gates_x, Mat& top_blob, int dr, int reverse, const unsigned short* weight_hc_packed, const float* bias_bn, float* hidden_state, int num_output, const Option& opt)
+{
+    gru_fp16s(gates_x, top_blob, dr, reverse, weight_hc_packed, bias_bn, hidden_state, num_output, opt);
+}
+
+} // namespace ncnn
@@ -0,0 +1,161 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#if NCNN_RUNTIME_CPU && NCNN_AVX512AMX && __AVX512F__ && !__AMX_INT8__
+int innerproduct_gemm_int8_amx_avx512amx(const Mat& bottom_blob_int8, Mat& top_blob, const Mat& weight_data_tm, const Mat& scale_in_data, const Mat& bias_data, int activation_type, const Mat& activation_params, const Option& opt);
+#endif
+
+static bool innerproduct_int8_support_amx()
+{
+#if __AMX_INT8__
+    return true;
+#elif NCNN_RUNTIME_CPU && NCNN_AVX512AMX && __AVX512F__
+    return ncnn::cpu_support_x86_amx_int8();
+#else
+    return false;
+#endif
+}
+
+static void innerproduct_transform_kernel_int8_amx(const Mat& weight_data, Mat& weight_data_tm, int num_input, int num_output)
+{
+    const int nn_K = (num_input + 63) / 64;
+    const int nn_N = (num_output + 15) / 16;
+
+    // src = inch-outch
+    // dst = 4k-16n-16k-nn_K-outch/16
+    Mat weight_data_r2 = weight_data.reshape(num_input, num_output);
+
+    weight_data_tm.create(1024 * nn_K, nn_N, (size_t)1u);
+
+    memset(weight_data_tm.data, 0, weight_data_tm.total() * weight_data_tm.elemsize);
+
+    for (int p = 0; p < num_output; p++)
+    {
+        const signed char* k0 = weight_data_r2.row<const signed char>(p);
+        signed char* g0 = weight_data_tm.row<signed char>(p / 16) + (p % 16) * 4;
+
+        for (int k = 0; k < num_input; k++)
+        {
+            g0[(k / 64) * 1024 + (k % 64) / 4 * 64 + k % 4] = k0[k];
+        }
+    }
+}
+
+static int innerproduct_gemm_int8_amx(const Mat& bottom_blob_int8, Mat& top_blob, const Mat& weight_data_tm, const Mat& scale_in_data, const Mat& bias_data, int activation_type, const Mat& activation_params, const Option& opt)
+{
+#if NCNN_RUNTIME_CPU && NCNN_AVX512AMX && __AVX512F__ && !__AMX_INT8__
+    if (ncnn::cpu_support_x86_amx_int8())
+    {
+        return innerproduct_gemm_int8_amx_avx512amx(bottom_blob_int8, top_blob, weight_data_tm, scale_in_data, bias_data, activation_type, activation_params, opt);
+    }
+#endif
+
+#if __AMX_INT8__
+    // bottom is either a vector or unpacked rows
+    const int num_input = bottom_blob_int8.w * bottom_blob_int8.elempack;
+    const int h = bottom_blob_int8.dims == 1 ? 1 : bottom_blob_int8.h;
+
+    // a vector top is contiguous whatever its elempack
+    const int num_output = top_blob.dims == 1 ? top_blob.w * top_blob.elempack : top_blob.w;
+    const int out_elempack = top_blob.dims == 1 ? 1 : top_blob.elempack;
+
+    const int nn_M = (h + 15) / 16;
+    const int nn_N = weight_data_tm.h;
+    const int nn_K = (num_input + 63) / 64;
+
+    // rows of 64 k into the blocked A tiles, the single row of a vector pads to a whole tile
+    Mat AT(1024 * nn_K, nn_M, (size_t)1u, opt.workspace_allocator);
+    if (AT.empty())
+        return -100;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int mb = 0; mb < nn_M; mb++)
+    {
+        signed char* pA = AT.row<signed char>(mb);
+
+        memset(pA, 0, 1024 * nn_K);
+
+        const int max_r = std::min(16, h - mb * 16);
+        for (int r = 0; r < max_r; r++)
+        {
+            const signed char* ptr = (const signed char*)bottom_blob_int8.data + (mb * 16 + r) * num_input;
+
+            for (int kb = 0; kb < nn_K; kb++)
+            {
+                memcpy(pA + kb * 1024 + r * 64, ptr + kb * 64, std::min(64, num_input - kb * 64));
+            }
+        }
+    }
+
+    const int ldc = nn_N * 16;
+
+    Mat C(ldc, nn_M * 16, (size_t)4u, opt.workspace_allocator);
+    if (C.empty())
+        return -100;
+
+    amx_gemm_int8(AT, weight_data_tm, C, nn_M, nn_N, nn_K, ldc, opt.num_threads);
+
+    const float* scale_in_ptr = scale_in_data;
+    const float* bias_ptr = bias_data;
+
+    // dequantize, bias and activation on 16 outputs at a time, then scatter into the top layout
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int j = 0; j < h; j++)
+    {
+        const int* cptr = C.row<const int>(j);
+
+        float* outptr = (float*)top_blob + (j / out_elempack) * num_output * out_elempack + j % out_elempack;
+
+        for (int p = 0; p < num_output; p += 16)
+        {
+            const int n = std::min(16, num_output - p);
+            const __mmask16 _mask = (__mmask16)((1u << n) - 1);
+
+            __m512 _scale_in = _mm512_maskz_loadu_ps(_mask, scale_in_ptr + p);
+            __m512 _bias = bias_ptr ? _mm512_maskz_loadu_ps(_mask, bias_ptr + p) : _mm512_setzero_ps();
+
+            __m512 _f = _mm512_fmadd_ps(_mm512_cvtepi32_ps(_mm512_loadu_si512((const __m512i*)(cptr + p))), _scale_in, _bias);
+            _f = activation_avx512(_f, activation_type, activation_params);
+
+            if (out_elempack == 1)
+            {
+                _mm512_mask_storeu_ps(outptr + p, _mask, _f);
+            }
+            else
+            {
+                float sums[16];
+                _mm512_storeu_ps(sums, _f);
+
+                for (int i = 0; i < n; i++)
+                {
+                    outptr[(p + i) * out_elempack] = sums[i];
+                }
+            }
+        }
+    }
+
+    return 0;
+#else // __AMX_INT8__
+    // unreachable, innerproduct_int8_support_amx() guards the caller
+    (void)bottom_blob_int8;
+    (void)top_blob;
+    (void)weight_data_tm;
+    (void)scale_in_data;
+    (void)bias_data;
+    (void)activation_type;
+    (void)activation_params;
+    (void)opt;
+    return -1;
+#endif // __AMX_INT8__
+}
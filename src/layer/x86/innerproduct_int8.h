@@ -0,0 +1,348 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#if !(__AVX512VNNI__ || __AVXVNNI__)
+#if NCNN_RUNTIME_CPU && NCNN_AVX512VNNI && __AVX512F__ && !__AVX512VNNI__
+int innerproduct_gemm_int8_vnni_avx512vnni(const Mat& bottom_blob_int8, Mat& top_blob, const Mat& weight_data_tm, const Mat& scale_in_data, const Mat& bias_data, int activation_type, const Mat& activation_params, const Option& opt);
+#endif
+
+#if NCNN_RUNTIME_CPU && NCNN_AVXVNNI && __AVX__ && !__AVXVNNI__
+int innerproduct_gemm_int8_vnni_avxvnni(const Mat& bottom_blob_int8, Mat& top_blob, const Mat& weight_data_tm, const Mat& scale_in_data, const Mat& bias_data, int activation_type, const Mat& activation_params, const Option& opt);
+#endif
+#endif
+
+// output block width of the vnni kernel available on this cpu, 0 if none
+static int innerproduct_int8_vnni_block()
+{
+#if __AVX512VNNI__
+    return 16;
+#elif __AVXVNNI__
+    return 8;
+#else
+#if NCNN_RUNTIME_CPU && NCNN_AVX512VNNI && __AVX512F__
+    if (ncnn::cpu_support_x86_avx512_vnni())
+        return 16;
+#endif
+
+#if NCNN_RUNTIME_CPU && NCNN_AVXVNNI && __AVX__
+    if (ncnn::cpu_support_x86_avx_vnni())
+        return 8;
+#endif
+
+    return 0;
+#endif
+}
+
+static void innerproduct_transform_kernel_int8_vnni(const Mat& weight_data, Mat& weight_data_tm, int num_input, int num_output, int block)
+{
+    // src = inch-outch
+    // dst = 4b-4a-inch/4a-outch/4b + comp-4b
+    // comp holds 128 * sum(w) so that the u8 shifted input can be corrected after the dot
+    const int num_input4 = (num_input + 3) / 4 * 4;
+    const int nn_block = (num_output + block - 1) / block;
+
+    Mat weight_data_r2 = weight_data.reshape(num_input, num_output);
+
+    weight_data_tm.create(num_input4 * block + block * 4, nn_block, (size_t)1u);
+
+    for (int b = 0; b < nn_block; b++)
+    {
+        signed char* g0 = weight_data_tm.row<signed char>(b);
+        int* comp = (int*)(g0 + num_input4 * block);
+
+        for (int j = 0; j < block; j++)
+        {
+            comp[j] = 0;
+        }
+
+        for (int k = 0; k < num_input4; k += 4)
+        {
+            for (int j = 0; j < block; j++)
+            {
+                const int p = b * block + j;
+
+                for (int i = 0; i < 4; i++)
+                {
+                    signed char w = 0;
+                    if (p < num_output && k + i < num_input)
+                        w = weight_data_r2.row<const signed char>(p)[k + i];
+
+                    g0[0] = w;
+                    comp[j] += w * 128;
+                    g0++;
+                }
+            }
+        }
+    }
+}
+
+static int innerproduct_gemm_int8_vnni(const Mat& bottom_blob_int8, Mat& top_blob, const Mat& weight_data_tm, const Mat& scale_in_data, const Mat& bias_data, int activation_type, const Mat& activation_params, const Option& opt)
+{
+#if !(__AVX512VNNI__ || __AVXVNNI__)
+#if NCNN_RUNTIME_CPU && NCNN_AVX512VNNI && __AVX512F__ && !__AVX512VNNI__
+    if (ncnn::cpu_support_x86_avx512_vnni())
+    {
+        return innerproduct_gemm_int8_vnni_avx512vnni(bottom_blob_int8, top_blob, weight_data_tm, scale_in_data, bias_data, activation_type, activation_params, opt);
+    }
+#endif
+
+#if NCNN_RUNTIME_CPU && NCNN_AVXVNNI && __AVX__ && !__AVXVNNI__
+    if (ncnn::cpu_support_x86_avx_vnni())
+    {
+        return innerproduct_gemm_int8_vnni_avxvnni(bottom_blob_int8, top_blob, weight_data_tm, scale_in_data, bias_data, activation_type, activation_params, opt);
+    }
+#endif
+
+    // unreachable, innerproduct_int8_vnni_block() guards the caller
+    (void)bottom_blob_int8;
+    (void)top_blob;
+    (void)weight_data_tm;
+    (void)scale_in_data;
+    (void)bias_data;
+    (void)activation_type;
+    (void)activation_params;
+    (void)opt;
+    return -1;
+#else // __AVX512VNNI__ || __AVXVNNI__
+#if __AVX512VNNI__
+    const int block = 16;
+#else
+    const int block = 8;
+#endif
+
+    // bottom is either a vector or unpacked rows
+    const int num_input = bottom_blob_int8.w * bottom_blob_int8.elempack;
+    const int h = bottom_blob_int8.dims == 1 ? 1 : bottom_blob_int8.h;
+
+    // a vector top is contiguous whatever its elempack
+    const int num_output = top_blob.dims == 1 ? top_blob.w * top_blob.elempack : top_blob.w;
+    const int out_elempack = top_blob.dims == 1 ? 1 : top_blob.elempack;
+
+    const int num_input4 = (num_input + 3) / 4 * 4;
+    const int nn_block = weight_data_tm.h;
+
+    // shift input to u8 for dpbusd, x + 128 == x ^ 0x80
+    Mat bottom_blob_u8(num_input4, h, (size_t)1u, opt.workspace_allocator);
+    if (bottom_blob_u8.empty())
+        return -100;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int j = 0; j < h; j++)
+    {
+        const signed char* ptr = (const signed char*)bottom_blob_int8.data + j * num_input;
+        unsigned char* outptr = bottom_blob_u8.row<unsigned char>(j);
+
+        for (int k = 0; k < num_input; k++)
+        {
+            outptr[k] = (unsigned char)(ptr[k] ^ 0x80);
+        }
+        for (int k = num_input; k < num_input4; k++)
+        {
+            outptr[k] = 0x80;
+        }
+    }
+
+    const float* scale_in_ptr = scale_in_data;
+    const float* bias_ptr = bias_data;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int b = 0; b < nn_block; b++)
+    {
+        const int p = b * block;
+        const int n = std::min(block, num_output - p);
+
+        const signed char* kptr0 = weight_data_tm.row<const signed char>(b);
+        const int* comp = (const int*)(kptr0 + num_input4 * block);
+
+        // scale and bias of the tail block are zero padded
+        float scale_in_block[16];
+        float bias_block[16];
+        for (int i = 0; i < block; i++)
+        {
+            scale_in_block[i] = i < n ? scale_in_ptr[p + i] : 0.f;
+            bias_block[i] = i < n && bias_ptr ? bias_ptr[p + i] : 0.f;
+        }
+
+        // results of up to four rows
+        float sums[4][16];
+
+#if __AVX512VNNI__
+        __m512i _comp = _mm512_loadu_si512((const __m512i*)comp);
+        __m512 _scale_in = _mm512_loadu_ps(scale_in_block);
+        __m512 _bias = _mm512_loadu_ps(bias_block);
+#else
+        __m256i _comp = _mm256_loadu_si256((const __m256i*)comp);
+        __m256 _scale_in = _mm256_loadu_ps(scale_in_block);
+        __m256 _bias = _mm256_loadu_ps(bias_block);
+#endif
+
+        int j = 0;
+        for (; j < h; j += 4)
+        {
+            const int m = std::min(4, h - j);
+
+            if (m == 4)
+            {
+                const int* r0 = (const int*)bottom_blob_u8.row<const unsigned char>(j);
+                const int* r1 = (const int*)bottom_blob_u8.row<const unsigned char>(j + 1);
+                const int* r2 = (const int*)bottom_blob_u8.row<const unsigned char>(j + 2);
+                const int* r3 = (const int*)bottom_blob_u8.row<const unsigned char>(j + 3);
+
+                const signed char* kptr = kptr0;
+
+#if __AVX512VNNI__
+                __m512i _sum0 = _mm512_setzero_si512();
+                __m512i _sum1 = _mm512_setzero_si512();
+                __m512i _sum2 = _mm512_setzero_si512();
+                __m512i _sum3 = _mm512_setzero_si512();
+
+                for (int k = 0; k < num_input4 / 4; k++)
+                {
+                    __m512i _w = _mm512_loadu_si512((const __m512i*)kptr);
+
+                    _sum0 = _mm512_dpbusd_epi32(_sum0, _mm512_set1_epi32(r0[k]), _w);
+                    _sum1 = _mm512_dpbusd_epi32(_sum1, _mm512_set1_epi32(r1[k]), _w);
+                    _sum2 = _mm512_dpbusd_epi32(_sum2, _mm512_set1_epi32(r2[k]), _w);
+                    _sum3 = _mm512_dpbusd_epi32(_sum3, _mm512_set1_epi32(r3[k]), _w);
+
+                    kptr += 64;
+                }
+
+                // dequantize
+                __m512 _f0 = _mm512_fmadd_ps(_mm512_cvtepi32_ps(_mm512_sub_epi32(_sum0, _comp)), _scale_in, _bias);
+                __m512 _f1 = _mm512_fmadd_ps(_mm512_cvtepi32_ps(_mm512_sub_epi32(_sum1, _comp)), _scale_in, _bias);
+                __m512 _f2 = _mm512_fmadd_ps(_mm512_cvtepi32_ps(_mm512_sub_epi32(_sum2, _comp)), _scale_in, _bias);
+                __m512 _f3 = _mm512_fmadd_ps(_mm512_cvtepi32_ps(_mm512_sub_epi32(_sum3, _comp)), _scale_in, _bias);
+
+                _mm512_storeu_ps(sums[0], activation_avx512(_f0, activation_type, activation_params));
+                _mm512_storeu_ps(sums[1], activation_avx512(_f1, activation_type, activation_params));
+                _mm512_storeu_ps(sums[2], activation_avx512(_f2, activation_type, activation_params));
+                _mm512_storeu_ps(sums[3], activation_avx512(_f3, activation_type, activation_params));
+#else
+                __m256i _sum0 = _mm256_setzero_si256();
+                __m256i _sum1 = _mm256_setzero_si256();
+                __m256i _sum2 = _mm256_setzero_si256();
+                __m256i _sum3 = _mm256_setzero_si256();
+
+                for (int k = 0; k < num_input4 / 4; k++)
+                {
+                    __m256i _w = _mm256_loadu_si256((const __m256i*)kptr);
+
+                    _sum0 = _mm256_dpbusd_epi32(_sum0, _mm256_set1_epi32(r0[k]), _w);
+                    _sum1 = _mm256_dpbusd_epi32(_sum1, _mm256_set1_epi32(r1[k]), _w);
+                    _sum2 = _mm256_dpbusd_epi32(_sum2, _mm256_set1_epi32(r2[k]), _w);
+                    _sum3 = _mm256_dpbusd_epi32(_sum3, _mm256_set1_epi32(r3[k]), _w);
+
+                    kptr += 32;
+                }
+
+                // dequantize
+                __m256 _f0 = _mm256_comp_fmadd_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(_sum0, _comp)), _scale_in, _bias);
+                __m256 _f1 = _mm256_comp_fmadd_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(_sum1, _comp)), _scale_in, _bias);
+                __m256 _f2 = _mm256_comp_fmadd_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(_sum2, _comp)), _scale_in, _bias);
+                __m256 _f3 = _mm256_comp_fmadd_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(_sum3, _comp)), _scale_in, _bias);
+
+                _mm256_storeu_ps(sums[0], activation_avx(_f0, activation_type, activation_params));
+                _mm256_storeu_ps(sums[1], activation_avx(_f1, activation_type, activation_params));
+                _mm256_storeu_ps(sums[2], activation_avx(_f2, activation_type, activation_params));
+                _mm256_storeu_ps(sums[3], activation_avx(_f3, activation_type, activation_params));
+#endif
+            }
+            else
+            {
+                for (int jj = 0; jj < m; jj++)
+                {
+                    const int* r0 = (const int*)bottom_blob_u8.row<const unsigned char>(j + jj);
+
+                    const signed char* kptr = kptr0;
+
+                    // four independent accumulators hide the dpbusd latency
+#if __AVX512VNNI__
+                    __m512i _sum0 = _mm512_setzero_si512();
+                    __m512i _sum1 = _mm512_setzero_si512();
+                    __m512i _sum2 = _mm512_setzero_si512();
+                    __m512i _sum3 = _mm512_setzero_si512();
+
+                    int k = 0;
+                    for (; k + 3 < num_input4 / 4; k += 4)
+                    {
+                        _sum0 = _mm512_dpbusd_epi32(_sum0, _mm512_set1_epi32(r0[k]), _mm512_loadu_si512((const __m512i*)kptr));
+                        _sum1 = _mm512_dpbusd_epi32(_sum1, _mm512_set1_epi32(r0[k + 1]), _mm512_loadu_si512((const __m512i*)(kptr + 64)));
+                        _sum2 = _mm512_dpbusd_epi32(_sum2, _mm512_set1_epi32(r0[k + 2]), _mm512_loadu_si512((const __m512i*)(kptr + 128)));
+                        _sum3 = _mm512_dpbusd_epi32(_sum3, _mm512_set1_epi32(r0[k + 3]), _mm512_loadu_si512((const __m512i*)(kptr + 192)));
+
+                        kptr += 256;
+                    }
+                    for (; k < num_input4 / 4; k++)
+                    {
+                        _sum0 = _mm512_dpbusd_epi32(_sum0, _mm512_set1_epi32(r0[k]), _mm512_loadu_si512((const __m512i*)kptr));
+
+                        kptr += 64;
+                    }
+
+                    _sum0 = _mm512_add_epi32(_mm512_add_epi32(_sum0, _sum1), _mm512_add_epi32(_sum2, _sum3));
+
+                    __m512 _f0 = _mm512_fmadd_ps(_mm512_cvtepi32_ps(_mm512_sub_epi32(_sum0, _comp)), _scale_in, _bias);
+
+                    _mm512_storeu_ps(sums[jj], activation_avx512(_f0, activation_type, activation_params));
+#else
+                    __m256i _sum0 = _mm256_setzero_si256();
+                    __m256i _sum1 = _mm256_setzero_si256();
+                    __m256i _sum2 = _mm256_setzero_si256();
+                    __m256i _sum3 = _mm256_setzero_si256();
+
+                    int k = 0;
+                    for (; k + 3 < num_input4 / 4; k += 4)
+                    {
+                        _sum0 = _mm256_dpbusd_epi32(_sum0, _mm256_set1_epi32(r0[k]), _mm256_loadu_si256((const __m256i*)kptr));
+                        _sum1 = _mm256_dpbusd_epi32(_sum1, _mm256_set1_epi32(r0[k + 1]), _mm256_loadu_si256((const __m256i*)(kptr + 32)));
+                        _sum2 = _mm256_dpbusd_epi32(_sum2, _mm256_set1_epi32(r0[k + 2]), _mm256_loadu_si256((const __m256i*)(kptr + 64)));
+                        _sum3 = _mm256_dpbusd_epi32(_sum3, _mm256_set1_epi32(r0[k + 3]), _mm256_loadu_si256((const __m256i*)(kptr + 96)));
+
+                        kptr += 128;
+                    }
+                    for (; k < num_input4 / 4; k++)
+                    {
+                        _sum0 = _mm256_dpbusd_epi32(_sum0, _mm256_set1_epi32(r0[k]), _mm256_loadu_si256((const __m256i*)kptr));
+
+                        kptr += 32;
+                    }
+
+                    _sum0 = _mm256_add_epi32(_mm256_add_epi32(_sum0, _sum1), _mm256_add_epi32(_sum2, _sum3));
+
+                    __m256 _f0 = _mm256_comp_fmadd_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(_sum0, _comp)), _scale_in, _bias);
+
+                    _mm256_storeu_ps(sums[jj], activation_avx(_f0, activation_type, activation_params));
+#endif
+                }
+            }
+
+            // scatter into the top layout
+            float* outptr = top_blob;
+            for (int jj = 0; jj < m; jj++)
+            {
+                const int y = j + jj;
+                float* outptr0 = outptr + (y / out_elempack) * num_output * out_elempack + p * out_elempack + y % out_elempack;
+
+                for (int i = 0; i < n; i++)
+                {
+                    outptr0[i * out_elempack] = sums[jj][i];
+                }
+            }
+        }
+    }
+
+    return 0;
+#endif // __AVX512VNNI__ || __AVXVNNI__
+}
@@ -22,6 +22,7 @@
 #endif // __SSE2__
 
 #include "x86_activation.h"
+#include "x86_amx.h"
 #include "x86_usability.h"
 
 #include "layer_type.h"
@@ -35,6 +36,11 @@ namespace ncnn {
 #include "innerproduct_gemm_fp16s.h"
 #endif
 
+#if NCNN_INT8
+#include "innerproduct_int8.h"
+#include "innerproduct_gemm_int8_amx.h"
+#endif
+
 InnerProduct_x86::InnerProduct_x86()
 {
 #if __SSE2__
@@ -42,6 +48,7 @@ InnerProduct_x86::InnerProduct_x86()
 #endif // __SSE2__
 
     flatten = 0;
+    gemm = 0;
 }
 
 int InnerProduct_x86::create_pipeline(const Option& opt)
@@ -64,6 +71,13 @@ int InnerProduct_x86::create_pipeline(const Option& opt)
     }
 #endif
 
+#if NCNN_BF16 && NCNN_AVX512BF16 && __AVX512F__
+    if (cpu_support_x86_avx512_bf16() && opt.use_bf16_storage)
+    {
+        return create_pipeline_bf16s(opt);
+    }
+#endif
+
 #if NCNN_F16C
     if (cpu_support_x86_f16c() && opt.use_fp16_storage)
     {
@@ -133,6 +147,67 @@ int InnerProduct_x86::destroy_pipeline(const Option& opt)
         flatten = 0;
     }
 
+    if (gemm)
+    {
+        gemm->destroy_pipeline(opt);
+        delete gemm;
+        gemm = 0;
+    }
+
+    return 0;
+}
+
+int InnerProduct_x86::save_pipeline(std::vector<Mat>& pipeline_data) const
+{
+    // the bf16 path keeps its weights in a sub layer
+    if (gemm)
+        return -1;
+
+    pipeline_data.resize(2);
+    pipeline_data[0] = weight_data_tm;
+#if NCNN_INT8
+    pipeline_data[1] = scale_in_data;
+#endif
+
+    return 0;
+}
+
+int InnerProduct_x86::load_pipeline(const std::vector<Mat>& pipeline_data, const Option& opt)
+{
+    if (pipeline_data.size() != 2)
+        return -1;
+
+#if NCNN_INT8
+    // runtime quantization derives the weight scales in create_pipeline
+    if (opt.use_int8_inference && int8_scale_term && weight_data.elemsize != (size_t)1u)
+        return -1;
+#endif
+
+#if NCNN_BF16 && NCNN_AVX512BF16 && __AVX512F__
+    if (cpu_support_x86_avx512_bf16() && opt.use_bf16_storage && !(opt.use_int8_inference && int8_scale_term))
+        return -1;
+#endif
+
+    {
+        flatten = ncnn::create_layer(ncnn::LayerType::Flatten);
+
+        ncnn::ParamDict pd;
+
+        flatten->load_param(pd);
+
+        flatten->create_pipeline(opt);
+    }
+
+    weight_data_tm = pipeline_data[0];
+#if NCNN_INT8
+    scale_in_data = pipeline_data[1];
+#endif
+
+    if (opt.lightmode)
+    {
+        weight_data.release();
+    }
+
     return 0;
 }
 
@@ -145,6 +220,13 @@ int InnerProduct_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Optio
     }
 #endif
 
+#if NCNN_BF16
+    if (gemm)
+    {
+        return forward_bf16s(bottom_blob, top_blob, opt);
+    }
+#endif
+
 #if NCNN_F16C
     if (cpu_support_x86_f16c() && opt.use_fp16_storage)
     {
@@ -2004,6 +2086,133 @@ int InnerProduct_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Optio
     return 0;
 }
 
+int InnerProduct_x86::forward_batch(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    const int batch = (int)bottom_blobs.size();
+    const int num_input = weight_data_size / num_output;
+
+    if (batch < 2)
+        return Layer::forward_batch(bottom_blobs, top_blobs, opt);
+
+    Option opt_ws = opt;
+    opt_ws.blob_allocator = opt.workspace_allocator;
+
+    // flatten and unpack every sample
+    std::vector<Mat> bottom_blobs_flattened(batch);
+    for (int b = 0; b < batch; b++)
+    {
+        const Mat& bottom_blob = bottom_blobs[b];
+
+        Mat bottom_blob_flattened = bottom_blob;
+        if (bottom_blob.dims != 1)
+        {
+            int ret = flatten->forward(bottom_blob, bottom_blob_flattened, opt_ws);
+            if (ret != 0)
+                return ret;
+        }
+
+        if (bottom_blob_flattened.elempack != 1)
+        {
+            Mat bottom_blob_unpacked;
+            convert_packing(bottom_blob_flattened, bottom_blob_unpacked, 1, opt_ws);
+            bottom_blob_flattened = bottom_blob_unpacked;
+        }
+
+        if (bottom_blob_flattened.w != num_input || (b != 0 && bottom_blob_flattened.elemsize != bottom_blobs_flattened[0].elemsize))
+            return Layer::forward_batch(bottom_blobs, top_blobs, opt);
+
+        bottom_blobs_flattened[b] = bottom_blob_flattened;
+    }
+
+    // stack samples as rows so that the gemm path streams the weights once for the whole batch
+    const size_t elemsize = bottom_blobs_flattened[0].elemsize;
+
+    Mat bottom_blob_stacked(num_input, batch, elemsize, opt.workspace_allocator);
+    if (bottom_blob_stacked.empty())
+        return -100;
+
+    for (int b = 0; b < batch; b++)
+    {
+        memcpy(bottom_blob_stacked.row<unsigned char>(b), bottom_blobs_flattened[b].data, num_input * elemsize);
+    }
+
+    Mat bottom_blob_stacked_packed = bottom_blob_stacked;
+    if (opt.use_packing_layout && elemsize == 4u)
+    {
+        int elempack = 1;
+#if __SSE2__
+#if __AVX512F__
+        elempack = batch % 16 == 0 ? 16 : batch % 8 == 0 ? 8 : batch % 4 == 0 ? 4 : 1;
+#elif __AVX__
+        elempack = batch % 8 == 0 ? 8 : batch % 4 == 0 ? 4 : 1;
+#else
+        elempack = batch % 4 == 0 ? 4 : 1;
+#endif
+#endif // __SSE2__
+
+        if (elempack != 1)
+            convert_packing(bottom_blob_stacked, bottom_blob_stacked_packed, elempack, opt_ws);
+    }
+
+    Mat top_blob_stacked;
+    int ret = forward(bottom_blob_stacked_packed, top_blob_stacked, opt_ws);
+    if (ret != 0)
+        return ret;
+
+    Mat top_blob_stacked_unpacked = top_blob_stacked;
+    if (top_blob_stacked.elempack != 1)
+    {
+        convert_packing(top_blob_stacked, top_blob_stacked_unpacked, 1, opt_ws);
+        if (top_blob_stacked_unpacked.empty())
+            return -100;
+    }
+
+    const size_t out_elemsize = top_blob_stacked_unpacked.elemsize;
+
+    top_blobs.resize(batch);
+    for (int b = 0; b < batch; b++)
+    {
+        Mat& top_blob = top_blobs[b];
+        top_blob.create(num_output, out_elemsize, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        memcpy(top_blob.data, top_blob_stacked_unpacked.row<const unsigned char>(b), num_output * out_elemsize);
+    }
+
+    return 0;
+}
+
+const char* InnerProduct_x86::kernel_path(const Mat& bottom_blob, const Option& opt) const
+{
+#if NCNN_INT8
+    if (opt.use_int8_inference && int8_scale_term)
+    {
+        if (innerproduct_int8_support_amx())
+            return "int8_amx";
+
+        return innerproduct_int8_vnni_block() ? "int8_vnni" : "int8";
+    }
+#endif
+
+    const int num_input = weight_data_size / num_output;
+    const bool gemm = bottom_blob.dims == 2 && bottom_blob.w == num_input && bottom_blob.h * bottom_blob.elempack > 1;
+
+#if NCNN_BF16
+    if (this->gemm)
+        return gemm ? "gemm_bf16s" : "gemv_bf16s";
+#endif
+
+#if NCNN_F16C
+    if (cpu_support_x86_f16c() && opt.use_fp16_storage)
+        return gemm ? "gemm_fp16s" : "gemv_fp16s";
+#else
+    (void)opt;
+#endif
+
+    return gemm ? "gemm" : "gemv";
+}
+
 #if NCNN_F16C
 int InnerProduct_x86::create_pipeline_fp16s(const Option& opt)
 {
@@ -2093,11 +2302,143 @@ int InnerProduct_x86::forward_fp16s(const Mat& bottom_blob, Mat& top_blob, const
 }
 #endif // NCNN_F16C
 
+#if NCNN_BF16
+int InnerProduct_x86::create_pipeline_bf16s(const Option& opt)
+{
+    const int num_input = weight_data_size / num_output;
+
+    // top = bottom * weight^T + bias, weight is num_output rows of num_input
+    gemm = ncnn::create_layer(ncnn::LayerType::Gemm);
+
+    ncnn::ParamDict pd;
+    pd.set(0, 1.f);        // alpha
+    pd.set(1, 1.f);        // beta
+    pd.set(2, 0);          // transA
+    pd.set(3, 1);          // transB
+    pd.set(5, 1);          // constantB
+    pd.set(8, num_output); // constantN
+    pd.set(9, num_input);  // constantK
+
+    gemm->load_param(pd);
+
+    Mat weights[1];
+    weights[0] = weight_data.reshape(num_input, num_output);
+
+    gemm->load_model(ModelBinFromMatArray(weights));
+
+    gemm->create_pipeline(opt);
+
+    if (opt.lightmode)
+    {
+        weight_data.release();
+    }
+
+    return 0;
+}
+
+int InnerProduct_x86::forward_bf16s(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    const int num_input = weight_data_size / num_output;
+
+    Option opt_ws = opt;
+    opt_ws.blob_allocator = opt.workspace_allocator;
+
+    const bool is_gemm = bottom_blob.dims == 2 && bottom_blob.w == num_input && bottom_blob.h * bottom_blob.elempack > 1;
+
+    // one row per sample
+    Mat bottom_blob_flattened = bottom_blob;
+    Mat bottom_blob_rows;
+    if (is_gemm)
+    {
+        convert_packing(bottom_blob, bottom_blob_rows, 1, opt_ws);
+        if (bottom_blob_rows.empty())
+            return -100;
+    }
+    else
+    {
+        if (bottom_blob.dims != 1)
+        {
+            int ret = flatten->forward(bottom_blob, bottom_blob_flattened, opt_ws);
+            if (ret != 0)
+                return ret;
+        }
+
+        // packed vectors are contiguous already
+        bottom_blob_rows = Mat(num_input, 1, bottom_blob_flattened.data, 4u);
+    }
+
+    std::vector<Mat> gemm_bottom_blobs(bias_term ? 2 : 1);
+    gemm_bottom_blobs[0] = bottom_blob_rows;
+    if (bias_term)
+        gemm_bottom_blobs[1] = bias_data;
+
+    std::vector<Mat> gemm_top_blobs(1);
+    int ret = gemm->forward(gemm_bottom_blobs, gemm_top_blobs, opt_ws);
+    if (ret != 0)
+        return ret;
+
+    Mat& top_blob_rows = gemm_top_blobs[0];
+
+    if (activation_type)
+    {
+        const int size = top_blob_rows.w * top_blob_rows.h;
+
+        float* ptr = top_blob_rows;
+
+        int i = 0;
+#if __AVX512F__
+        for (; i + 15 < size; i += 16)
+        {
+            _mm512_storeu_ps(ptr + i, activation_avx512(_mm512_loadu_ps(ptr + i), activation_type, activation_params));
+        }
+#endif // __AVX512F__
+        for (; i < size; i++)
+        {
+            ptr[i] = activation_ss(ptr[i], activation_type, activation_params);
+        }
+    }
+
+    if (is_gemm)
+    {
+        // keep the packing of the bottom rows
+        convert_packing(top_blob_rows, top_blob, bottom_blob.elempack, opt);
+        if (top_blob.empty())
+            return -100;
+
+        return 0;
+    }
+
+    int out_elempack = 1;
+#if __SSE2__
+    if (opt.use_packing_layout)
+    {
+#if __AVX512F__
+        out_elempack = num_output % 16 == 0 ? 16 : num_output % 8 == 0 ? 8 : num_output % 4 == 0 ? 4 : 1;
+#elif __AVX__
+        out_elempack = num_output % 8 == 0 ? 8 : num_output % 4 == 0 ? 4 : 1;
+#else
+        out_elempack = num_output % 4 == 0 ? 4 : 1;
+#endif
+    }
+#endif // __SSE2__
+
+    top_blob.create(num_output / out_elempack, (size_t)4u * out_elempack, out_elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    memcpy(top_blob.data, top_blob_rows.data, num_output * sizeof(float));
+
+    return 0;
+}
+#endif // NCNN_BF16
+
 #if NCNN_INT8
 int InnerProduct_x86::create_pipeline_int8_x86(const Option& opt)
 {
     const int num_input = weight_data_size / num_output;
 
+    const int vnni_block = innerproduct_int8_vnni_block();
+
     int out_elempack = 1;
 #if __SSE2__
     if (opt.use_packing_layout)
@@ -2106,9 +2447,18 @@ int InnerProduct_x86::create_pipeline_int8_x86(const Option& opt)
     }
 #endif // __SSE2__
 
-    // src = inch-outch
-    // dst = pb-inch-outch/pb
+    if (innerproduct_int8_support_amx())
     {
+        innerproduct_transform_kernel_int8_amx(weight_data, weight_data_tm, num_input, num_output);
+    }
+    else if (vnni_block)
+    {
+        innerproduct_transform_kernel_int8_vnni(weight_data, weight_data_tm, num_input, num_output, vnni_block);
+    }
+    else
+    {
+        // src = inch-outch
+        // dst = pb-inch-outch/pb
         Mat weight_data_r2 = weight_data.reshape(num_input, num_output);
 
         weight_data_tm.create(num_input, num_output / out_elempack, (size_t)out_elempack, out_elempack);
@@ -2186,6 +2536,16 @@ int InnerProduct_x86::forward_int8_x86(const Mat& bottom_blob, Mat& top_blob, co
         if (top_blob.empty())
             return -100;
 
+        if (innerproduct_int8_support_amx())
+        {
+            return innerproduct_gemm_int8_amx(bottom_blob_int8_unpacked, top_blob, weight_data_tm, scale_in_data, bias_data, activation_type, activation_params, opt);
+        }
+
+        if (innerproduct_int8_vnni_block())
+        {
+            return innerproduct_gemm_int8_vnni(bottom_blob_int8_unpacked, top_blob, weight_data_tm, scale_in_data, bias_data, activation_type, activation_params, opt);
+        }
+
         int num_output_elempack = 1;
 #if __SSE2__
         if (opt.use_packing_layout)
@@ -2506,6 +2866,16 @@ int InnerProduct_x86::forward_int8_x86(const Mat& bottom_blob, Mat& top_blob, co
     if (top_blob.empty())
         return -100;
 
+    if (innerproduct_int8_support_amx())
+    {
+        return innerproduct_gemm_int8_amx(bottom_blob_int8_flattened, top_blob, weight_data_tm, scale_in_data, bias_data, activation_type, activation_params, opt);
+    }
+
+    if (innerproduct_int8_vnni_block())
+    {
+        return innerproduct_gemm_int8_vnni(bottom_blob_int8_flattened, top_blob, weight_data_tm, scale_in_data, bias_data, activation_type, activation_params, opt);
+    }
+
 #if __SSE2__
     if (out_elempack == 8)
     {
@@ -27,13 +27,24 @@ public:
     virtual int create_pipeline(const Option& opt);
     virtual int destroy_pipeline(const Option& opt);
 
+    virtual int save_pipeline(std::vector<Mat>& pipeline_data) const;
+    virtual int load_pipeline(const std::vector<Mat>& pipeline_data, const Option& opt);
+
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
 
+    virtual int forward_batch(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
+
+    virtual const char* kernel_path(const Mat& bottom_blob, const Option& opt) const;
+
 protected:
 #if NCNN_F16C
     int create_pipeline_fp16s(const Option& opt);
     int forward_fp16s(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
 #endif
+#if NCNN_BF16
+    int create_pipeline_bf16s(const Option& opt);
+    int forward_bf16s(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+#endif
 #if NCNN_INT8
     int create_pipeline_int8_x86(const Option& opt);
     int forward_int8_x86(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
@@ -42,6 +53,9 @@ protected:
 public:
     Layer* flatten;
 
+    // bf16 dot product path keeps the weights packed in a gemm
+    Layer* gemm;
+
     Mat weight_data_tm;
 
 #if NCNN_INT8
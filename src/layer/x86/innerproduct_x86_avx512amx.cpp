@@ -0,0 +1,33 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "cpu.h"
+#include "layer.h"
+#include "mat.h"
+#include "x86_activation.h"
+#include "x86_amx.h"
+#include "x86_usability.h"
+
+#include <algorithm>
+
+namespace ncnn {
+
+#include "innerproduct_gemm_int8_amx.h"
+
+int innerproduct_gemm_int8_amx_avx512amx(const Mat& bottom_blob_int8, Mat& top_blob, const Mat& weight_data_tm, const Mat& scale_in_data, const Mat& bias_data, int activation_type, const Mat& activation_params, const Option& opt)
+{
+    return innerproduct_gemm_int8_amx(bottom_blob_int8, top_blob, weight_data_tm, scale_in_data, bias_data, activation_type, activation_params, opt);
+}
+
+} // namespace ncnn
@@ -0,0 +1,74 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "instancenorm_x86.h"
+
+#include "x86_norm.h"
+
+#include <math.h>
+
+namespace ncnn {
+
+InstanceNorm_x86::InstanceNorm_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+int InstanceNorm_x86::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
+{
+    // x = (x - mean) / (sqrt(var + eps)) * gamma + beta
+
+    const int w = bottom_top_blob.w;
+    const int h = bottom_top_blob.h;
+    const int c = bottom_top_blob.c;
+    const int elempack = bottom_top_blob.elempack;
+    const int size = w * h;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < c; q++)
+    {
+        float* ptr = bottom_top_blob.channel(q);
+
+        float mean[16];
+        float m2[16];
+        norm_channel_stats(ptr, elempack, size, mean, m2);
+
+        // fold the normalization and the affine into one multiply-add per lane
+        float a[16];
+        float b[16];
+        for (int k = 0; k < elempack; k++)
+        {
+            const float var = m2[k] / size;
+
+            if (affine)
+            {
+                a[k] = static_cast<float>(gamma_data[q * elempack + k] / sqrt(var + eps));
+                b[k] = -mean[k] * a[k] + beta_data[q * elempack + k];
+            }
+            else
+            {
+                a[k] = static_cast<float>(1.f / sqrt(var + eps));
+                b[k] = -mean[k] * a[k];
+            }
+        }
+
+        norm_apply(ptr, ptr, elempack, size, a, b);
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
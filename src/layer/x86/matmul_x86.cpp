@@ -0,0 +1,295 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "matmul_x86.h"
+
+#include "layer_type.h"
+
+namespace ncnn {
+
+MatMul_x86::MatMul_x86()
+{
+#if NCNN_BF16
+    support_bf16_storage = true;
+#endif
+
+    gemm = 0;
+}
+
+int MatMul_x86::create_pipeline(const Option& opt)
+{
+    gemm = ncnn::create_layer(ncnn::LayerType::Gemm);
+
+    ncnn::ParamDict pd;
+    pd.set(0, 1.f);    // alpha
+    pd.set(1, 1.f);    // beta
+    pd.set(2, 0);      // transA
+    pd.set(3, transB); // transB
+
+    gemm->load_param(pd);
+
+    gemm->load_model(ModelBinFromMatArray(0));
+
+    gemm->create_pipeline(opt);
+
+    return 0;
+}
+
+int MatMul_x86::destroy_pipeline(const Option& opt)
+{
+    if (gemm)
+    {
+        gemm->destroy_pipeline(opt);
+        delete gemm;
+        gemm = 0;
+    }
+
+    return 0;
+}
+
+static int matmul_gemm_batch(const Layer* gemm, const std::vector<Mat>& As, const std::vector<Mat>& Bs, const std::vector<Mat>& tops, const Option& opt)
+{
+    const int batch_size = (int)As.size();
+
+    // the top slices are preallocated, gemm writes into them in place
+    if (opt.num_threads > 1 && batch_size >= opt.num_threads)
+    {
+        // one single-threaded gemm per batch item
+        // the workspace goes to the default allocator which is always thread-safe
+        Option opt1 = opt;
+        opt1.num_threads = 1;
+        opt1.workspace_allocator = 0;
+
+        std::vector<int> rets(batch_size);
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int p = 0; p < batch_size; p++)
+        {
+            std::vector<Mat> bottom_blobs(2);
+            bottom_blobs[0] = As[p];
+            bottom_blobs[1] = Bs[p];
+
+            std::vector<Mat> top_blobs(1);
+            top_blobs[0] = tops[p];
+
+            rets[p] = gemm->forward(bottom_blobs, top_blobs, opt1);
+        }
+
+        for (int p = 0; p < batch_size; p++)
+        {
+            if (rets[p] != 0)
+                return rets[p];
+        }
+
+        return 0;
+    }
+
+    for (int p = 0; p < batch_size; p++)
+    {
+        std::vector<Mat> bottom_blobs(2);
+        bottom_blobs[0] = As[p];
+        bottom_blobs[1] = Bs[p];
+
+        std::vector<Mat> top_blobs(1);
+        top_blobs[0] = tops[p];
+
+        int ret = gemm->forward(bottom_blobs, top_blobs, opt);
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+int MatMul_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    const Mat& A = bottom_blobs[0];
+    const Mat& B = bottom_blobs[1];
+    Mat& top_blob = top_blobs[0];
+
+    const int Adims = A.dims;
+    const int Bdims = B.dims;
+    const int max_ABdims = std::max(Adims, Bdims);
+    const size_t elemsize = A.elemsize;
+
+    // vector A is a single row, vector B is a single column
+    const Mat A1 = Adims == 1 ? A.reshape(A.w, 1) : A;
+    const Mat B1 = Bdims == 1 ? (transB ? B.reshape(B.w, 1) : B.reshape(1, B.w)) : B;
+
+    const int M = A1.h;
+    const int N = transB ? B1.h : B1.w;
+
+    std::vector<Mat> As;
+    std::vector<Mat> Bs;
+    std::vector<Mat> tops;
+
+    if (max_ABdims <= 2)
+    {
+        top_blob.create(N, M, elemsize, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        As.push_back(A1);
+        Bs.push_back(B1);
+        tops.push_back(top_blob);
+
+        int ret = matmul_gemm_batch(gemm, As, Bs, tops, opt);
+        if (ret != 0)
+            return ret;
+
+        if (Adims == 1 && Bdims == 1)
+            top_blob = top_blob.reshape(1);
+        else if (Adims == 1)
+            top_blob = top_blob.reshape(N);
+        else if (Bdims == 1)
+            top_blob = top_blob.reshape(M);
+
+        return 0;
+    }
+
+    if (Adims == 1)
+    {
+        // batched vector-matrix multiply
+        if (Bdims == 3)
+            top_blob.create(N, B.c, elemsize, opt.blob_allocator);
+        else
+            top_blob.create(N, B.d, B.c, elemsize, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        for (int p = 0; p < B.c; p++)
+        {
+            if (Bdims == 3)
+            {
+                As.push_back(A1);
+                Bs.push_back(B.channel(p));
+                tops.push_back(Mat(N, 1, top_blob.row(p), elemsize, opt.blob_allocator));
+                continue;
+            }
+
+            for (int q = 0; q < B.d; q++)
+            {
+                As.push_back(A1);
+                Bs.push_back(B.channel(p).depth(q));
+                tops.push_back(Mat(N, 1, top_blob.channel(p).row(q), elemsize, opt.blob_allocator));
+            }
+        }
+
+        return matmul_gemm_batch(gemm, As, Bs, tops, opt);
+    }
+
+    if (Bdims == 1)
+    {
+        // batched matrix-vector multiply
+        if (Adims == 3)
+            top_blob.create(M, A.c, elemsize, opt.blob_allocator);
+        else
+            top_blob.create(M, A.d, A.c, elemsize, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        for (int p = 0; p < A.c; p++)
+        {
+            if (Adims == 3)
+            {
+                As.push_back(A.channel(p));
+                Bs.push_back(B1);
+                tops.push_back(Mat(1, M, top_blob.row(p), elemsize, opt.blob_allocator));
+                continue;
+            }
+
+            for (int q = 0; q < A.d; q++)
+            {
+                As.push_back(A.channel(p).depth(q));
+                Bs.push_back(B1);
+                tops.push_back(Mat(1, M, top_blob.channel(p).row(q), elemsize, opt.blob_allocator));
+            }
+        }
+
+        return matmul_gemm_batch(gemm, As, Bs, tops, opt);
+    }
+
+    if (max_ABdims == 3)
+    {
+        const int Ac = Adims == 2 ? 1 : A.c;
+        const int Bc = Bdims == 2 ? 1 : B.c;
+        const int batch_size = std::max(Ac, Bc);
+
+        top_blob.create(N, M, batch_size, elemsize, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        for (int p = 0; p < batch_size; p++)
+        {
+            const int Ap = Ac == 1 ? 0 : p;
+            const int Bp = Bc == 1 ? 0 : p;
+
+            As.push_back(Adims == 2 ? A : A.channel(Ap));
+            Bs.push_back(Bdims == 2 ? B : B.channel(Bp));
+            tops.push_back(top_blob.channel(p));
+        }
+
+        return matmul_gemm_batch(gemm, As, Bs, tops, opt);
+    }
+
+    if (max_ABdims == 4)
+    {
+        // 3-dim operands broadcast their channels along d
+        const int Ad = Adims == 4 ? A.d : Adims == 3 ? A.c : 1;
+        const int Ac = Adims == 4 ? A.c : 1;
+        const int Bd = Bdims == 4 ? B.d : Bdims == 3 ? B.c : 1;
+        const int Bc = Bdims == 4 ? B.c : 1;
+        const int batch_size_d = std::max(Ad, Bd);
+        const int batch_size_c = std::max(Ac, Bc);
+
+        top_blob.create(N, M, batch_size_d, batch_size_c, elemsize, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        for (int p = 0; p < batch_size_c; p++)
+        {
+            const int Ap = Ac == 1 ? 0 : p;
+            const int Bp = Bc == 1 ? 0 : p;
+
+            for (int q = 0; q < batch_size_d; q++)
+            {
+                const int Aq = Ad == 1 ? 0 : q;
+                const int Bq = Bd == 1 ? 0 : q;
+
+                if (Adims == 4)
+                    As.push_back(A.channel(Ap).depth(Aq));
+                else if (Adims == 3)
+                    As.push_back(A.channel(Aq));
+                else
+                    As.push_back(A);
+
+                if (Bdims == 4)
+                    Bs.push_back(B.channel(Bp).depth(Bq));
+                else if (Bdims == 3)
+                    Bs.push_back(B.channel(Bq));
+                else
+                    Bs.push_back(B);
+
+                tops.push_back(top_blob.channel(p).depth(q));
+            }
+        }
+
+        return matmul_gemm_batch(gemm, As, Bs, tops, opt);
+    }
+
+    NCNN_LOGE("impossible matmul %d %d", Adims, Bdims);
+    return -1;
+}
+
+} // namespace ncnn
@@ -0,0 +1,839 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "multiheadattention_x86.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#if __SSE2__
+#include <emmintrin.h>
+#include "sse_mathfun.h"
+#if __AVX__
+#include <immintrin.h>
+#include "avx_mathfun.h"
+#if __AVX512F__
+#include "avx512_mathfun.h"
+#endif // __AVX512F__
+#endif // __AVX__
+#endif // __SSE2__
+
+#include "x86_usability.h"
+
+#include "cpu.h"
+#include "layer_type.h"
+
+namespace ncnn {
+
+MultiHeadAttention_x86::MultiHeadAttention_x86()
+{
+    q_gemm = 0;
+    k_gemm = 0;
+    v_gemm = 0;
+    o_gemm = 0;
+}
+
+static Layer* create_projection_gemm(const Mat& weight_data, int embed_dim, int qdim, float alpha, const Option& opt)
+{
+    // out = (x * weight^T + bias) * alpha, with weight packed once here
+    Layer* gemm = ncnn::create_layer(ncnn::LayerType::Gemm);
+
+    ncnn::ParamDict pd;
+    pd.set(0, alpha);     // alpha
+    pd.set(1, 1.f);       // beta
+    pd.set(2, 0);         // transA
+    pd.set(3, 1);         // transB
+    pd.set(5, 1);         // constantB
+    pd.set(8, embed_dim); // constantN
+    pd.set(9, qdim);      // constantK
+
+    gemm->load_param(pd);
+
+    Mat weights[1];
+    weights[0] = weight_data;
+
+    gemm->load_model(ModelBinFromMatArray(weights));
+
+    // keep the projections in fp32, the attention logits are sensitive to bf16 rounding
+    Option opt1 = opt;
+    opt1.use_bf16_storage = false;
+
+    gemm->create_pipeline(opt1);
+
+    return gemm;
+}
+
+int MultiHeadAttention_x86::create_pipeline(const Option& opt)
+{
+    const int qdim = weight_data_size / embed_dim;
+    const int embed_dim_per_head = embed_dim / num_head;
+    const float inv_sqrt_embed_dim_per_head = 1.f / sqrt(embed_dim_per_head);
+
+    q_gemm = create_projection_gemm(q_weight_data, embed_dim, qdim, inv_sqrt_embed_dim_per_head, opt);
+    k_gemm = create_projection_gemm(k_weight_data, embed_dim, qdim, 1.f, opt);
+    v_gemm = create_projection_gemm(v_weight_data, embed_dim, qdim, 1.f, opt);
+    o_gemm = create_projection_gemm(out_weight_data, embed_dim, embed_dim, 1.f, opt);
+
+    if (opt.lightmode)
+    {
+        q_weight_data.release();
+        k_weight_data.release();
+        v_weight_data.release();
+        out_weight_data.release();
+    }
+
+    return 0;
+}
+
+int MultiHeadAttention_x86::destroy_pipeline(const Option& opt)
+{
+    Layer** gemms[4] = {&q_gemm, &k_gemm, &v_gemm, &o_gemm};
+
+    for (int i = 0; i < 4; i++)
+    {
+        Layer*& gemm = *gemms[i];
+        if (gemm)
+        {
+            gemm->destroy_pipeline(opt);
+            delete gemm;
+            gemm = 0;
+        }
+    }
+
+    return 0;
+}
+
+// KT = K^T
+// K  max_jj rows of d with row stride k_stride
+// KT d rows of max_jj
+static void attention_transpose_k_tile(const float* K, int k_stride, float* KT, int max_jj, int d)
+{
+    int jj = 0;
+#if __SSE2__
+    for (; jj + 3 < max_jj; jj += 4)
+    {
+        const float* k0 = K + jj * k_stride;
+        const float* k1 = k0 + k_stride;
+        const float* k2 = k1 + k_stride;
+        const float* k3 = k2 + k_stride;
+
+        int kk = 0;
+        for (; kk + 3 < d; kk += 4)
+        {
+            __m128 _r0 = _mm_loadu_ps(k0 + kk);
+            __m128 _r1 = _mm_loadu_ps(k1 + kk);
+            __m128 _r2 = _mm_loadu_ps(k2 + kk);
+            __m128 _r3 = _mm_loadu_ps(k3 + kk);
+            _MM_TRANSPOSE4_PS(_r0, _r1, _r2, _r3);
+            _mm_storeu_ps(KT + kk * max_jj + jj, _r0);
+            _mm_storeu_ps(KT + (kk + 1) * max_jj + jj, _r1);
+            _mm_storeu_ps(KT + (kk + 2) * max_jj + jj, _r2);
+            _mm_storeu_ps(KT + (kk + 3) * max_jj + jj, _r3);
+        }
+        for (; kk < d; kk++)
+        {
+            float* outptr = KT + kk * max_jj + jj;
+            outptr[0] = k0[kk];
+            outptr[1] = k1[kk];
+            outptr[2] = k2[kk];
+            outptr[3] = k3[kk];
+        }
+    }
+#endif // __SSE2__
+    for (; jj < max_jj; jj++)
+    {
+        const float* k0 = K + jj * k_stride;
+
+        for (int kk = 0; kk < d; kk++)
+        {
+            KT[kk * max_jj + jj] = k0[kk];
+        }
+    }
+}
+
+// S = Q * KT
+// Q  max_ii rows of d with row stride q_stride
+// KT d rows of max_jj with row stride kT_stride
+// S  max_ii rows of max_jj
+static void attention_qk_tile(const float* Q, int q_stride, const float* KT, int kT_stride, float* S, int max_ii, int max_jj, int d)
+{
+    int ii = 0;
+    for (; ii + 3 < max_ii; ii += 4)
+    {
+        const float* q0 = Q + ii * q_stride;
+        const float* q1 = q0 + q_stride;
+        const float* q2 = q1 + q_stride;
+        const float* q3 = q2 + q_stride;
+
+        float* s0 = S + ii * max_jj;
+        float* s1 = s0 + max_jj;
+        float* s2 = s1 + max_jj;
+        float* s3 = s2 + max_jj;
+
+        int jj = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+        for (; jj + 15 < max_jj; jj += 16)
+        {
+            const float* kptr = KT + jj;
+
+            __m512 _s0 = _mm512_setzero_ps();
+            __m512 _s1 = _mm512_setzero_ps();
+            __m512 _s2 = _mm512_setzero_ps();
+            __m512 _s3 = _mm512_setzero_ps();
+            for (int k = 0; k < d; k++)
+            {
+                __m512 _k = _mm512_loadu_ps(kptr);
+                _s0 = _mm512_fmadd_ps(_mm512_set1_ps(q0[k]), _k, _s0);
+                _s1 = _mm512_fmadd_ps(_mm512_set1_ps(q1[k]), _k, _s1);
+                _s2 = _mm512_fmadd_ps(_mm512_set1_ps(q2[k]), _k, _s2);
+                _s3 = _mm512_fmadd_ps(_mm512_set1_ps(q3[k]), _k, _s3);
+                kptr += kT_stride;
+            }
+            _mm512_storeu_ps(s0 + jj, _s0);
+            _mm512_storeu_ps(s1 + jj, _s1);
+            _mm512_storeu_ps(s2 + jj, _s2);
+            _mm512_storeu_ps(s3 + jj, _s3);
+        }
+#endif // __AVX512F__
+        for (; jj + 7 < max_jj; jj += 8)
+        {
+            const float* kptr = KT + jj;
+
+            __m256 _s0 = _mm256_setzero_ps();
+            __m256 _s1 = _mm256_setzero_ps();
+            __m256 _s2 = _mm256_setzero_ps();
+            __m256 _s3 = _mm256_setzero_ps();
+            for (int k = 0; k < d; k++)
+            {
+                __m256 _k = _mm256_loadu_ps(kptr);
+                _s0 = _mm256_comp_fmadd_ps(_mm256_set1_ps(q0[k]), _k, _s0);
+                _s1 = _mm256_comp_fmadd_ps(_mm256_set1_ps(q1[k]), _k, _s1);
+                _s2 = _mm256_comp_fmadd_ps(_mm256_set1_ps(q2[k]), _k, _s2);
+                _s3 = _mm256_comp_fmadd_ps(_mm256_set1_ps(q3[k]), _k, _s3);
+                kptr += kT_stride;
+            }
+            _mm256_storeu_ps(s0 + jj, _s0);
+            _mm256_storeu_ps(s1 + jj, _s1);
+            _mm256_storeu_ps(s2 + jj, _s2);
+            _mm256_storeu_ps(s3 + jj, _s3);
+        }
+#endif // __AVX__
+        for (; jj + 3 < max_jj; jj += 4)
+        {
+            const float* kptr = KT + jj;
+
+            __m128 _s0 = _mm_setzero_ps();
+            __m128 _s1 = _mm_setzero_ps();
+            __m128 _s2 = _mm_setzero_ps();
+            __m128 _s3 = _mm_setzero_ps();
+            for (int k = 0; k < d; k++)
+            {
+                __m128 _k = _mm_loadu_ps(kptr);
+                _s0 = _mm_comp_fmadd_ps(_mm_set1_ps(q0[k]), _k, _s0);
+                _s1 = _mm_comp_fmadd_ps(_mm_set1_ps(q1[k]), _k, _s1);
+                _s2 = _mm_comp_fmadd_ps(_mm_set1_ps(q2[k]), _k, _s2);
+                _s3 = _mm_comp_fmadd_ps(_mm_set1_ps(q3[k]), _k, _s3);
+                kptr += kT_stride;
+            }
+            _mm_storeu_ps(s0 + jj, _s0);
+            _mm_storeu_ps(s1 + jj, _s1);
+            _mm_storeu_ps(s2 + jj, _s2);
+            _mm_storeu_ps(s3 + jj, _s3);
+        }
+#endif // __SSE2__
+        for (; jj < max_jj; jj++)
+        {
+            const float* kptr = KT + jj;
+
+            float sum0 = 0.f;
+            float sum1 = 0.f;
+            float sum2 = 0.f;
+            float sum3 = 0.f;
+            for (int k = 0; k < d; k++)
+            {
+                sum0 += q0[k] * kptr[0];
+                sum1 += q1[k] * kptr[0];
+                sum2 += q2[k] * kptr[0];
+                sum3 += q3[k] * kptr[0];
+                kptr += kT_stride;
+            }
+            s0[jj] = sum0;
+            s1[jj] = sum1;
+            s2[jj] = sum2;
+            s3[jj] = sum3;
+        }
+    }
+    for (; ii < max_ii; ii++)
+    {
+        const float* q0 = Q + ii * q_stride;
+
+        float* s0 = S + ii * max_jj;
+
+        int jj = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+        for (; jj + 15 < max_jj; jj += 16)
+        {
+            const float* kptr = KT + jj;
+
+            __m512 _s0 = _mm512_setzero_ps();
+            for (int k = 0; k < d; k++)
+            {
+                _s0 = _mm512_fmadd_ps(_mm512_set1_ps(q0[k]), _mm512_loadu_ps(kptr), _s0);
+                kptr += kT_stride;
+            }
+            _mm512_storeu_ps(s0 + jj, _s0);
+        }
+#endif // __AVX512F__
+        for (; jj + 7 < max_jj; jj += 8)
+        {
+            const float* kptr = KT + jj;
+
+            __m256 _s0 = _mm256_setzero_ps();
+            for (int k = 0; k < d; k++)
+            {
+                _s0 = _mm256_comp_fmadd_ps(_mm256_set1_ps(q0[k]), _mm256_loadu_ps(kptr), _s0);
+                kptr += kT_stride;
+            }
+            _mm256_storeu_ps(s0 + jj, _s0);
+        }
+#endif // __AVX__
+        for (; jj + 3 < max_jj; jj += 4)
+        {
+            const float* kptr = KT + jj;
+
+            __m128 _s0 = _mm_setzero_ps();
+            for (int k = 0; k < d; k++)
+            {
+                _s0 = _mm_comp_fmadd_ps(_mm_set1_ps(q0[k]), _mm_loadu_ps(kptr), _s0);
+                kptr += kT_stride;
+            }
+            _mm_storeu_ps(s0 + jj, _s0);
+        }
+#endif // __SSE2__
+        for (; jj < max_jj; jj++)
+        {
+            const float* kptr = KT + jj;
+
+            float sum0 = 0.f;
+            for (int k = 0; k < d; k++)
+            {
+                sum0 += q0[k] * kptr[0];
+                kptr += kT_stride;
+            }
+            s0[jj] = sum0;
+        }
+    }
+}
+
+// online softmax step for one row
+// s becomes exp(s - max), the running output row o is rescaled to the new max
+static void attention_online_softmax(float* s, int max_jj, float* o, int d, float& m, float& l)
+{
+    float max = m;
+    {
+        int jj = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+        __m512 _max_avx512 = _mm512_set1_ps(max);
+        for (; jj + 15 < max_jj; jj += 16)
+        {
+            _max_avx512 = _mm512_max_ps(_max_avx512, _mm512_loadu_ps(s + jj));
+        }
+        max = std::max(max, _mm512_comp_reduce_max_ps(_max_avx512));
+#endif // __AVX512F__
+        __m256 _max_avx = _mm256_set1_ps(max);
+        for (; jj + 7 < max_jj; jj += 8)
+        {
+            _max_avx = _mm256_max_ps(_max_avx, _mm256_loadu_ps(s + jj));
+        }
+        max = std::max(max, _mm256_reduce_max_ps(_max_avx));
+#endif // __AVX__
+        __m128 _max = _mm_set1_ps(max);
+        for (; jj + 3 < max_jj; jj += 4)
+        {
+            _max = _mm_max_ps(_max, _mm_loadu_ps(s + jj));
+        }
+        max = std::max(max, _mm_reduce_max_ps(_max));
+#endif // __SSE2__
+        for (; jj < max_jj; jj++)
+        {
+            max = std::max(max, s[jj]);
+        }
+    }
+
+    float sum = 0.f;
+    {
+        int jj = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+        __m512 _max_avx512 = _mm512_set1_ps(max);
+        __m512 _sum_avx512 = _mm512_setzero_ps();
+        for (; jj + 15 < max_jj; jj += 16)
+        {
+            __m512 _p = exp512_ps(_mm512_sub_ps(_mm512_loadu_ps(s + jj), _max_avx512));
+            _mm512_storeu_ps(s + jj, _p);
+            _sum_avx512 = _mm512_add_ps(_sum_avx512, _p);
+        }
+        sum += _mm512_comp_reduce_add_ps(_sum_avx512);
+#endif // __AVX512F__
+        __m256 _max_avx = _mm256_set1_ps(max);
+        __m256 _sum_avx = _mm256_setzero_ps();
+        for (; jj + 7 < max_jj; jj += 8)
+        {
+            __m256 _p = exp256_ps(_mm256_sub_ps(_mm256_loadu_ps(s + jj), _max_avx));
+            _mm256_storeu_ps(s + jj, _p);
+            _sum_avx = _mm256_add_ps(_sum_avx, _p);
+        }
+        sum += _mm256_reduce_add_ps(_sum_avx);
+#endif // __AVX__
+        __m128 _max = _mm_set1_ps(max);
+        __m128 _sum = _mm_setzero_ps();
+        for (; jj + 3 < max_jj; jj += 4)
+        {
+            __m128 _p = exp_ps(_mm_sub_ps(_mm_loadu_ps(s + jj), _max));
+            _mm_storeu_ps(s + jj, _p);
+            _sum = _mm_add_ps(_sum, _p);
+        }
+        sum += _mm_reduce_add_ps(_sum);
+#endif // __SSE2__
+        for (; jj < max_jj; jj++)
+        {
+            s[jj] = expf(s[jj] - max);
+            sum += s[jj];
+        }
+    }
+
+    const float scale = expf(m - max);
+
+    m = max;
+    l = l * scale + sum;
+
+    if (scale == 1.f)
+        return;
+
+    int kk = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    __m512 _scale_avx512 = _mm512_set1_ps(scale);
+    for (; kk + 15 < d; kk += 16)
+    {
+        _mm512_storeu_ps(o + kk, _mm512_mul_ps(_mm512_loadu_ps(o + kk), _scale_avx512));
+    }
+#endif // __AVX512F__
+    __m256 _scale_avx = _mm256_set1_ps(scale);
+    for (; kk + 7 < d; kk += 8)
+    {
+        _mm256_storeu_ps(o + kk, _mm256_mul_ps(_mm256_loadu_ps(o + kk), _scale_avx));
+    }
+#endif // __AVX__
+    __m128 _scale = _mm_set1_ps(scale);
+    for (; kk + 3 < d; kk += 4)
+    {
+        _mm_storeu_ps(o + kk, _mm_mul_ps(_mm_loadu_ps(o + kk), _scale));
+    }
+#endif // __SSE2__
+    for (; kk < d; kk++)
+    {
+        o[kk] *= scale;
+    }
+}
+
+// O += P * V
+// P max_ii rows of max_jj
+// V max_jj rows of d with row stride v_stride
+// O max_ii rows of d
+static void attention_pv_tile(const float* P, const float* V, int v_stride, float* O, int max_ii, int max_jj, int d)
+{
+    int ii = 0;
+    for (; ii + 3 < max_ii; ii += 4)
+    {
+        const float* p0 = P + ii * max_jj;
+        const float* p1 = p0 + max_jj;
+        const float* p2 = p1 + max_jj;
+        const float* p3 = p2 + max_jj;
+
+        float* o0 = O + ii * d;
+        float* o1 = o0 + d;
+        float* o2 = o1 + d;
+        float* o3 = o2 + d;
+
+        int kk = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+        for (; kk + 15 < d; kk += 16)
+        {
+            const float* vptr = V + kk;
+
+            __m512 _o0 = _mm512_loadu_ps(o0 + kk);
+            __m512 _o1 = _mm512_loadu_ps(o1 + kk);
+            __m512 _o2 = _mm512_loadu_ps(o2 + kk);
+            __m512 _o3 = _mm512_loadu_ps(o3 + kk);
+            for (int jj = 0; jj < max_jj; jj++)
+            {
+                __m512 _v = _mm512_loadu_ps(vptr);
+                _o0 = _mm512_fmadd_ps(_mm512_set1_ps(p0[jj]), _v, _o0);
+                _o1 = _mm512_fmadd_ps(_mm512_set1_ps(p1[jj]), _v, _o1);
+                _o2 = _mm512_fmadd_ps(_mm512_set1_ps(p2[jj]), _v, _o2);
+                _o3 = _mm512_fmadd_ps(_mm512_set1_ps(p3[jj]), _v, _o3);
+                vptr += v_stride;
+            }
+            _mm512_storeu_ps(o0 + kk, _o0);
+            _mm512_storeu_ps(o1 + kk, _o1);
+            _mm512_storeu_ps(o2 + kk, _o2);
+            _mm512_storeu_ps(o3 + kk, _o3);
+        }
+#endif // __AVX512F__
+        for (; kk + 7 < d; kk += 8)
+        {
+            const float* vptr = V + kk;
+
+            __m256 _o0 = _mm256_loadu_ps(o0 + kk);
+            __m256 _o1 = _mm256_loadu_ps(o1 + kk);
+            __m256 _o2 = _mm256_loadu_ps(o2 + kk);
+            __m256 _o3 = _mm256_loadu_ps(o3 + kk);
+            for (int jj = 0; jj < max_jj; jj++)
+            {
+                __m256 _v = _mm256_loadu_ps(vptr);
+                _o0 = _mm256_comp_fmadd_ps(_mm256_set1_ps(p0[jj]), _v, _o0);
+                _o1 = _mm256_comp_fmadd_ps(_mm256_set1_ps(p1[jj]), _v, _o1);
+                _o2 = _mm256_comp_fmadd_ps(_mm256_set1_ps(p2[jj]), _v, _o2);
+                _o3 = _mm256_comp_fmadd_ps(_mm256_set1_ps(p3[jj]), _v, _o3);
+                vptr += v_stride;
+            }
+            _mm256_storeu_ps(o0 + kk, _o0);
+            _mm256_storeu_ps(o1 + kk, _o1);
+            _mm256_storeu_ps(o2 + kk, _o2);
+            _mm256_storeu_ps(o3 + kk, _o3);
+        }
+#endif // __AVX__
+        for (; kk + 3 < d; kk += 4)
+        {
+            const float* vptr = V + kk;
+
+            __m128 _o0 = _mm_loadu_ps(o0 + kk);
+            __m128 _o1 = _mm_loadu_ps(o1 + kk);
+            __m128 _o2 = _mm_loadu_ps(o2 + kk);
+            __m128 _o3 = _mm_loadu_ps(o3 + kk);
+            for (int jj = 0; jj < max_jj; jj++)
+            {
+                __m128 _v = _mm_loadu_ps(vptr);
+                _o0 = _mm_comp_fmadd_ps(_mm_set1_ps(p0[jj]), _v, _o0);
+                _o1 = _mm_comp_fmadd_ps(_mm_set1_ps(p1[jj]), _v, _o1);
+                _o2 = _mm_comp_fmadd_ps(_mm_set1_ps(p2[jj]), _v, _o2);
+                _o3 = _mm_comp_fmadd_ps(_mm_set1_ps(p3[jj]), _v, _o3);
+                vptr += v_stride;
+            }
+            _mm_storeu_ps(o0 + kk, _o0);
+            _mm_storeu_ps(o1 + kk, _o1);
+            _mm_storeu_ps(o2 + kk, _o2);
+            _mm_storeu_ps(o3 + kk, _o3);
+        }
+#endif // __SSE2__
+        for (; kk < d; kk++)
+        {
+            const float* vptr = V + kk;
+
+            float sum0 = o0[kk];
+            float sum1 = o1[kk];
+            float sum2 = o2[kk];
+            float sum3 = o3[kk];
+            for (int jj = 0; jj < max_jj; jj++)
+            {
+                sum0 += p0[jj] * vptr[0];
+                sum1 += p1[jj] * vptr[0];
+                sum2 += p2[jj] * vptr[0];
+                sum3 += p3[jj] * vptr[0];
+                vptr += v_stride;
+            }
+            o0[kk] = sum0;
+            o1[kk] = sum1;
+            o2[kk] = sum2;
+            o3[kk] = sum3;
+        }
+    }
+    for (; ii < max_ii; ii++)
+    {
+        const float* p0 = P + ii * max_jj;
+
+        float* o0 = O + ii * d;
+
+        int kk = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+        for (; kk + 15 < d; kk += 16)
+        {
+            const float* vptr = V + kk;
+
+            __m512 _o0 = _mm512_loadu_ps(o0 + kk);
+            for (int jj = 0; jj < max_jj; jj++)
+            {
+                _o0 = _mm512_fmadd_ps(_mm512_set1_ps(p0[jj]), _mm512_loadu_ps(vptr), _o0);
+                vptr += v_stride;
+            }
+            _mm512_storeu_ps(o0 + kk, _o0);
+        }
+#endif // __AVX512F__
+        for (; kk + 7 < d; kk += 8)
+        {
+            const float* vptr = V + kk;
+
+            __m256 _o0 = _mm256_loadu_ps(o0 + kk);
+            for (int jj = 0; jj < max_jj; jj++)
+            {
+                _o0 = _mm256_comp_fmadd_ps(_mm256_set1_ps(p0[jj]), _mm256_loadu_ps(vptr), _o0);
+                vptr += v_stride;
+            }
+            _mm256_storeu_ps(o0 + kk, _o0);
+        }
+#endif // __AVX__
+        for (; kk + 3 < d; kk += 4)
+        {
+            const float* vptr = V + kk;
+
+            __m128 _o0 = _mm_loadu_ps(o0 + kk);
+            for (int jj = 0; jj < max_jj; jj++)
+            {
+                _o0 = _mm_comp_fmadd_ps(_mm_set1_ps(p0[jj]), _mm_loadu_ps(vptr), _o0);
+                vptr += v_stride;
+            }
+            _mm_storeu_ps(o0 + kk, _o0);
+        }
+#endif // __SSE2__
+        for (; kk < d; kk++)
+        {
+            const float* vptr = V + kk;
+
+            float sum0 = o0[kk];
+            for (int jj = 0; jj < max_jj; jj++)
+            {
+                sum0 += p0[jj] * vptr[0];
+                vptr += v_stride;
+            }
+            o0[kk] = sum0;
+        }
+    }
+}
+
+// refers to https://pytorch.org/docs/stable/generated/torch.nn.MultiheadAttention.html
+// softmax(xq * xk^T) * xv is evaluated in TILE_Q x TILE_KV blocks with a running max and sum per row
+// so the full attention matrix is never materialized
+int MultiHeadAttention_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    // in kv cache mode the cached xk and xv follow q k v
+    const int input_count = (int)bottom_blobs.size() - (kv_cache ? 2 : 0);
+
+    const Mat& q_blob = bottom_blobs[0];
+    const Mat& k_blob = input_count == 1 ? q_blob : bottom_blobs[1];
+    const Mat& v_blob = input_count == 1 ? q_blob : bottom_blobs[2];
+
+    const int src_seqlen = q_blob.h;
+    const int past_seqlen = kv_cache ? bottom_blobs[input_count].h : 0;
+    const int dst_seqlen = past_seqlen + k_blob.h;
+    const int embed_dim_per_head = embed_dim / num_head;
+
+    Option opt_ws = opt;
+    opt_ws.blob_allocator = opt.workspace_allocator;
+
+    // xq = affine(q) * inv_sqrt_embed_dim_per_head
+    // xq  (embed_dim, src_seqlen)
+    Mat xq;
+    {
+        std::vector<Mat> bottoms(2);
+        bottoms[0] = q_blob;
+        bottoms[1] = q_bias_data;
+
+        std::vector<Mat> tops(1);
+        int ret = q_gemm->forward(bottoms, tops, opt_ws);
+        if (ret != 0)
+            return ret;
+
+        xq = tops[0];
+    }
+
+    // xk = affine(k)
+    // xv = affine(v)
+    // xk and xv of all positions, the cached past ones first
+    // they become the new cache in kv cache mode
+    // xk  (embed_dim, dst_seqlen)
+    // xv  (embed_dim, dst_seqlen)
+    // only the new rows are projected, the cache grows geometrically and keeps the past rows in place
+    Option opt_kv = opt;
+    opt_kv.blob_allocator = kv_cache ? 0 : opt.workspace_allocator;
+
+    Mat xk;
+    Mat xv;
+    if (kv_cache)
+    {
+        if (grow_kv_cache(bottom_blobs[input_count], dst_seqlen, xk) != 0 || grow_kv_cache(bottom_blobs[input_count + 1], dst_seqlen, xv) != 0)
+            return -100;
+    }
+    else
+    {
+        xk.create(embed_dim, dst_seqlen, 4u, opt_kv.blob_allocator);
+        xv.create(embed_dim, dst_seqlen, 4u, opt_kv.blob_allocator);
+        if (xk.empty() || xv.empty())
+            return -100;
+    }
+
+    {
+        std::vector<Mat> bottoms(2);
+        bottoms[0] = k_blob;
+        bottoms[1] = k_bias_data;
+
+        // gemm writes the new rows in place
+        std::vector<Mat> tops(1);
+        tops[0] = Mat(embed_dim, dst_seqlen - past_seqlen, xk.row(past_seqlen), 4u, opt_kv.blob_allocator);
+
+        int ret = k_gemm->forward(bottoms, tops, opt_kv);
+        if (ret != 0)
+            return ret;
+    }
+
+    {
+        std::vector<Mat> bottoms(2);
+        bottoms[0] = v_blob;
+        bottoms[1] = v_bias_data;
+
+        std::vector<Mat> tops(1);
+        tops[0] = Mat(embed_dim, dst_seqlen - past_seqlen, xv.row(past_seqlen), 4u, opt_kv.blob_allocator);
+
+        int ret = v_gemm->forward(bottoms, tops, opt_kv);
+        if (ret != 0)
+            return ret;
+    }
+
+    // xqkv = softmax(xq * xk^T) * xv per head
+    // xqkv (embed_dim, src_seqlen)
+    Mat xqkv(embed_dim, src_seqlen, 4u, opt.workspace_allocator);
+    if (xqkv.empty())
+        return -100;
+
+    const int TILE_Q = 64;
+    const int TILE_KV = 64;
+
+    const int d = embed_dim_per_head;
+
+    // per-thread score tile, transposed key tile, output accumulator, running max and running sum
+    Mat scratch(TILE_Q * TILE_KV + d * TILE_KV + TILE_Q * d + TILE_Q * 2, 1, opt.num_threads, 4u, opt.workspace_allocator);
+    if (scratch.empty())
+        return -100;
+
+    const int nn_Q = (src_seqlen + TILE_Q - 1) / TILE_Q;
+    const int nn = num_head * nn_Q;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int ppi = 0; ppi < nn; ppi++)
+    {
+        const int q = ppi / nn_Q;
+        const int i = (ppi % nn_Q) * TILE_Q;
+        const int max_ii = std::min(src_seqlen - i, TILE_Q);
+
+        float* S = scratch.channel(get_omp_thread_num());
+        float* KT = S + TILE_Q * TILE_KV;
+        float* O = KT + d * TILE_KV;
+        float* m = O + TILE_Q * d;
+        float* l = m + TILE_Q;
+
+        for (int ii = 0; ii < max_ii; ii++)
+        {
+            m[ii] = -FLT_MAX;
+            l[ii] = 0.f;
+        }
+        memset(O, 0, max_ii * d * sizeof(float));
+
+        const float* Q = xq.row(i) + q * d;
+
+        // causal in kv cache mode, query i attends to the keys up to its own position past_seqlen + i
+        // key tiles beyond the last query row of this tile are skipped
+        const int kv_end = kv_cache ? std::min(dst_seqlen, past_seqlen + i + max_ii) : dst_seqlen;
+
+        for (int j = 0; j < kv_end; j += TILE_KV)
+        {
+            const int max_jj = std::min(kv_end - j, TILE_KV);
+
+            const float* K = xk.row(j) + q * d;
+            const float* V = xv.row(j) + q * d;
+
+            attention_transpose_k_tile(K, xk.w, KT, max_jj, d);
+
+            attention_qk_tile(Q, xq.w, KT, max_jj, S, max_ii, max_jj, d);
+
+            for (int ii = 0; ii < max_ii; ii++)
+            {
+                float* s = S + ii * max_jj;
+
+                const int valid_jj = kv_cache ? std::min(max_jj, past_seqlen + i + ii + 1 - j) : max_jj;
+                if (valid_jj > 0)
+                {
+                    attention_online_softmax(s, valid_jj, O + ii * d, d, m[ii], l[ii]);
+                }
+
+                // masked keys take no weight
+                for (int jj = std::max(valid_jj, 0); jj < max_jj; jj++)
+                {
+                    s[jj] = 0.f;
+                }
+            }
+
+            attention_pv_tile(S, V, xv.w, O, max_ii, max_jj, d);
+        }
+
+        for (int ii = 0; ii < max_ii; ii++)
+        {
+            const float* ptr = O + ii * d;
+            float* outptr = xqkv.row(i + ii) + q * d;
+
+            const float inv_sum = 1.f / l[ii];
+            for (int kk = 0; kk < d; kk++)
+            {
+                outptr[kk] = ptr[kk] * inv_sum;
+            }
+        }
+    }
+
+    // out = affine(xqkv)
+    // out (embed_dim, src_seqlen)
+    {
+        std::vector<Mat> bottoms(2);
+        bottoms[0] = xqkv;
+        bottoms[1] = out_bias_data;
+
+        std::vector<Mat> tops(1);
+        int ret = o_gemm->forward(bottoms, tops, opt);
+        if (ret != 0)
+            return ret;
+
+        top_blobs[0] = tops[0];
+    }
+
+    if (kv_cache)
+    {
+        top_blobs[1] = xk;
+        top_blobs[2] = xv;
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
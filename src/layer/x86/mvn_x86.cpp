@@ -0,0 +1,120 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "mvn_x86.h"
+
+#include "x86_norm.h"
+
+#include <math.h>
+
+namespace ncnn {
+
+MVN_x86::MVN_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+int MVN_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    if (bottom_blob.dims != 3)
+    {
+        // 1d and 2d blobs are a single channel, normalize them unpacked
+        Mat bottom_blob_unpacked = bottom_blob;
+        if (bottom_blob.elempack != 1)
+        {
+            Option opt_pack = opt;
+            opt_pack.blob_allocator = opt.workspace_allocator;
+
+            convert_packing(bottom_blob, bottom_blob_unpacked, 1, opt_pack);
+            if (bottom_blob_unpacked.empty())
+                return -100;
+        }
+
+        return MVN::forward(bottom_blob_unpacked, top_blob, opt);
+    }
+
+    const int w = bottom_blob.w;
+    const int h = bottom_blob.h;
+    const int c = bottom_blob.c;
+    const int elempack = bottom_blob.elempack;
+    const size_t elemsize = bottom_blob.elemsize;
+    const int size = w * h;
+
+    top_blob.create(w, h, c, elemsize, elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    if (!across_channels)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q = 0; q < c; q++)
+        {
+            const float* ptr = bottom_blob.channel(q);
+            float* outptr = top_blob.channel(q);
+
+            float mean[16];
+            float m2[16];
+            norm_channel_stats(ptr, elempack, size, mean, m2);
+
+            float a[16];
+            float b[16];
+            for (int k = 0; k < elempack; k++)
+            {
+                a[k] = normalize_variance ? static_cast<float>(1.f / (sqrt(m2[k] / size) + eps)) : 1.f;
+                b[k] = -mean[k] * a[k];
+            }
+
+            norm_apply(ptr, outptr, elempack, size, a, b);
+        }
+
+        return 0;
+    }
+
+    const int channels = c * elempack;
+
+    Mat mean(channels, (size_t)4u, opt.workspace_allocator);
+    Mat m2(channels, (size_t)4u, opt.workspace_allocator);
+    if (mean.empty() || m2.empty())
+        return -100;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < c; q++)
+    {
+        const float* ptr = bottom_blob.channel(q);
+
+        norm_channel_stats(ptr, elempack, size, (float*)mean + q * elempack, (float*)m2 + q * elempack);
+    }
+
+    float total_mean;
+    float total_m2;
+    norm_merge_stats(mean, m2, channels, size, total_mean, total_m2);
+
+    float a = normalize_variance ? static_cast<float>(1.f / (sqrt(total_m2 / (channels * size)) + eps)) : 1.f;
+    float b = -total_mean * a;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < c; q++)
+    {
+        const float* ptr = bottom_blob.channel(q);
+        float* outptr = top_blob.channel(q);
+
+        norm_apply(ptr, outptr, 1, size * elempack, &a, &b);
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,161 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "permute_x86.h"
+
+#include "x86_permute.h"
+
+namespace ncnn {
+
+Permute_x86::Permute_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+int Permute_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    const int dims = bottom_blob.dims;
+    const int elempack = bottom_blob.elempack;
+    const size_t elemsize = bottom_blob.elemsize;
+
+    if (dims == 1 || order_type == 0)
+    {
+        top_blob = bottom_blob;
+        return 0;
+    }
+
+    // the input axis that lands on each output axis, innermost first, 0 = w 1 = h 2 = d 3 = c
+    static const int orders_2d[2][2] = {
+        {0, 1}, {1, 0}
+    };
+    static const int orders_3d[6][3] = {
+        {0, 1, 2}, {1, 0, 2}, {0, 2, 1}, {2, 0, 1}, {1, 2, 0}, {2, 1, 0}
+    };
+    static const int orders_4d[24][4] = {
+        {0, 1, 2, 3}, {1, 0, 2, 3}, {0, 2, 1, 3}, {2, 0, 1, 3}, {1, 2, 0, 3}, {2, 1, 0, 3},
+        {0, 1, 3, 2}, {1, 0, 3, 2}, {0, 3, 1, 2}, {3, 0, 1, 2}, {1, 3, 0, 2}, {3, 1, 0, 2},
+        {0, 2, 3, 1}, {2, 0, 3, 1}, {0, 3, 2, 1}, {3, 0, 2, 1}, {2, 3, 0, 1}, {3, 2, 0, 1},
+        {1, 2, 3, 0}, {2, 1, 3, 0}, {1, 3, 2, 0}, {3, 1, 2, 0}, {2, 3, 1, 0}, {3, 2, 1, 0}
+    };
+
+    const int* order = 0;
+    if (dims == 2 && order_type < 2)
+        order = orders_2d[order_type];
+    if (dims == 3 && order_type < 6)
+        order = orders_3d[order_type];
+    if (dims == 4 && order_type < 24)
+        order = orders_4d[order_type];
+
+    if (!order)
+        return 0;
+
+    // extents in elements and strides in floats, the outermost axis is the packed one
+    int extents[4];
+    size_t strides[4];
+    extents[0] = bottom_blob.w;
+    strides[0] = elempack;
+    extents[1] = bottom_blob.h;
+    strides[1] = (size_t)bottom_blob.w * elempack;
+    extents[2] = bottom_blob.d;
+    strides[2] = (size_t)bottom_blob.w * bottom_blob.h * elempack;
+    extents[dims - 1] = (dims == 2 ? bottom_blob.h : bottom_blob.c) * elempack;
+    strides[dims - 1] = dims == 2 ? (size_t)bottom_blob.w * elempack : bottom_blob.cstep * elempack;
+
+    int outextents[4] = {1, 1, 1, 1};
+    for (int k = 0; k < dims; k++)
+    {
+        outextents[k] = extents[order[k]];
+    }
+
+    const int outer = outextents[dims - 1];
+
+    int out_elempack = 1;
+    if (order[dims - 1] == dims - 1)
+    {
+        out_elempack = elempack;
+    }
+#if __SSE2__
+    else if (opt.use_packing_layout)
+    {
+#if __AVX512F__
+        out_elempack = outer % 16 == 0 ? 16 : outer % 8 == 0 ? 8 : outer % 4 == 0 ? 4 : 1;
+#elif __AVX__
+        out_elempack = outer % 8 == 0 ? 8 : outer % 4 == 0 ? 4 : 1;
+#else
+        out_elempack = outer % 4 == 0 ? 4 : 1;
+#endif
+    }
+#endif // __SSE2__
+    size_t out_elemsize = elemsize / elempack * out_elempack;
+
+    if (dims == 2)
+        top_blob.create(outextents[0], outer / out_elempack, out_elemsize, out_elempack, opt.blob_allocator);
+    if (dims == 3)
+        top_blob.create(outextents[0], outextents[1], outer / out_elempack, out_elemsize, out_elempack, opt.blob_allocator);
+    if (dims == 4)
+        top_blob.create(outextents[0], outextents[1], outextents[2], outer / out_elempack, out_elemsize, out_elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    size_t outstrides[4];
+    outstrides[0] = out_elempack;
+    outstrides[1] = (size_t)top_blob.w * out_elempack;
+    outstrides[2] = (size_t)top_blob.w * top_blob.h * out_elempack;
+    outstrides[dims - 1] = dims == 2 ? (size_t)top_blob.w * out_elempack : top_blob.cstep * out_elempack;
+
+    // the packed axis of either side splits into the packed blocks and the lanes within
+    permute_axis axes[8];
+    int naxes = 0;
+    for (int k = 0; k < dims; k++)
+    {
+        const int i = order[k];
+        const bool in_packed = i == dims - 1;
+        const bool out_packed = k == dims - 1;
+
+        if (in_packed && out_packed)
+        {
+            permute_axis block = {extents[i] / elempack, strides[i], outstrides[k]};
+            permute_axis lane = {elempack, 1, 1};
+            axes[naxes++] = block;
+            axes[naxes++] = lane;
+        }
+        else if (in_packed)
+        {
+            permute_axis block = {extents[i] / elempack, strides[i], outstrides[k] * elempack};
+            permute_axis lane = {elempack, 1, outstrides[k]};
+            axes[naxes++] = block;
+            axes[naxes++] = lane;
+        }
+        else if (out_packed)
+        {
+            permute_axis block = {extents[i] / out_elempack, strides[i] * out_elempack, outstrides[k]};
+            permute_axis lane = {out_elempack, strides[i], 1};
+            axes[naxes++] = block;
+            axes[naxes++] = lane;
+        }
+        else
+        {
+            permute_axis axis = {extents[i], strides[i], outstrides[k]};
+            axes[naxes++] = axis;
+        }
+    }
+
+    permute_strided(bottom_blob, top_blob, axes, naxes, opt);
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,142 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#include "pooling1d_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX__
+#include <immintrin.h>
+#endif
+#endif // __SSE2__
+
+#include <float.h>
+
+namespace ncnn {
+
+#include "pooling_packed.h"
+
+Pooling1D_x86::Pooling1D_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+int Pooling1D_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    // max value in N window
+    // avg value in N window
+
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    size_t elemsize = bottom_blob.elemsize;
+    int elempack = bottom_blob.elempack;
+
+    if (global_pooling)
+    {
+        top_blob.create(h, elemsize, elempack, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q = 0; q < h; q++)
+        {
+            const float* ptr = bottom_blob.row(q);
+            float* outptr = (float*)top_blob + q * elempack;
+
+            pooling_box_packed_sse(ptr, outptr, w, 1, 0, w, 0, 1, 0, 1, elempack, pooling_type, 1.f / w);
+        }
+
+        return 0;
+    }
+
+    if (adaptive_pooling)
+    {
+        top_blob.create(out_w, h, elemsize, elempack, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q = 0; q < h; q++)
+        {
+            const float* ptr = bottom_blob.row(q);
+            float* outptr = top_blob.row(q);
+
+            for (int j = 0; j < out_w; j++)
+            {
+                // floor div
+                const int iw0 = w * j / out_w;
+                // ceil div
+                const int iw1 = (w * (j + 1) + out_w - 1) / out_w;
+
+                pooling_box_packed_sse(ptr, outptr, w, 1, iw0, iw1, 0, 1, 0, 1, elempack, pooling_type, 1.f / (iw1 - iw0));
+                outptr += elempack;
+            }
+        }
+
+        return 0;
+    }
+
+    Mat bottom_blob_bordered;
+    make_padding(bottom_blob, bottom_blob_bordered, opt);
+    if (bottom_blob_bordered.empty())
+        return -100;
+
+    w = bottom_blob_bordered.w;
+    h = bottom_blob_bordered.h;
+
+    int outw = (w - kernel_w) / stride_w + 1;
+
+    top_blob.create(outw, h, elemsize, elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    // the window excluding the padding when the average does not count it
+    const bool exclude_pad = pooling_type == PoolMethod_AVE && avgpool_count_include_pad == 0;
+
+    int wtailpad = 0;
+
+    if (exclude_pad && pad_mode == 0) // full padding
+    {
+        wtailpad = bottom_blob_bordered.w - bottom_blob.w - pad_left - pad_right;
+    }
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < h; q++)
+    {
+        const float* ptr = bottom_blob_bordered.row(q);
+        float* outptr = top_blob.row(q);
+
+        for (int j = 0; j < outw; j++)
+        {
+            int sx0 = j * stride_w;
+            int sx1 = sx0 + kernel_w;
+
+            if (exclude_pad)
+            {
+                sx0 = std::max(sx0, pad_left);
+                sx1 = std::min(sx1, w - pad_right - wtailpad);
+            }
+
+            pooling_box_packed_sse(ptr, outptr, w, 1, sx0, sx1, 0, 1, 0, 1, elempack, pooling_type, 1.f / (sx1 - sx0));
+            outptr += elempack;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
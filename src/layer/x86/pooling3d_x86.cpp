@@ -0,0 +1,196 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#include "pooling3d_x86.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX__
+#include <immintrin.h>
+#endif
+#endif // __SSE2__
+
+#include <float.h>
+
+namespace ncnn {
+
+#include "pooling_packed.h"
+
+Pooling3D_x86::Pooling3D_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+int Pooling3D_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    // max value in NxNxN window
+    // avg value in NxNxN window
+
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int d = bottom_blob.d;
+    int channels = bottom_blob.c;
+    size_t elemsize = bottom_blob.elemsize;
+    int elempack = bottom_blob.elempack;
+
+    if (global_pooling)
+    {
+        top_blob.create(channels, elemsize, elempack, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        const int size = w * h * d;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q = 0; q < channels; q++)
+        {
+            const float* ptr = bottom_blob.channel(q);
+            float* outptr = (float*)top_blob + q * elempack;
+
+            // the whole volume as one row
+            pooling_box_packed_sse(ptr, outptr, size, 1, 0, size, 0, 1, 0, 1, elempack, pooling_type, 1.f / size);
+        }
+
+        return 0;
+    }
+
+    if (adaptive_pooling)
+    {
+        top_blob.create(out_w, out_h, out_d, channels, elemsize, elempack, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q = 0; q < channels; q++)
+        {
+            const float* ptr = bottom_blob.channel(q);
+            float* outptr = top_blob.channel(q);
+
+            for (int z = 0; z < out_d; z++)
+            {
+                // floor div
+                const int id0 = d * z / out_d;
+                // ceil div
+                const int id1 = (d * (z + 1) + out_d - 1) / out_d;
+
+                for (int i = 0; i < out_h; i++)
+                {
+                    const int ih0 = h * i / out_h;
+                    const int ih1 = (h * (i + 1) + out_h - 1) / out_h;
+
+                    for (int j = 0; j < out_w; j++)
+                    {
+                        const int iw0 = w * j / out_w;
+                        const int iw1 = (w * (j + 1) + out_w - 1) / out_w;
+
+                        const int area = (id1 - id0) * (ih1 - ih0) * (iw1 - iw0);
+
+                        pooling_box_packed_sse(ptr, outptr, w, h, iw0, iw1, ih0, ih1, id0, id1, elempack, pooling_type, 1.f / area);
+                        outptr += elempack;
+                    }
+                }
+            }
+        }
+
+        return 0;
+    }
+
+    Mat bottom_blob_bordered;
+    make_padding(bottom_blob, bottom_blob_bordered, opt);
+    if (bottom_blob_bordered.empty())
+        return -100;
+
+    w = bottom_blob_bordered.w;
+    h = bottom_blob_bordered.h;
+    d = bottom_blob_bordered.d;
+
+    int outw = (w - kernel_w) / stride_w + 1;
+    int outh = (h - kernel_h) / stride_h + 1;
+    int outd = (d - kernel_d) / stride_d + 1;
+
+    top_blob.create(outw, outh, outd, channels, elemsize, elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    // the window excluding the padding when the average does not count it
+    const bool exclude_pad = pooling_type == PoolMethod_AVE && avgpool_count_include_pad == 0;
+
+    int wtailpad = 0;
+    int htailpad = 0;
+    int dtailpad = 0;
+
+    if (exclude_pad && pad_mode == 0) // full padding
+    {
+        wtailpad = bottom_blob_bordered.w - bottom_blob.w - pad_left - pad_right;
+        htailpad = bottom_blob_bordered.h - bottom_blob.h - pad_top - pad_bottom;
+        dtailpad = bottom_blob_bordered.d - bottom_blob.d - pad_front - pad_behind;
+    }
+
+    const float area_inv = 1.f / (kernel_w * kernel_h * kernel_d);
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < channels; q++)
+    {
+        const float* ptr = bottom_blob_bordered.channel(q);
+        float* outptr = top_blob.channel(q);
+
+        for (int z = 0; z < outd; z++)
+        {
+            int sz0 = z * stride_d;
+            int sz1 = sz0 + kernel_d;
+
+            if (exclude_pad)
+            {
+                sz0 = std::max(sz0, pad_front);
+                sz1 = std::min(sz1, d - pad_behind - dtailpad);
+            }
+
+            for (int i = 0; i < outh; i++)
+            {
+                int sy0 = i * stride_h;
+                int sy1 = sy0 + kernel_h;
+
+                if (exclude_pad)
+                {
+                    sy0 = std::max(sy0, pad_top);
+                    sy1 = std::min(sy1, h - pad_bottom - htailpad);
+                }
+
+                for (int j = 0; j < outw; j++)
+                {
+                    int sx0 = j * stride_w;
+                    int sx1 = sx0 + kernel_w;
+
+                    if (exclude_pad)
+                    {
+                        sx0 = std::max(sx0, pad_left);
+                        sx1 = std::min(sx1, w - pad_right - wtailpad);
+                    }
+
+                    const float scale = exclude_pad ? 1.f / ((sz1 - sz0) * (sy1 - sy0) * (sx1 - sx0)) : area_inv;
+
+                    pooling_box_packed_sse(ptr, outptr, w, h, sx0, sx1, sy0, sy1, sz0, sz1, elempack, pooling_type, scale);
+                    outptr += elempack;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,103 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+// box reduction shared by the 1d and 3d pooling layers
+// every pooled output is the max or the scaled sum over one box [x0, x1) x [y0, y1) x [z0, z1)
+// of a (w, h, d) plane of packed pixels, adaptive and padded windows only differ in the box
+static void pooling_box_packed_sse(const float* ptr, float* outptr, int w, int h, int x0, int x1, int y0, int y1, int z0, int z1, int elempack, int pooling_type, float scale)
+{
+    const bool is_max = pooling_type == 0;
+
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    if (elempack == 16)
+    {
+        __m512 _r = is_max ? _mm512_set1_ps(-FLT_MAX) : _mm512_setzero_ps();
+        for (int z = z0; z < z1; z++)
+        {
+            for (int y = y0; y < y1; y++)
+            {
+                const float* sptr = ptr + ((size_t)z * h + y) * w * 16;
+                for (int x = x0; x < x1; x++)
+                {
+                    __m512 _val = _mm512_loadu_ps(sptr + x * 16);
+                    _r = is_max ? _mm512_max_ps(_r, _val) : _mm512_add_ps(_r, _val);
+                }
+            }
+        }
+        if (!is_max)
+            _r = _mm512_mul_ps(_r, _mm512_set1_ps(scale));
+        _mm512_storeu_ps(outptr, _r);
+        return;
+    }
+#endif // __AVX512F__
+    if (elempack == 8)
+    {
+        __m256 _r = is_max ? _mm256_set1_ps(-FLT_MAX) : _mm256_setzero_ps();
+        for (int z = z0; z < z1; z++)
+        {
+            for (int y = y0; y < y1; y++)
+            {
+                const float* sptr = ptr + ((size_t)z * h + y) * w * 8;
+                for (int x = x0; x < x1; x++)
+                {
+                    __m256 _val = _mm256_loadu_ps(sptr + x * 8);
+                    _r = is_max ? _mm256_max_ps(_r, _val) : _mm256_add_ps(_r, _val);
+                }
+            }
+        }
+        if (!is_max)
+            _r = _mm256_mul_ps(_r, _mm256_set1_ps(scale));
+        _mm256_storeu_ps(outptr, _r);
+        return;
+    }
+#endif // __AVX__
+    if (elempack == 4)
+    {
+        __m128 _r = is_max ? _mm_set1_ps(-FLT_MAX) : _mm_setzero_ps();
+        for (int z = z0; z < z1; z++)
+        {
+            for (int y = y0; y < y1; y++)
+            {
+                const float* sptr = ptr + ((size_t)z * h + y) * w * 4;
+                for (int x = x0; x < x1; x++)
+                {
+                    __m128 _val = _mm_loadu_ps(sptr + x * 4);
+                    _r = is_max ? _mm_max_ps(_r, _val) : _mm_add_ps(_r, _val);
+                }
+            }
+        }
+        if (!is_max)
+            _r = _mm_mul_ps(_r, _mm_set1_ps(scale));
+        _mm_storeu_ps(outptr, _r);
+        return;
+    }
+#endif // __SSE2__
+
+    float r = is_max ? -FLT_MAX : 0.f;
+    for (int z = z0; z < z1; z++)
+    {
+        for (int y = y0; y < y1; y++)
+        {
+            const float* sptr = ptr + ((size_t)z * h + y) * w;
+            for (int x = x0; x < x1; x++)
+            {
+                r = is_max ? std::max(r, sptr[x]) : r + sptr[x];
+            }
+        }
+    }
+    outptr[0] = is_max ? r : r * scale;
+}
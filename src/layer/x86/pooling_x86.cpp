@@ -39,6 +39,8 @@ namespace ncnn {
 #endif // __AVX__
 #endif // __SSE2__
 
+#include "pooling_packed.h"
+
 Pooling_x86::Pooling_x86()
 {
 #if __SSE2__
@@ -50,8 +52,6 @@ int Pooling_x86::create_pipeline(const Option& /*opt*/)
 {
     if (adaptive_pooling)
     {
-        support_packing = false;
-
         support_bf16_storage = false;
         support_fp16_storage = false;
         support_int8_storage = false;
@@ -67,7 +67,40 @@ int Pooling_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& op
 
     if (adaptive_pooling)
     {
-        return Pooling::forward(bottom_blob, top_blob, opt);
+        const int w = bottom_blob.w;
+        const int h = bottom_blob.h;
+        const int channels = bottom_blob.c;
+        const int elempack = bottom_blob.elempack;
+
+        top_blob.create(out_w, out_h, channels, bottom_blob.elemsize, elempack, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q = 0; q < channels; q++)
+        {
+            const float* ptr = bottom_blob.channel(q);
+            float* outptr = top_blob.channel(q);
+
+            for (int i = 0; i < out_h; i++)
+            {
+                // floor div
+                const int ih0 = h * i / out_h;
+                // ceil div
+                const int ih1 = (h * (i + 1) + out_h - 1) / out_h;
+
+                for (int j = 0; j < out_w; j++)
+                {
+                    const int iw0 = w * j / out_w;
+                    const int iw1 = (w * (j + 1) + out_w - 1) / out_w;
+
+                    pooling_box_packed_sse(ptr, outptr, w, h, iw0, iw1, ih0, ih1, 0, 1, elempack, pooling_type, 1.f / ((ih1 - ih0) * (iw1 - iw0)));
+                    outptr += elempack;
+                }
+            }
+        }
+
+        return 0;
     }
 
 #if __SSE2__
@@ -0,0 +1,825 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "reduction_x86.h"
+
+#include <float.h>
+#include <math.h>
+
+#if __SSE2__
+#include <emmintrin.h>
+#include "sse_mathfun.h"
+#if __AVX__
+#include <immintrin.h>
+#include "avx_mathfun.h"
+#if __AVX512F__
+#include "avx512_mathfun.h"
+#endif // __AVX512F__
+#endif // __AVX__
+#endif // __SSE2__
+
+#include "x86_usability.h"
+#include "x86_activation.h"
+
+namespace ncnn {
+
+Reduction_x86::Reduction_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+namespace Reduction_x86_functor {
+
+struct reduction_op_add
+{
+    float func(const float& x, const float& y) const
+    {
+        return x + y;
+    }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const
+    {
+        return _mm_add_ps(x, y);
+    }
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const
+    {
+        return _mm256_add_ps(x, y);
+    }
+#if __AVX512F__
+    __m512 func_pack16(const __m512& x, const __m512& y) const
+    {
+        return _mm512_add_ps(x, y);
+    }
+#endif // __AVX512F__
+#endif // __AVX__
+#endif // __SSE2__
+};
+
+struct reduction_op_mul
+{
+    float func(const float& x, const float& y) const
+    {
+        return x * y;
+    }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const
+    {
+        return _mm_mul_ps(x, y);
+    }
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const
+    {
+        return _mm256_mul_ps(x, y);
+    }
+#if __AVX512F__
+    __m512 func_pack16(const __m512& x, const __m512& y) const
+    {
+        return _mm512_mul_ps(x, y);
+    }
+#endif // __AVX512F__
+#endif // __AVX__
+#endif // __SSE2__
+};
+
+struct reduction_op_asum
+{
+    float func(const float& x, const float& y) const
+    {
+        return (float)(x + fabs(y));
+    }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const
+    {
+        return _mm_add_ps(x, abs_sse(y));
+    }
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const
+    {
+        return _mm256_add_ps(x, abs_avx(y));
+    }
+#if __AVX512F__
+    __m512 func_pack16(const __m512& x, const __m512& y) const
+    {
+        return _mm512_add_ps(x, abs_avx512(y));
+    }
+#endif // __AVX512F__
+#endif // __AVX__
+#endif // __SSE2__
+};
+
+struct reduction_op_sumsq
+{
+    float func(const float& x, const float& y) const
+    {
+        return x + y * y;
+    }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const
+    {
+        return _mm_comp_fmadd_ps(y, y, x);
+    }
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const
+    {
+        return _mm256_comp_fmadd_ps(y, y, x);
+    }
+#if __AVX512F__
+    __m512 func_pack16(const __m512& x, const __m512& y) const
+    {
+        return _mm512_fmadd_ps(y, y, x);
+    }
+#endif // __AVX512F__
+#endif // __AVX__
+#endif // __SSE2__
+};
+
+struct reduction_op_sumsexp
+{
+    float func(const float& x, const float& y) const
+    {
+        return (float)(x + exp(y));
+    }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const
+    {
+        return _mm_add_ps(x, exp_ps(y));
+    }
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const
+    {
+        return _mm256_add_ps(x, exp256_ps(y));
+    }
+#if __AVX512F__
+    __m512 func_pack16(const __m512& x, const __m512& y) const
+    {
+        return _mm512_add_ps(x, exp512_ps(y));
+    }
+#endif // __AVX512F__
+#endif // __AVX__
+#endif // __SSE2__
+};
+
+struct reduction_op_max
+{
+    float func(const float& x, const float& y) const
+    {
+        return std::max(x, y);
+    }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const
+    {
+        return _mm_max_ps(x, y);
+    }
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const
+    {
+        return _mm256_max_ps(x, y);
+    }
+#if __AVX512F__
+    __m512 func_pack16(const __m512& x, const __m512& y) const
+    {
+        return _mm512_max_ps(x, y);
+    }
+#endif // __AVX512F__
+#endif // __AVX__
+#endif // __SSE2__
+};
+
+struct reduction_op_min
+{
+    float func(const float& x, const float& y) const
+    {
+        return std::min(x, y);
+    }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x, const __m128& y) const
+    {
+        return _mm_min_ps(x, y);
+    }
+#if __AVX__
+    __m256 func_pack8(const __m256& x, const __m256& y) const
+    {
+        return _mm256_min_ps(x, y);
+    }
+#if __AVX512F__
+    __m512 func_pack16(const __m512& x, const __m512& y) const
+    {
+        return _mm512_min_ps(x, y);
+    }
+#endif // __AVX512F__
+#endif // __AVX__
+#endif // __SSE2__
+};
+
+struct post_process_identity
+{
+    float func(const float& x) const
+    {
+        return x;
+    }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x) const
+    {
+        return x;
+    }
+#if __AVX__
+    __m256 func_pack8(const __m256& x) const
+    {
+        return x;
+    }
+#if __AVX512F__
+    __m512 func_pack16(const __m512& x) const
+    {
+        return x;
+    }
+#endif // __AVX512F__
+#endif // __AVX__
+#endif // __SSE2__
+};
+
+struct post_process_sqrt
+{
+    float func(const float& x) const
+    {
+        return (float)sqrt(x);
+    }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x) const
+    {
+        return _mm_sqrt_ps(x);
+    }
+#if __AVX__
+    __m256 func_pack8(const __m256& x) const
+    {
+        return _mm256_sqrt_ps(x);
+    }
+#if __AVX512F__
+    __m512 func_pack16(const __m512& x) const
+    {
+        return _mm512_sqrt_ps(x);
+    }
+#endif // __AVX512F__
+#endif // __AVX__
+#endif // __SSE2__
+};
+
+struct post_process_log
+{
+    float func(const float& x) const
+    {
+        return (float)log(x);
+    }
+#if __SSE2__
+    __m128 func_pack4(const __m128& x) const
+    {
+        return log_ps(x);
+    }
+#if __AVX__
+    __m256 func_pack8(const __m256& x) const
+    {
+        return log256_ps(x);
+    }
+#if __AVX512F__
+    __m512 func_pack16(const __m512& x) const
+    {
+        return log512_ps(x);
+    }
+#endif // __AVX512F__
+#endif // __AVX__
+#endif // __SSE2__
+};
+
+} // namespace Reduction_x86_functor
+
+// outptr[i] = op(outptr[i], ptr[i]), the layout does not matter for elementwise accumulation
+template<typename Op>
+static void reduction_accumulate(const float* ptr, float* outptr, int size)
+{
+    Op op;
+
+    int i = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    for (; i + 15 < size; i += 16)
+    {
+        _mm512_storeu_ps(outptr + i, op.func_pack16(_mm512_loadu_ps(outptr + i), _mm512_loadu_ps(ptr + i)));
+    }
+#endif // __AVX512F__
+    for (; i + 7 < size; i += 8)
+    {
+        _mm256_storeu_ps(outptr + i, op.func_pack8(_mm256_loadu_ps(outptr + i), _mm256_loadu_ps(ptr + i)));
+    }
+#endif // __AVX__
+    for (; i + 3 < size; i += 4)
+    {
+        _mm_storeu_ps(outptr + i, op.func_pack4(_mm_loadu_ps(outptr + i), _mm_loadu_ps(ptr + i)));
+    }
+#endif // __SSE2__
+    for (; i < size; i++)
+    {
+        outptr[i] = op.func(outptr[i], ptr[i]);
+    }
+}
+
+// reduce size positions of elempack lanes into outptr[0..elempack), merging with what outptr already holds
+// the lanes are replicated across the widest vector, so elempack 1/4/8 still run 16 wide
+template<typename Op, typename Op2>
+static void reduction_fold(const float* ptr, float* outptr, int size, int elempack, float v0)
+{
+    Op op;
+    Op2 op2;
+
+    const int total = size * elempack;
+
+    float sum[16];
+    for (int k = 0; k < elempack; k++)
+    {
+        sum[k] = outptr[k];
+    }
+
+    int i = 0;
+#if __SSE2__
+    float tmp[16];
+#if __AVX__
+#if __AVX512F__
+    if (total >= 16)
+    {
+        __m512 _sum = _mm512_set1_ps(v0);
+        for (; i + 15 < total; i += 16)
+        {
+            _sum = op.func_pack16(_sum, _mm512_loadu_ps(ptr + i));
+        }
+        _mm512_storeu_ps(tmp, _sum);
+        for (int k = 0; k < 16; k++)
+        {
+            sum[k % elempack] = op2.func(sum[k % elempack], tmp[k]);
+        }
+    }
+#endif // __AVX512F__
+    if (i + 7 < total)
+    {
+        __m256 _sum = _mm256_set1_ps(v0);
+        for (; i + 7 < total; i += 8)
+        {
+            _sum = op.func_pack8(_sum, _mm256_loadu_ps(ptr + i));
+        }
+        _mm256_storeu_ps(tmp, _sum);
+        for (int k = 0; k < 8; k++)
+        {
+            sum[k % elempack] = op2.func(sum[k % elempack], tmp[k]);
+        }
+    }
+#endif // __AVX__
+    if (i + 3 < total)
+    {
+        __m128 _sum = _mm_set1_ps(v0);
+        for (; i + 3 < total; i += 4)
+        {
+            _sum = op.func_pack4(_sum, _mm_loadu_ps(ptr + i));
+        }
+        _mm_storeu_ps(tmp, _sum);
+        for (int k = 0; k < 4; k++)
+        {
+            sum[k % elempack] = op2.func(sum[k % elempack], tmp[k]);
+        }
+    }
+#endif // __SSE2__
+    for (; i < total; i++)
+    {
+        // only elempack 1 reaches here
+        sum[0] = op.func(sum[0], ptr[i]);
+    }
+
+    for (int k = 0; k < elempack; k++)
+    {
+        outptr[k] = sum[k];
+    }
+}
+
+// reduce the w h d axes of one packed channel, the packed lanes stay apart
+// outptr receives outw * outh * outd positions of elempack lanes
+template<typename Op, typename Op2>
+static void reduction_block(const float* ptr, float* outptr, int w, int h, int d, int elempack, bool reduce_w, bool reduce_h, bool reduce_d, float v0)
+{
+    const int outw = reduce_w ? 1 : w;
+    const int outh = reduce_h ? 1 : h;
+    const int outd = reduce_d ? 1 : d;
+    const int outsize = outw * outh * outd;
+
+    for (int i = 0; i < outsize * elempack; i++)
+    {
+        outptr[i] = v0;
+    }
+
+    for (int z = 0; z < d; z++)
+    {
+        for (int y = 0; y < h; y++)
+        {
+            const float* row = ptr + (z * h + y) * w * elempack;
+            float* outrow = outptr + ((reduce_d ? 0 : z) * outh + (reduce_h ? 0 : y)) * outw * elempack;
+
+            if (reduce_w)
+            {
+                reduction_fold<Op, Op2>(row, outrow, w, elempack, v0);
+            }
+            else
+            {
+                reduction_accumulate<Op>(row, outrow, w * elempack);
+            }
+        }
+    }
+}
+
+// reduce across channels, sweeping every channel over a strip of positions
+// the packed lanes are accumulated apart and folded once at the end of the strip
+template<typename Op, typename Op2>
+static void reduction_c(const float* ptr, size_t cstep, int channels, float* outptr, int size, int elempack, float v0, const Option& opt)
+{
+    Op2 op2;
+
+    const int nn_size = (size + 63) / 64;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int ii = 0; ii < nn_size; ii++)
+    {
+        const int i = ii * 64;
+        const int max_ii = std::min(size - i, 64);
+
+        float acc[64 * 16];
+        for (int j = 0; j < max_ii * elempack; j++)
+        {
+            acc[j] = v0;
+        }
+
+        for (int q = 0; q < channels; q++)
+        {
+            reduction_accumulate<Op>(ptr + q * cstep + i * elempack, acc, max_ii * elempack);
+        }
+
+        for (int j = 0; j < max_ii; j++)
+        {
+            float sum = v0;
+            for (int k = 0; k < elempack; k++)
+            {
+                sum = op2.func(sum, acc[j * elempack + k]);
+            }
+            outptr[i + j] = sum;
+        }
+    }
+}
+
+template<typename Op, typename Op2>
+static int reduction_op(const Mat& a, Mat& b, float v0, bool reduce_w, bool reduce_h, bool reduce_d, bool reduce_c, int keepdims, const Option& opt)
+{
+    const int dims = a.dims;
+    const int elempack = a.elempack;
+
+    if (dims == 1)
+    {
+        // a packed vector is laid out like an unpacked one
+        b.create(1, 4u, opt.blob_allocator);
+        if (b.empty())
+            return -100;
+
+        b[0] = v0;
+        reduction_fold<Op, Op2>(a, b, a.w * elempack, 1, v0);
+
+        return 0;
+    }
+
+    // top shape, the packed axis is always the outermost one and keeps its packing unless reduced
+    {
+        int shape[4];
+        bool reduced[4];
+        int n = 0;
+        shape[n] = a.w;
+        reduced[n++] = reduce_w;
+        shape[n] = a.h;
+        reduced[n++] = reduce_h;
+        if (dims == 4)
+        {
+            shape[n] = a.d;
+            reduced[n++] = reduce_d;
+        }
+        if (dims >= 3)
+        {
+            shape[n] = a.c;
+            reduced[n++] = reduce_c;
+        }
+
+        const int out_elempack = reduced[n - 1] ? 1 : elempack;
+        const size_t out_elemsize = out_elempack * 4u;
+
+        int outshape[4];
+        int outdims = 0;
+        for (int i = 0; i < n; i++)
+        {
+            if (!reduced[i])
+                outshape[outdims++] = shape[i];
+            else if (keepdims)
+                outshape[outdims++] = 1;
+        }
+        if (outdims == 0)
+            outshape[outdims++] = 1;
+
+        if (outdims == 1)
+            b.create(outshape[0], out_elemsize, out_elempack, opt.blob_allocator);
+        if (outdims == 2)
+            b.create(outshape[0], outshape[1], out_elemsize, out_elempack, opt.blob_allocator);
+        if (outdims == 3)
+            b.create(outshape[0], outshape[1], outshape[2], out_elemsize, out_elempack, opt.blob_allocator);
+        if (outdims == 4)
+            b.create(outshape[0], outshape[1], outshape[2], outshape[3], out_elemsize, out_elempack, opt.blob_allocator);
+        if (b.empty())
+            return -100;
+    }
+
+    // view the blob as packed channels of w h d positions, rows take the place of channels for 2d
+    int w = a.w;
+    int h = dims == 2 ? 1 : a.h;
+    int d = dims == 4 ? a.d : 1;
+    const int channels = dims == 2 ? a.h : a.c;
+    const size_t cstep = dims == 2 ? (size_t)a.w * elempack : a.cstep * elempack;
+    if (dims == 2)
+    {
+        reduce_c = reduce_h;
+        reduce_h = false;
+    }
+
+    // merge neighbouring axes reduced alike into one contiguous run
+    // so that reduce-W, reduce-HW and reduce-WHD all fold a single span per channel
+    if (d == 1 || reduce_d == reduce_h)
+    {
+        h *= d;
+        d = 1;
+        reduce_d = reduce_h;
+    }
+    if (h == 1 || reduce_h == reduce_w)
+    {
+        w *= h;
+        h = 1;
+        reduce_h = reduce_w;
+    }
+
+    const int outw = reduce_w ? 1 : w;
+    const int outh = reduce_h ? 1 : h;
+    const int outd = reduce_d ? 1 : d;
+    const int outsize = outw * outh * outd;
+
+    if (!reduce_c)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q = 0; q < channels; q++)
+        {
+            const float* ptr = (const float*)a + q * cstep;
+            float* outptr = b.dims == 1 ? (float*)b + q * elempack : b.dims == 2 ? b.row(q) : b.channel(q);
+
+            reduction_block<Op, Op2>(ptr, outptr, w, h, d, elempack, reduce_w, reduce_h, reduce_d, v0);
+        }
+
+        return 0;
+    }
+
+    // squeezing c out of a 4d blob leaves a 3d top whose channels may be padded
+    const bool top_contiguous = b.dims < 3 || b.c == 1 || b.cstep == (size_t)b.w * b.h * b.d;
+
+    Mat top_flat = b;
+    if (!top_contiguous)
+    {
+        top_flat.create(outsize, 4u, opt.workspace_allocator);
+        if (top_flat.empty())
+            return -100;
+    }
+
+    if (outsize == w * h * d)
+    {
+        // reduce-C only
+        reduction_c<Op, Op2>(a, cstep, channels, top_flat, outsize, elempack, v0, opt);
+    }
+    else
+    {
+        Mat partials(outsize * elempack, channels, 4u, opt.workspace_allocator);
+        if (partials.empty())
+            return -100;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int q = 0; q < channels; q++)
+        {
+            const float* ptr = (const float*)a + q * cstep;
+
+            reduction_block<Op, Op2>(ptr, partials.row(q), w, h, d, elempack, reduce_w, reduce_h, reduce_d, v0);
+        }
+
+        reduction_c<Op2, Op2>(partials, outsize * elempack, channels, top_flat, outsize, elempack, v0, opt);
+    }
+
+    if (!top_contiguous)
+    {
+        const int size = b.w * b.h * b.d;
+        for (int q = 0; q < b.c; q++)
+        {
+            memcpy(b.channel(q), (const float*)top_flat + q * size, size * sizeof(float));
+        }
+    }
+
+    return 0;
+}
+
+template<typename MathOp>
+static int reduction_post_process(Mat& a, float coeff, const Option& opt)
+{
+    MathOp mathop;
+
+    const int channels = a.dims >= 3 ? a.c : 1;
+    const int size = a.dims >= 3 ? a.w * a.h * a.d * a.elempack : a.w * a.h * a.elempack;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < channels; q++)
+    {
+        float* ptr = a.dims >= 3 ? a.channel(q) : a;
+
+        int i = 0;
+#if __SSE2__
+        __m128 _coeff = _mm_set1_ps(coeff);
+#if __AVX__
+        __m256 _coeff_avx = _mm256_set1_ps(coeff);
+#if __AVX512F__
+        __m512 _coeff_avx512 = _mm512_set1_ps(coeff);
+        for (; i + 15 < size; i += 16)
+        {
+            _mm512_storeu_ps(ptr + i, _mm512_mul_ps(mathop.func_pack16(_mm512_loadu_ps(ptr + i)), _coeff_avx512));
+        }
+#endif // __AVX512F__
+        for (; i + 7 < size; i += 8)
+        {
+            _mm256_storeu_ps(ptr + i, _mm256_mul_ps(mathop.func_pack8(_mm256_loadu_ps(ptr + i)), _coeff_avx));
+        }
+#endif // __AVX__
+        for (; i + 3 < size; i += 4)
+        {
+            _mm_storeu_ps(ptr + i, _mm_mul_ps(mathop.func_pack4(_mm_loadu_ps(ptr + i)), _coeff));
+        }
+#endif // __SSE2__
+        for (; i < size; i++)
+        {
+            ptr[i] = mathop.func(ptr[i]) * coeff;
+        }
+    }
+
+    return 0;
+}
+
+template<typename Op, typename Op2, typename Op3>
+static int reduction(const Mat& a, Mat& b, float v0, bool reduce_w, bool reduce_h, bool reduce_d, bool reduce_c, bool post_process, float coeff, int keepdims, const Option& opt)
+{
+    int ret = reduction_op<Op, Op2>(a, b, v0, reduce_w, reduce_h, reduce_d, reduce_c, keepdims, opt);
+    if (ret != 0)
+        return -100;
+
+    if (post_process || fabs(coeff - 1.f) > FLT_EPSILON)
+    {
+        ret = reduction_post_process<Op3>(b, coeff, opt);
+        if (ret != 0)
+            return -100;
+    }
+
+    return 0;
+}
+
+int Reduction_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    using namespace Reduction_x86_functor;
+
+    int dims = bottom_blob.dims;
+    int elempack = bottom_blob.elempack;
+    int axes_flag[4] = {0};
+    bool reduce_w = false;
+    bool reduce_h = false;
+    bool reduce_d = false;
+    bool reduce_c = false;
+
+    if (reduce_all)
+    {
+        reduce_w = true;
+        reduce_h = true;
+        reduce_d = true;
+        reduce_c = true;
+    }
+    else
+    {
+        const int* axes_ptr = axes;
+        int reduced_axes_num = axes.w;
+
+        for (int i = 0; i < reduced_axes_num; i++)
+        {
+            int axis = axes_ptr[i];
+            // handle negative axis
+            if (axis < 0)
+                axis += dims;
+            axes_flag[axis] = 1;
+        }
+
+        if (dims == 1)
+        {
+            reduce_w = true;
+        }
+        else if (dims == 2)
+        {
+            if (axes_flag[0] == 1) reduce_h = true;
+            if (axes_flag[1] == 1) reduce_w = true;
+        }
+        else if (dims == 3)
+        {
+            if (axes_flag[0] == 1) reduce_c = true;
+            if (axes_flag[1] == 1) reduce_h = true;
+            if (axes_flag[2] == 1) reduce_w = true;
+        }
+        else if (dims == 4)
+        {
+            if (axes_flag[0] == 1) reduce_c = true;
+            if (axes_flag[1] == 1) reduce_d = true;
+            if (axes_flag[2] == 1) reduce_h = true;
+            if (axes_flag[3] == 1) reduce_w = true;
+        }
+    }
+
+    if (operation == ReductionOp_SUM)
+        return reduction<reduction_op_add, reduction_op_add, post_process_identity>(bottom_blob, top_blob, 0.f, reduce_w, reduce_h, reduce_d, reduce_c, false, coeff, keepdims, opt);
+
+    if (operation == ReductionOp_ASUM)
+        return reduction<reduction_op_asum, reduction_op_add, post_process_identity>(bottom_blob, top_blob, 0.f, reduce_w, reduce_h, reduce_d, reduce_c, false, coeff, keepdims, opt);
+
+    if (operation == ReductionOp_SUMSQ)
+        return reduction<reduction_op_sumsq, reduction_op_add, post_process_identity>(bottom_blob, top_blob, 0.f, reduce_w, reduce_h, reduce_d, reduce_c, false, coeff, keepdims, opt);
+
+    if (operation == ReductionOp_MEAN)
+    {
+        // the packed axis counts elempack elements per position
+        int scale = 1;
+        if (dims == 1)
+        {
+            scale = bottom_blob.w * elempack;
+        }
+        else if (dims == 2)
+        {
+            if (reduce_w) scale *= bottom_blob.w;
+            if (reduce_h) scale *= bottom_blob.h * elempack;
+        }
+        else if (dims == 3)
+        {
+            if (reduce_w) scale *= bottom_blob.w;
+            if (reduce_h) scale *= bottom_blob.h;
+            if (reduce_c) scale *= bottom_blob.c * elempack;
+        }
+        else if (dims == 4)
+        {
+            if (reduce_w) scale *= bottom_blob.w;
+            if (reduce_h) scale *= bottom_blob.h;
+            if (reduce_d) scale *= bottom_blob.d;
+            if (reduce_c) scale *= bottom_blob.c * elempack;
+        }
+
+        float coeff_mean = coeff / scale;
+        return reduction<reduction_op_add, reduction_op_add, post_process_identity>(bottom_blob, top_blob, 0.f, reduce_w, reduce_h, reduce_d, reduce_c, true, coeff_mean, keepdims, opt);
+    }
+
+    if (operation == ReductionOp_MAX)
+        return reduction<reduction_op_max, reduction_op_max, post_process_identity>(bottom_blob, top_blob, -FLT_MAX, reduce_w, reduce_h, reduce_d, reduce_c, false, coeff, keepdims, opt);
+
+    if (operation == ReductionOp_MIN)
+        return reduction<reduction_op_min, reduction_op_min, post_process_identity>(bottom_blob, top_blob, FLT_MAX, reduce_w, reduce_h, reduce_d, reduce_c, false, coeff, keepdims, opt);
+
+    if (operation == ReductionOp_PROD)
+        return reduction<reduction_op_mul, reduction_op_mul, post_process_identity>(bottom_blob, top_blob, 1.f, reduce_w, reduce_h, reduce_d, reduce_c, false, coeff, keepdims, opt);
+
+    if (operation == ReductionOp_L1)
+        return reduction<reduction_op_asum, reduction_op_add, post_process_identity>(bottom_blob, top_blob, 0.f, reduce_w, reduce_h, reduce_d, reduce_c, false, 1.f, keepdims, opt);
+
+    if (operation == ReductionOp_L2)
+        return reduction<reduction_op_sumsq, reduction_op_add, post_process_sqrt>(bottom_blob, top_blob, 0.f, reduce_w, reduce_h, reduce_d, reduce_c, true, 1.f, keepdims, opt);
+
+    if (operation == ReductionOp_LogSum)
+        return reduction<reduction_op_add, reduction_op_add, post_process_log>(bottom_blob, top_blob, 0.f, reduce_w, reduce_h, reduce_d, reduce_c, true, 1.f, keepdims, opt);
+
+    if (operation == ReductionOp_LogSumExp)
+        return reduction<reduction_op_sumsexp, reduction_op_add, post_process_log>(bottom_blob, top_blob, 0.f, reduce_w, reduce_h, reduce_d, reduce_c, true, 1.f, keepdims, opt);
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,180 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "shufflechannel_x86.h"
+
+#include "x86_permute.h"
+
+namespace ncnn {
+
+ShuffleChannel_x86::ShuffleChannel_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+int ShuffleChannel_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    const int dims = bottom_blob.dims;
+    const int channels = bottom_blob.c;
+    const int elempack = bottom_blob.elempack;
+    const size_t elemsize = bottom_blob.elemsize;
+
+    if (dims != 3)
+        return ShuffleChannel::forward(bottom_blob, top_blob, opt);
+
+    const int real_channels = channels * elempack;
+
+    if (real_channels % group != 0)
+    {
+        // reject invalid group
+        return -100;
+    }
+
+    const int _group = reverse ? real_channels / group : group;
+    const int channels_per_group = real_channels / _group;
+
+    if (_group == 1)
+    {
+        top_blob = bottom_blob;
+        return 0;
+    }
+
+    // real channel channels_per_group * i + j goes to _group * j + i
+    // either whole packed lanes move between groups, or every packed channel of the output
+    // interleaves _group runs of elempack / _group lanes that each sit inside one input packed channel
+    const bool lanes_in_groups = _group % elempack == 0 && channels_per_group % elempack == 0;
+    const bool groups_in_lanes = elempack % _group == 0 && channels_per_group % (elempack / _group) == 0;
+
+    if (!lanes_in_groups && !groups_in_lanes)
+    {
+        Option opt_pack = opt;
+        opt_pack.blob_allocator = opt.workspace_allocator;
+
+        Mat bottom_blob_unpacked;
+        convert_packing(bottom_blob, bottom_blob_unpacked, 1, opt_pack);
+        if (bottom_blob_unpacked.empty())
+            return -100;
+
+        Mat top_blob_unpacked;
+        int ret = ShuffleChannel::forward(bottom_blob_unpacked, top_blob_unpacked, opt_pack);
+        if (ret != 0)
+            return ret;
+
+        convert_packing(top_blob_unpacked, top_blob, elempack, opt);
+        if (top_blob.empty())
+            return -100;
+
+        return 0;
+    }
+
+    top_blob.create(bottom_blob.w, bottom_blob.h, channels, elemsize, elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const int size = bottom_blob.w * bottom_blob.h;
+    const size_t cstep = bottom_blob.cstep * elempack;
+    const size_t outcstep = top_blob.cstep * elempack;
+
+    if (lanes_in_groups)
+    {
+        // i = iq * elempack + il and j = jq * elempack + jl
+        permute_axis axes[5] = {
+            {size, (size_t)elempack, (size_t)elempack},
+            {_group / elempack, channels_per_group * cstep, outcstep},
+            {elempack, channels_per_group / elempack * cstep, 1},
+            {channels_per_group / elempack, cstep, _group * outcstep},
+            {elempack, 1, _group / elempack * outcstep}
+        };
+
+        permute_strided(bottom_blob, top_blob, axes, 5, opt);
+    }
+    else
+    {
+        // j = jq * r + jr lands on output packed channel jq at lane _group * jr + i,
+        // so every output pixel interleaves one run of r lanes from each group
+        const int r = elempack / _group;
+        const int nn_jq = channels_per_group / r;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int jq = 0; jq < nn_jq; jq++)
+        {
+            const float* ptrs[16];
+            for (int i = 0; i < _group; i++)
+            {
+                const int m = channels_per_group * i / r + jq;
+                ptrs[i] = (const float*)bottom_blob + m / _group * cstep + m % _group * r;
+            }
+
+            float* outptr = (float*)top_blob + jq * outcstep;
+
+            for (int s = 0; s < size; s++)
+            {
+                const int offset = s * elempack;
+
+#if __SSE2__
+                if (_group == 2 && r % 4 == 0)
+                {
+                    for (int k = 0; k < r; k += 4)
+                    {
+                        __m128 _a = _mm_loadu_ps(ptrs[0] + offset + k);
+                        __m128 _b = _mm_loadu_ps(ptrs[1] + offset + k);
+                        _mm_storeu_ps(outptr, _mm_unpacklo_ps(_a, _b));
+                        _mm_storeu_ps(outptr + 4, _mm_unpackhi_ps(_a, _b));
+                        outptr += 8;
+                    }
+                    continue;
+                }
+                if (_group == 2 && r == 2)
+                {
+                    __m128 _a = _mm_castpd_ps(_mm_load_sd((const double*)(ptrs[0] + offset)));
+                    __m128 _b = _mm_castpd_ps(_mm_load_sd((const double*)(ptrs[1] + offset)));
+                    _mm_storeu_ps(outptr, _mm_unpacklo_ps(_a, _b));
+                    outptr += 4;
+                    continue;
+                }
+                if (_group == 4 && r % 4 == 0)
+                {
+                    for (int k = 0; k < r; k += 4)
+                    {
+                        __m128 _r0 = _mm_loadu_ps(ptrs[0] + offset + k);
+                        __m128 _r1 = _mm_loadu_ps(ptrs[1] + offset + k);
+                        __m128 _r2 = _mm_loadu_ps(ptrs[2] + offset + k);
+                        __m128 _r3 = _mm_loadu_ps(ptrs[3] + offset + k);
+                        _MM_TRANSPOSE4_PS(_r0, _r1, _r2, _r3);
+                        _mm_storeu_ps(outptr, _r0);
+                        _mm_storeu_ps(outptr + 4, _r1);
+                        _mm_storeu_ps(outptr + 8, _r2);
+                        _mm_storeu_ps(outptr + 12, _r3);
+                        outptr += 16;
+                    }
+                    continue;
+                }
+#endif // __SSE2__
+                for (int jr = 0; jr < r; jr++)
+                {
+                    for (int i = 0; i < _group; i++)
+                    {
+                        *outptr++ = ptrs[i][offset + jr];
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
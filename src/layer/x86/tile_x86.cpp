@@ -0,0 +1,215 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "tile_x86.h"
+
+namespace ncnn {
+
+Tile_x86::Tile_x86()
+{
+#if __SSE2__
+    support_packing = true;
+#endif // __SSE2__
+}
+
+int Tile_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    int dims = bottom_blob.dims;
+    int elempack = bottom_blob.elempack;
+    int repeat_w = 1;
+    int repeat_h = 1;
+    int repeat_d = 1;
+    int repeat_c = 1;
+
+    const int repeats_num = repeats.w;
+
+    if (repeats.empty())
+    {
+        if (dims == 1) // axis == 0
+        {
+            repeat_w = tiles;
+        }
+        else if (dims == 2)
+        {
+            if (axis == 0) repeat_h = tiles;
+            if (axis == 1) repeat_w = tiles;
+        }
+        else if (dims == 3)
+        {
+            if (axis == 0) repeat_c = tiles;
+            if (axis == 1) repeat_h = tiles;
+            if (axis == 2) repeat_w = tiles;
+        }
+        else if (dims == 4)
+        {
+            if (axis == 0) repeat_c = tiles;
+            if (axis == 1) repeat_d = tiles;
+            if (axis == 2) repeat_h = tiles;
+            if (axis == 3) repeat_w = tiles;
+        }
+    }
+    else
+    {
+        // numpy style tile
+        const int* repeats_ptr = repeats;
+
+        if (repeats_num == 1)
+        {
+            repeat_w = repeats_ptr[0];
+        }
+        if (repeats_num == 2)
+        {
+            repeat_h = repeats_ptr[0];
+            repeat_w = repeats_ptr[1];
+        }
+        if (repeats_num == 3)
+        {
+            if (dims == 4)
+            {
+                repeat_d = repeats_ptr[0];
+                repeat_h = repeats_ptr[1];
+                repeat_w = repeats_ptr[2];
+            }
+            else
+            {
+                repeat_c = repeats_ptr[0];
+                repeat_h = repeats_ptr[1];
+                repeat_w = repeats_ptr[2];
+            }
+        }
+        if (repeats_num == 4)
+        {
+            repeat_c = repeats_ptr[0];
+            repeat_d = repeats_ptr[1];
+            repeat_h = repeats_ptr[2];
+            repeat_w = repeats_ptr[3];
+        }
+    }
+
+    const int outdims = std::max(dims, repeats_num);
+
+    if (repeat_w == 1 && repeat_h == 1 && repeat_d == 1 && repeat_c == 1 && (repeats_num == 0 || dims == repeats_num))
+    {
+        top_blob = bottom_blob;
+        return 0;
+    }
+
+    if (elempack != 1 && outdims != dims)
+    {
+        // the packed axis is no longer the outermost one
+        Option opt_pack = opt;
+        opt_pack.blob_allocator = opt.workspace_allocator;
+
+        Mat bottom_blob_unpacked;
+        convert_packing(bottom_blob, bottom_blob_unpacked, 1, opt_pack);
+        if (bottom_blob_unpacked.empty())
+            return -100;
+
+        return Tile::forward(bottom_blob_unpacked, top_blob, opt);
+    }
+
+    // the repeated extent of the packed axis stays a multiple of elempack,
+    // so whole packed rows and channels are repeated as they are
+    int w = bottom_blob.w;
+    int h = bottom_blob.h;
+    int d = bottom_blob.d;
+    int channels = bottom_blob.c;
+    size_t elemsize = bottom_blob.elemsize;
+
+    const int outw = w * repeat_w;
+    const int outh = h * repeat_h;
+    const int outd = d * repeat_d;
+    const int outc = channels * repeat_c;
+
+    if (outdims == 1)
+        top_blob.create(outw, elemsize, elempack, opt.blob_allocator);
+    if (outdims == 2)
+        top_blob.create(outw, outh, elemsize, elempack, opt.blob_allocator);
+    if (outdims == 3)
+        top_blob.create(outw, outh, outc, elemsize, elempack, opt.blob_allocator);
+    if (outdims == 4)
+        top_blob.create(outw, outh, outd, outc, elemsize, elempack, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    // repeat 0-w, one task per input row
+    const int rows = channels * d * h;
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int i = 0; i < rows; i++)
+    {
+        const int q = i / (d * h);
+        const int z = i / h % d;
+        const int y = i % h;
+
+        const unsigned char* ptr = bottom_blob.channel(q).depth(z).row<const unsigned char>(y);
+        unsigned char* outptr = top_blob.channel(q).depth(z).row<unsigned char>(y);
+
+        for (int p = 0; p < repeat_w; p++)
+        {
+            memcpy(outptr, ptr, w * elemsize);
+            outptr += w * elemsize;
+        }
+    }
+
+    // repeat 1-h, one task per copy
+    if (repeat_h > 1)
+    {
+        const size_t size = (size_t)outw * h * elemsize;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int i = 0; i < channels * d * (repeat_h - 1); i++)
+        {
+            const int q = i / (d * (repeat_h - 1));
+            const int z = i / (repeat_h - 1) % d;
+            const int p = i % (repeat_h - 1) + 1;
+
+            const unsigned char* ptr = top_blob.channel(q).depth(z);
+            unsigned char* outptr = top_blob.channel(q).depth(z).row<unsigned char>(h * p);
+
+            memcpy(outptr, ptr, size);
+        }
+    }
+
+    // repeat 1-d
+    if (repeat_d > 1)
+    {
+        const size_t size = (size_t)outw * outh * d * elemsize;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int i = 0; i < channels * (repeat_d - 1); i++)
+        {
+            const int q = i / (repeat_d - 1);
+            const int p = i % (repeat_d - 1) + 1;
+
+            const unsigned char* ptr = top_blob.channel(q);
+            unsigned char* outptr = top_blob.channel(q).depth(d * p);
+
+            memcpy(outptr, ptr, size);
+        }
+    }
+
+    // repeat 1-c
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p = 1; p < repeat_c; p++)
+    {
+        const unsigned char* ptr = top_blob.channel_range(0, channels);
+        unsigned char* outptr = top_blob.channel_range(p * channels, channels);
+
+        memcpy(outptr, ptr, top_blob.cstep * channels * elemsize);
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,161 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef X86_AMX_H
+#define X86_AMX_H
+
+#if __AMX_TILE__
+#include <immintrin.h>
+#include <string.h>
+
+#include <algorithm>
+
+// palette 1 with all eight tiles shaped 16 rows x 64 bytes
+// the tile state is per thread, load it inside the parallel region and release before leaving
+static NCNN_FORCEINLINE void amx_tile_config_16x64()
+{
+    struct
+    {
+        unsigned char palette_id;
+        unsigned char start_row;
+        unsigned char reserved[14];
+        unsigned short colsb[16];
+        unsigned char rows[16];
+    } cfg;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.palette_id = 1;
+    for (int i = 0; i < 8; i++)
+    {
+        cfg.colsb[i] = 64;
+        cfg.rows[i] = 16;
+    }
+
+    _tile_loadconfig(&cfg);
+}
+
+#if __AMX_INT8__
+// C = A * B on blocked int8 tiles, signed x signed with int32 accumulation
+// AT = 64k-16m-nn_K-nn_M, one 1024 byte tile per 16 rows x 64 k
+// BT = 4k-16n-16k-nn_K-nn_N, one 1024 byte tile per 64 k x 16 n
+// C is row-major int32 with ldc elements per row and room for nn_M * 16 rows
+// k padding must be zero in AT and BT
+static void amx_gemm_int8(const signed char* AT, const signed char* BT, int* C, int nn_M, int nn_N, int nn_K, int ldc, int num_threads)
+{
+    // 512 deep k blocks keep two A strips in L1 and the B slab in L2 while the 2x2 C tiles sweep over n
+    const int TILE_KB = 8;
+
+    const int nn_M2 = (nn_M + 1) / 2;
+    const int nn_N2 = (nn_N + 1) / 2;
+
+    for (int kb = 0; kb < nn_K; kb += TILE_KB)
+    {
+        const int max_kb = std::min(nn_K - kb, TILE_KB);
+
+        #pragma omp parallel for num_threads(num_threads)
+        for (int ij = 0; ij < nn_M2 * nn_N2; ij++)
+        {
+            const int mb = ij / nn_N2 * 2;
+            const int nb = ij % nn_N2 * 2;
+
+            const bool has_m1 = mb + 1 < nn_M;
+            const bool has_n1 = nb + 1 < nn_N;
+
+            int* c00 = C + mb * 16 * ldc + nb * 16;
+            int* c01 = c00 + 16;
+            int* c10 = c00 + 16 * ldc;
+            int* c11 = c10 + 16;
+
+            const int c_stride = ldc * 4;
+
+            amx_tile_config_16x64();
+
+            if (kb == 0)
+            {
+                _tile_zero(0);
+                _tile_zero(1);
+                _tile_zero(2);
+                _tile_zero(3);
+            }
+            else
+            {
+                _tile_loadd(0, c00, c_stride);
+                if (has_n1) _tile_loadd(1, c01, c_stride);
+                if (has_m1) _tile_loadd(2, c10, c_stride);
+                if (has_m1 && has_n1) _tile_loadd(3, c11, c_stride);
+            }
+
+            const signed char* pA0 = AT + (mb * nn_K + kb) * 1024;
+            const signed char* pA1 = has_m1 ? pA0 + nn_K * 1024 : pA0;
+            const signed char* pB0 = BT + (nb * nn_K + kb) * 1024;
+            const signed char* pB1 = has_n1 ? pB0 + nn_K * 1024 : pB0;
+
+            if (has_m1 && has_n1)
+            {
+                for (int k = 0; k < max_kb; k++)
+                {
+                    _tile_loadd(4, pA0, 64);
+                    _tile_loadd(6, pB0, 64);
+                    _tile_dpbssd(0, 4, 6);
+                    _tile_loadd(7, pB1, 64);
+                    _tile_dpbssd(1, 4, 7);
+                    _tile_loadd(5, pA1, 64);
+                    _tile_dpbssd(2, 5, 6);
+                    _tile_dpbssd(3, 5, 7);
+
+                    pA0 += 1024;
+                    pA1 += 1024;
+                    pB0 += 1024;
+                    pB1 += 1024;
+                }
+            }
+            else
+            {
+                for (int k = 0; k < max_kb; k++)
+                {
+                    _tile_loadd(4, pA0, 64);
+                    _tile_loadd(6, pB0, 64);
+                    _tile_dpbssd(0, 4, 6);
+                    if (has_n1)
+                    {
+                        _tile_loadd(7, pB1, 64);
+                        _tile_dpbssd(1, 4, 7);
+                    }
+                    if (has_m1)
+                    {
+                        _tile_loadd(5, pA1, 64);
+                        _tile_dpbssd(2, 5, 6);
+                    }
+
+                    pA0 += 1024;
+                    pA1 += 1024;
+                    pB0 += 1024;
+                    pB1 += 1024;
+                }
+            }
+
+            _tile_stored(0, c00, c_stride);
+            if (has_n1) _tile_stored(1, c01, c_stride);
+            if (has_m1) _tile_stored(2, c10, c_stride);
+            if (has_m1 && has_n1) _tile_stored(3, c11, c_stride);
+
+            _tile_release();
+        }
+    }
+}
+#endif // __AMX_INT8__
+
+#endif // __AMX_TILE__
+
+#endif // X86_AMX_H
@@ -0,0 +1,191 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef X86_NORM_H
+#define X86_NORM_H
+
+#include "x86_usability.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+#endif // __SSE2__
+
+#include <algorithm>
+
+// mean and sum of squared deviations for every lane of one packed channel, in a single pass
+// each lane is shifted by its first value so that the squared sums stay well conditioned
+// packed lanes are replicated across the widest vector, so elempack 1/4/8 still run 16 wide
+static void norm_channel_stats(const float* ptr, int elempack, int size, float* mean, float* m2)
+{
+    const int total = size * elempack;
+
+    float shift[16];
+    for (int k = 0; k < 16; k++)
+    {
+        shift[k] = ptr[k % elempack];
+    }
+
+    float sum[16] = {0.f};
+    float sqsum[16] = {0.f};
+
+    int i = 0;
+#if __SSE2__
+    float tmp[16];
+#if __AVX__
+#if __AVX512F__
+    {
+        __m512 _shift = _mm512_loadu_ps(shift);
+        __m512 _sum = _mm512_setzero_ps();
+        __m512 _sqsum = _mm512_setzero_ps();
+        for (; i + 15 < total; i += 16)
+        {
+            __m512 _p = _mm512_sub_ps(_mm512_loadu_ps(ptr + i), _shift);
+            _sum = _mm512_add_ps(_sum, _p);
+            _sqsum = _mm512_fmadd_ps(_p, _p, _sqsum);
+        }
+        _mm512_storeu_ps(tmp, _sum);
+        for (int k = 0; k < 16; k++)
+            sum[k % elempack] += tmp[k];
+        _mm512_storeu_ps(tmp, _sqsum);
+        for (int k = 0; k < 16; k++)
+            sqsum[k % elempack] += tmp[k];
+    }
+#endif // __AVX512F__
+    {
+        __m256 _shift = _mm256_loadu_ps(shift);
+        __m256 _sum = _mm256_setzero_ps();
+        __m256 _sqsum = _mm256_setzero_ps();
+        for (; i + 7 < total; i += 8)
+        {
+            __m256 _p = _mm256_sub_ps(_mm256_loadu_ps(ptr + i), _shift);
+            _sum = _mm256_add_ps(_sum, _p);
+            _sqsum = _mm256_comp_fmadd_ps(_p, _p, _sqsum);
+        }
+        _mm256_storeu_ps(tmp, _sum);
+        for (int k = 0; k < 8; k++)
+            sum[k % elempack] += tmp[k];
+        _mm256_storeu_ps(tmp, _sqsum);
+        for (int k = 0; k < 8; k++)
+            sqsum[k % elempack] += tmp[k];
+    }
+#endif // __AVX__
+    {
+        __m128 _shift = _mm_loadu_ps(shift);
+        __m128 _sum = _mm_setzero_ps();
+        __m128 _sqsum = _mm_setzero_ps();
+        for (; i + 3 < total; i += 4)
+        {
+            __m128 _p = _mm_sub_ps(_mm_loadu_ps(ptr + i), _shift);
+            _sum = _mm_add_ps(_sum, _p);
+            _sqsum = _mm_comp_fmadd_ps(_p, _p, _sqsum);
+        }
+        _mm_storeu_ps(tmp, _sum);
+        for (int k = 0; k < 4; k++)
+            sum[k % elempack] += tmp[k];
+        _mm_storeu_ps(tmp, _sqsum);
+        for (int k = 0; k < 4; k++)
+            sqsum[k % elempack] += tmp[k];
+    }
+#endif // __SSE2__
+    for (; i < total; i++)
+    {
+        // only elempack 1 reaches here
+        float p = ptr[i] - shift[0];
+        sum[0] += p;
+        sqsum[0] += p * p;
+    }
+
+    for (int k = 0; k < elempack; k++)
+    {
+        mean[k] = shift[k] + sum[k] / size;
+        m2[k] = std::max(sqsum[k] - sum[k] * sum[k] / size, 0.f);
+    }
+}
+
+// merge the statistics of count channels holding size elements each
+// the grand mean is the mean of means, the spread of the means adds to the squared deviations
+static void norm_merge_stats(const float* mean, const float* m2, int count, int size, float& merged_mean, float& merged_m2)
+{
+    float sum = 0.f;
+    for (int q = 0; q < count; q++)
+    {
+        sum += mean[q];
+    }
+    merged_mean = sum / count;
+
+    float sqsum = 0.f;
+    float spread = 0.f;
+    for (int q = 0; q < count; q++)
+    {
+        float d = mean[q] - merged_mean;
+        sqsum += m2[q];
+        spread += d * d;
+    }
+    merged_m2 = sqsum + spread * size;
+}
+
+// outptr = ptr * a + b with one a and b per lane of the packed channel, ptr may alias outptr
+static void norm_apply(const float* ptr, float* outptr, int elempack, int size, const float* a, const float* b)
+{
+    const int total = size * elempack;
+
+    float a16[16];
+    float b16[16];
+    for (int k = 0; k < 16; k++)
+    {
+        a16[k] = a[k % elempack];
+        b16[k] = b[k % elempack];
+    }
+
+    int i = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    {
+        __m512 _a = _mm512_loadu_ps(a16);
+        __m512 _b = _mm512_loadu_ps(b16);
+        for (; i + 15 < total; i += 16)
+        {
+            _mm512_storeu_ps(outptr + i, _mm512_fmadd_ps(_mm512_loadu_ps(ptr + i), _a, _b));
+        }
+    }
+#endif // __AVX512F__
+    {
+        __m256 _a = _mm256_loadu_ps(a16);
+        __m256 _b = _mm256_loadu_ps(b16);
+        for (; i + 7 < total; i += 8)
+        {
+            _mm256_storeu_ps(outptr + i, _mm256_comp_fmadd_ps(_mm256_loadu_ps(ptr + i), _a, _b));
+        }
+    }
+#endif // __AVX__
+    {
+        __m128 _a = _mm_loadu_ps(a16);
+        __m128 _b = _mm_loadu_ps(b16);
+        for (; i + 3 < total; i += 4)
+        {
+            _mm_storeu_ps(outptr + i, _mm_comp_fmadd_ps(_mm_loadu_ps(ptr + i), _a, _b));
+        }
+    }
+#endif // __SSE2__
+    for (; i < total; i++)
+    {
+        outptr[i] = ptr[i] * a16[0] + b16[0];
+    }
+}
+
+#endif // X86_NORM_H
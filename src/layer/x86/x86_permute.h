@@ -0,0 +1,411 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef X86_PERMUTE_H
+#define X86_PERMUTE_H
+
+#include "option.h"
+#include "x86_usability.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+#endif // __SSE2__
+
+#include <algorithm>
+
+// one axis of a strided float copy, strides are counted in floats
+// packed layouts split the packed axis into a block axis and a lane axis
+struct permute_axis
+{
+    int n;
+    size_t in_stride;
+    size_t out_stride;
+};
+
+// drop unit axes and merge the axes that continue each other contiguously on both sides
+static int permute_axes_simplify(permute_axis* axes, int naxes)
+{
+    int k = 0;
+    for (int i = 0; i < naxes; i++)
+    {
+        if (axes[i].n != 1)
+            axes[k++] = axes[i];
+    }
+    naxes = k;
+
+    bool merged = true;
+    while (merged)
+    {
+        merged = false;
+        for (int i = 0; i < naxes && !merged; i++)
+        {
+            for (int j = 0; j < naxes && !merged; j++)
+            {
+                if (i == j)
+                    continue;
+
+                if (axes[j].in_stride == axes[i].in_stride * axes[i].n && axes[j].out_stride == axes[i].out_stride * axes[i].n)
+                {
+                    axes[i].n *= axes[j].n;
+                    axes[j] = axes[naxes - 1];
+                    naxes--;
+                    merged = true;
+                }
+            }
+        }
+    }
+
+    return naxes;
+}
+
+static void permute_copy_run(const float* ptr, float* outptr, int n, size_t in_stride, size_t out_stride)
+{
+    if (in_stride == 1 && out_stride == 1)
+    {
+        int i = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+        for (; i + 15 < n; i += 16)
+        {
+            _mm512_storeu_ps(outptr + i, _mm512_loadu_ps(ptr + i));
+        }
+#endif // __AVX512F__
+        for (; i + 7 < n; i += 8)
+        {
+            _mm256_storeu_ps(outptr + i, _mm256_loadu_ps(ptr + i));
+        }
+#endif // __AVX__
+        for (; i + 3 < n; i += 4)
+        {
+            _mm_storeu_ps(outptr + i, _mm_loadu_ps(ptr + i));
+        }
+#endif // __SSE2__
+        for (; i < n; i++)
+        {
+            outptr[i] = ptr[i];
+        }
+        return;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        *outptr = *ptr;
+        ptr += in_stride;
+        outptr += out_stride;
+    }
+}
+
+// outptr[a * out_stride + b] = ptr[b * in_stride + a] for a < nA, b < nB
+// square tiles go through registers, the ragged edges are copied one by one
+static void permute_transpose_tile(const float* ptr, float* outptr, int nA, int nB, size_t in_stride, size_t out_stride)
+{
+    const int tile = std::min(nA, nB);
+
+    int a = 0;
+    int b_end = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    if (tile >= 16)
+    {
+        b_end = nB / 16 * 16;
+        for (; a + 15 < nA; a += 16)
+        {
+            for (int b = 0; b < b_end; b += 16)
+            {
+                const float* p0 = ptr + b * in_stride + a;
+                __m512 _r0 = _mm512_loadu_ps(p0);
+                __m512 _r1 = _mm512_loadu_ps(p0 + in_stride);
+                __m512 _r2 = _mm512_loadu_ps(p0 + in_stride * 2);
+                __m512 _r3 = _mm512_loadu_ps(p0 + in_stride * 3);
+                __m512 _r4 = _mm512_loadu_ps(p0 + in_stride * 4);
+                __m512 _r5 = _mm512_loadu_ps(p0 + in_stride * 5);
+                __m512 _r6 = _mm512_loadu_ps(p0 + in_stride * 6);
+                __m512 _r7 = _mm512_loadu_ps(p0 + in_stride * 7);
+                __m512 _r8 = _mm512_loadu_ps(p0 + in_stride * 8);
+                __m512 _r9 = _mm512_loadu_ps(p0 + in_stride * 9);
+                __m512 _ra = _mm512_loadu_ps(p0 + in_stride * 10);
+                __m512 _rb = _mm512_loadu_ps(p0 + in_stride * 11);
+                __m512 _rc = _mm512_loadu_ps(p0 + in_stride * 12);
+                __m512 _rd = _mm512_loadu_ps(p0 + in_stride * 13);
+                __m512 _re = _mm512_loadu_ps(p0 + in_stride * 14);
+                __m512 _rf = _mm512_loadu_ps(p0 + in_stride * 15);
+                transpose16_ps(_r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7, _r8, _r9, _ra, _rb, _rc, _rd, _re, _rf);
+                float* pp = outptr + a * out_stride + b;
+                _mm512_storeu_ps(pp, _r0);
+                _mm512_storeu_ps(pp + out_stride, _r1);
+                _mm512_storeu_ps(pp + out_stride * 2, _r2);
+                _mm512_storeu_ps(pp + out_stride * 3, _r3);
+                _mm512_storeu_ps(pp + out_stride * 4, _r4);
+                _mm512_storeu_ps(pp + out_stride * 5, _r5);
+                _mm512_storeu_ps(pp + out_stride * 6, _r6);
+                _mm512_storeu_ps(pp + out_stride * 7, _r7);
+                _mm512_storeu_ps(pp + out_stride * 8, _r8);
+                _mm512_storeu_ps(pp + out_stride * 9, _r9);
+                _mm512_storeu_ps(pp + out_stride * 10, _ra);
+                _mm512_storeu_ps(pp + out_stride * 11, _rb);
+                _mm512_storeu_ps(pp + out_stride * 12, _rc);
+                _mm512_storeu_ps(pp + out_stride * 13, _rd);
+                _mm512_storeu_ps(pp + out_stride * 14, _re);
+                _mm512_storeu_ps(pp + out_stride * 15, _rf);
+            }
+        }
+    }
+    else
+#endif // __AVX512F__
+    if (tile >= 8)
+    {
+        b_end = nB / 8 * 8;
+        for (; a + 7 < nA; a += 8)
+        {
+            for (int b = 0; b < b_end; b += 8)
+            {
+                const float* p0 = ptr + b * in_stride + a;
+                __m256 _r0 = _mm256_loadu_ps(p0);
+                __m256 _r1 = _mm256_loadu_ps(p0 + in_stride);
+                __m256 _r2 = _mm256_loadu_ps(p0 + in_stride * 2);
+                __m256 _r3 = _mm256_loadu_ps(p0 + in_stride * 3);
+                __m256 _r4 = _mm256_loadu_ps(p0 + in_stride * 4);
+                __m256 _r5 = _mm256_loadu_ps(p0 + in_stride * 5);
+                __m256 _r6 = _mm256_loadu_ps(p0 + in_stride * 6);
+                __m256 _r7 = _mm256_loadu_ps(p0 + in_stride * 7);
+                transpose8_ps(_r0, _r1, _r2, _r3, _r4, _r5, _r6, _r7);
+                float* pp = outptr + a * out_stride + b;
+                _mm256_storeu_ps(pp, _r0);
+                _mm256_storeu_ps(pp + out_stride, _r1);
+                _mm256_storeu_ps(pp + out_stride * 2, _r2);
+                _mm256_storeu_ps(pp + out_stride * 3, _r3);
+                _mm256_storeu_ps(pp + out_stride * 4, _r4);
+                _mm256_storeu_ps(pp + out_stride * 5, _r5);
+                _mm256_storeu_ps(pp + out_stride * 6, _r6);
+                _mm256_storeu_ps(pp + out_stride * 7, _r7);
+            }
+        }
+    }
+    else
+#endif // __AVX__
+    if (tile >= 4)
+    {
+        b_end = nB / 4 * 4;
+        for (; a + 3 < nA; a += 4)
+        {
+            for (int b = 0; b < b_end; b += 4)
+            {
+                const float* p0 = ptr + b * in_stride + a;
+                __m128 _r0 = _mm_loadu_ps(p0);
+                __m128 _r1 = _mm_loadu_ps(p0 + in_stride);
+                __m128 _r2 = _mm_loadu_ps(p0 + in_stride * 2);
+                __m128 _r3 = _mm_loadu_ps(p0 + in_stride * 3);
+                _MM_TRANSPOSE4_PS(_r0, _r1, _r2, _r3);
+                float* pp = outptr + a * out_stride + b;
+                _mm_storeu_ps(pp, _r0);
+                _mm_storeu_ps(pp + out_stride, _r1);
+                _mm_storeu_ps(pp + out_stride * 2, _r2);
+                _mm_storeu_ps(pp + out_stride * 3, _r3);
+            }
+        }
+    }
+#endif // __SSE2__
+
+    // right edge of the tiled rows
+    for (int i = 0; i < a; i++)
+    {
+        for (int b = b_end; b < nB; b++)
+        {
+            outptr[i * out_stride + b] = ptr[b * in_stride + i];
+        }
+    }
+
+    // bottom rows
+    for (; a < nA; a++)
+    {
+        for (int b = 0; b < nB; b++)
+        {
+            outptr[a * out_stride + b] = ptr[b * in_stride + a];
+        }
+    }
+}
+
+// copy ptr into outptr over the permuted axes
+// the axis contiguous in the source and the axis contiguous in the destination form
+// the transposed plane, it is walked in register tiles so that both sides stream whole lines
+static void permute_strided(const float* ptr, float* outptr, permute_axis* _axes, int naxes, const ncnn::Option& opt)
+{
+    permute_axis axes[8];
+    for (int i = 0; i < naxes; i++)
+    {
+        axes[i] = _axes[i];
+    }
+    naxes = permute_axes_simplify(axes, naxes);
+
+    if (naxes == 0)
+    {
+        outptr[0] = ptr[0];
+        return;
+    }
+
+    int A = 0;
+    int B = 0;
+    for (int i = 1; i < naxes; i++)
+    {
+        if (axes[i].in_stride < axes[A].in_stride)
+            A = i;
+        if (axes[i].out_stride < axes[B].out_stride)
+            B = i;
+    }
+
+    const bool transpose = A != B && axes[A].in_stride == 1 && axes[B].out_stride == 1;
+
+    // the remaining axes are walked outside the plane or the run
+    permute_axis outer[8];
+    int nouter = 0;
+    for (int i = 0; i < naxes; i++)
+    {
+        if (i == B || (transpose && i == A))
+            continue;
+        outer[nouter++] = axes[i];
+    }
+
+    if (transpose)
+    {
+        const permute_axis& a = axes[A];
+        const permute_axis& b = axes[B];
+
+        // split the rows of the plane so that a plain 2d transpose still spreads over threads
+        const int rows = 64;
+        const int nn_rows = (a.n + rows - 1) / rows;
+
+        // small planes step the outer axes closest to the source and to the destination in the inner loops,
+        // so that every cache line touched on either side is used up before moving on
+        permute_axis inner0 = {1, 0, 0};
+        permute_axis inner1 = {1, 0, 0};
+        if (nouter > 0 && a.n * b.n < 1024)
+        {
+            int I = 0;
+            for (int i = 1; i < nouter; i++)
+            {
+                if (outer[i].in_stride < outer[I].in_stride)
+                    I = i;
+            }
+            inner0 = outer[I];
+            outer[I] = outer[nouter - 1];
+            nouter--;
+        }
+        if (nouter > 0 && a.n * b.n < 1024)
+        {
+            int I = 0;
+            for (int i = 1; i < nouter; i++)
+            {
+                if (outer[i].out_stride < outer[I].out_stride)
+                    I = i;
+            }
+            inner1 = outer[I];
+            outer[I] = outer[nouter - 1];
+            nouter--;
+        }
+
+        int nn_outer = 1;
+        for (int i = 0; i < nouter; i++)
+        {
+            nn_outer *= outer[i].n;
+        }
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int ii = 0; ii < nn_outer * nn_rows; ii++)
+        {
+            int o = ii / nn_rows;
+            const int r = ii % nn_rows * rows;
+
+            size_t in_offset = r;
+            size_t out_offset = r * a.out_stride;
+            for (int i = 0; i < nouter; i++)
+            {
+                const int k = o % outer[i].n;
+                o /= outer[i].n;
+                in_offset += k * outer[i].in_stride;
+                out_offset += k * outer[i].out_stride;
+            }
+
+            for (int j1 = 0; j1 < inner1.n; j1++)
+            {
+                const float* p = ptr + in_offset + j1 * inner1.in_stride;
+                float* pp = outptr + out_offset + j1 * inner1.out_stride;
+                for (int j0 = 0; j0 < inner0.n; j0++)
+                {
+                    permute_transpose_tile(p, pp, std::min(rows, a.n - r), b.n, b.in_stride, a.out_stride);
+                    p += inner0.in_stride;
+                    pp += inner0.out_stride;
+                }
+            }
+        }
+
+        return;
+    }
+
+    // runs along the destination contiguous axis, the outer axis closest to it is stepped in the inner loop
+    const permute_axis& run = axes[B];
+
+    if (nouter == 0)
+    {
+        permute_copy_run(ptr, outptr, run.n, run.in_stride, run.out_stride);
+        return;
+    }
+
+    int I = 0;
+    for (int i = 1; i < nouter; i++)
+    {
+        if (outer[i].out_stride < outer[I].out_stride)
+            I = i;
+    }
+    const permute_axis inner = outer[I];
+    outer[I] = outer[nouter - 1];
+    nouter--;
+
+    int nn_outer = 1;
+    for (int i = 0; i < nouter; i++)
+    {
+        nn_outer *= outer[i].n;
+    }
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int ii = 0; ii < nn_outer; ii++)
+    {
+        int o = ii;
+
+        size_t in_offset = 0;
+        size_t out_offset = 0;
+        for (int i = 0; i < nouter; i++)
+        {
+            const int k = o % outer[i].n;
+            o /= outer[i].n;
+            in_offset += k * outer[i].in_stride;
+            out_offset += k * outer[i].out_stride;
+        }
+
+        const float* p = ptr + in_offset;
+        float* pp = outptr + out_offset;
+        for (int j = 0; j < inner.n; j++)
+        {
+            permute_copy_run(p, pp, run.n, run.in_stride, run.out_stride);
+            p += inner.in_stride;
+            pp += inner.out_stride;
+        }
+    }
+}
+
+#endif // X86_PERMUTE_H
@@ -490,6 +490,15 @@ static NCNN_FORCEINLINE float _mm512_comp_reduce_max_ps(__m512 x)
     const __m128 x32 = _mm_max_ss(x64, _mm_shuffle_ps(x64, x64, 0x55));
     return _mm_cvtss_f32(x32);
 }
+
+static NCNN_FORCEINLINE __m512i _mm512_comp_dpwssd_epi32(__m512i src, __m512i a, __m512i b)
+{
+#if __AVX512VNNI__
+    return _mm512_dpwssd_epi32(src, a, b);
+#else
+    return _mm512_add_epi32(src, _mm512_madd_epi16(a, b));
+#endif
+}
 #endif // __AVX512F__
 #endif // __AVX__
 #endif // __SSE2__
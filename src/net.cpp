@@ -14,6 +14,7 @@
 
 #include "net.h"
 
+#include "benchmark.h"
 #include "cpu.h"
 #include "datareader.h"
 #include "layer_type.h"
@@ -24,10 +25,6 @@
 #include <stdint.h>
 #include <string.h>
 
-#if NCNN_BENCHMARK
-#include "benchmark.h"
-#endif // NCNN_BENCHMARK
-
 #if NCNN_VULKAN
 #include "command.h"
 #include "pipelinecache.h"
@@ -35,6 +32,446 @@
 
 namespace ncnn {
 
+// record the size and lifetime of every blob allocation in a planning run
+class BlobRecordAllocator : public Allocator
+{
+public:
+    BlobRecordAllocator();
+    virtual ~BlobRecordAllocator();
+
+    virtual void* fastMalloc(size_t size);
+    virtual void fastFree(void* ptr);
+
+public:
+    Mutex lock;
+    int clock;
+    std::vector<size_t> sizes;
+    std::vector<int> births;
+    std::vector<int> deaths;
+    std::list<std::pair<void*, int> > payouts;
+};
+
+BlobRecordAllocator::BlobRecordAllocator()
+    : Allocator()
+{
+    clock = 0;
+}
+
+BlobRecordAllocator::~BlobRecordAllocator()
+{
+    std::list<std::pair<void*, int> >::iterator it = payouts.begin();
+    for (; it != payouts.end(); ++it)
+    {
+        ncnn::fastFree(it->first);
+    }
+}
+
+void* BlobRecordAllocator::fastMalloc(size_t size)
+{
+    MutexLockGuard guard(lock);
+
+    void* ptr = ncnn::fastMalloc(size);
+
+    int slot = (int)sizes.size();
+    sizes.push_back(size);
+    births.push_back(clock++);
+    deaths.push_back(-1);
+
+    payouts.push_back(std::make_pair(ptr, slot));
+
+    return ptr;
+}
+
+void BlobRecordAllocator::fastFree(void* ptr)
+{
+    MutexLockGuard guard(lock);
+
+    std::list<std::pair<void*, int> >::iterator it = payouts.begin();
+    for (; it != payouts.end(); ++it)
+    {
+        if (it->first == ptr)
+        {
+            deaths[it->second] = clock++;
+            payouts.erase(it);
+            break;
+        }
+    }
+
+    ncnn::fastFree(ptr);
+}
+
+// arena offset of every blob allocation in the recorded order
+class BlobMemoryPlan
+{
+public:
+    BlobMemoryPlan(const BlobRecordAllocator& record);
+
+public:
+    // held by the net and by every arena built on it
+    int refcount;
+
+    size_t arena_size;
+    std::vector<size_t> sizes;
+    std::vector<size_t> offsets;
+    // slots sharing arena bytes with each slot at different time
+    std::vector<std::vector<int> > aliases;
+};
+
+struct compare_size_desc_index
+{
+    bool operator()(const std::pair<size_t, int>& a, const std::pair<size_t, int>& b) const
+    {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    }
+};
+
+struct compare_range_begin
+{
+    bool operator()(const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b) const
+    {
+        return a.first < b.first;
+    }
+};
+
+BlobMemoryPlan::BlobMemoryPlan(const BlobRecordAllocator& record)
+{
+    refcount = 1;
+
+    const int count = (int)record.sizes.size();
+
+    sizes.resize(count);
+    offsets.resize(count);
+    aliases.resize(count);
+
+    std::vector<int> deaths = record.deaths;
+    for (int i = 0; i < count; i++)
+    {
+        sizes[i] = alignSize(record.sizes[i], NCNN_MALLOC_ALIGN);
+
+        // blob alive until the end of planning run
+        if (deaths[i] == -1)
+            deaths[i] = record.clock;
+    }
+
+    // place larger blobs first
+    std::vector<std::pair<size_t, int> > order(count);
+    for (int i = 0; i < count; i++)
+    {
+        order[i] = std::make_pair(sizes[i], i);
+    }
+    std::partial_sort(order.begin(), order.end(), order.end(), compare_size_desc_index());
+
+    // interval coloring, put each blob at the lowest offset that is free during its lifetime
+    arena_size = 0;
+    std::vector<int> placed;
+    for (int k = 0; k < count; k++)
+    {
+        const int i = order[k].second;
+
+        std::vector<std::pair<size_t, size_t> > busy;
+        for (size_t j = 0; j < placed.size(); j++)
+        {
+            const int p = placed[j];
+            if (record.births[i] < deaths[p] && record.births[p] < deaths[i])
+            {
+                busy.push_back(std::make_pair(offsets[p], offsets[p] + sizes[p]));
+            }
+        }
+        std::partial_sort(busy.begin(), busy.end(), busy.end(), compare_range_begin());
+
+        size_t offset = 0;
+        for (size_t j = 0; j < busy.size(); j++)
+        {
+            if (offset + sizes[i] <= busy[j].first)
+                break;
+
+            offset = std::max(offset, busy[j].second);
+        }
+
+        offsets[i] = offset;
+        placed.push_back(i);
+
+        arena_size = std::max(arena_size, offset + sizes[i]);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = 0; j < count; j++)
+        {
+            if (i != j && offsets[i] < offsets[j] + sizes[j] && offsets[j] < offsets[i] + sizes[i])
+            {
+                aliases[i].push_back(j);
+            }
+        }
+    }
+}
+
+// hand out planned views into one pre-sized arena
+// allocations off the plan fall back to heap so that divergent runs stay correct
+class BlobArenaAllocator : public Allocator
+{
+public:
+    BlobArenaAllocator(BlobMemoryPlan* _plan);
+    virtual ~BlobArenaAllocator();
+
+    // restart the planned allocation sequence and the counters
+    void reset();
+
+    virtual void* fastMalloc(size_t size);
+    virtual void fastFree(void* ptr);
+
+public:
+    BlobMemoryPlan* plan;
+    unsigned char* arena;
+
+    Mutex lock;
+    int next;
+    std::vector<int> inuse;
+    std::list<std::pair<void*, int> > payouts;
+
+    // allocations served from the arena and off the plan since reset
+    size_t hits;
+    size_t misses;
+};
+
+BlobArenaAllocator::BlobArenaAllocator(BlobMemoryPlan* _plan)
+    : Allocator(), plan(_plan)
+{
+    arena = plan->arena_size ? (unsigned char*)ncnn::fastMalloc(plan->arena_size) : 0;
+    next = 0;
+    inuse.resize(plan->sizes.size(), 0);
+    hits = 0;
+    misses = 0;
+}
+
+BlobArenaAllocator::~BlobArenaAllocator()
+{
+    if (!payouts.empty())
+    {
+        NCNN_LOGE("FATAL ERROR! blob arena allocator destroyed too early");
+    }
+
+    ncnn::fastFree(arena);
+}
+
+void BlobArenaAllocator::reset()
+{
+    MutexLockGuard guard(lock);
+
+    next = 0;
+    hits = 0;
+    misses = 0;
+}
+
+void* BlobArenaAllocator::fastMalloc(size_t size)
+{
+    lock.lock();
+
+    const int i = next++;
+    if (i < (int)plan->sizes.size() && size <= plan->sizes[i] && !inuse[i])
+    {
+        // the planned bytes must not be held by any other live blob
+        bool vacant = true;
+        const std::vector<int>& aliases = plan->aliases[i];
+        for (size_t j = 0; j < aliases.size(); j++)
+        {
+            if (inuse[aliases[j]])
+            {
+                vacant = false;
+                break;
+            }
+        }
+
+        if (vacant)
+        {
+            void* ptr = arena + plan->offsets[i];
+
+            inuse[i] = 1;
+            payouts.push_back(std::make_pair(ptr, i));
+            hits++;
+
+            lock.unlock();
+
+            return ptr;
+        }
+    }
+
+    misses++;
+
+    lock.unlock();
+
+    // off the plan
+    return ncnn::fastMalloc(size);
+}
+
+void BlobArenaAllocator::fastFree(void* ptr)
+{
+    if ((unsigned char*)ptr >= arena && (unsigned char*)ptr < arena + plan->arena_size)
+    {
+        MutexLockGuard guard(lock);
+
+        std::list<std::pair<void*, int> >::iterator it = payouts.begin();
+        for (; it != payouts.end(); ++it)
+        {
+            if (it->first == ptr)
+            {
+                inuse[it->second] = 0;
+                payouts.erase(it);
+                return;
+            }
+        }
+
+        NCNN_LOGE("FATAL ERROR! blob arena allocator get wild %p", ptr);
+        return;
+    }
+
+    ncnn::fastFree(ptr);
+}
+
+#if NCNN_STDIO
+// cpu pipeline cache file layout
+//   header, payload size and hash cover everything after it
+//   for each cached layer
+//     int layer_index, int typeindex, int mat count
+//     for each mat: descriptor, zero padding to 64 bytes, raw data
+struct PipelineCacheHeader
+{
+    unsigned int magic;
+    unsigned int version;
+    uint64_t model_hash;
+    unsigned int isa_bits;
+    unsigned int option_bits;
+    unsigned int build_hash;
+    int layer_count;
+    int entry_count;
+    uint64_t payload_size;
+    uint64_t payload_hash;
+};
+
+struct PipelineCacheMatDesc
+{
+    int dims;
+    int w;
+    int h;
+    int d;
+    int c;
+    int elempack;
+    uint64_t elemsize;
+    uint64_t cstep;
+    uint64_t data_size;
+};
+
+static const unsigned int PIPELINE_CACHE_MAGIC = 0x4350434e; // NCPC
+static const unsigned int PIPELINE_CACHE_VERSION = 2;
+static const size_t PIPELINE_CACHE_ALIGN = 64;
+
+static uint64_t fnv1a_hash(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+
+    // fold 8 bytes per step, the tail byte by byte
+    size_t i = 0;
+    for (; i + 7 < size; i += 8)
+    {
+        uint64_t v;
+        memcpy(&v, p + i, 8);
+        hash = (hash ^ v) * 0x100000001b3ULL;
+    }
+    for (; i < size; i++)
+    {
+        hash = (hash ^ p[i]) * 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+// pass-through reader hashing every byte of model data
+class DataReaderHashing : public DataReader
+{
+public:
+    DataReaderHashing(const DataReader& _dr)
+        : dr(_dr), hash(0xcbf29ce484222325ULL)
+    {
+    }
+
+    virtual size_t read(void* buf, size_t size) const
+    {
+        size_t nread = dr.read(buf, size);
+        hash = fnv1a_hash(hash, buf, nread);
+        return nread;
+    }
+
+    virtual size_t reference(size_t size, const void** buf) const
+    {
+        size_t nread = dr.reference(size, buf);
+        if (nread)
+            hash = fnv1a_hash(hash, *buf, nread);
+        return nread;
+    }
+
+    const DataReader& dr;
+    mutable uint64_t hash;
+};
+
+static unsigned int get_pipeline_cache_isa_bits()
+{
+    unsigned int bits = 0;
+    bits |= (cpu_support_x86_avx() ? 1 : 0) << 0;
+    bits |= (cpu_support_x86_fma() ? 1 : 0) << 1;
+    bits |= (cpu_support_x86_f16c() ? 1 : 0) << 2;
+    bits |= (cpu_support_x86_avx2() ? 1 : 0) << 3;
+    bits |= (cpu_support_x86_avx_vnni() ? 1 : 0) << 4;
+    bits |= (cpu_support_x86_avx512() ? 1 : 0) << 5;
+    bits |= (cpu_support_x86_avx512_vnni() ? 1 : 0) << 6;
+    bits |= (cpu_support_x86_avx512_bf16() ? 1 : 0) << 7;
+    bits |= (cpu_support_x86_avx512_fp16() ? 1 : 0) << 8;
+    bits |= (cpu_support_arm_neon() ? 1 : 0) << 9;
+    bits |= (cpu_support_arm_vfpv4() ? 1 : 0) << 10;
+    bits |= (cpu_support_arm_asimdhp() ? 1 : 0) << 11;
+    bits |= (cpu_support_arm_asimddp() ? 1 : 0) << 12;
+    bits |= (cpu_support_arm_bf16() ? 1 : 0) << 13;
+    bits |= (cpu_support_arm_i8mm() ? 1 : 0) << 14;
+    bits |= (cpu_support_mips_msa() ? 1 : 0) << 15;
+    bits |= (cpu_support_loongson_mmi() ? 1 : 0) << 16;
+    bits |= (cpu_support_riscv_v() ? 1 : 0) << 17;
+    bits |= (cpu_support_riscv_zfh() ? 1 : 0) << 18;
+    bits |= (cpu_support_x86_amx_int8() ? 1 : 0) << 19;
+    bits |= (cpu_support_x86_amx_bf16() ? 1 : 0) << 20;
+    return bits;
+}
+
+static unsigned int get_pipeline_cache_option_bits(const Option& opt)
+{
+    // options steering the weight transforms in create_pipeline
+    unsigned int bits = 0;
+    bits |= (opt.use_winograd_convolution ? 1 : 0) << 0;
+    bits |= (opt.use_sgemm_convolution ? 1 : 0) << 1;
+    bits |= (opt.use_int8_inference ? 1 : 0) << 2;
+    bits |= (opt.use_bf16_storage ? 1 : 0) << 3;
+    bits |= (opt.use_fp16_packed ? 1 : 0) << 4;
+    bits |= (opt.use_fp16_storage ? 1 : 0) << 5;
+    bits |= (opt.use_fp16_arithmetic ? 1 : 0) << 6;
+    bits |= (opt.use_int8_packed ? 1 : 0) << 7;
+    bits |= (opt.use_int8_storage ? 1 : 0) << 8;
+    bits |= (opt.use_int8_arithmetic ? 1 : 0) << 9;
+    bits |= (opt.use_packing_layout ? 1 : 0) << 10;
+    bits |= (opt.use_winograd23_convolution ? 1 : 0) << 11;
+    bits |= (opt.use_winograd43_convolution ? 1 : 0) << 12;
+    bits |= (opt.use_winograd63_convolution ? 1 : 0) << 13;
+    bits |= (opt.use_fp16_weight_storage ? 1 : 0) << 14;
+    return bits;
+}
+
+static unsigned int get_pipeline_cache_build_hash()
+{
+    const char* version = NCNN_VERSION_STRING;
+    uint64_t hash = fnv1a_hash(0xcbf29ce484222325ULL, version, strlen(version));
+    return (unsigned int)(hash ^ (hash >> 32));
+}
+#endif // NCNN_STDIO
+
+class BranchWorkerPool;
+
 class NetPrivate
 {
 public:
@@ -49,29 +486,53 @@ public:
 #endif // NCNN_VULKAN
 
     friend class Extractor;
-    int forward_layer(int layer_index, std::vector<Mat>& blob_mats, const Option& opt) const;
+    int forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<Mat>& state_mats, const Option& opt, Profiler* profiler) const;
+    int forward_layer_parallel(int layer_index, std::vector<Mat>& blob_mats, std::vector<Mat>& state_mats, const Option& opt, BranchWorkerPool* pool, Profiler* profiler) const;
+    int forward_layer_batch(int layer_index, std::vector<std::vector<Mat> >& batch_blob_mats, std::vector<std::vector<Mat> >& batch_state_mats, const Option& opt, Profiler* profiler) const;
 
 #if NCNN_VULKAN
-    int forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<VkMat>& blob_mats_gpu, VkCompute& cmd, const Option& opt) const;
-    int forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<VkMat>& blob_mats_gpu, std::vector<VkImageMat>& blob_mats_gpu_image, VkCompute& cmd, const Option& opt) const;
+    int forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<Mat>& state_mats, std::vector<VkMat>& blob_mats_gpu, VkCompute& cmd, const Option& opt) const;
+    int forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<Mat>& state_mats, std::vector<VkMat>& blob_mats_gpu, std::vector<VkImageMat>& blob_mats_gpu_image, VkCompute& cmd, const Option& opt) const;
 #endif // NCNN_VULKAN
 
     int convert_layout(Mat& bottom_blob, const Layer* layer, const Option& opt) const;
 
-    int do_forward_layer(const Layer* layer, std::vector<Mat>& blob_mats, const Option& opt) const;
+    int do_forward_layer(const Layer* layer, std::vector<Mat>& blob_mats, Mat* states, const Option& opt, LayerProfile* profile) const;
+    int profile_forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<Mat>& state_mats, const Option& opt, Profiler* profiler) const;
+    int do_forward_layer_batch(int layer_index, std::vector<std::vector<Mat> >& batch_blob_mats, std::vector<std::vector<Mat> >& batch_state_mats, const Option& opt) const;
 #if NCNN_VULKAN
     int do_forward_layer(const Layer* layer, std::vector<VkMat>& blob_mats_gpu, VkCompute& cmd, const Option& opt) const;
     int do_forward_layer(const Layer* layer, std::vector<VkImageMat>& blob_mats_gpu_image, VkCompute& cmd, const Option& opt) const;
 #endif // NCNN_VULKAN
 
     void update_input_output_indexes();
+    void update_state_offsets();
+
+    // the state mats of layer_index in state_mats, null for stateless layer
+    Mat* get_layer_states(int layer_index, std::vector<Mat>& state_mats) const;
 #if NCNN_STRING
     void update_input_output_names();
 #endif // NCNN_STRING
 
+    int create_layer_pipeline(int layer_index, const Option& opt);
+    int create_pipeline_parallel(const Option& opt);
+
+#if NCNN_STDIO
+    void match_pipeline_cache(const Option& opt);
+    void clear_pipeline_cache();
+#endif // NCNN_STDIO
+
+    BlobArenaAllocator* acquire_arena_allocator();
+    void reclaim_arena_allocator(BlobArenaAllocator* allocator);
+    void clear_memory_plan();
+
     std::vector<Blob> blobs;
     std::vector<Layer*> layers;
 
+    // first slot of each layer in the extractor state mats, -1 for stateless layer
+    std::vector<int> layer_state_offsets;
+    int state_mat_count;
+
     std::vector<int> input_blob_indexes;
     std::vector<int> output_blob_indexes;
 #if NCNN_STRING
@@ -84,6 +545,26 @@ public:
     PoolAllocator* local_blob_allocator;
     PoolAllocator* local_workspace_allocator;
 
+    // static blob memory plan
+    BlobMemoryPlan* memory_plan;
+    Mutex arena_allocators_lock;
+    std::vector<BlobArenaAllocator*> arena_allocators;
+    std::vector<BlobArenaAllocator*> idle_arena_allocators;
+    // arenas of a dropped plan still held by extractors, deleted on reclaim
+    std::vector<BlobArenaAllocator*> retired_arena_allocators;
+
+#if NCNN_STDIO
+    // cpu pipeline cache
+    bool use_pipeline_cache;
+    // set once load_model ran, the layers may alias the mapped cache from then on
+    bool model_loaded;
+    uint64_t model_hash;
+    DataReaderFromMmap* pipeline_cache_mmap;
+    PipelineCacheHeader pipeline_cache_header;
+    std::vector<int> cached_pipeline_typeindex;
+    std::vector<std::vector<Mat> > cached_pipeline_data;
+#endif // NCNN_STDIO
+
 #if NCNN_VULKAN
     const VulkanDevice* vkdev;
 
@@ -94,12 +575,86 @@ public:
 #endif // NCNN_VULKAN
 };
 
+// header-only copy of blob geometry, never holds a reference to the data
+static Mat get_profile_shape(const Mat& m)
+{
+    Mat shape;
+    shape.dims = m.dims;
+    shape.w = m.w;
+    shape.h = m.h;
+    shape.d = m.d;
+    shape.c = m.c;
+    shape.elemsize = m.elemsize;
+    shape.elempack = m.elempack;
+    shape.cstep = m.cstep;
+    return shape;
+}
+
+static void init_layer_profile(LayerProfile& profile, int layer_index, const Layer* layer)
+{
+    profile.layer_index = layer_index;
+    profile.typeindex = layer->typeindex;
+#if NCNN_STRING
+    profile.type = layer->type;
+    profile.name = layer->name;
+#endif // NCNN_STRING
+}
+
+static void profile_bottom_blob(LayerProfile& profile, int bottom, const Mat& bottom_blob_ref, const Mat& bottom_blob)
+{
+    profile.bottom_shapes.push_back(get_profile_shape(bottom_blob));
+
+    if (bottom_blob.data == bottom_blob_ref.data)
+        return;
+
+    // deep copy or layout conversion allocated a new blob
+    profile.bytes_allocated += bottom_blob.total() * bottom_blob.elemsize;
+
+    const int from_elembits = bottom_blob_ref.elembits();
+    const int to_elembits = bottom_blob.elembits();
+    if (bottom_blob_ref.elempack != bottom_blob.elempack || from_elembits != to_elembits)
+    {
+        LayoutConversion conversion;
+        conversion.bottom = bottom;
+        conversion.from_elembits = from_elembits;
+        conversion.from_elempack = bottom_blob_ref.elempack;
+        conversion.to_elembits = to_elembits;
+        conversion.to_elempack = bottom_blob.elempack;
+        profile.conversions.push_back(conversion);
+    }
+}
+
+static void profile_top_blob(LayerProfile& profile, const Mat& top_blob, const Mat* bottom_blob_refs, size_t bottom_count)
+{
+    profile.top_shapes.push_back(get_profile_shape(top_blob));
+
+    // inplace and passthrough tops reuse the bottom storage
+    for (size_t i = 0; i < bottom_count; i++)
+    {
+        if (top_blob.data == bottom_blob_refs[i].data)
+            return;
+    }
+
+    profile.bytes_allocated += top_blob.total() * top_blob.elemsize;
+}
+
 NetPrivate::NetPrivate(Option& _opt)
     : opt(_opt)
 {
     local_blob_allocator = 0;
     local_workspace_allocator = 0;
 
+    memory_plan = 0;
+
+    state_mat_count = 0;
+
+#if NCNN_STDIO
+    use_pipeline_cache = false;
+    model_loaded = false;
+    model_hash = 0;
+    pipeline_cache_mmap = 0;
+#endif // NCNN_STDIO
+
 #if NCNN_VULKAN
     vkdev = 0;
     weight_vkallocator = 0;
@@ -108,118 +663,613 @@ NetPrivate::NetPrivate(Option& _opt)
 #endif // NCNN_VULKAN
 }
 
+int NetPrivate::create_layer_pipeline(int layer_index, const Option& opt)
+{
+    Layer* layer = layers[layer_index];
+
+#if NCNN_STDIO
+    if (layer_index < (int)cached_pipeline_data.size() && !cached_pipeline_data[layer_index].empty())
+    {
+        // skip the weight transforms with cached pipeline data
+        if (layer->load_pipeline(cached_pipeline_data[layer_index], opt) == 0)
+            return 0;
+    }
+#endif // NCNN_STDIO
+
+    return layer->create_pipeline(opt);
+}
+
+#if NCNN_STDIO
+void NetPrivate::match_pipeline_cache(const Option& opt)
+{
+    if (!pipeline_cache_mmap)
+        return;
+
+    const PipelineCacheHeader& header = pipeline_cache_header;
+
+    if (header.model_hash != model_hash || header.layer_count != (int)layers.size()
+            || header.isa_bits != get_pipeline_cache_isa_bits()
+            || header.option_bits != get_pipeline_cache_option_bits(opt)
+            || header.build_hash != get_pipeline_cache_build_hash())
+    {
+        NCNN_LOGE("pipeline cache does not match the model, ignored");
+        cached_pipeline_data.clear();
+        return;
+    }
+
+    for (size_t i = 0; i < cached_pipeline_data.size(); i++)
+    {
+        if (!cached_pipeline_data[i].empty() && cached_pipeline_typeindex[i] != layers[i]->typeindex)
+        {
+            NCNN_LOGE("pipeline cache does not match the layer %d type, ignored", (int)i);
+            cached_pipeline_data[i].clear();
+        }
+    }
+}
+
+void NetPrivate::clear_pipeline_cache()
+{
+    cached_pipeline_typeindex.clear();
+    cached_pipeline_data.clear();
+
+    delete pipeline_cache_mmap;
+    pipeline_cache_mmap = 0;
+}
+#endif // NCNN_STDIO
+
+// worker pool creating layer pipelines concurrently
+class PipelineCreator
+{
+public:
+    void run();
+
+public:
+    NetPrivate* net;
+    const Option* opt;
+    int num_workers;
+
+    Mutex lock;
+    int next;
+    std::vector<int> rets;
+};
+
+void PipelineCreator::run()
+{
+    const int layer_count = (int)net->layers.size();
+
+    for (;;)
+    {
+        lock.lock();
+        const int i = next++;
+        lock.unlock();
+
+        if (i >= layer_count)
+            break;
+
+        // custom layers were never required to be thread-safe, they are created afterwards
+        if (net->layers[i]->typeindex & LayerType::CustomBit)
+            continue;
+
+        // hand the spare threads to the last layers once the queue drains
+        Option opt1 = *opt;
+        opt1.num_threads = std::max(1, opt->num_threads / std::min(num_workers, layer_count - i));
+
+        // user allocators such as UnlockedPoolAllocator are not safe to share between the workers,
+        // transformed weights outlive the pipeline creation and belong to the default allocator anyway
+        opt1.blob_allocator = 0;
+        opt1.workspace_allocator = 0;
+
+        rets[i] = net->create_layer_pipeline(i, opt1);
+    }
+}
+
+static void* pipeline_creator_worker(void* args)
+{
+    PipelineCreator* creator = (PipelineCreator*)args;
+    creator->run();
+    return 0;
+}
+
+int NetPrivate::create_pipeline_parallel(const Option& opt)
+{
+    const int layer_count = (int)layers.size();
+
+    PipelineCreator creator;
+    creator.net = this;
+    creator.opt = &opt;
+    creator.num_workers = std::min(opt.num_threads, layer_count);
+    creator.next = 0;
+    creator.rets.resize(layer_count, 0);
+
+    std::vector<Thread*> workers;
+    for (int i = 1; i < creator.num_workers; i++)
+    {
+        workers.push_back(new Thread(pipeline_creator_worker, &creator));
+    }
+
+    // the calling thread works too
+    creator.run();
+
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i]->join();
+        delete workers[i];
+    }
+
+    // custom layers one by one on the calling thread
+    for (int i = 0; i < layer_count; i++)
+    {
+        if (layers[i]->typeindex & LayerType::CustomBit)
+        {
+            creator.rets[i] = create_layer_pipeline(i, opt);
+        }
+    }
+
+    // report failures in layer order regardless of completion order
+    int ret = 0;
+    for (int i = 0; i < layer_count; i++)
+    {
+        if (creator.rets[i] != 0)
+        {
+#if NCNN_STRING
+            NCNN_LOGE("layer create_pipeline %d %s failed", i, layers[i]->name.c_str());
+#else
+            NCNN_LOGE("layer create_pipeline %d failed", i);
+#endif
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
 #if NCNN_VULKAN
 int NetPrivate::upload_model()
 {
-    ncnn::VkTransfer cmd(vkdev);
+    ncnn::VkTransfer cmd(vkdev);
+
+    // create gpu device allocator if null
+    if (!weight_vkallocator)
+    {
+        weight_vkallocator = new VkWeightAllocator(vkdev);
+    }
+    if (!weight_staging_vkallocator)
+    {
+        weight_staging_vkallocator = new VkWeightStagingAllocator(vkdev);
+    }
+
+    Option opt_upload = opt;
+    opt_upload.blob_vkallocator = weight_vkallocator;
+    opt_upload.workspace_vkallocator = weight_vkallocator;
+    opt_upload.staging_vkallocator = weight_staging_vkallocator;
+
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        if (layers[i]->support_vulkan)
+        {
+            int uret = layers[i]->upload_model(cmd, opt_upload);
+            if (uret != 0)
+            {
+                NCNN_LOGE("layer upload_model %d failed", (int)i);
+                return -1;
+            }
+        }
+    }
+
+    cmd.submit_and_wait();
+
+    return 0;
+}
+#endif // NCNN_VULKAN
+
+int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<Mat>& state_mats, const Option& opt, Profiler* profiler) const
+{
+    const Layer* layer = layers[layer_index];
+
+    //     NCNN_LOGE("forward_layer %d %s", layer_index, layer->name.c_str());
+
+    if (layer->one_blob_only)
+    {
+        // load bottom blob
+        int bottom_blob_index = layer->bottoms[0];
+
+        if (blob_mats[bottom_blob_index].dims == 0)
+        {
+            int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, state_mats, opt, profiler);
+            if (ret != 0)
+                return ret;
+        }
+    }
+    else
+    {
+        // load bottom blobs
+        for (size_t i = 0; i < layer->bottoms.size(); i++)
+        {
+            int bottom_blob_index = layer->bottoms[i];
+
+            if (blob_mats[bottom_blob_index].dims == 0)
+            {
+                int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, state_mats, opt, profiler);
+                if (ret != 0)
+                    return ret;
+            }
+        }
+    }
+
+#if NCNN_BENCHMARK
+    double start = get_current_time();
+    Mat bottom_blob;
+    if (layer->one_blob_only)
+    {
+        int bottom_blob_index = layer->bottoms[0];
+        bottom_blob.dims = blob_mats[bottom_blob_index].dims;
+        bottom_blob.w = blob_mats[bottom_blob_index].w;
+        bottom_blob.h = blob_mats[bottom_blob_index].h;
+        bottom_blob.c = blob_mats[bottom_blob_index].c;
+        bottom_blob.elempack = blob_mats[bottom_blob_index].elempack;
+        bottom_blob.elemsize = blob_mats[bottom_blob_index].elemsize;
+    }
+#endif
+    int ret = profiler ? profile_forward_layer(layer_index, blob_mats, state_mats, opt, profiler) : do_forward_layer(layer, blob_mats, get_layer_states(layer_index, state_mats), opt, 0);
+#if NCNN_BENCHMARK
+    double end = get_current_time();
+    if (layer->one_blob_only)
+    {
+        int top_blob_index = layer->tops[0];
+        benchmark(layer, bottom_blob, blob_mats[top_blob_index], start, end);
+    }
+    else
+    {
+        benchmark(layer, start, end);
+    }
+#endif
+    if (ret != 0)
+        return ret;
+
+    //     NCNN_LOGE("forward_layer %d %s done", layer_index, layer->name.c_str());
+    //     const Mat& blob = blob_mats[layer->tops[0]];
+    //     NCNN_LOGE("[%-2d %-16s %-16s]  %d    blobs count = %-3d   size = %-3d x %-3d", layer_index, layer->type.c_str(), layer->name.c_str(), layer->tops[0], blob.c, blob.h, blob.w);
+
+    return 0;
+}
+
+// ready-queue scheduler running independent layers concurrently
+class LayerScheduler
+{
+public:
+    void run();
+
+public:
+    const NetPrivate* net;
+    std::vector<Mat>* blob_mats;
+    std::vector<Mat>* state_mats;
+    const Option* opt;
+    int num_workers;
+    Profiler* profiler;
+
+    Mutex lock;
+    ConditionVariable condition;
+
+    // layers whose bottom blobs are all ready
+    std::vector<int> ready;
+    // count of unfinished producers per layer, -1 for layers not needed
+    std::vector<int> pending;
+    std::vector<std::vector<int> > consumers;
+    int remaining;
+    int running;
+    int ret;
+};
+
+void LayerScheduler::run()
+{
+    set_kmp_blocktime(opt->openmp_blocktime);
+    set_flush_denormals(opt->flush_denormals);
+
+    lock.lock();
+    for (;;)
+    {
+        while (ready.empty() && remaining > 0 && running > 0 && ret == 0)
+        {
+            condition.wait(lock);
+        }
+
+        if (remaining == 0 || ret != 0)
+            break;
+
+        if (ready.empty())
+        {
+            NCNN_LOGE("layer scheduler stalled with %d layers remaining", remaining);
+            ret = -1;
+            condition.broadcast();
+            break;
+        }
+
+        const int layer_index = ready[ready.size() - 1];
+        ready.resize(ready.size() - 1);
+        running++;
+
+        // split the thread budget among the layers running at the same time
+        Option opt_layer = *opt;
+        opt_layer.num_threads = std::max(1, opt->num_threads / std::min(num_workers, running + (int)ready.size()));
+
+        lock.unlock();
+
+        const Layer* layer = net->layers[layer_index];
+#if NCNN_BENCHMARK
+        double start = get_current_time();
+#endif
+        int lret = profiler ? net->profile_forward_layer(layer_index, *blob_mats, *state_mats, opt_layer, profiler) : net->do_forward_layer(layer, *blob_mats, net->get_layer_states(layer_index, *state_mats), opt_layer, 0);
+#if NCNN_BENCHMARK
+        double end = get_current_time();
+        benchmark(layer, start, end);
+#endif
+
+        lock.lock();
+
+        running--;
+        remaining--;
+
+        if (lret != 0)
+        {
+            ret = lret;
+        }
+        else
+        {
+            const std::vector<int>& layer_consumers = consumers[layer_index];
+            for (size_t i = 0; i < layer_consumers.size(); i++)
+            {
+                int consumer = layer_consumers[i];
+                pending[consumer]--;
+                if (pending[consumer] == 0)
+                {
+                    ready.push_back(consumer);
+                }
+            }
+        }
+
+        condition.broadcast();
+    }
+    lock.unlock();
+}
+
+// threads kept alive by an extractor, every inference hands them a new scheduler
+class BranchWorkerPool
+{
+public:
+    BranchWorkerPool(int num_workers);
+    ~BranchWorkerPool();
+
+    // run the scheduler on the calling thread and all pool threads
+    // return when every thread is done with it
+    void run(LayerScheduler* scheduler);
+
+    // pool threads plus the calling thread
+    int num_workers() const;
+
+    void work();
+
+public:
+    std::vector<Thread*> threads;
+
+    Mutex lock;
+    ConditionVariable condition;
+
+    LayerScheduler* scheduler;
+    int generation;
+    int busy;
+    bool quit;
+};
+
+static void* branch_worker(void* args)
+{
+    BranchWorkerPool* pool = (BranchWorkerPool*)args;
+    pool->work();
+    return 0;
+}
+
+BranchWorkerPool::BranchWorkerPool(int num_workers)
+    : scheduler(0), generation(0), busy(0), quit(false)
+{
+#if NCNN_THREADS
+    // the calling thread is the first worker
+    for (int i = 1; i < num_workers; i++)
+    {
+        threads.push_back(new Thread(branch_worker, this));
+    }
+#else
+    (void)num_workers;
+#endif // NCNN_THREADS
+}
+
+BranchWorkerPool::~BranchWorkerPool()
+{
+    lock.lock();
+    quit = true;
+    condition.broadcast();
+    lock.unlock();
+
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i]->join();
+        delete threads[i];
+    }
+}
+
+void BranchWorkerPool::run(LayerScheduler* _scheduler)
+{
+    lock.lock();
+    scheduler = _scheduler;
+    generation++;
+    busy = (int)threads.size();
+    condition.broadcast();
+    lock.unlock();
+
+    _scheduler->run();
+
+    lock.lock();
+    while (busy > 0)
+    {
+        condition.wait(lock);
+    }
+    scheduler = 0;
+    lock.unlock();
+}
+
+int BranchWorkerPool::num_workers() const
+{
+    return (int)threads.size() + 1;
+}
+
+void BranchWorkerPool::work()
+{
+    int seen_generation = 0;
 
-    // create gpu device allocator if null
-    if (!weight_vkallocator)
+    lock.lock();
+    for (;;)
     {
-        weight_vkallocator = new VkWeightAllocator(vkdev);
+        while (!quit && generation == seen_generation)
+        {
+            condition.wait(lock);
+        }
+
+        if (quit)
+            break;
+
+        seen_generation = generation;
+        LayerScheduler* s = scheduler;
+
+        lock.unlock();
+
+        s->run();
+
+        lock.lock();
+
+        busy--;
+        if (busy == 0)
+            condition.broadcast();
     }
-    if (!weight_staging_vkallocator)
+    lock.unlock();
+}
+
+int NetPrivate::forward_layer_parallel(int layer_index, std::vector<Mat>& blob_mats, std::vector<Mat>& state_mats, const Option& opt, BranchWorkerPool* pool, Profiler* profiler) const
+{
+    LayerScheduler scheduler;
+    scheduler.net = this;
+    scheduler.blob_mats = &blob_mats;
+    scheduler.state_mats = &state_mats;
+    scheduler.opt = &opt;
+    scheduler.profiler = profiler;
+    scheduler.remaining = 0;
+    scheduler.running = 0;
+    scheduler.ret = 0;
+
+    const int layer_count = (int)layers.size();
+    scheduler.pending.resize(layer_count, -1);
+    scheduler.consumers.resize(layer_count);
+
+    // walk back from the requested layer and count the producers not run yet
+    std::vector<int> stack(1, layer_index);
+    scheduler.pending[layer_index] = 0;
+    while (!stack.empty())
     {
-        weight_staging_vkallocator = new VkWeightStagingAllocator(vkdev);
-    }
+        const int i = stack[stack.size() - 1];
+        stack.resize(stack.size() - 1);
 
-    Option opt_upload = opt;
-    opt_upload.blob_vkallocator = weight_vkallocator;
-    opt_upload.workspace_vkallocator = weight_vkallocator;
-    opt_upload.staging_vkallocator = weight_staging_vkallocator;
+        scheduler.remaining++;
 
-    for (size_t i = 0; i < layers.size(); i++)
-    {
-        if (layers[i]->support_vulkan)
+        const Layer* layer = layers[i];
+        for (size_t j = 0; j < layer->bottoms.size(); j++)
         {
-            int uret = layers[i]->upload_model(cmd, opt_upload);
-            if (uret != 0)
+            int bottom_blob_index = layer->bottoms[j];
+            if (blob_mats[bottom_blob_index].dims != 0)
+                continue;
+
+            int producer = blobs[bottom_blob_index].producer;
+            scheduler.consumers[producer].push_back(i);
+            scheduler.pending[i]++;
+
+            if (scheduler.pending[producer] == -1)
             {
-                NCNN_LOGE("layer upload_model %d failed", (int)i);
-                return -1;
+                scheduler.pending[producer] = 0;
+                stack.push_back(producer);
             }
         }
     }
 
-    cmd.submit_and_wait();
+    for (int i = layer_count - 1; i >= 0; i--)
+    {
+        if (scheduler.pending[i] == 0)
+            scheduler.ready.push_back(i);
+    }
 
-    return 0;
+    scheduler.num_workers = std::min(pool->num_workers(), scheduler.remaining);
+
+    pool->run(&scheduler);
+
+    return scheduler.ret;
 }
-#endif // NCNN_VULKAN
 
-int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, const Option& opt) const
+int NetPrivate::forward_layer_batch(int layer_index, std::vector<std::vector<Mat> >& batch_blob_mats, std::vector<std::vector<Mat> >& batch_state_mats, const Option& opt, Profiler* profiler) const
 {
     const Layer* layer = layers[layer_index];
 
-    //     NCNN_LOGE("forward_layer %d %s", layer_index, layer->name.c_str());
+    // all samples walk the graph in lockstep, so sample 0 tells which blobs are ready
+    const std::vector<Mat>& blob_mats = batch_blob_mats[0];
 
-    if (layer->one_blob_only)
+    for (size_t i = 0; i < layer->bottoms.size(); i++)
     {
-        // load bottom blob
-        int bottom_blob_index = layer->bottoms[0];
+        int bottom_blob_index = layer->bottoms[i];
 
         if (blob_mats[bottom_blob_index].dims == 0)
         {
-            int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, opt);
+            int ret = forward_layer_batch(blobs[bottom_blob_index].producer, batch_blob_mats, batch_state_mats, opt, profiler);
             if (ret != 0)
                 return ret;
         }
     }
-    else
+
+    // batched forward records the timing and the blob shapes of the first sample
+    LayerProfile profile;
+    if (profiler)
     {
-        // load bottom blobs
+        init_layer_profile(profile, layer_index, layer);
+
         for (size_t i = 0; i < layer->bottoms.size(); i++)
         {
-            int bottom_blob_index = layer->bottoms[i];
-
-            if (blob_mats[bottom_blob_index].dims == 0)
-            {
-                int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, opt);
-                if (ret != 0)
-                    return ret;
-            }
+            profile.bottom_shapes.push_back(get_profile_shape(blob_mats[layer->bottoms[i]]));
         }
+
+        profile.start = get_current_time();
     }
 
 #if NCNN_BENCHMARK
     double start = get_current_time();
-    Mat bottom_blob;
-    if (layer->one_blob_only)
-    {
-        int bottom_blob_index = layer->bottoms[0];
-        bottom_blob.dims = blob_mats[bottom_blob_index].dims;
-        bottom_blob.w = blob_mats[bottom_blob_index].w;
-        bottom_blob.h = blob_mats[bottom_blob_index].h;
-        bottom_blob.c = blob_mats[bottom_blob_index].c;
-        bottom_blob.elempack = blob_mats[bottom_blob_index].elempack;
-        bottom_blob.elemsize = blob_mats[bottom_blob_index].elemsize;
-    }
 #endif
-    int ret = do_forward_layer(layer, blob_mats, opt);
+    int ret = do_forward_layer_batch(layer_index, batch_blob_mats, batch_state_mats, opt);
 #if NCNN_BENCHMARK
     double end = get_current_time();
-    if (layer->one_blob_only)
-    {
-        int top_blob_index = layer->tops[0];
-        benchmark(layer, bottom_blob, blob_mats[top_blob_index], start, end);
-    }
-    else
-    {
-        benchmark(layer, start, end);
-    }
+    benchmark(layer, start, end);
 #endif
     if (ret != 0)
         return ret;
 
-    //     NCNN_LOGE("forward_layer %d %s done", layer_index, layer->name.c_str());
-    //     const Mat& blob = blob_mats[layer->tops[0]];
-    //     NCNN_LOGE("[%-2d %-16s %-16s]  %d    blobs count = %-3d   size = %-3d x %-3d", layer_index, layer->type.c_str(), layer->name.c_str(), layer->tops[0], blob.c, blob.h, blob.w);
+    if (profiler)
+    {
+        profile.end = get_current_time();
+
+        for (size_t i = 0; i < layer->tops.size(); i++)
+        {
+            profile.top_shapes.push_back(get_profile_shape(blob_mats[layer->tops[i]]));
+        }
+
+        profiler->record(profile);
+    }
 
     return 0;
 }
 
 #if NCNN_VULKAN
-int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<VkMat>& blob_mats_gpu, VkCompute& cmd, const Option& opt) const
+int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<Mat>& state_mats, std::vector<VkMat>& blob_mats_gpu, VkCompute& cmd, const Option& opt) const
 {
     const Layer* layer = layers[layer_index];
 
@@ -234,7 +1284,7 @@ int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, std:
 
         if (blob_mats_gpu[bottom_blob_index].dims == 0 && blob_mats[bottom_blob_index].dims == 0)
         {
-            int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, blob_mats_gpu, cmd, opt);
+            int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, state_mats, blob_mats_gpu, cmd, opt);
             if (ret != 0)
                 return ret;
         }
@@ -283,7 +1333,7 @@ int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, std:
 
             if (blob_mats_gpu[bottom_blob_index].dims == 0 && blob_mats[bottom_blob_index].dims == 0)
             {
-                int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, blob_mats_gpu, cmd, opt);
+                int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, state_mats, blob_mats_gpu, cmd, opt);
                 if (ret != 0)
                     return ret;
             }
@@ -368,7 +1418,7 @@ int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, std:
             bottom_blob = blob_mats[bottom_blob_index].shape();
         }
 #endif
-        ret = do_forward_layer(layer, blob_mats, opt);
+        ret = do_forward_layer(layer, blob_mats, get_layer_states(layer_index, state_mats), opt, 0);
 #if NCNN_BENCHMARK
         double end = get_current_time();
         if (layer->one_blob_only)
@@ -390,7 +1440,7 @@ int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, std:
     return 0;
 }
 
-int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<VkMat>& blob_mats_gpu, std::vector<VkImageMat>& blob_mats_gpu_image, VkCompute& cmd, const Option& opt) const
+int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<Mat>& state_mats, std::vector<VkMat>& blob_mats_gpu, std::vector<VkImageMat>& blob_mats_gpu_image, VkCompute& cmd, const Option& opt) const
 {
     const Layer* layer = layers[layer_index];
 
@@ -417,7 +1467,7 @@ IMAGE_ALLOCATION_FAILED:
 
         if (blob_mats_gpu_image[bottom_blob_index].dims == 0 && blob_mats_gpu[bottom_blob_index].dims == 0 && blob_mats[bottom_blob_index].dims == 0)
         {
-            int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, blob_mats_gpu, blob_mats_gpu_image, cmd, opt);
+            int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, state_mats, blob_mats_gpu, blob_mats_gpu_image, cmd, opt);
             if (ret != 0)
                 return ret;
         }
@@ -536,7 +1586,7 @@ IMAGE_ALLOCATION_FAILED:
 
             if (blob_mats_gpu_image[bottom_blob_index].dims == 0 && blob_mats_gpu[bottom_blob_index].dims == 0 && blob_mats[bottom_blob_index].dims == 0)
             {
-                int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, blob_mats_gpu, blob_mats_gpu_image, cmd, opt);
+                int ret = forward_layer(blobs[bottom_blob_index].producer, blob_mats, state_mats, blob_mats_gpu, blob_mats_gpu_image, cmd, opt);
                 if (ret != 0)
                     return ret;
             }
@@ -703,7 +1753,7 @@ IMAGE_ALLOCATION_FAILED:
             bottom_blob = blob_mats[bottom_blob_index].shape();
         }
 #endif
-        ret = do_forward_layer(layer, blob_mats, opt);
+        ret = do_forward_layer(layer, blob_mats, get_layer_states(layer_index, state_mats), opt, 0);
 #if NCNN_BENCHMARK
         double end = get_current_time();
         if (layer->one_blob_only)
@@ -867,7 +1917,17 @@ int NetPrivate::convert_layout(Mat& bottom_blob, const Layer* layer, const Optio
     return 0;
 }
 
-int NetPrivate::do_forward_layer(const Layer* layer, std::vector<Mat>& blob_mats, const Option& opt) const
+// states outlive this inference while the blob allocator may be an arena or a pool recycled after it
+// so a state top taken from an allocator moves onto the default one, graph tops stay where they are
+static Mat detach_state(const Mat& state)
+{
+    if (!state.allocator)
+        return state;
+
+    return state.clone();
+}
+
+int NetPrivate::do_forward_layer(const Layer* layer, std::vector<Mat>& blob_mats, Mat* states, const Option& opt, LayerProfile* profile) const
 {
     if (layer->one_blob_only)
     {
@@ -892,6 +1952,12 @@ int NetPrivate::do_forward_layer(const Layer* layer, std::vector<Mat>& blob_mats
 
         convert_layout(bottom_blob, layer, opt);
 
+        if (profile)
+        {
+            profile_bottom_blob(*profile, bottom_blob_index, bottom_blob_ref, bottom_blob);
+            profile->kernel = layer->kernel_path(bottom_blob, opt);
+        }
+
         // forward
         if (opt.lightmode && layer->support_inplace)
         {
@@ -914,6 +1980,12 @@ int NetPrivate::do_forward_layer(const Layer* layer, std::vector<Mat>& blob_mats
             blob_mats[top_blob_index] = top_blob;
         }
 
+        if (profile)
+        {
+            const Mat bottom_blob_refs[2] = {bottom_blob_ref, bottom_blob};
+            profile_top_blob(*profile, blob_mats[top_blob_index], bottom_blob_refs, 2);
+        }
+
         if (opt.lightmode)
         {
             // delete after taken in light mode
@@ -944,10 +2016,47 @@ int NetPrivate::do_forward_layer(const Layer* layer, std::vector<Mat>& blob_mats
             }
 
             convert_layout(bottom_blobs[i], layer, opt);
+
+            if (profile)
+            {
+                profile_bottom_blob(*profile, bottom_blob_index, bottom_blob_ref, bottom_blobs[i]);
+            }
+        }
+
+        if (profile && !bottom_blobs.empty())
+        {
+            profile->kernel = layer->kernel_path(bottom_blobs[0], opt);
         }
 
         // forward
-        if (opt.lightmode && layer->support_inplace)
+        if (states)
+        {
+            // the carried states follow the graph blobs
+            for (int i = 0; i < layer->state_count; i++)
+            {
+                bottom_blobs.push_back(states[i]);
+            }
+
+            std::vector<Mat> top_blobs(layer->tops.size() + layer->state_count);
+            int ret = layer->forward(bottom_blobs, top_blobs, opt);
+            if (ret != 0)
+                return ret;
+
+            // store top blobs
+            for (size_t i = 0; i < layer->tops.size(); i++)
+            {
+                int top_blob_index = layer->tops[i];
+
+                blob_mats[top_blob_index] = top_blobs[i];
+            }
+
+            // store states for the next forward
+            for (int i = 0; i < layer->state_count; i++)
+            {
+                states[i] = detach_state(top_blobs[layer->tops.size() + i]);
+            }
+        }
+        else if (opt.lightmode && layer->support_inplace)
         {
             std::vector<Mat>& bottom_top_blobs = bottom_blobs;
             int ret = layer->forward_inplace(bottom_top_blobs, opt);
@@ -978,6 +2087,21 @@ int NetPrivate::do_forward_layer(const Layer* layer, std::vector<Mat>& blob_mats
             }
         }
 
+        if (profile)
+        {
+            // tops may alias either the stored bottoms or their converted copies
+            std::vector<Mat> bottom_blob_refs(bottom_blobs);
+            for (size_t i = 0; i < layer->bottoms.size(); i++)
+            {
+                bottom_blob_refs.push_back(blob_mats[layer->bottoms[i]]);
+            }
+
+            for (size_t i = 0; i < layer->tops.size(); i++)
+            {
+                profile_top_blob(*profile, blob_mats[layer->tops[i]], bottom_blob_refs.data(), bottom_blob_refs.size());
+            }
+        }
+
         for (size_t i = 0; i < layer->bottoms.size(); i++)
         {
             int bottom_blob_index = layer->bottoms[i];
@@ -993,6 +2117,135 @@ int NetPrivate::do_forward_layer(const Layer* layer, std::vector<Mat>& blob_mats
     return 0;
 }
 
+int NetPrivate::profile_forward_layer(int layer_index, std::vector<Mat>& blob_mats, std::vector<Mat>& state_mats, const Option& opt, Profiler* profiler) const
+{
+    const Layer* layer = layers[layer_index];
+
+    LayerProfile profile;
+    init_layer_profile(profile, layer_index, layer);
+
+    profile.start = get_current_time();
+    int ret = do_forward_layer(layer, blob_mats, get_layer_states(layer_index, state_mats), opt, &profile);
+    profile.end = get_current_time();
+
+    if (ret != 0)
+        return ret;
+
+    profiler->record(profile);
+
+    return 0;
+}
+
+int NetPrivate::do_forward_layer_batch(int layer_index, std::vector<std::vector<Mat> >& batch_blob_mats, std::vector<std::vector<Mat> >& batch_state_mats, const Option& opt) const
+{
+    const Layer* layer = layers[layer_index];
+
+    const int batch = (int)batch_blob_mats.size();
+
+    if (layer->state_count > 0)
+    {
+        // step the independent streams together, each one carries its own states
+        std::vector<std::vector<Mat> > bottom_blobs(batch);
+        std::vector<std::vector<Mat> > top_blobs(batch);
+        for (int b = 0; b < batch; b++)
+        {
+            Mat* states = get_layer_states(layer_index, batch_state_mats[b]);
+
+            for (size_t i = 0; i < layer->bottoms.size(); i++)
+            {
+                Mat bottom_blob = batch_blob_mats[b][layer->bottoms[i]];
+
+                convert_layout(bottom_blob, layer, opt);
+
+                bottom_blobs[b].push_back(bottom_blob);
+            }
+
+            for (int i = 0; i < layer->state_count; i++)
+            {
+                bottom_blobs[b].push_back(states[i]);
+            }
+
+            top_blobs[b].resize(layer->tops.size() + layer->state_count);
+        }
+
+        int ret = layer->forward_batch(bottom_blobs, top_blobs, opt);
+        if (ret != 0)
+            return ret;
+
+        for (int b = 0; b < batch; b++)
+        {
+            Mat* states = get_layer_states(layer_index, batch_state_mats[b]);
+
+            // store top blobs
+            for (size_t i = 0; i < layer->tops.size(); i++)
+            {
+                batch_blob_mats[b][layer->tops[i]] = top_blobs[b][i];
+            }
+
+            // store states for the next forward
+            for (int i = 0; i < layer->state_count; i++)
+            {
+                states[i] = detach_state(top_blobs[b][layer->tops.size() + i]);
+            }
+
+            if (opt.lightmode)
+            {
+                // delete after taken in light mode
+                for (size_t i = 0; i < layer->bottoms.size(); i++)
+                {
+                    batch_blob_mats[b][layer->bottoms[i]].release();
+                }
+            }
+        }
+
+        return 0;
+    }
+
+    if (!layer->one_blob_only || (opt.lightmode && layer->support_inplace))
+    {
+        // run sample by sample
+        for (int b = 0; b < batch; b++)
+        {
+            int ret = do_forward_layer(layer, batch_blob_mats[b], get_layer_states(layer_index, batch_state_mats[b]), opt, 0);
+            if (ret != 0)
+                return ret;
+        }
+
+        return 0;
+    }
+
+    int bottom_blob_index = layer->bottoms[0];
+    int top_blob_index = layer->tops[0];
+
+    std::vector<Mat> bottom_blobs(batch);
+    for (int b = 0; b < batch; b++)
+    {
+        bottom_blobs[b] = batch_blob_mats[b][bottom_blob_index];
+
+        convert_layout(bottom_blobs[b], layer, opt);
+    }
+
+    // forward
+    std::vector<Mat> top_blobs(batch);
+    int ret = layer->forward_batch(bottom_blobs, top_blobs, opt);
+    if (ret != 0)
+        return ret;
+
+    for (int b = 0; b < batch; b++)
+    {
+        // store top blob
+        batch_blob_mats[b][top_blob_index] = top_blobs[b];
+
+        if (opt.lightmode)
+        {
+            // delete after taken in light mode
+            batch_blob_mats[b][bottom_blob_index].release();
+        }
+    }
+
+    return 0;
+}
+
 #if NCNN_VULKAN
 int NetPrivate::do_forward_layer(const Layer* layer, std::vector<VkMat>& blob_mats_gpu, VkCompute& cmd, const Option& opt) const
 {
@@ -1269,6 +2522,110 @@ void NetPrivate::update_input_output_indexes()
     }
 }
 
+void NetPrivate::update_state_offsets()
+{
+    layer_state_offsets.resize(layers.size());
+    state_mat_count = 0;
+
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        if (layers[i]->state_count == 0)
+        {
+            layer_state_offsets[i] = -1;
+            continue;
+        }
+
+        layer_state_offsets[i] = state_mat_count;
+        state_mat_count += layers[i]->state_count;
+    }
+}
+
+Mat* NetPrivate::get_layer_states(int layer_index, std::vector<Mat>& state_mats) const
+{
+    if (layer_index >= (int)layer_state_offsets.size() || layer_state_offsets[layer_index] == -1)
+        return 0;
+
+    return &state_mats[layer_state_offsets[layer_index]];
+}
+
+// the caller holds arena_allocators_lock
+static void release_memory_plan(BlobMemoryPlan* plan)
+{
+    plan->refcount--;
+    if (plan->refcount == 0)
+        delete plan;
+}
+
+BlobArenaAllocator* NetPrivate::acquire_arena_allocator()
+{
+    MutexLockGuard lock(arena_allocators_lock);
+
+    BlobArenaAllocator* allocator = 0;
+    if (!idle_arena_allocators.empty())
+    {
+        allocator = idle_arena_allocators[idle_arena_allocators.size() - 1];
+        idle_arena_allocators.resize(idle_arena_allocators.size() - 1);
+    }
+    else
+    {
+        // one arena for each concurrent extractor
+        allocator = new BlobArenaAllocator(memory_plan);
+        memory_plan->refcount++;
+        arena_allocators.push_back(allocator);
+    }
+
+    allocator->reset();
+    return allocator;
+}
+
+void NetPrivate::reclaim_arena_allocator(BlobArenaAllocator* allocator)
+{
+    MutexLockGuard lock(arena_allocators_lock);
+
+    std::vector<BlobArenaAllocator*>::iterator it = std::find(retired_arena_allocators.begin(), retired_arena_allocators.end(), allocator);
+    if (it != retired_arena_allocators.end())
+    {
+        // the plan was dropped while the extractor held the arena
+        retired_arena_allocators.erase(it);
+
+        BlobMemoryPlan* plan = allocator->plan;
+        delete allocator;
+        release_memory_plan(plan);
+        return;
+    }
+
+    idle_arena_allocators.push_back(allocator);
+}
+
+void NetPrivate::clear_memory_plan()
+{
+    MutexLockGuard lock(arena_allocators_lock);
+
+    // arenas held by live extractors stay until the extractor gives them back
+    for (size_t i = 0; i < arena_allocators.size(); i++)
+    {
+        BlobArenaAllocator* allocator = arena_allocators[i];
+
+        if (std::find(idle_arena_allocators.begin(), idle_arena_allocators.end(), allocator) == idle_arena_allocators.end())
+        {
+            retired_arena_allocators.push_back(allocator);
+            continue;
+        }
+
+        BlobMemoryPlan* plan = allocator->plan;
+        delete allocator;
+        release_memory_plan(plan);
+    }
+    arena_allocators.clear();
+    idle_arena_allocators.clear();
+
+    if (memory_plan)
+    {
+        release_memory_plan(memory_plan);
+        memory_plan = 0;
+    }
+}
+
 #if NCNN_STRING
 void NetPrivate::update_input_output_names()
 {
@@ -1582,6 +2939,7 @@ int Net::load_param(const DataReader& dr)
     }
 
     d->update_input_output_indexes();
+    d->update_state_offsets();
     d->update_input_output_names();
 
 #undef SCAN_VALUE
@@ -1789,6 +3147,7 @@ int Net::load_param_bin(const DataReader& dr)
     }
 
     d->update_input_output_indexes();
+    d->update_state_offsets();
 
 #undef READ_VALUE
     return 0;
@@ -1807,7 +3166,15 @@ int Net::load_model(const DataReader& dr)
     // load file
     int ret = 0;
 
+#if NCNN_STDIO
+    d->model_loaded = true;
+
+    // hash model data for the pipeline cache key
+    DataReaderHashing drh(dr);
+    ModelBinFromDataReader mb(d->use_pipeline_cache ? (const DataReader&)drh : dr);
+#else
     ModelBinFromDataReader mb(dr);
+#endif // NCNN_STDIO
     for (int i = 0; i < layer_count; i++)
     {
         Layer* layer = d->layers[i];
@@ -1851,28 +3218,46 @@ int Net::load_model(const DataReader& dr)
     }
 #endif // NCNN_VULKAN
 
-    for (int i = 0; i < layer_count; i++)
+#if NCNN_STDIO
+    if (d->use_pipeline_cache)
     {
-        Layer* layer = d->layers[i];
+        d->model_hash = drh.hash;
 
-        Option opt1 = opt;
-#if NCNN_VULKAN
-        if (opt.use_vulkan_compute)
+        if (!opt.use_vulkan_compute)
+            d->match_pipeline_cache(opt);
+    }
+#endif // NCNN_STDIO
+
+    if (ret == 0 && opt.use_parallel_pipeline && !opt.use_vulkan_compute && opt.num_threads > 1 && layer_count > 1)
+    {
+        if (d->create_pipeline_parallel(opt) != 0)
+            ret = -1;
+    }
+    else
+    {
+        for (int i = 0; i < layer_count; i++)
         {
-            if (!layer->support_image_storage) opt1.use_image_storage = false;
-        }
+            Layer* layer = d->layers[i];
+
+            Option opt1 = opt;
+#if NCNN_VULKAN
+            if (opt.use_vulkan_compute)
+            {
+                if (!layer->support_image_storage) opt1.use_image_storage = false;
+            }
 #endif // NCNN_VULKAN
 
-        int cret = layer->create_pipeline(opt1);
-        if (cret != 0)
-        {
+            int cret = d->create_layer_pipeline(i, opt1);
+            if (cret != 0)
+            {
 #if NCNN_STRING
-            NCNN_LOGE("layer create_pipeline %d %s failed", i, layer->name.c_str());
+                NCNN_LOGE("layer create_pipeline %d %s failed", i, layer->name.c_str());
 #else
-            NCNN_LOGE("layer create_pipeline %d failed", i);
+                NCNN_LOGE("layer create_pipeline %d failed", i);
 #endif
-            ret = -1;
-            break;
+                ret = -1;
+                break;
+            }
         }
     }
 
@@ -1975,6 +3360,293 @@ int Net::load_model(const char* modelpath)
     fclose(fp);
     return ret;
 }
+
+int Net::load_pipeline_cache(const char* cachepath)
+{
+    if (d->model_loaded)
+    {
+        // loaded layers may still reference the current mapping
+        NCNN_LOGE("load_pipeline_cache must be called before load_model");
+        return -1;
+    }
+
+    d->clear_pipeline_cache();
+    d->use_pipeline_cache = true;
+
+    FILE* fp = fopen(cachepath, "rb");
+    if (!fp)
+    {
+        // nothing cached yet
+        return 0;
+    }
+    fseek(fp, 0, SEEK_END);
+    const long filesize = ftell(fp);
+    fclose(fp);
+
+    DataReaderFromMmap* dr = new DataReaderFromMmap(cachepath);
+    if (!dr->mapped())
+    {
+        delete dr;
+        return -1;
+    }
+
+    size_t offset = 0;
+
+    // the payload size is checked against the file before any page of the payload is touched
+    PipelineCacheHeader header;
+    offset += dr->read(&header, sizeof(header));
+    if (offset != sizeof(header) || header.magic != PIPELINE_CACHE_MAGIC || header.version != PIPELINE_CACHE_VERSION || header.layer_count < 0
+            || filesize < (long)sizeof(header) || header.payload_size != (uint64_t)(filesize - (long)sizeof(header)))
+    {
+        NCNN_LOGE("invalid pipeline cache %s", cachepath);
+        delete dr;
+        return -1;
+    }
+
+    // hash the payload in the same pieces save_pipeline_cache wrote it
+    DataReaderHashing drh(*dr);
+
+    std::vector<int> cached_pipeline_typeindex(header.layer_count, -1);
+    std::vector<std::vector<Mat> > cached_pipeline_data(header.layer_count);
+
+    for (int i = 0; i < header.entry_count; i++)
+    {
+        int entry[3];
+        size_t nread = drh.read(entry, sizeof(entry));
+        offset += nread;
+
+        const int layer_index = entry[0];
+        const int mat_count = entry[2];
+        if (nread != sizeof(entry) || layer_index < 0 || layer_index >= header.layer_count || mat_count < 0)
+        {
+            NCNN_LOGE("invalid pipeline cache entry %d", i);
+            delete dr;
+            return -1;
+        }
+
+        cached_pipeline_typeindex[layer_index] = entry[1];
+
+        std::vector<Mat>& pipeline_data = cached_pipeline_data[layer_index];
+        pipeline_data.resize(mat_count);
+
+        for (int j = 0; j < mat_count; j++)
+        {
+            PipelineCacheMatDesc desc;
+            nread = drh.read(&desc, sizeof(desc));
+            offset += nread;
+            if (nread != sizeof(desc))
+            {
+                NCNN_LOGE("invalid pipeline cache entry %d", i);
+                delete dr;
+                return -1;
+            }
+
+            if (desc.dims == 0)
+                continue;
+
+            // skip padding
+            const void* refbuf = 0;
+            const size_t padding = alignSize(offset, PIPELINE_CACHE_ALIGN) - offset;
+            if (padding)
+            {
+                offset += drh.reference(padding, &refbuf);
+            }
+
+            nread = drh.reference(desc.data_size, &refbuf);
+            offset += nread;
+            if (nread != desc.data_size)
+            {
+                NCNN_LOGE("invalid pipeline cache entry %d", i);
+                delete dr;
+                return -1;
+            }
+
+            Mat m;
+            if (desc.dims == 1)
+                m = Mat(desc.w, (void*)refbuf, (size_t)desc.elemsize, desc.elempack);
+            if (desc.dims == 2)
+                m = Mat(desc.w, desc.h, (void*)refbuf, (size_t)desc.elemsize, desc.elempack);
+            if (desc.dims == 3)
+                m = Mat(desc.w, desc.h, desc.c, (void*)refbuf, (size_t)desc.elemsize, desc.elempack);
+            if (desc.dims == 4)
+                m = Mat(desc.w, desc.h, desc.d, desc.c, (void*)refbuf, (size_t)desc.elemsize, desc.elempack);
+
+            m.cstep = (size_t)desc.cstep;
+            if (m.dims == 0 || m.total() * m.elemsize != desc.data_size)
+            {
+                NCNN_LOGE("invalid pipeline cache entry %d", i);
+                delete dr;
+                return -1;
+            }
+
+            pipeline_data[j] = m;
+        }
+    }
+
+    if (offset != (size_t)filesize || drh.hash != header.payload_hash)
+    {
+        NCNN_LOGE("corrupted pipeline cache %s", cachepath);
+        delete dr;
+        return -1;
+    }
+
+    d->pipeline_cache_mmap = dr;
+    d->pipeline_cache_header = header;
+    d->cached_pipeline_typeindex = cached_pipeline_typeindex;
+    d->cached_pipeline_data = cached_pipeline_data;
+
+    return 0;
+}
+
+// write one piece of the payload and fold it into the hash
+// load_pipeline_cache reads back the same pieces in the same order
+static int fwrite_pipeline_cache(const void* data, size_t size, FILE* fp, size_t& offset, uint64_t& hash)
+{
+    if (size == 0)
+        return 0;
+
+    if (fwrite(data, 1, size, fp) != size)
+        return -1;
+
+    offset += size;
+    hash = fnv1a_hash(hash, data, size);
+    return 0;
+}
+
+static int fwrite_aligned_padding(FILE* fp, size_t& offset, uint64_t& hash)
+{
+    static const unsigned char zeros[PIPELINE_CACHE_ALIGN] = {0};
+
+    const size_t padding = alignSize(offset, PIPELINE_CACHE_ALIGN) - offset;
+    return fwrite_pipeline_cache(zeros, padding, fp, offset, hash);
+}
+
+int Net::save_pipeline_cache(const char* cachepath) const
+{
+    if (!d->use_pipeline_cache)
+    {
+        NCNN_LOGE("load_pipeline_cache must be called before load_model");
+        return -1;
+    }
+
+    if (opt.use_vulkan_compute)
+    {
+        NCNN_LOGE("pipeline cache is for cpu inference only");
+        return -1;
+    }
+
+    const int layer_count = (int)d->layers.size();
+
+    std::vector<std::vector<Mat> > pipeline_data(layer_count);
+    int entry_count = 0;
+    for (int i = 0; i < layer_count; i++)
+    {
+        if (d->layers[i]->save_pipeline(pipeline_data[i]) != 0)
+        {
+            pipeline_data[i].clear();
+            continue;
+        }
+
+        entry_count++;
+    }
+
+    // write aside and rename, so a failed save never leaves a truncated cache behind
+    const std::string tmppath = std::string(cachepath) + ".tmp";
+
+    FILE* fp = fopen(tmppath.c_str(), "wb");
+    if (!fp)
+    {
+        NCNN_LOGE("fopen %s failed", tmppath.c_str());
+        return -1;
+    }
+
+    PipelineCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = PIPELINE_CACHE_MAGIC;
+    header.version = PIPELINE_CACHE_VERSION;
+    header.model_hash = d->model_hash;
+    header.isa_bits = get_pipeline_cache_isa_bits();
+    header.option_bits = get_pipeline_cache_option_bits(opt);
+    header.build_hash = get_pipeline_cache_build_hash();
+    header.layer_count = layer_count;
+    header.entry_count = entry_count;
+
+    // the header is written again once the payload size and hash are known
+    int ret = fwrite(&header, 1, sizeof(header), fp) == sizeof(header) ? 0 : -1;
+
+    size_t offset = sizeof(header);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (int i = 0; i < layer_count && ret == 0; i++)
+    {
+        if (pipeline_data[i].empty())
+            continue;
+
+        int entry[3] = {i, d->layers[i]->typeindex, (int)pipeline_data[i].size()};
+        ret = fwrite_pipeline_cache(entry, sizeof(entry), fp, offset, hash);
+
+        for (size_t j = 0; j < pipeline_data[i].size() && ret == 0; j++)
+        {
+            const Mat& m = pipeline_data[i][j];
+
+            PipelineCacheMatDesc desc;
+            memset(&desc, 0, sizeof(desc));
+            if (!m.empty())
+            {
+                desc.dims = m.dims;
+                desc.w = m.w;
+                desc.h = m.h;
+                desc.d = m.d;
+                desc.c = m.c;
+                desc.elempack = m.elempack;
+                desc.elemsize = m.elemsize;
+                desc.cstep = m.cstep;
+                desc.data_size = m.total() * m.elemsize;
+            }
+
+            ret = fwrite_pipeline_cache(&desc, sizeof(desc), fp, offset, hash);
+
+            if (ret != 0 || m.empty())
+                continue;
+
+            ret = fwrite_aligned_padding(fp, offset, hash);
+            if (ret == 0)
+                ret = fwrite_pipeline_cache(m.data, (size_t)desc.data_size, fp, offset, hash);
+        }
+    }
+
+    if (ret == 0)
+    {
+        header.payload_size = offset - sizeof(header);
+        header.payload_hash = hash;
+
+        if (fseek(fp, 0, SEEK_SET) != 0 || fwrite(&header, 1, sizeof(header), fp) != sizeof(header))
+            ret = -1;
+    }
+
+    if (fclose(fp) != 0)
+        ret = -1;
+
+    if (ret != 0)
+    {
+        NCNN_LOGE("write %s failed", tmppath.c_str());
+        remove(tmppath.c_str());
+        return -1;
+    }
+
+#if defined _WIN32
+    // rename does not replace an existing file on windows
+    remove(cachepath);
+#endif
+    if (rename(tmppath.c_str(), cachepath) != 0)
+    {
+        NCNN_LOGE("rename %s to %s failed", tmppath.c_str(), cachepath);
+        remove(tmppath.c_str());
+        return -1;
+    }
+
+    return 0;
+}
 #endif // NCNN_STDIO
 
 int Net::load_param(const unsigned char* _mem)
@@ -2059,6 +3731,73 @@ int Net::load_model(AAssetManager* mgr, const char* assetpath)
 #endif // __ANDROID_API__ >= 9
 #endif // NCNN_PLATFORM_API
 
+int Net::plan_memory(const std::vector<Mat>& in_shapes)
+{
+    if (d->layers.empty())
+    {
+        NCNN_LOGE("network graph not ready");
+        return -1;
+    }
+
+    if (in_shapes.size() != d->input_blob_indexes.size())
+    {
+        NCNN_LOGE("plan_memory expect %d input shapes but got %d", (int)d->input_blob_indexes.size(), (int)in_shapes.size());
+        return -1;
+    }
+
+#if NCNN_VULKAN
+    if (opt.use_vulkan_compute)
+    {
+        NCNN_LOGE("plan_memory is only available for cpu inference");
+        return -1;
+    }
+#endif // NCNN_VULKAN
+
+    d->clear_memory_plan();
+
+    // planning run, record every blob allocation in order
+    BlobRecordAllocator record;
+    {
+        Extractor ex = create_extractor();
+        ex.set_blob_allocator(&record);
+
+        for (size_t i = 0; i < in_shapes.size(); i++)
+        {
+            Mat in;
+            in.create_like(in_shapes[i]);
+            if (in.empty())
+            {
+                NCNN_LOGE("plan_memory input shape %d is empty", (int)i);
+                return -1;
+            }
+
+            memset(in.data, 0, in.total() * in.elemsize);
+
+            ex.input(d->input_blob_indexes[i], in);
+        }
+
+        for (size_t i = 0; i < d->output_blob_indexes.size(); i++)
+        {
+            Mat out;
+            int ret = ex.extract(d->output_blob_indexes[i], out);
+            if (ret != 0)
+            {
+                NCNN_LOGE("plan_memory forward failed");
+                return -1;
+            }
+        }
+    }
+
+    d->memory_plan = new BlobMemoryPlan(record);
+
+    return 0;
+}
+
+size_t Net::planned_memory_size() const
+{
+    return d->memory_plan ? d->memory_plan->arena_size : 0;
+}
+
 void Net::clear()
 {
     d->blobs.clear();
@@ -2097,6 +3836,8 @@ void Net::clear()
         }
     }
     d->layers.clear();
+    d->layer_state_offsets.clear();
+    d->state_mat_count = 0;
 
     if (d->local_blob_allocator)
     {
@@ -2109,6 +3850,15 @@ void Net::clear()
         d->local_workspace_allocator = 0;
     }
 
+    d->clear_memory_plan();
+
+#if NCNN_STDIO
+    d->clear_pipeline_cache();
+    d->use_pipeline_cache = false;
+    d->model_loaded = false;
+    d->model_hash = 0;
+#endif // NCNN_STDIO
+
 #if NCNN_VULKAN
     if (d->weight_vkallocator)
     {
@@ -2261,6 +4011,52 @@ Layer* Net::create_custom_layer(int index)
     return layer;
 }
 
+// unpack and cast the extracted blob back to fp32 unless type = 1
+static void convert_extracted(Mat& feat, int type, const Option& opt)
+{
+    if (opt.use_packing_layout && (type == 0) && feat.elempack != 1)
+    {
+        Mat bottom_blob_unpacked;
+        convert_packing(feat, bottom_blob_unpacked, 1, opt);
+        feat = bottom_blob_unpacked;
+    }
+
+    // clang-format off
+    // *INDENT-OFF*
+#if NCNN_ARM82
+    if (opt.use_fp16_storage && cpu_support_arm_asimdhp() && (type == 0))
+    {
+        if (feat.elembits() == 16)
+        {
+            Mat feat_fp32;
+            cast_float16_to_float32(feat, feat_fp32, opt);
+            feat = feat_fp32;
+        }
+    }
+    else
+#endif // NCNN_ARM82
+#if NCNN_BF16
+    if (opt.use_bf16_storage && (type == 0))
+    {
+        if (feat.elembits() == 16)
+        {
+            Mat feat_fp32;
+            cast_bfloat16_to_float32(feat, feat_fp32, opt);
+            feat = feat_fp32;
+        }
+    }
+    else
+#endif // NCNN_BF16
+    if (feat.elembits() == 8 && (type == 0))
+    {
+        Mat feat_fp32;
+        cast_int8_to_float32(feat, feat_fp32, opt);
+        feat = feat_fp32;
+    }
+    // *INDENT-ON*
+    // clang-format on
+}
+
 class ExtractorPrivate
 {
 public:
@@ -2270,8 +4066,20 @@ public:
     }
     const Net* net;
     std::vector<Mat> blob_mats;
+    std::vector<std::vector<Mat> > batch_blob_mats;
     Option opt;
 
+    // layer states carried from one inference to the next
+    std::vector<Mat> state_mats;
+    std::vector<std::vector<Mat> > batch_state_mats;
+
+    BlobArenaAllocator* local_arena_allocator;
+
+    int num_branch_workers;
+    BranchWorkerPool* branch_pool;
+
+    Profiler* profiler;
+
 #if NCNN_VULKAN
     VkAllocator* local_blob_vkallocator;
     VkAllocator* local_staging_vkallocator;
@@ -2287,6 +4095,15 @@ Extractor::Extractor(const Net* _net, size_t blob_count)
     d->blob_mats.resize(blob_count);
     d->opt = d->net->opt;
 
+    d->state_mats.resize(d->net->d->state_mat_count);
+
+    d->local_arena_allocator = 0;
+
+    d->num_branch_workers = 1;
+    d->branch_pool = 0;
+
+    d->profiler = 0;
+
 #if NCNN_VULKAN
     if (d->net->opt.use_vulkan_compute)
     {
@@ -2303,16 +4120,47 @@ Extractor::~Extractor()
 {
     clear();
 
+    delete d->branch_pool;
+
     delete d;
 }
 
+// layers such as MultiHeadAttention append to their states in place, so copies never share them
+static void clone_states(std::vector<Mat>& dst, const std::vector<Mat>& src)
+{
+    dst.resize(src.size());
+    for (size_t i = 0; i < src.size(); i++)
+    {
+        dst[i] = src[i].clone();
+    }
+}
+
 Extractor::Extractor(const Extractor& rhs)
     : d(new ExtractorPrivate(0))
 {
     d->net = rhs.d->net;
     d->blob_mats = rhs.d->blob_mats;
+    d->batch_blob_mats = rhs.d->batch_blob_mats;
     d->opt = rhs.d->opt;
 
+    clone_states(d->state_mats, rhs.d->state_mats);
+    d->batch_state_mats.resize(rhs.d->batch_state_mats.size());
+    for (size_t b = 0; b < rhs.d->batch_state_mats.size(); b++)
+    {
+        clone_states(d->batch_state_mats[b], rhs.d->batch_state_mats[b]);
+    }
+
+    d->local_arena_allocator = 0;
+    if (d->opt.blob_allocator == rhs.d->local_arena_allocator)
+    {
+        d->opt.blob_allocator = 0;
+    }
+
+    d->num_branch_workers = rhs.d->num_branch_workers;
+    d->branch_pool = 0;
+
+    d->profiler = rhs.d->profiler;
+
 #if NCNN_VULKAN
     d->local_blob_vkallocator = 0;
     d->local_staging_vkallocator = 0;
@@ -2327,10 +4175,37 @@ Extractor& Extractor::operator=(const Extractor& rhs)
     if (this == &rhs)
         return *this;
 
+    const Net* old_net = d->net;
+
     d->net = rhs.d->net;
     d->blob_mats = rhs.d->blob_mats;
+    d->batch_blob_mats = rhs.d->batch_blob_mats;
     d->opt = rhs.d->opt;
 
+    clone_states(d->state_mats, rhs.d->state_mats);
+    d->batch_state_mats.resize(rhs.d->batch_state_mats.size());
+    for (size_t b = 0; b < rhs.d->batch_state_mats.size(); b++)
+    {
+        clone_states(d->batch_state_mats[b], rhs.d->batch_state_mats[b]);
+    }
+
+    if (d->local_arena_allocator)
+    {
+        old_net->d->reclaim_arena_allocator(d->local_arena_allocator);
+    }
+    d->local_arena_allocator = 0;
+    if (d->opt.blob_allocator == rhs.d->local_arena_allocator)
+    {
+        d->opt.blob_allocator = 0;
+    }
+
+    // the pool threads are not shared, a new pool starts on the next parallel extract
+    d->num_branch_workers = rhs.d->num_branch_workers;
+    delete d->branch_pool;
+    d->branch_pool = 0;
+
+    d->profiler = rhs.d->profiler;
+
 #if NCNN_VULKAN
     d->local_blob_vkallocator = 0;
     d->local_staging_vkallocator = 0;
@@ -2345,6 +4220,18 @@ Extractor& Extractor::operator=(const Extractor& rhs)
 void Extractor::clear()
 {
     d->blob_mats.clear();
+    d->batch_blob_mats.clear();
+
+    if (d->local_arena_allocator)
+    {
+        if (d->opt.blob_allocator == d->local_arena_allocator)
+        {
+            d->opt.blob_allocator = 0;
+        }
+
+        d->net->d->reclaim_arena_allocator(d->local_arena_allocator);
+        d->local_arena_allocator = 0;
+    }
 
 #if NCNN_VULKAN
     if (d->opt.use_vulkan_compute)
@@ -2364,6 +4251,111 @@ void Extractor::clear()
 #endif // NCNN_VULKAN
 }
 
+void Extractor::clear_blobs()
+{
+    clear();
+
+#if NCNN_VULKAN
+    if (d->opt.use_vulkan_compute)
+    {
+        // the local vulkan allocators have been reclaimed by clear
+        if (d->local_blob_vkallocator)
+        {
+            if (d->opt.workspace_vkallocator == d->local_blob_vkallocator)
+            {
+                d->opt.workspace_vkallocator = 0;
+            }
+            if (d->opt.blob_vkallocator == d->local_blob_vkallocator)
+            {
+                d->opt.blob_vkallocator = 0;
+            }
+            d->local_blob_vkallocator = 0;
+        }
+        if (d->local_staging_vkallocator)
+        {
+            if (d->opt.staging_vkallocator == d->local_staging_vkallocator)
+            {
+                d->opt.staging_vkallocator = 0;
+            }
+            d->local_staging_vkallocator = 0;
+        }
+    }
+#endif // NCNN_VULKAN
+
+    const size_t blob_count = d->net->blobs().size();
+
+    d->blob_mats.resize(blob_count);
+
+#if NCNN_VULKAN
+    if (d->opt.use_vulkan_compute)
+    {
+        d->blob_mats_gpu.resize(blob_count);
+        d->blob_mats_gpu_image.resize(blob_count);
+    }
+#endif // NCNN_VULKAN
+}
+
+void Extractor::reset_states()
+{
+    d->state_mats.clear();
+    d->state_mats.resize(d->net->d->state_mat_count);
+    d->batch_state_mats.clear();
+}
+
+static int trim_layer_states(const Layer* layer, Mat* states, int len)
+{
+    std::vector<Mat> layer_states(states, states + layer->state_count);
+
+    bool has_state = false;
+    for (int i = 0; i < layer->state_count; i++)
+    {
+        if (!layer_states[i].empty())
+            has_state = true;
+    }
+
+    // nothing carried yet
+    if (!has_state)
+        return 0;
+
+    int ret = layer->trim_states(layer_states, len);
+    if (ret != 0)
+        return ret;
+
+    for (int i = 0; i < layer->state_count; i++)
+    {
+        states[i] = layer_states[i];
+    }
+
+    return 0;
+}
+
+int Extractor::trim_states(int len)
+{
+    const std::vector<Layer*>& layers = d->net->layers();
+
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        Mat* states = d->net->d->get_layer_states((int)i, d->state_mats);
+        if (!states)
+            continue;
+
+        int ret = trim_layer_states(layers[i], states, len);
+
+        for (size_t b = 0; b < d->batch_state_mats.size() && ret == 0; b++)
+        {
+            ret = trim_layer_states(layers[i], d->net->d->get_layer_states((int)i, d->batch_state_mats[b]), len);
+        }
+
+        if (ret != 0)
+        {
+            NCNN_LOGE("layer trim_states %d failed", (int)i);
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
 void Extractor::set_light_mode(bool enable)
 {
     d->opt.lightmode = enable;
@@ -2374,6 +4366,41 @@ void Extractor::set_num_threads(int num_threads)
     d->opt.num_threads = num_threads;
 }
 
+size_t Extractor::planned_memory_hits() const
+{
+    if (!d->local_arena_allocator)
+        return 0;
+
+    MutexLockGuard guard(d->local_arena_allocator->lock);
+    return d->local_arena_allocator->hits;
+}
+
+size_t Extractor::planned_memory_misses() const
+{
+    if (!d->local_arena_allocator)
+        return 0;
+
+    MutexLockGuard guard(d->local_arena_allocator->lock);
+    return d->local_arena_allocator->misses;
+}
+
+void Extractor::set_parallel_branches(int num_workers)
+{
+    if (d->num_branch_workers == num_workers)
+        return;
+
+    d->num_branch_workers = num_workers;
+
+    // respawn the pool threads on the next parallel extract
+    delete d->branch_pool;
+    d->branch_pool = 0;
+}
+
+void Extractor::set_profiler(Profiler* profiler)
+{
+    d->profiler = profiler;
+}
+
 void Extractor::set_blob_allocator(Allocator* allocator)
 {
     d->opt.blob_allocator = allocator;
@@ -2478,6 +4505,13 @@ int Extractor::extract(int blob_index, Mat& feat, int type)
     {
         int layer_index = d->net->blobs()[blob_index].producer;
 
+        // use planned arena allocator
+        if (!d->opt.blob_allocator && d->net->d->memory_plan)
+        {
+            d->local_arena_allocator = d->net->d->acquire_arena_allocator();
+            d->opt.blob_allocator = d->local_arena_allocator;
+        }
+
         // use local allocator
         if (d->opt.use_local_pool_allocator)
         {
@@ -2571,64 +4605,188 @@ int Extractor::extract(int blob_index, Mat& feat, int type)
                 }
             }
         }
+        else if (d->num_branch_workers > 1)
+        {
+            if (!d->branch_pool)
+                d->branch_pool = new BranchWorkerPool(d->num_branch_workers);
+
+            ret = d->net->d->forward_layer_parallel(layer_index, d->blob_mats, d->state_mats, d->opt, d->branch_pool, d->profiler);
+        }
         else
         {
-            ret = d->net->d->forward_layer(layer_index, d->blob_mats, d->opt);
+            ret = d->net->d->forward_layer(layer_index, d->blob_mats, d->state_mats, d->opt, d->profiler);
         }
 #else
-        ret = d->net->d->forward_layer(layer_index, d->blob_mats, d->opt);
+        if (d->num_branch_workers > 1)
+        {
+            if (!d->branch_pool)
+                d->branch_pool = new BranchWorkerPool(d->num_branch_workers);
+
+            ret = d->net->d->forward_layer_parallel(layer_index, d->blob_mats, d->state_mats, d->opt, d->branch_pool, d->profiler);
+        }
+        else
+        {
+            ret = d->net->d->forward_layer(layer_index, d->blob_mats, d->state_mats, d->opt, d->profiler);
+        }
 #endif // NCNN_VULKAN
     }
 
     feat = d->blob_mats[blob_index];
 
-    if (d->opt.use_packing_layout && (type == 0) && feat.elempack != 1)
+    convert_extracted(feat, type, d->opt);
+
+    if (d->opt.use_local_pool_allocator && feat.allocator == d->net->d->local_blob_allocator)
     {
-        Mat bottom_blob_unpacked;
-        convert_packing(feat, bottom_blob_unpacked, 1, d->opt);
-        feat = bottom_blob_unpacked;
+        // detach the returned mat from local pool allocator
+        // so we could destroy net instance much earlier
+        feat = feat.clone();
     }
 
-    // clang-format off
-    // *INDENT-OFF*
-#if NCNN_ARM82
-    if (d->opt.use_fp16_storage && cpu_support_arm_asimdhp() && (type == 0))
+    if (d->local_arena_allocator && feat.allocator == d->local_arena_allocator)
     {
-        if (feat.elembits() == 16)
-        {
-            Mat feat_fp32;
-            cast_float16_to_float32(feat, feat_fp32, d->opt);
-            feat = feat_fp32;
-        }
+        // detach the returned mat from planned arena
+        // so the arena could be reused by the next inference
+        feat = feat.clone();
     }
-    else
-#endif // NCNN_ARM82
-#if NCNN_BF16
-    if (d->opt.use_bf16_storage && (type == 0))
+
+    set_kmp_blocktime(old_blocktime);
+    set_flush_denormals(old_flush_denormals);
+
+    return ret;
+}
+
+#if NCNN_STRING
+int Extractor::input(const char* blob_name, const std::vector<Mat>& in)
+{
+    int blob_index = d->net->find_blob_index_by_name(blob_name);
+    if (blob_index == -1)
+        return -1;
+
+    return input(blob_index, in);
+}
+
+int Extractor::extract(const char* blob_name, std::vector<Mat>& feats, int type)
+{
+    int blob_index = d->net->find_blob_index_by_name(blob_name);
+    if (blob_index == -1)
+        return -1;
+
+    return extract(blob_index, feats, type);
+}
+#endif // NCNN_STRING
+
+int Extractor::input(int blob_index, const std::vector<Mat>& in)
+{
+    const int blob_count = (int)d->net->blobs().size();
+
+    if (blob_index < 0 || blob_index >= blob_count)
+        return -1;
+
+    if (in.empty())
+        return -1;
+
+    if (d->batch_blob_mats.empty())
     {
-        if (feat.elembits() == 16)
+        d->batch_blob_mats.resize(in.size());
+        for (size_t b = 0; b < in.size(); b++)
         {
-            Mat feat_fp32;
-            cast_bfloat16_to_float32(feat, feat_fp32, d->opt);
-            feat = feat_fp32;
+            d->batch_blob_mats[b].resize(blob_count);
         }
     }
-    else
-#endif // NCNN_BF16
-    if (feat.elembits() == 8 && (type == 0))
+
+    if (d->batch_blob_mats.size() != in.size())
     {
-        Mat feat_fp32;
-        cast_int8_to_float32(feat, feat_fp32, d->opt);
-        feat = feat_fp32;
+        NCNN_LOGE("batch size mismatch, got %d but the extractor holds %d", (int)in.size(), (int)d->batch_blob_mats.size());
+        return -1;
     }
-    // *INDENT-ON*
-    // clang-format on
 
-    if (d->opt.use_local_pool_allocator && feat.allocator == d->net->d->local_blob_allocator)
+    for (size_t b = 0; b < in.size(); b++)
     {
-        // detach the returned mat from local pool allocator
-        // so we could destroy net instance much earlier
-        feat = feat.clone();
+        d->batch_blob_mats[b][blob_index] = in[b];
+    }
+
+    return 0;
+}
+
+int Extractor::extract(int blob_index, std::vector<Mat>& feats, int type)
+{
+    if (blob_index < 0 || blob_index >= (int)d->net->blobs().size())
+        return -1;
+
+    if (d->batch_blob_mats.empty())
+    {
+        NCNN_LOGE("extract batch without batched input");
+        return -1;
+    }
+
+    int old_blocktime = get_kmp_blocktime();
+    set_kmp_blocktime(d->opt.openmp_blocktime);
+
+    int old_flush_denormals = get_flush_denormals();
+    set_flush_denormals(d->opt.flush_denormals);
+
+    int ret = 0;
+
+    if (d->batch_blob_mats[0][blob_index].dims == 0)
+    {
+        int layer_index = d->net->blobs()[blob_index].producer;
+
+        // use local allocator
+        if (d->opt.use_local_pool_allocator)
+        {
+            if (!d->opt.blob_allocator)
+            {
+                d->opt.blob_allocator = d->net->d->local_blob_allocator;
+            }
+            if (!d->opt.workspace_allocator)
+            {
+                d->opt.workspace_allocator = d->net->d->local_workspace_allocator;
+            }
+        }
+
+        if (d->batch_state_mats.empty())
+        {
+            d->batch_state_mats.resize(d->batch_blob_mats.size());
+            for (size_t b = 0; b < d->batch_blob_mats.size(); b++)
+            {
+                d->batch_state_mats[b].resize(d->net->d->state_mat_count);
+            }
+        }
+
+        if (d->batch_state_mats.size() != d->batch_blob_mats.size())
+        {
+            NCNN_LOGE("batch size mismatch, got %d but the extractor carries states of %d", (int)d->batch_blob_mats.size(), (int)d->batch_state_mats.size());
+            set_kmp_blocktime(old_blocktime);
+            set_flush_denormals(old_flush_denormals);
+            return -1;
+        }
+
+        // batched inference always runs on cpu
+        ret = d->net->d->forward_layer_batch(layer_index, d->batch_blob_mats, d->batch_state_mats, d->opt, d->profiler);
+    }
+
+    const int batch = (int)d->batch_blob_mats.size();
+
+    feats.resize(batch);
+    for (int b = 0; b < batch; b++)
+    {
+        Mat& feat = feats[b];
+
+        feat = d->batch_blob_mats[b][blob_index];
+
+        convert_extracted(feat, type, d->opt);
+
+        if (d->opt.use_local_pool_allocator && feat.allocator == d->net->d->local_blob_allocator)
+        {
+            // detach the returned mat from local pool allocator
+            feat = feat.clone();
+        }
+
+        if (d->local_arena_allocator && feat.allocator == d->local_arena_allocator)
+        {
+            // detach the returned mat from planned arena
+            feat = feat.clone();
+        }
     }
 
     set_kmp_blocktime(old_blocktime);
@@ -2750,7 +4908,7 @@ int Extractor::extract(int blob_index, VkMat& feat, VkCompute& cmd)
         else
         {
             int layer_index = d->net->blobs()[blob_index].producer;
-            ret = d->net->d->forward_layer(layer_index, d->blob_mats, d->blob_mats_gpu, cmd, d->opt);
+            ret = d->net->d->forward_layer(layer_index, d->blob_mats, d->state_mats, d->blob_mats_gpu, cmd, d->opt);
         }
     }
 
@@ -2800,7 +4958,7 @@ int Extractor::extract(int blob_index, VkImageMat& feat, VkCompute& cmd)
         else
         {
             int layer_index = d->net->blobs()[blob_index].producer;
-            ret = d->net->d->forward_layer(layer_index, d->blob_mats, d->blob_mats_gpu, d->blob_mats_gpu_image, cmd, d->opt);
+            ret = d->net->d->forward_layer(layer_index, d->blob_mats, d->state_mats, d->blob_mats_gpu, d->blob_mats_gpu_image, cmd, d->opt);
         }
     }
 
@@ -35,6 +35,7 @@ class VkCompute;
 class DataReader;
 class Extractor;
 class NetPrivate;
+class Profiler;
 class NCNN_EXPORT Net
 {
 public:
@@ -92,6 +93,20 @@ public:
     // return 0 if success
     int load_model(FILE* fp);
     int load_model(const char* modelpath);
+
+    // enable the cpu pipeline cache, call before load_model
+    // layers found in the cache take their transformed weights from the memory mapped file
+    // instead of recomputing them in create_pipeline
+    // entries are keyed by model hash, layer index, cpu isa and option bits
+    // a missing or stale cache file only means pipelines are created as usual
+    // fails once load_model has run, the loaded layers may reference the current cache
+    // return 0 if success
+    int load_pipeline_cache(const char* cachepath);
+
+    // write the transformed weights of the loaded network to the pipeline cache file
+    // the file is written aside and renamed into place, a size and hash guard the payload
+    // return 0 if success
+    int save_pipeline_cache(const char* cachepath) const;
 #endif // NCNN_STDIO
 
     // load network structure from external memory
@@ -123,6 +138,20 @@ public:
 #endif // __ANDROID_API__ >= 9
 #endif // NCNN_PLATFORM_API
 
+    // plan intermediate blob memory for fixed input shapes
+    // blob lifetimes are recorded from one forward run over all outputs
+    // and packed into a single arena by interval coloring
+    // extractor allocates the arena once and hands out views into it
+    // extract outputs in the order of output_indexes() to stay on the plan
+    // in_shapes follow the order of input_indexes(), only shape and elemsize are used
+    // call after loading model, cpu inference only
+    // extractors keep the arena they hold across plan_memory and clear, the net must outlive them
+    // return 0 if success
+    int plan_memory(const std::vector<Mat>& in_shapes);
+
+    // planned arena bytes for each extractor, 0 if not planned
+    size_t planned_memory_size() const;
+
     // unload network structure and weight data
     void clear();
 
@@ -175,6 +204,19 @@ public:
     // clear blob mats and alloctors
     void clear();
 
+    // clear blob mats so that the extractor takes new inputs again
+    // layer states such as the kv cache of MultiHeadAttention or the hidden states
+    // of streaming LSTM GRU RNN are carried over and the next extract continues from them
+    void clear_blobs();
+
+    // drop the carried layer states, the next extract starts from empty states
+    void reset_states();
+
+    // keep the first len steps of the carried layer states
+    // for rolling back an incremental decoder
+    // return 0 if success
+    int trim_states(int len);
+
     // enable light mode
     // intermediate blob will be recycled when enabled
     // enabled by default
@@ -185,6 +227,25 @@ public:
     // default count is system depended
     void set_num_threads(int num_threads);
 
+    // blob allocations of the current inference served from the planned arena
+    // and those that went off the plan to the heap, 0 if the net has no memory plan
+    // misses mean the allocation order diverged from the planning run, as with parallel branches
+    size_t planned_memory_hits() const;
+    size_t planned_memory_misses() const;
+
+    // run independent branches of the graph concurrently
+    // layers are dispatched from a ready queue to num_workers threads
+    // and the thread count is split among the layers running at the same time
+    // blob and workspace allocators must be thread-safe when enabled
+    // the worker threads stay alive with the extractor and are reused by every extract
+    // default is 1, run layers one by one
+    void set_parallel_branches(int num_workers);
+
+    // record per-layer timing, blob shapes and kernel paths into profiler
+    // the profiler may be shared by several extractors running concurrently
+    // only the cpu path is recorded, pass null to disable
+    void set_profiler(Profiler* profiler);
+
     // set blob memory allocator
     void set_blob_allocator(Allocator* allocator);
 
@@ -223,6 +284,28 @@ public:
     // type = 1, do not convert fp16/bf16 or / and packing
     int extract(int blob_index, Mat& feat, int type = 0);
 
+#if NCNN_STRING
+    // set batched input by blob name, one mat for each sample
+    // every input of the extractor must carry the same sample count
+    // return 0 if success
+    int input(const char* blob_name, const std::vector<Mat>& in);
+
+    // get batched result by blob name, one mat for each sample
+    // layers with batched kernels process all samples in one pass
+    // the others fall back to running sample by sample
+    // each sample carries its own layer states, so a batch steps independent streams together
+    // return 0 if success
+    int extract(const char* blob_name, std::vector<Mat>& feats, int type = 0);
+#endif // NCNN_STRING
+
+    // set batched input by blob index, one mat for each sample
+    // return 0 if success
+    int input(int blob_index, const std::vector<Mat>& in);
+
+    // get batched result by blob index, one mat for each sample
+    // return 0 if success
+    int extract(int blob_index, std::vector<Mat>& feats, int type = 0);
+
 #if NCNN_VULKAN
 #if NCNN_STRING
     // set input by blob name
@@ -72,6 +72,10 @@ Option::Option()
     use_winograd23_convolution = true;
     use_winograd43_convolution = true;
     use_winograd63_convolution = true;
+
+    use_parallel_pipeline = false;
+
+    use_fp16_weight_storage = false;
 }
 
 } // namespace ncnn
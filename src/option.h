@@ -140,8 +140,17 @@ public:
     bool use_winograd43_convolution;
     bool use_winograd63_convolution;
 
-    bool use_reserved_6;
-    bool use_reserved_7;
+    // create layer pipelines concurrently in load_model for cpu inference
+    // split num_threads among the layers being created
+    // custom layers registered with register_custom_layer are still created one by one on the calling thread
+    // disabled by default
+    bool use_parallel_pipeline;
+
+    // keep convolution and gemm weights as fp16 for cpu inference, converted on the fly
+    // halve the weight memory and bandwidth at the cost of fp16 weight precision
+    // changes should be applied before loading network structure and weight
+    // disabled by default
+    bool use_fp16_weight_storage;
     bool use_reserved_8;
     bool use_reserved_9;
     bool use_reserved_10;
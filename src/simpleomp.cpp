@@ -24,6 +24,12 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdarg.h>
+#include <time.h>
+
+#if defined __ANDROID__ || defined __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #if __clang__
 extern "C" typedef void (*kmpc_micro)(int32_t* gtid, int32_t* tid, ...);
@@ -74,6 +80,8 @@ static void* kmp_threadfunc(void* args);
 
 namespace ncnn {
 
+class KMPWorker;
+
 class KMPTask
 {
 public:
@@ -93,103 +101,40 @@ public:
     // per-task
     int thread_num;
 
-    // finish status
-    int* num_threads_to_wait;
-    Mutex* finish_lock;
-    ConditionVariable* finish_condition;
+    // the worker running this task, null if the master runs it
+    KMPWorker* worker;
 };
 
-class KMPTaskQueue
+// task slot owned by one pool thread
+class KMPWorker
 {
 public:
-    KMPTaskQueue(int _max_size)
-    {
-        max_size = _max_size;
-        tasks = new KMPTask*[max_size];
-        size = 0;
-        front = 0;
-        back = 0;
-    }
-
-    ~KMPTaskQueue()
-    {
-        delete[] tasks;
-    }
-
-    void dispatch(KMPTask* v, int n)
-    {
-        lock.lock();
-
-        if (size + n > max_size)
-        {
-            lock.unlock();
-
-            for (int i = 0; i < n; i++)
-            {
-                put(&v[i]);
-            }
-            return;
-        }
-
-        for (int i = 0; i < n; i++)
-        {
-            tasks[back] = &v[i];
-            back++;
-            if (back == max_size)
-                back = 0;
-        }
-
-        size += n;
-
-        lock.unlock();
-
-        condition.signal();
-    }
-
-    void put(KMPTask* v)
+    KMPWorker()
     {
-        lock.lock();
-        while (size >= max_size)
-        {
-            condition.wait(lock);
-        }
-        tasks[back] = v;
-        back++;
-        if (back == max_size)
-            back = 0;
-        size++;
-        lock.unlock();
-
-        condition.signal();
+        state = 0;
+        task = 0;
+        sleeping = 0;
+        waiting = 0;
+        thread = 0;
+        tid = 0;
     }
 
-    void get(KMPTask*& v)
-    {
-        lock.lock();
-        while (size == 0)
-        {
-            condition.wait(lock);
-        }
-        v = tasks[front];
-        front++;
-        if (front == max_size)
-            front = 0;
-        size--;
-        lock.unlock();
-
-        condition.signal();
-    }
+    // 0 = idle, 1 = claimed by a master, 2 = task posted, 3 = task finished
+    volatile int state;
+    KMPTask* task;
 
-private:
+    // worker parked for new task
+    volatile int sleeping;
     Mutex lock;
     ConditionVariable condition;
 
-    // ring buffer queue
-    int max_size;
-    KMPTask** tasks;
-    int size;
-    int front;
-    int back;
+    // master parked for task finish
+    volatile int waiting;
+    Mutex finish_lock;
+    ConditionVariable finish_condition;
+
+    ncnn::Thread* thread;
+    int tid;
 };
 
 class KMPGlobal
@@ -198,9 +143,9 @@ public:
     KMPGlobal()
     {
         kmp_max_threads = 0;
-        kmp_threads = 0;
-        kmp_threads_tid = 0;
-        kmp_task_queue = 0;
+        kmp_workers = 0;
+        kmp_thread_affinity_mask = 0;
+        kmp_oversubscribed = false;
     }
 
     ~KMPGlobal()
@@ -221,16 +166,21 @@ public:
         // NCNN_LOGE("KMPGlobal init");
         kmp_max_threads = ncnn::get_cpu_count();
 
-        kmp_task_queue = new ncnn::KMPTaskQueue(std::max(kmp_max_threads * 4, 16));
+        // workers stay on the cores of current powersave mode
+        kmp_thread_affinity_mask = &ncnn::get_cpu_thread_affinity_mask(ncnn::get_cpu_powersave());
+
+        int num_cpus = kmp_thread_affinity_mask->num_enabled();
+        if (num_cpus == 0)
+            num_cpus = ncnn::get_cpu_count();
+        kmp_oversubscribed = kmp_max_threads > num_cpus;
 
         if (kmp_max_threads > 1)
         {
-            kmp_threads = new ncnn::Thread*[kmp_max_threads - 1];
-            kmp_threads_tid = new int[kmp_max_threads - 1];
+            kmp_workers = new ncnn::KMPWorker[kmp_max_threads - 1];
             for (int i = 0; i < kmp_max_threads - 1; i++)
             {
-                kmp_threads_tid[i] = i + 1;
-                kmp_threads[i] = new ncnn::Thread(kmp_threadfunc, (void*)&kmp_threads_tid[i]);
+                kmp_workers[i].tid = i + 1;
+                kmp_workers[i].thread = new ncnn::Thread(kmp_threadfunc, (void*)&kmp_workers[i]);
             }
         }
     }
@@ -254,13 +204,22 @@ public:
 #endif
                 tasks[i].num_threads = kmp_max_threads;
                 tasks[i].thread_num = i + 1;
-                tasks[i].num_threads_to_wait = 0;
-                tasks[i].finish_lock = 0;
-                tasks[i].finish_condition = 0;
+                tasks[i].worker = 0;
             }
 
-            // dispatch 1 ~ kmp_max_threads
-            kmp_task_queue->dispatch(tasks, kmp_max_threads - 1);
+            // post exit to every worker
+            for (int i = 0; i < kmp_max_threads - 1; i++)
+            {
+                ncnn::KMPWorker* w = &kmp_workers[i];
+
+                int expected = 0;
+                while (!__atomic_compare_exchange_n(&w->state, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                {
+                    expected = 0;
+                }
+
+                kmp_post(w, &tasks[i]);
+            }
 
             for (int i = 0; i < kmp_max_threads - 1; i++)
             {
@@ -268,22 +227,74 @@ public:
                 // FIXME emscripten complains
                 // pthread_join attempted on thread 12345678,
                 // which does not point to a valid thread, or does not exist anymore!
-                kmp_threads[i]->join();
+                kmp_workers[i].thread->join();
 #endif
-                delete kmp_threads[i];
+                delete kmp_workers[i].thread;
             }
-            delete[] kmp_threads;
-            delete[] kmp_threads_tid;
+            delete[] kmp_workers;
+        }
+    }
+
+    static void kmp_post(ncnn::KMPWorker* w, ncnn::KMPTask* task)
+    {
+        task->worker = w;
+        w->task = task;
+
+        __atomic_store_n(&w->state, 2, __ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(&w->sleeping, __ATOMIC_SEQ_CST))
+        {
+            w->lock.lock();
+            w->condition.signal();
+            w->lock.unlock();
         }
+    }
+
+    // hand task 1 ~ n to idle workers, task i prefers worker i
+    // tasks without an idle worker are left to the master
+    void dispatch(ncnn::KMPTask* tasks, int n)
+    {
+        const int num_workers = kmp_max_threads - 1;
+
+        bool all_busy = false;
+        for (int i = 0; i < n; i++)
+        {
+            tasks[i].worker = 0;
+
+            if (all_busy)
+                continue;
+
+            ncnn::KMPWorker* w = 0;
+            for (int j = 0; j < num_workers; j++)
+            {
+                ncnn::KMPWorker* wj = &kmp_workers[(tasks[i].thread_num - 1 + j) % num_workers];
+
+                int expected = 0;
+                if (__atomic_load_n(&wj->state, __ATOMIC_RELAXED) == 0 && __atomic_compare_exchange_n(&wj->state, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                {
+                    w = wj;
+                    break;
+                }
+            }
 
-        delete kmp_task_queue;
+            if (!w)
+            {
+                all_busy = true;
+                continue;
+            }
+
+            kmp_post(w, &tasks[i]);
+        }
     }
 
+    // run tasks left to the master, then wait for the workers
+    void wait(ncnn::KMPTask* tasks, int n);
+
 public:
     int kmp_max_threads;
-    ncnn::Thread** kmp_threads;
-    int* kmp_threads_tid;
-    ncnn::KMPTaskQueue* kmp_task_queue;
+    ncnn::KMPWorker* kmp_workers;
+    const ncnn::CpuSet* kmp_thread_affinity_mask;
+    bool kmp_oversubscribed;
 };
 
 } // namespace ncnn
@@ -295,11 +306,75 @@ static ncnn::KMPGlobal g_kmp_global;
 static ncnn::ThreadLocalStorage tls_num_threads;
 static ncnn::ThreadLocalStorage tls_thread_num;
 
+// spin time in ms before parking, 0 for passive waiting
+static int g_kmp_blocktime = 0;
+
 static void init_g_kmp_global()
 {
     g_kmp_global.init();
 }
 
+static uint64_t kmp_get_time_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static NCNN_FORCEINLINE void kmp_cpu_relax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__arm__) && __ARM_ARCH >= 7)
+    __asm__ __volatile__("yield" ::: "memory");
+#endif
+}
+
+// busy wait until *addr == value for at most blocktime
+// return false if timeout
+static bool kmp_spin_wait(volatile int* addr, int value)
+{
+    if (__atomic_load_n(addr, __ATOMIC_ACQUIRE) == value)
+        return true;
+
+    // spinning only steals time from the busy threads if cores are not enough
+    const int blocktime = __atomic_load_n(&g_kmp_blocktime, __ATOMIC_RELAXED);
+    if (blocktime <= 0 || g_kmp_global.kmp_oversubscribed)
+        return false;
+
+    const uint64_t deadline = kmp_get_time_us() + blocktime * 1000;
+    for (;;)
+    {
+        for (int i = 0; i < 64; i++)
+        {
+            if (__atomic_load_n(addr, __ATOMIC_ACQUIRE) == value)
+                return true;
+
+            kmp_cpu_relax();
+        }
+
+        if (kmp_get_time_us() >= deadline)
+            return false;
+    }
+}
+
+static void kmp_pin_thread(const ncnn::CpuSet* thread_affinity_mask)
+{
+#if defined __ANDROID__ || defined __linux__
+    if (!thread_affinity_mask || thread_affinity_mask->num_enabled() == 0)
+        return;
+
+    pid_t pid = syscall(SYS_gettid);
+    int syscallret = syscall(__NR_sched_setaffinity, pid, sizeof(cpu_set_t), &thread_affinity_mask->cpu_set);
+    if (syscallret)
+    {
+        NCNN_LOGE("syscall error %d", syscallret);
+    }
+#else
+    (void)thread_affinity_mask;
+#endif
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -334,17 +409,17 @@ int omp_get_thread_num()
     return (int)reinterpret_cast<size_t>(tls_thread_num.get());
 }
 
-#if __clang__
 int kmp_get_blocktime()
 {
-    return 0;
+    return __atomic_load_n(&g_kmp_blocktime, __ATOMIC_RELAXED);
 }
 
-void kmp_set_blocktime(int /*blocktime*/)
+void kmp_set_blocktime(int blocktime)
 {
-    // always passive, ignore
+    __atomic_store_n(&g_kmp_blocktime, std::max(blocktime, 0), __ATOMIC_RELAXED);
 }
 
+#if __clang__
 static int kmp_invoke_microtask(kmpc_micro fn, int gtid, int tid, int argc, void** argv)
 {
     // fprintf(stderr, "__kmp_invoke_microtask %d %d %d\n", gtid, tid, argc);
@@ -456,42 +531,99 @@ static int kmp_invoke_microtask(kmpc_micro fn, int gtid, int tid, int argc, void
 }
 #endif // __clang__
 
-static void* kmp_threadfunc(void* args)
+static void kmp_run_task(ncnn::KMPTask* task, int tid)
 {
+    tls_num_threads.set(reinterpret_cast<void*>((size_t)task->num_threads));
+    tls_thread_num.set(reinterpret_cast<void*>((size_t)task->thread_num));
+
 #if __clang__
-    int tid = *(int*)args;
+    kmp_invoke_microtask(task->fn, task->thread_num, tid, task->argc, task->argv);
 #else
-    (void)args;
+    (void)tid;
+    task->fn(task->data);
 #endif
+}
+
+void ncnn::KMPGlobal::wait(ncnn::KMPTask* tasks, int n)
+{
+    // run tasks no worker picked up
+    bool run_by_master = false;
+    for (int i = 0; i < n; i++)
+    {
+        if (tasks[i].worker)
+            continue;
+
+        kmp_run_task(&tasks[i], 0);
+        run_by_master = true;
+    }
+
+    if (run_by_master)
+    {
+        tls_thread_num.set(reinterpret_cast<void*>((size_t)0));
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        ncnn::KMPWorker* w = tasks[i].worker;
+        if (!w)
+            continue;
+
+        // spin for a while then park
+        if (!kmp_spin_wait(&w->state, 3))
+        {
+            w->finish_lock.lock();
+            __atomic_store_n(&w->waiting, 1, __ATOMIC_SEQ_CST);
+            while (__atomic_load_n(&w->state, __ATOMIC_SEQ_CST) != 3)
+            {
+                w->finish_condition.wait(w->finish_lock);
+            }
+            __atomic_store_n(&w->waiting, 0, __ATOMIC_RELAXED);
+            w->finish_lock.unlock();
+        }
+
+        // release the worker
+        __atomic_store_n(&w->state, 0, __ATOMIC_RELEASE);
+    }
+}
+
+static void* kmp_threadfunc(void* args)
+{
+    ncnn::KMPWorker* w = (ncnn::KMPWorker*)args;
+
+    kmp_pin_thread(g_kmp_global.kmp_thread_affinity_mask);
 
     for (;;)
     {
-        ncnn::KMPTask* task;
-        g_kmp_global.kmp_task_queue->get(task);
+        // spin for a while then park
+        if (!kmp_spin_wait(&w->state, 2))
+        {
+            w->lock.lock();
+            __atomic_store_n(&w->sleeping, 1, __ATOMIC_SEQ_CST);
+            while (__atomic_load_n(&w->state, __ATOMIC_SEQ_CST) != 2)
+            {
+                w->condition.wait(w->lock);
+            }
+            __atomic_store_n(&w->sleeping, 0, __ATOMIC_RELAXED);
+            w->lock.unlock();
+        }
 
-        // fprintf(stderr, "get %d\n", tid);
+        ncnn::KMPTask* task = w->task;
+
+        // fprintf(stderr, "get %d\n", w->tid);
 
         if (!task->fn)
             break;
 
-        tls_num_threads.set(reinterpret_cast<void*>((size_t)task->num_threads));
-        tls_thread_num.set(reinterpret_cast<void*>((size_t)task->thread_num));
-
-#if __clang__
-        kmp_invoke_microtask(task->fn, task->thread_num, tid, task->argc, task->argv);
-#else
-        task->fn(task->data);
-#endif
+        kmp_run_task(task, w->tid);
 
         // update finished
+        __atomic_store_n(&w->state, 3, __ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(&w->waiting, __ATOMIC_SEQ_CST))
         {
-            task->finish_lock->lock();
-            *task->num_threads_to_wait = *task->num_threads_to_wait - 1;
-            if (*task->num_threads_to_wait == 0)
-            {
-                task->finish_condition->signal();
-            }
-            task->finish_lock->unlock();
+            w->finish_lock.lock();
+            w->finish_condition.signal();
+            w->finish_lock.unlock();
         }
     }
 
@@ -541,10 +673,6 @@ void __kmpc_fork_call(void* /*loc*/, int32_t argc, kmpc_micro fn, ...)
         return;
     }
 
-    int num_threads_to_wait = num_threads - 1;
-    ncnn::Mutex finish_lock;
-    ncnn::ConditionVariable finish_condition;
-
     // TODO portable stack allocation
     ncnn::KMPTask* tasks = (ncnn::KMPTask*)alloca((num_threads - 1) * sizeof(ncnn::KMPTask));
     for (int i = 0; i < num_threads - 1; i++)
@@ -554,13 +682,11 @@ void __kmpc_fork_call(void* /*loc*/, int32_t argc, kmpc_micro fn, ...)
         tasks[i].argv = (void**)argv;
         tasks[i].num_threads = num_threads;
         tasks[i].thread_num = i + 1;
-        tasks[i].num_threads_to_wait = &num_threads_to_wait;
-        tasks[i].finish_lock = &finish_lock;
-        tasks[i].finish_condition = &finish_condition;
+        tasks[i].worker = 0;
     }
 
     // dispatch 1 ~ num_threads
-    g_kmp_global.kmp_task_queue->dispatch(tasks, num_threads - 1);
+    g_kmp_global.dispatch(tasks, num_threads - 1);
 
     // dispatch 0
     {
@@ -571,14 +697,7 @@ void __kmpc_fork_call(void* /*loc*/, int32_t argc, kmpc_micro fn, ...)
     }
 
     // wait for finished
-    {
-        finish_lock.lock();
-        if (num_threads_to_wait != 0)
-        {
-            finish_condition.wait(finish_lock);
-        }
-        finish_lock.unlock();
-    }
+    g_kmp_global.wait(tasks, num_threads - 1);
 }
 
 void __kmpc_for_static_init_4(void* /*loc*/, int32_t gtid, int32_t /*sched*/, int32_t* last, int32_t* lower, int32_t* upper, int32_t* /*stride*/, int32_t /*incr*/, int32_t /*chunk*/)
@@ -656,9 +775,7 @@ static ncnn::ThreadLocalStorage tls_parallel_context;
 
 struct parallel_context
 {
-    int num_threads_to_wait;
-    ncnn::Mutex finish_lock;
-    ncnn::ConditionVariable finish_condition;
+    int num_tasks;
     ncnn::KMPTask* tasks;
 };
 
@@ -689,7 +806,7 @@ void GOMP_parallel_start(void (*fn)(void*), void* data, unsigned num_threads)
 
     tls_parallel_context.set(pc);
 
-    pc->num_threads_to_wait = num_threads - 1;
+    pc->num_tasks = num_threads - 1;
 
     pc->tasks = new ncnn::KMPTask[num_threads - 1];
     for (unsigned i = 0; i < num_threads - 1; i++)
@@ -698,13 +815,11 @@ void GOMP_parallel_start(void (*fn)(void*), void* data, unsigned num_threads)
         pc->tasks[i].data = data;
         pc->tasks[i].num_threads = num_threads;
         pc->tasks[i].thread_num = i + 1;
-        pc->tasks[i].num_threads_to_wait = &pc->num_threads_to_wait;
-        pc->tasks[i].finish_lock = &pc->finish_lock;
-        pc->tasks[i].finish_condition = &pc->finish_condition;
+        pc->tasks[i].worker = 0;
     }
 
     // dispatch 1 ~ num_threads
-    g_kmp_global.kmp_task_queue->dispatch(pc->tasks, num_threads - 1);
+    g_kmp_global.dispatch(pc->tasks, num_threads - 1);
 
     // dispatch 0
     {
@@ -720,14 +835,7 @@ void GOMP_parallel_end()
     tls_parallel_context.set(0);
 
     // wait for finished
-    {
-        pc->finish_lock.lock();
-        if (pc->num_threads_to_wait != 0)
-        {
-            pc->finish_condition.wait(pc->finish_lock);
-        }
-        pc->finish_lock.unlock();
-    }
+    g_kmp_global.wait(pc->tasks, pc->num_tasks);
 
     delete[] pc->tasks;
     delete pc;
@@ -756,10 +864,6 @@ void GOMP_parallel(void (*fn)(void*), void* data, unsigned num_threads, unsigned
         return;
     }
 
-    int num_threads_to_wait = num_threads - 1;
-    ncnn::Mutex finish_lock;
-    ncnn::ConditionVariable finish_condition;
-
     // TODO portable stack allocation
     ncnn::KMPTask* tasks = (ncnn::KMPTask*)alloca((num_threads - 1) * sizeof(ncnn::KMPTask));
     for (unsigned i = 0; i < num_threads - 1; i++)
@@ -768,13 +872,11 @@ void GOMP_parallel(void (*fn)(void*), void* data, unsigned num_threads, unsigned
         tasks[i].data = data;
         tasks[i].num_threads = num_threads;
         tasks[i].thread_num = i + 1;
-        tasks[i].num_threads_to_wait = &num_threads_to_wait;
-        tasks[i].finish_lock = &finish_lock;
-        tasks[i].finish_condition = &finish_condition;
+        tasks[i].worker = 0;
     }
 
     // dispatch 1 ~ num_threads
-    g_kmp_global.kmp_task_queue->dispatch(tasks, num_threads - 1);
+    g_kmp_global.dispatch(tasks, num_threads - 1);
 
     // dispatch 0
     {
@@ -785,14 +887,7 @@ void GOMP_parallel(void (*fn)(void*), void* data, unsigned num_threads, unsigned
     }
 
     // wait for finished
-    {
-        finish_lock.lock();
-        if (num_threads_to_wait != 0)
-        {
-            finish_condition.wait(finish_lock);
-        }
-        finish_lock.unlock();
-    }
+    g_kmp_global.wait(tasks, num_threads - 1);
 }
 #endif // __clang__
 
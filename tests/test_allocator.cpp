@@ -0,0 +1,303 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "mat.h"
+
+static int test_size_class_pool_allocator_reuse()
+{
+    ncnn::SizeClassPoolAllocator allocator;
+
+    static const size_t sizes[] = {1, 63, 64, 65, 100, 1000, 4096, 4097, 100000, 3 * 1024 * 1024 + 7};
+    const int count = sizeof(sizes) / sizeof(sizes[0]);
+
+    void* ptrs[count];
+    for (int i = 0; i < count; i++)
+    {
+        unsigned char* ptr = (unsigned char*)allocator.fastMalloc(sizes[i]);
+        if (!ptr || ((size_t)ptr % NCNN_MALLOC_ALIGN) != 0)
+        {
+            fprintf(stderr, "size class pool allocator returned misaligned block for size %d\n", (int)sizes[i]);
+            return -1;
+        }
+
+        memset(ptr, 0x5a, sizes[i]);
+        ptrs[i] = ptr;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        allocator.fastFree(ptrs[i]);
+    }
+
+    if (allocator.misses() != (size_t)count || allocator.hits() != 0)
+    {
+        fprintf(stderr, "size class pool allocator first round should only miss\n");
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        void* ptr = allocator.fastMalloc(sizes[i]);
+        allocator.fastFree(ptr);
+    }
+
+    if (allocator.hits() != (size_t)count)
+    {
+        fprintf(stderr, "size class pool allocator second round should only hit, got %d hits\n", (int)allocator.hits());
+        return -1;
+    }
+
+    if (allocator.bytes_held() == 0)
+    {
+        fprintf(stderr, "size class pool allocator should hold idle blocks\n");
+        return -1;
+    }
+
+    allocator.clear();
+
+    if (allocator.bytes_held() != 0)
+    {
+        fprintf(stderr, "size class pool allocator clear should release all idle blocks\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_size_class_pool_allocator_accounting()
+{
+    ncnn::SizeClassPoolAllocator allocator;
+
+    // 1000 bytes round up to the 1024 class
+    const int count = 100;
+    const size_t size = 1000;
+
+    // most blocks overflow the thread cache into the shared freelist
+    void* ptrs[count];
+    for (int k = 0; k < 3; k++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            ptrs[i] = allocator.fastMalloc(size);
+
+            // user data must not overlap the block header
+            memset(ptrs[i], 0xff, size);
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            allocator.fastFree(ptrs[i]);
+        }
+
+        if (allocator.bytes_held() != count * 1024)
+        {
+            fprintf(stderr, "size class pool allocator should hold %d bytes, got %d\n", count * 1024, (int)allocator.bytes_held());
+            return -1;
+        }
+    }
+
+    if (allocator.misses() != (size_t)count || allocator.hits() != (size_t)count * 2)
+    {
+        fprintf(stderr, "size class pool allocator should reuse every block, got %d hits %d misses\n", (int)allocator.hits(), (int)allocator.misses());
+        return -1;
+    }
+
+    allocator.clear();
+
+    if (allocator.bytes_held() != 0)
+    {
+        fprintf(stderr, "size class pool allocator clear should release all idle blocks\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_size_class_pool_allocator_mat()
+{
+    ncnn::SizeClassPoolAllocator allocator;
+
+    for (int i = 0; i < 4; i++)
+    {
+        ncnn::Mat m(17, 13, 5, 4u, &allocator);
+        m.fill(1.f);
+
+        ncnn::Mat m2 = m.clone(&allocator);
+        if (m2[0] != 1.f || m2.channel(4).row(12)[16] != 1.f)
+        {
+            fprintf(stderr, "size class pool allocator mat clone mismatch\n");
+            return -1;
+        }
+    }
+
+    if (allocator.hits() == 0)
+    {
+        fprintf(stderr, "size class pool allocator should reuse mat blocks\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+#if NCNN_THREADS
+struct allocator_thread_args
+{
+    ncnn::SizeClassPoolAllocator* allocator;
+    int seed;
+    int ret;
+};
+
+static void* allocator_thread_worker(void* args)
+{
+    allocator_thread_args* a = (allocator_thread_args*)args;
+
+    void* ptrs[32] = {0};
+
+    unsigned int r = a->seed;
+    for (int i = 0; i < 20000; i++)
+    {
+        r = r * 1103515245 + 12345;
+        const int slot = (r >> 8) % 32;
+
+        if (ptrs[slot])
+        {
+            // check the pattern written on allocation
+            if (*(int*)ptrs[slot] != slot + a->seed)
+                a->ret = -1;
+
+            a->allocator->fastFree(ptrs[slot]);
+            ptrs[slot] = 0;
+        }
+        else
+        {
+            const size_t size = 4 + (r >> 16) % 8192;
+            ptrs[slot] = a->allocator->fastMalloc(size);
+            *(int*)ptrs[slot] = slot + a->seed;
+        }
+    }
+
+    for (int i = 0; i < 32; i++)
+    {
+        a->allocator->fastFree(ptrs[i]);
+    }
+
+    return 0;
+}
+
+static int test_size_class_pool_allocator_threads()
+{
+    ncnn::SizeClassPoolAllocator allocator;
+
+    // small thread cache so that blocks travel through the shared freelists
+    allocator.set_thread_cache_size(64 * 1024);
+
+    const int num_threads = 4;
+
+    allocator_thread_args args[num_threads];
+    ncnn::Thread* threads[num_threads];
+    for (int i = 0; i < num_threads; i++)
+    {
+        args[i].allocator = &allocator;
+        args[i].seed = i * 1000;
+        args[i].ret = 0;
+        threads[i] = new ncnn::Thread(allocator_thread_worker, &args[i]);
+    }
+
+    int ret = 0;
+    for (int i = 0; i < num_threads; i++)
+    {
+        threads[i]->join();
+        delete threads[i];
+
+        if (args[i].ret != 0)
+            ret = -1;
+    }
+
+    if (ret != 0)
+    {
+        fprintf(stderr, "size class pool allocator blocks corrupted across threads\n");
+        return -1;
+    }
+
+    if (allocator.hits() == 0)
+    {
+        fprintf(stderr, "size class pool allocator should reuse blocks across threads\n");
+        return -1;
+    }
+
+    allocator.clear();
+
+    if (allocator.bytes_held() != 0)
+    {
+        fprintf(stderr, "size class pool allocator clear should release blocks of all threads\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void* allocator_thread_exit_worker(void* args)
+{
+    ncnn::SizeClassPoolAllocator* allocator = (ncnn::SizeClassPoolAllocator*)args;
+
+    // the block stays in the thread cache until the thread exits
+    allocator->fastFree(allocator->fastMalloc(5000));
+
+    return 0;
+}
+
+static int test_size_class_pool_allocator_thread_exit()
+{
+    ncnn::SizeClassPoolAllocator allocator;
+
+    ncnn::Thread* thread = new ncnn::Thread(allocator_thread_exit_worker, &allocator);
+    thread->join();
+    delete thread;
+
+    // another thread reuses the block left by the exited one
+    allocator.fastFree(allocator.fastMalloc(5000));
+
+    if (allocator.hits() != 1 || allocator.misses() != 1)
+    {
+        fprintf(stderr, "size class pool allocator should take over the cache of an exited thread, got %d hits %d misses\n", (int)allocator.hits(), (int)allocator.misses());
+        return -1;
+    }
+
+    return 0;
+}
+#else
+static int test_size_class_pool_allocator_threads()
+{
+    return 0;
+}
+
+static int test_size_class_pool_allocator_thread_exit()
+{
+    return 0;
+}
+#endif
+
+int main()
+{
+    return 0
+           || test_size_class_pool_allocator_reuse()
+           || test_size_class_pool_allocator_accounting()
+           || test_size_class_pool_allocator_mat()
+           || test_size_class_pool_allocator_threads()
+           || test_size_class_pool_allocator_thread_exit();
+}
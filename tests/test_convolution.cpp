@@ -414,10 +414,70 @@ static int test_convolution_1()
            || test_convolution_int8(4, 20, 16, 24, 3, 1, 1, 1, 0)
            || test_convolution_int8(6, 7, 64, 64, 3, 1, 2, 0, 1)
            || test_convolution_int8(25, 33, 16, 15, 3, 1, 1, 1, 0)
-           || test_convolution_int8(7, 7, 15, 12, 3, 1, 1, 1, 0);
+           || test_convolution_int8(7, 7, 15, 12, 3, 1, 1, 1, 0)
+           || test_convolution_int8(23, 11, 32, 48, 3, 1, 1, 1, 1)
+           || test_convolution_int8(28, 4, 16, 36, 3, 1, 1, 1, 0)
+           || test_convolution_int8(19, 18, 24, 20, 3, 1, 1, 1, 1, true)
+           || test_convolution_int8(33, 31, 64, 40, 3, 1, 2, 1, 1)
+           || test_convolution_int8(15, 13, 520, 36, 1, 1, 1, 0, 1, true);
 }
 #endif // NCNN_INT8
 
+static int test_convolution_batch(int w, int h, int c, int outch, int kernel, int dilation, int stride, int pad, int pad_bottom, int bias, int batch)
+{
+    // distinct samples so that a mixed up or misplaced sample is caught
+    std::vector<ncnn::Mat> a(batch);
+    for (int i = 0; i < batch; i++)
+    {
+        a[i] = RandomMat(w, h, c);
+    }
+
+    ncnn::ParamDict pd;
+    pd.set(0, outch);
+    pd.set(1, kernel);
+    pd.set(2, dilation);
+    pd.set(3, stride);
+    pd.set(4, pad);
+    pd.set(16, pad_bottom);
+    pd.set(5, bias);
+    pd.set(6, outch * c * kernel * kernel);
+
+    int activation_type = RAND() % 7; // 0 1 2 3 4 5 6
+    ncnn::Mat activation_params(2);
+    activation_params[0] = (activation_type == 6) ? RandomFloat(0, 1) : RandomFloat(-1, 0); // alpha
+    activation_params[1] = RandomFloat(0, 1);                                               // beta
+    pd.set(9, activation_type);
+    pd.set(10, activation_params);
+
+    std::vector<ncnn::Mat> weights(bias ? 2 : 1);
+    weights[0] = RandomMat(outch * c * kernel * kernel);
+    if (bias)
+        weights[1] = RandomMat(outch);
+
+    int ret = test_layer_batch("Convolution", pd, weights, a);
+    if (ret != 0)
+    {
+        fprintf(stderr, "test_convolution_batch failed w=%d h=%d c=%d outch=%d kernel=%d dilation=%d stride=%d pad=%d pad_bottom=%d bias=%d batch=%d act=%d actparams=[%f,%f]\n", w, h, c, outch, kernel, dilation, stride, pad, pad_bottom, bias, batch, activation_type, activation_params[0], activation_params[1]);
+    }
+
+    return ret;
+}
+
+static int test_convolution_4()
+{
+    // the weight bound cases stack the samples along height
+    return 0
+           || test_convolution_batch(9, 8, 16, 32, 3, 1, 1, 1, 1, 1, 3)
+           || test_convolution_batch(9, 7, 16, 32, 3, 1, 1, 1, 0, 0, 4)
+           || test_convolution_batch(10, 8, 16, 24, 3, 1, 2, 1, 1, 1, 4)
+           || test_convolution_batch(9, 8, 16, 16, 3, 2, 1, 2, 2, 1, 2)
+           || test_convolution_batch(6, 6, 12, 16, 5, 1, 1, 2, 2, 1, 2)
+           || test_convolution_batch(5, 4, 8, 32, 1, 1, 1, 0, 0, 0, 3)
+           || test_convolution_batch(6, 6, 3, 8, 3, 1, 2, 0, 0, 1, 3)
+           || test_convolution_batch(9, 7, 16, 32, 3, 1, 1, -233, -233, 1, 2)
+           || test_convolution_batch(32, 32, 4, 8, 3, 1, 1, 1, 1, 1, 2);
+}
+
 int main()
 {
     SRAND(7767517);
@@ -427,11 +487,13 @@ int main()
            || test_convolution_0()
            || test_convolution_1()
            || test_convolution_2()
-           || test_convolution_3();
+           || test_convolution_3()
+           || test_convolution_4();
 #else
     return 0
            || test_convolution_0()
            || test_convolution_2()
-           || test_convolution_3();
+           || test_convolution_3()
+           || test_convolution_4();
 #endif
 }
@@ -68,6 +68,68 @@ static int test_gemm_bias(int M, int N, int K, const ncnn::Mat& C, float alpha,
     return ret;
 }
 
+static int test_gemm_constantB(int M, int N, int K, const ncnn::Mat& C, float alpha, float beta, int transA, int transB)
+{
+    ncnn::ParamDict pd;
+    pd.set(0, alpha);
+    pd.set(1, beta);
+    pd.set(2, transA);
+    pd.set(3, transB);
+    pd.set(5, 1); // constantB
+    pd.set(8, N);
+    pd.set(9, K);
+
+    std::vector<ncnn::Mat> weights(1);
+    weights[0] = transB ? RandomMat(K, N) : RandomMat(N, K);
+
+    std::vector<ncnn::Mat> a(C.empty() ? 1 : 2);
+    a[0] = transA ? ncnn::Mat(M, K) : ncnn::Mat(K, M);
+    if (!C.empty())
+        a[1] = C;
+
+    Randomize(a[0]);
+
+    int ret = test_layer<ncnn::Gemm>("Gemm", pd, weights, a);
+    if (ret != 0)
+    {
+        fprintf(stderr, "test_gemm_constantB failed M=%d N=%d K=%d C.dims=%d C=(%d %d %d) alpha=%f beta=%f transA=%d transB=%d\n", M, N, K, C.dims, C.w, C.h, C.c, alpha, beta, transA, transB);
+    }
+
+    return ret;
+}
+
+static int test_gemm_constantA(int M, int N, int K, const ncnn::Mat& C, float alpha, float beta, int transA, int transB, int output_N1M, int output_elempack)
+{
+    ncnn::ParamDict pd;
+    pd.set(0, alpha);
+    pd.set(1, beta);
+    pd.set(2, transA);
+    pd.set(3, transB);
+    pd.set(4, 1); // constantA
+    pd.set(7, M);
+    pd.set(9, K);
+    pd.set(11, output_N1M);
+    pd.set(12, output_elempack);
+
+    std::vector<ncnn::Mat> weights(1);
+    weights[0] = transA ? RandomMat(M, K) : RandomMat(K, M);
+
+    std::vector<ncnn::Mat> a(C.empty() ? 1 : 2);
+    a[0] = transB ? ncnn::Mat(K, N) : ncnn::Mat(N, K);
+    if (!C.empty())
+        a[1] = C;
+
+    Randomize(a[0]);
+
+    int ret = test_layer<ncnn::Gemm>("Gemm", pd, weights, a);
+    if (ret != 0)
+    {
+        fprintf(stderr, "test_gemm_constantA failed M=%d N=%d K=%d C.dims=%d C=(%d %d %d) alpha=%f beta=%f transA=%d transB=%d output_N1M=%d output_elempack=%d\n", M, N, K, C.dims, C.w, C.h, C.c, alpha, beta, transA, transB, output_N1M, output_elempack);
+    }
+
+    return ret;
+}
+
 static int test_gemm_0()
 {
     return 0
@@ -159,6 +221,45 @@ static int test_gemm_6()
            || test_gemm_bias(16, 24, 15, RandomMat(14), 1.7f, 1.3f, 1, 1);
 }
 
+static int test_gemm_7()
+{
+    return 0
+           || test_gemm_constantB(13, 14, 15, ncnn::Mat(), 0.1f, 1.f, 0, 0)
+           || test_gemm_constantB(13, 14, 15, ncnn::Mat(), 0.4f, 1.f, 1, 1)
+           || test_gemm_constantB(13, 14, 15, RandomMat(14), -0.3f, 0.5f, 0, 1)
+           || test_gemm_constantB(13, 14, 15, RandomMat(14, 13), 1.7f, 2.f, 1, 0)
+           || test_gemm_constantB(1, 35, 27, RandomMat(35), 1.f, 1.f, 0, 1)
+           || test_gemm_constantB(40, 150, 300, RandomMat(40), 0.5f, 1.f, 0, 1)
+           || test_gemm_constantB(40, 150, 300, RandomMat(150, 40), 0.5f, -1.f, 1, 0);
+}
+
+static int test_gemm_8()
+{
+    // multiple tiles along m, n and k
+    return 0
+           || test_gemm(100, 150, 300, 0.3f, 0, 0)
+           || test_gemm(100, 150, 300, 0.3f, 1, 1)
+           || test_gemm_bias(71, 260, 520, RandomMat(260, 71), 1.f, 0.5f, 0, 1)
+           || test_gemm_bias(71, 260, 520, RandomMat(71), 1.f, 0.5f, 1, 0)
+           || test_gemm(1, 35, 27, 0.5f, 0, 0)
+           || test_gemm(1, 35, 27, 0.5f, 1, 1)
+           || test_gemm_bias(5, 70, 130, RandomMat(70), 1.f, 2.f, 0, 1)
+           || test_gemm_bias(5, 70, 130, RandomMat(70, 5), 1.f, 2.f, 1, 0);
+}
+
+static int test_gemm_9()
+{
+    // constant A with the output laid out as N x 1 x M and packed along M
+    return 0
+           || test_gemm_constantA(13, 14, 15, ncnn::Mat(), 0.1f, 1.f, 0, 0, 0, 0)
+           || test_gemm_constantA(13, 14, 15, ncnn::Mat(), 0.4f, 1.f, 1, 1, 1, 0)
+           || test_gemm_constantA(16, 14, 15, RandomMat(1, 16), -0.3f, 0.5f, 0, 0, 1, 4)
+           || test_gemm_constantA(24, 35, 27, RandomMat(24), 1.f, 1.f, 1, 0, 0, 8)
+           || test_gemm_constantA(13, 35, 27, RandomMat(13), 1.f, 1.f, 0, 0, 1, 4)
+           || test_gemm_constantA(64, 150, 300, RandomMat(1, 64), 0.5f, 1.f, 0, 0, 1, 16)
+           || test_gemm_constantA(40, 150, 300, RandomMat(150, 40), 0.5f, -1.f, 0, 1, 0, 4);
+}
+
 int main()
 {
     SRAND(7767517);
@@ -170,5 +271,8 @@ int main()
            || test_gemm_3()
            || test_gemm_4()
            || test_gemm_5()
-           || test_gemm_6();
+           || test_gemm_6()
+           || test_gemm_7()
+           || test_gemm_8()
+           || test_gemm_9();
 }
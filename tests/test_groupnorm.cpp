@@ -48,10 +48,20 @@ static int test_groupnorm_0()
            || test_groupnorm(RandomMat(8, 9, 24), 3, 0.0001f);
 }
 
+static int test_groupnorm_1()
+{
+    return 0
+           || test_groupnorm(RandomMat(7, 5, 48), 12, 0.001f)
+           || test_groupnorm(RandomMat(13, 11, 40), 4, 0.00001f)
+           || test_groupnorm(RandomMat(9, 8, 64), 32, 0.001f)
+           || test_groupnorm(RandomMat(11, 6, 32, 3.f, 5.f), 8, 0.001f);
+}
+
 int main()
 {
     SRAND(7767517);
 
     return 0
-           || test_groupnorm_0();
+           || test_groupnorm_0()
+           || test_groupnorm_1();
 }
@@ -15,6 +15,8 @@
 #include "layer/gru.h"
 #include "testutil.h"
 
+#include "net.h"
+
 static int test_gru(const ncnn::Mat& a, int outch, int direction)
 {
     int input_size = a.w;
@@ -249,8 +251,180 @@ static int test_gru_3()
            || test_gru(RandomMat(2, 5), 17, 1);
 }
 
+static int test_gru_long(const ncnn::Mat& a, int outch, int direction)
+{
+    int input_size = a.w;
+    int num_directions = direction == 2 ? 2 : 1;
+
+    ncnn::ParamDict pd;
+    pd.set(0, outch);
+    pd.set(1, outch * input_size * 3 * num_directions);
+    pd.set(2, direction);
+
+    // keep the recurrence contractive so that rounding differences do not blow up over long sequences
+    const float hc_scale = 1.f / sqrtf((float)outch);
+
+    std::vector<ncnn::Mat> weights(3);
+    weights[0] = RandomMat(outch * input_size * 3 * num_directions);
+    weights[1] = RandomMat(outch * 4 * num_directions);
+    weights[2] = RandomMat(outch * outch * 3 * num_directions, -hc_scale, hc_scale);
+
+    ncnn::Mat hidden = RandomMat(outch, num_directions);
+
+    std::vector<ncnn::Mat> as(2);
+    as[0] = a;
+    as[1] = hidden;
+
+    int ret = test_layer<ncnn::GRU>("GRU", pd, weights, as, 2);
+    if (ret != 0)
+    {
+        fprintf(stderr, "test_gru_long failed a.dims=%d a=(%d %d %d) outch=%d, direction = %d \n", a.dims, a.w, a.h, a.c, outch, direction);
+    }
+
+    return ret;
+}
+
+static int test_gru_4()
+{
+    // longer sequences with output blocks and tails of every width
+    return 0
+           || test_gru_long(RandomMat(32, 64), 35, 0)
+           || test_gru_long(RandomMat(13, 40), 64, 1)
+           || test_gru_long(RandomMat(24, 33), 29, 2)
+           || test_gru_long(RandomMat(40, 50), 61, 2)
+           || test_gru_long(RandomMat(7, 70), 48, 1);
+}
+
+// feed streams chunk by chunk through a streaming gru, one stream per batch sample
+// and compare with the whole sequences run at once
+static int test_gru_streaming(int input_size, int outch, int batch)
+{
+    const int T = 12;
+    const int chunks[3] = {3, 5, 4};
+
+    std::vector<ncnn::Mat> weights(3);
+    weights[0] = RandomMat(outch * input_size * 3);
+    weights[1] = RandomMat(outch * 4);
+    weights[2] = RandomMat(outch * outch * 3);
+
+    ncnn::Net net;
+    net.opt.use_fp16_storage = false;
+    net.opt.use_bf16_storage = false;
+
+    char parambuf[256];
+    sprintf(parambuf, "7767517\n2 2\nInput in 0 1 in\nGRU gru 1 1 in out 0=%d 1=%d 2=0 10=1\n", outch, outch * input_size * 3);
+    net.load_param_mem(parambuf);
+
+    DataReaderFromMatArray dr(weights.data());
+    net.load_model(dr);
+
+    ncnn::ParamDict pd;
+    pd.set(0, outch);
+    pd.set(1, outch * input_size * 3);
+    pd.set(2, 0);
+
+    ncnn::Option opt;
+    opt.num_threads = 1;
+    opt.use_fp16_storage = false;
+    opt.use_bf16_storage = false;
+
+    ncnn::Layer* ref = ncnn::create_layer("GRU");
+    ref->load_param(pd);
+    ref->load_model(ncnn::ModelBinFromMatArray(weights.data()));
+    ref->create_pipeline(opt);
+
+    std::vector<ncnn::Mat> xs(batch);
+    std::vector<ncnn::Mat> refs(batch);
+    for (int b = 0; b < batch; b++)
+    {
+        xs[b] = RandomMat(input_size, T);
+        ref->forward(xs[b], refs[b], opt);
+    }
+
+    int ret = 0;
+
+    ncnn::Extractor ex = net.create_extractor();
+
+    int t0 = 0;
+    for (int s = 0; s < 3 && ret == 0; s++)
+    {
+        std::vector<ncnn::Mat> xt(batch);
+        for (int b = 0; b < batch; b++)
+        {
+            xt[b] = xs[b].row_range(t0, chunks[s]).clone();
+        }
+
+        ex.clear_blobs();
+
+        std::vector<ncnn::Mat> outs(batch);
+        if (batch == 1)
+        {
+            ex.input("in", xt[0]);
+            ex.extract("out", outs[0]);
+        }
+        else
+        {
+            ex.input("in", xt);
+            ex.extract("out", outs);
+        }
+
+        for (int b = 0; b < batch; b++)
+        {
+            if (CompareMat(outs[b], refs[b].row_range(t0, chunks[s]), 0.001) != 0)
+            {
+                fprintf(stderr, "test_gru_streaming failed input_size=%d outch=%d batch=%d at chunk %d stream %d\n", input_size, outch, batch, s, b);
+                ret = -1;
+            }
+        }
+
+        t0 += chunks[s];
+    }
+
+    // a reset stream starts from zero hidden again
+    if (ret == 0)
+    {
+        ex.reset_states();
+        ex.clear_blobs();
+
+        std::vector<ncnn::Mat> outs(batch);
+        if (batch == 1)
+        {
+            ex.input("in", xs[0]);
+            ex.extract("out", outs[0]);
+        }
+        else
+        {
+            ex.input("in", xs);
+            ex.extract("out", outs);
+        }
+
+        for (int b = 0; b < batch; b++)
+        {
+            if (CompareMat(outs[b], refs[b], 0.001) != 0)
+            {
+                fprintf(stderr, "test_gru_streaming failed input_size=%d outch=%d batch=%d after reset stream %d\n", input_size, outch, batch, b);
+                ret = -1;
+            }
+        }
+    }
+
+    ref->destroy_pipeline(opt);
+    delete ref;
+
+    return ret;
+}
+
+static int test_gru_5()
+{
+    return 0
+           || test_gru_streaming(8, 16, 1)
+           || test_gru_streaming(13, 29, 1)
+           || test_gru_streaming(8, 16, 3)
+           || test_gru_streaming(13, 29, 4);
+}
+
 int main()
 {
     SRAND(7767517);
-    return test_gru_0() || test_gru_1() || test_gru_2() || test_gru_3();
+    return test_gru_0() || test_gru_1() || test_gru_2() || test_gru_3() || test_gru_4() || test_gru_5();
 }
@@ -144,7 +144,10 @@ static int test_innerproduct_3()
            || test_innerproduct_int8(RandomMat(6, 2, 8), 8, 1)
            || test_innerproduct_int8(RandomMat(8, 3, 15), 15, 1)
            || test_innerproduct_int8(RandomMat(7, 2, 16), 4, 1)
-           || test_innerproduct_int8(RandomMat(6, 3, 16), 16, 1);
+           || test_innerproduct_int8(RandomMat(6, 3, 16), 16, 1)
+           || test_innerproduct_int8(RandomMat(131), 33, 1)
+           || test_innerproduct_int8(RandomMat(5, 7, 11), 40, 0)
+           || test_innerproduct_int8(RandomMat(256), 1000, 1);
 }
 #endif // NCNN_INT8
 
@@ -252,10 +255,70 @@ static int test_innerproduct_5()
            || test_innerproduct_gemm_int8(RandomMat(16, 12), 16, 0)
            || test_innerproduct_gemm_int8(RandomMat(4, 15), 8, 1)
            || test_innerproduct_gemm_int8(RandomMat(6, 16), 16, 0)
-           || test_innerproduct_gemm_int8(RandomMat(12, 16), 7, 1);
+           || test_innerproduct_gemm_int8(RandomMat(12, 16), 7, 1)
+           || test_innerproduct_gemm_int8(RandomMat(67, 13), 33, 1)
+           || test_innerproduct_gemm_int8(RandomMat(128, 8), 24, 0)
+           || test_innerproduct_gemm_int8(RandomMat(45, 20), 40, 1)
+           || test_innerproduct_gemm_int8(RandomMat(600, 37), 50, 1);
 }
 #endif // NCNN_INT8
 
+static int test_innerproduct_batch(int w, int h, int c, int outch, int bias, int batch)
+{
+    // distinct samples so that a mixed up sample is caught
+    std::vector<ncnn::Mat> a(batch);
+    for (int i = 0; i < batch; i++)
+    {
+        if (h == 0)
+            a[i] = RandomMat(w);
+        else if (c == 0)
+            a[i] = RandomMat(w, h);
+        else
+            a[i] = RandomMat(w, h, c);
+    }
+
+    const int num_input = w * (h ? h : 1) * (c ? c : 1);
+
+    ncnn::ParamDict pd;
+    pd.set(0, outch); // num_output
+    pd.set(1, bias);  // bias_term
+    pd.set(2, outch * num_input);
+
+    int activation_type = RAND() % 7; // 0 1 2 3 4 5 6
+    ncnn::Mat activation_params(2);
+    activation_params[0] = (activation_type == 6) ? RandomFloat(0, 1) : RandomFloat(-1, 0); // alpha
+    activation_params[1] = RandomFloat(0, 1);                                               // beta
+    pd.set(9, activation_type);
+    pd.set(10, activation_params);
+
+    std::vector<ncnn::Mat> weights(bias ? 2 : 1);
+    weights[0] = RandomMat(outch * num_input);
+    if (bias)
+        weights[1] = RandomMat(outch);
+
+    int ret = test_layer_batch("InnerProduct", pd, weights, a);
+    if (ret != 0)
+    {
+        fprintf(stderr, "test_innerproduct_batch failed a=(%d %d %d) outch=%d bias=%d batch=%d act=%d actparams=[%f,%f]\n", w, h, c, outch, bias, batch, activation_type, activation_params[0], activation_params[1]);
+    }
+
+    return ret;
+}
+
+static int test_innerproduct_6()
+{
+    return 0
+           || test_innerproduct_batch(64, 0, 0, 32, 1, 2)
+           || test_innerproduct_batch(15, 0, 0, 7, 0, 3)
+           || test_innerproduct_batch(16, 0, 0, 16, 1, 4)
+           || test_innerproduct_batch(24, 0, 0, 13, 1, 8)
+           || test_innerproduct_batch(48, 0, 0, 40, 0, 16)
+           || test_innerproduct_batch(33, 0, 0, 16, 1, 17)
+           || test_innerproduct_batch(6, 16, 0, 24, 1, 4)
+           || test_innerproduct_batch(3, 4, 16, 32, 1, 5)
+           || test_innerproduct_batch(4, 3, 15, 8, 0, 8);
+}
+
 int main()
 {
     SRAND(7767517);
@@ -267,12 +330,14 @@ int main()
            || test_innerproduct_2()
            || test_innerproduct_3()
            || test_innerproduct_4()
-           || test_innerproduct_5();
+           || test_innerproduct_5()
+           || test_innerproduct_6();
 #else
     return 0
            || test_innerproduct_0()
            || test_innerproduct_1()
            || test_innerproduct_2()
-           || test_innerproduct_4();
+           || test_innerproduct_4()
+           || test_innerproduct_6();
 #endif
 }
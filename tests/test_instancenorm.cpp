@@ -48,10 +48,19 @@ static int test_instancenorm_0()
            || test_instancenorm(RandomMat(5, 7, 16), 0.02f, 1);
 }
 
+static int test_instancenorm_1()
+{
+    return 0
+           || test_instancenorm(RandomMat(13, 9, 24), 0.001f, 1)
+           || test_instancenorm(RandomMat(17, 15, 32), 0.00001f, 1)
+           || test_instancenorm(RandomMat(7, 11, 8, 3.f, 5.f), 0.001f, 0);
+}
+
 int main()
 {
     SRAND(7767517);
 
     return 0
-           || test_instancenorm_0();
+           || test_instancenorm_0()
+           || test_instancenorm_1();
 }
@@ -15,6 +15,8 @@
 #include "layer/lstm.h"
 #include "testutil.h"
 
+#include "net.h"
+
 static int test_lstm(const ncnn::Mat& a, int outch, int direction)
 {
     int input_size = a.w;
@@ -256,8 +258,84 @@ static int test_lstm_3()
            || test_lstm(RandomMat(2, 5), 17, 1);
 }
 
+// hidden and cell carried by the extractor across chunks
+static int test_lstm_streaming(int input_size, int outch)
+{
+    const int T = 10;
+    const int chunks[3] = {4, 1, 5};
+
+    std::vector<ncnn::Mat> weights(3);
+    weights[0] = RandomMat(outch * input_size * 4);
+    weights[1] = RandomMat(outch * 4);
+    weights[2] = RandomMat(outch * outch * 4);
+
+    ncnn::Net net;
+    net.opt.use_fp16_storage = false;
+    net.opt.use_bf16_storage = false;
+
+    char parambuf[256];
+    sprintf(parambuf, "7767517\n2 2\nInput in 0 1 in\nLSTM lstm 1 1 in out 0=%d 1=%d 2=0 10=1\n", outch, outch * input_size * 4);
+    net.load_param_mem(parambuf);
+
+    DataReaderFromMatArray dr(weights.data());
+    net.load_model(dr);
+
+    ncnn::ParamDict pd;
+    pd.set(0, outch);
+    pd.set(1, outch * input_size * 4);
+    pd.set(2, 0);
+
+    ncnn::Option opt;
+    opt.num_threads = 1;
+    opt.use_fp16_storage = false;
+    opt.use_bf16_storage = false;
+
+    ncnn::Layer* ref = ncnn::create_layer("LSTM");
+    ref->load_param(pd);
+    ref->load_model(ncnn::ModelBinFromMatArray(weights.data()));
+    ref->create_pipeline(opt);
+
+    ncnn::Mat x = RandomMat(input_size, T);
+    ncnn::Mat y;
+    ref->forward(x, y, opt);
+
+    int ret = 0;
+
+    ncnn::Extractor ex = net.create_extractor();
+
+    int t0 = 0;
+    for (int s = 0; s < 3 && ret == 0; s++)
+    {
+        ex.clear_blobs();
+        ex.input("in", x.row_range(t0, chunks[s]).clone());
+
+        ncnn::Mat out;
+        ex.extract("out", out);
+
+        if (CompareMat(out, y.row_range(t0, chunks[s]), 0.001) != 0)
+        {
+            fprintf(stderr, "test_lstm_streaming failed input_size=%d outch=%d at chunk %d\n", input_size, outch, s);
+            ret = -1;
+        }
+
+        t0 += chunks[s];
+    }
+
+    ref->destroy_pipeline(opt);
+    delete ref;
+
+    return ret;
+}
+
+static int test_lstm_4()
+{
+    return 0
+           || test_lstm_streaming(8, 16)
+           || test_lstm_streaming(13, 7);
+}
+
 int main()
 {
     SRAND(7767517);
-    return 0 || test_lstm_0() || test_lstm_1() || test_lstm_2() || test_lstm_3();
+    return 0 || test_lstm_0() || test_lstm_1() || test_lstm_2() || test_lstm_3() || test_lstm_4();
 }
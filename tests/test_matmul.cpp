@@ -231,6 +231,16 @@ static int test_matmul_15()
            || test_matmul_transb(RandomMat(14, 20, 8, 18), RandomMat(14, 9, 8, 18));
 }
 
+static int test_matmul_16()
+{
+    // attention shapes and more than one k block
+    return 0
+           || test_matmul_transb(RandomMat(64, 49, 12), RandomMat(64, 49, 12))
+           || test_matmul(RandomMat(49, 49, 12), RandomMat(64, 49, 12))
+           || test_matmul(RandomMat(300, 20, 2, 3), RandomMat(40, 300, 2, 3))
+           || test_matmul_transb(RandomMat(300, 3, 4), RandomMat(300, 70));
+}
+
 int main()
 {
     SRAND(7767517);
@@ -251,5 +261,6 @@ int main()
            || test_matmul_12()
            || test_matmul_13()
            || test_matmul_14()
-           || test_matmul_15();
+           || test_matmul_15()
+           || test_matmul_16();
 }
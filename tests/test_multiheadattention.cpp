@@ -15,6 +15,8 @@
 #include "layer/multiheadattention.h"
 #include "testutil.h"
 
+#include "net.h"
+
 static int test_multiheadattention(const ncnn::Mat& a, int num_heads)
 {
     int embed_dim = a.w;
@@ -93,11 +95,226 @@ static int test_multiheadattention_1()
            || test_multiheadattention_sameqkv(RandomMat(64, 127), 32);
 }
 
+static int test_multiheadattention_2()
+{
+    return 0
+           || test_multiheadattention(RandomMat(12, 5), 3)
+           || test_multiheadattention(RandomMat(40, 70), 5)
+           || test_multiheadattention_sameqkv(RandomMat(36, 1), 2)
+           || test_multiheadattention_sameqkv(RandomMat(80, 131), 10);
+}
+
+static int test_multiheadattention_kvcache(const ncnn::Mat& a, int past_seqlen, int num_heads, bool sameqkv)
+{
+    int embed_dim = a.w;
+
+    ncnn::ParamDict pd;
+    pd.set(0, embed_dim);
+    pd.set(1, num_heads);
+    pd.set(2, embed_dim * embed_dim);
+    pd.set(3, 1);
+
+    std::vector<ncnn::Mat> weights(8);
+    weights[0] = RandomMat(embed_dim * embed_dim);
+    weights[1] = RandomMat(embed_dim);
+    weights[2] = RandomMat(embed_dim * embed_dim);
+    weights[3] = RandomMat(embed_dim);
+    weights[4] = RandomMat(embed_dim * embed_dim);
+    weights[5] = RandomMat(embed_dim);
+    weights[6] = RandomMat(embed_dim * embed_dim);
+    weights[7] = RandomMat(embed_dim);
+
+    std::vector<ncnn::Mat> as;
+    as.push_back(a);
+    if (!sameqkv)
+    {
+        as.push_back(a);
+        as.push_back(a);
+    }
+    as.push_back(RandomMat(embed_dim, past_seqlen));
+    as.push_back(RandomMat(embed_dim, past_seqlen));
+
+    int ret = test_layer<ncnn::MultiHeadAttention>("MultiHeadAttention", pd, weights, as, 3);
+    if (ret != 0)
+    {
+        fprintf(stderr, "test_multiheadattention_kvcache failed a=(%d %d) past_seqlen=%d sameqkv=%d\n", a.w, a.h, past_seqlen, sameqkv);
+    }
+
+    return ret;
+}
+
+static int test_multiheadattention_3()
+{
+    return 0
+           || test_multiheadattention_kvcache(RandomMat(64, 1), 127, 4, true)
+           || test_multiheadattention_kvcache(RandomMat(64, 3), 66, 8, false)
+           || test_multiheadattention_kvcache(RandomMat(40, 7), 1, 5, true)
+           || test_multiheadattention_kvcache(RandomMat(16, 70), 5, 2, true);
+}
+
+static int test_multiheadattention_extractor_states()
+{
+    const int embed_dim = 32;
+    const int num_heads = 4;
+    const int seqlen = 6;
+
+    std::vector<ncnn::Mat> weights(8);
+    for (int i = 0; i < 8; i++)
+    {
+        weights[i] = RandomMat(i % 2 == 0 ? embed_dim * embed_dim : embed_dim);
+    }
+
+    ncnn::Mat x = RandomMat(embed_dim, seqlen);
+
+    ncnn::Net net;
+    net.opt.use_packing_layout = false;
+    net.opt.use_fp16_storage = false;
+    net.opt.use_bf16_storage = false;
+
+    char parambuf[256];
+    sprintf(parambuf, "7767517\n2 2\nInput in 0 1 in\nMultiHeadAttention mha 1 1 in out 0=%d 1=%d 2=%d 3=1\n", embed_dim, num_heads, embed_dim * embed_dim);
+    net.load_param_mem(parambuf);
+
+    // weight data comes with a float32 tag, bias data does not
+    const int types[8] = {0, 1, 0, 1, 0, 1, 0, 1};
+    DataReaderFromMatArray dr(weights.data(), types);
+    net.load_model(dr);
+
+    // stateless attention of one position over a whole prefix as reference
+    ncnn::ParamDict pd;
+    pd.set(0, embed_dim);
+    pd.set(1, num_heads);
+    pd.set(2, embed_dim * embed_dim);
+
+    ncnn::Option opt;
+    opt.num_threads = 1;
+    opt.use_packing_layout = false;
+
+    ncnn::Layer* ref = ncnn::create_layer("MultiHeadAttention");
+    ref->load_param(pd);
+    ref->load_model(ncnn::ModelBinFromMatArray(weights.data()));
+    ref->create_pipeline(opt);
+
+    int ret = 0;
+
+    ncnn::Extractor ex = net.create_extractor();
+
+    // positions fed one by one, then roll back to 2 positions and feed the last one again
+    const int steps[8] = {0, 1, 2, 3, 4, -2, 5, 5};
+    std::vector<ncnn::Mat> prefix;
+    for (int s = 0; s < 8 && ret == 0; s++)
+    {
+        if (steps[s] < 0)
+        {
+            ret = ex.trim_states(-steps[s]);
+            prefix.resize(-steps[s]);
+            continue;
+        }
+
+        ncnn::Mat xt = x.row_range(steps[s], 1).clone();
+        prefix.push_back(xt);
+
+        ex.clear_blobs();
+        ex.input("in", xt);
+
+        ncnn::Mat out;
+        ex.extract("out", out);
+
+        ncnn::Mat kv((int)embed_dim, (int)prefix.size());
+        for (size_t i = 0; i < prefix.size(); i++)
+        {
+            memcpy(kv.row(i), prefix[i], embed_dim * sizeof(float));
+        }
+
+        std::vector<ncnn::Mat> bottoms(3);
+        bottoms[0] = xt;
+        bottoms[1] = kv;
+        bottoms[2] = kv;
+        std::vector<ncnn::Mat> tops(1);
+        ref->forward(bottoms, tops, opt);
+
+        if (CompareMat(out, tops[0], 0.001) != 0)
+        {
+            fprintf(stderr, "test_multiheadattention_extractor_states failed at step %d\n", s);
+            ret = -1;
+        }
+    }
+
+    // a reset sequence attends to the new position only
+    if (ret == 0)
+    {
+        ex.reset_states();
+
+        ncnn::Mat xt = x.row_range(3, 1).clone();
+
+        ex.clear_blobs();
+        ex.input("in", xt);
+
+        ncnn::Mat out;
+        ex.extract("out", out);
+
+        std::vector<ncnn::Mat> bottoms(1, xt);
+        std::vector<ncnn::Mat> tops(1);
+        ref->forward(bottoms, tops, opt);
+
+        if (CompareMat(out, tops[0], 0.001) != 0)
+        {
+            fprintf(stderr, "test_multiheadattention_extractor_states failed after reset\n");
+            ret = -1;
+        }
+    }
+
+    // a chunk of several positions matches feeding them one by one
+    if (ret == 0)
+    {
+        ex.reset_states();
+
+        ncnn::Mat outs(embed_dim, seqlen);
+        for (int i = 0; i < seqlen; i++)
+        {
+            ex.clear_blobs();
+            ex.input("in", x.row_range(i, 1).clone());
+
+            ncnn::Mat out;
+            ex.extract("out", out);
+            memcpy(outs.row(i), out, embed_dim * sizeof(float));
+        }
+
+        ncnn::Extractor ex2 = net.create_extractor();
+
+        ncnn::Mat chunk_outs(embed_dim, seqlen);
+        const int chunks[3] = {0, 2, seqlen};
+        for (int c = 0; c < 2; c++)
+        {
+            ex2.clear_blobs();
+            ex2.input("in", x.row_range(chunks[c], chunks[c + 1] - chunks[c]).clone());
+
+            ncnn::Mat out;
+            ex2.extract("out", out);
+            memcpy(chunk_outs.row(chunks[c]), out, embed_dim * out.h * sizeof(float));
+        }
+
+        if (CompareMat(outs, chunk_outs, 0.001) != 0)
+        {
+            fprintf(stderr, "test_multiheadattention_extractor_states failed with chunked positions\n");
+            ret = -1;
+        }
+    }
+
+    ref->destroy_pipeline(opt);
+    delete ref;
+
+    return ret;
+}
+
 int main()
 {
     SRAND(7767517);
 
     return 0
            || test_multiheadattention_0()
-           || test_multiheadattention_1();
+           || test_multiheadattention_1()
+           || test_multiheadattention_2()
+           || test_multiheadattention_3()
+           || test_multiheadattention_extractor_states();
 }
@@ -115,6 +115,33 @@ static int test_permute_3()
     return 0;
 }
 
+static int test_permute_4()
+{
+    ncnn::Mat a = RandomMat(40, 64);
+    ncnn::Mat b = RandomMat(33, 48, 64);
+    ncnn::Mat c = RandomMat(17, 16, 3, 32);
+
+    for (int order_type = 0; order_type < 2; order_type++)
+    {
+        if (test_permute(a, order_type) != 0)
+            return -1;
+    }
+
+    for (int order_type = 0; order_type < 6; order_type++)
+    {
+        if (test_permute(b, order_type) != 0)
+            return -1;
+    }
+
+    for (int order_type = 0; order_type < 24; order_type++)
+    {
+        if (test_permute(c, order_type) != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
 int main()
 {
     SRAND(7767517);
@@ -123,5 +150,6 @@ int main()
            || test_permute_0()
            || test_permute_1()
            || test_permute_2()
-           || test_permute_3();
+           || test_permute_3()
+           || test_permute_4();
 }
@@ -0,0 +1,181 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "net.h"
+#include "testutil.h"
+
+static int g_create_pipeline_count = 0;
+static int g_load_pipeline_count = 0;
+
+// adds a transformed weight to the input and tells which setup path it took
+class PipelineProbe : public ncnn::Layer
+{
+public:
+    PipelineProbe()
+    {
+        one_blob_only = true;
+    }
+
+    virtual int load_param(const ncnn::ParamDict& pd)
+    {
+        w = pd.get(0, 0);
+        return 0;
+    }
+
+    virtual int load_model(const ncnn::ModelBin& mb)
+    {
+        weight_data = mb.load(w, 0);
+        if (weight_data.empty())
+            return -100;
+
+        return 0;
+    }
+
+    virtual int create_pipeline(const ncnn::Option& /*opt*/)
+    {
+        g_create_pipeline_count++;
+
+        weight_data_tm = weight_data.clone();
+        for (int i = 0; i < w; i++)
+        {
+            weight_data_tm[i] = weight_data[i] * 2.f;
+        }
+
+        return 0;
+    }
+
+    virtual int save_pipeline(std::vector<ncnn::Mat>& pipeline_data) const
+    {
+        pipeline_data.resize(1);
+        pipeline_data[0] = weight_data_tm;
+        return 0;
+    }
+
+    virtual int load_pipeline(const std::vector<ncnn::Mat>& pipeline_data, const ncnn::Option& /*opt*/)
+    {
+        if (pipeline_data.size() != 1 || pipeline_data[0].w != w)
+            return -1;
+
+        g_load_pipeline_count++;
+
+        weight_data_tm = pipeline_data[0];
+        return 0;
+    }
+
+    virtual int forward(const ncnn::Mat& bottom_blob, ncnn::Mat& top_blob, const ncnn::Option& opt) const
+    {
+        top_blob.create(w, (size_t)4u, opt.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        for (int i = 0; i < w; i++)
+        {
+            top_blob[i] = bottom_blob[i] + weight_data_tm[i];
+        }
+
+        return 0;
+    }
+
+public:
+    int w;
+    ncnn::Mat weight_data;
+    ncnn::Mat weight_data_tm;
+};
+
+DEFINE_LAYER_CREATOR(PipelineProbe)
+
+static int load_probe_net(ncnn::Net& net, const ncnn::Mat& weight, const char* cachepath)
+{
+    net.opt.num_threads = 1;
+
+    net.register_custom_layer("PipelineProbe", PipelineProbe_layer_creator);
+
+    char parambuf[256];
+    sprintf(parambuf, "7767517\n2 2\nInput in 0 1 in\nPipelineProbe probe 1 1 in out 0=%d\n", weight.w);
+    if (net.load_param_mem(parambuf) != 0)
+        return -1;
+
+    if (net.load_pipeline_cache(cachepath) != 0)
+        return -1;
+
+    DataReaderFromMatArray dr(&weight);
+    return net.load_model(dr);
+}
+
+static int test_pipeline_cache_0()
+{
+    const char* cachepath = "test_pipeline_cache.cache";
+
+    remove(cachepath);
+
+    ncnn::Mat weight = RandomMat(17);
+    ncnn::Mat in = RandomMat(17);
+
+    ncnn::Mat outs[2];
+    for (int i = 0; i < 2; i++)
+    {
+        g_create_pipeline_count = 0;
+        g_load_pipeline_count = 0;
+
+        ncnn::Net net;
+        if (load_probe_net(net, weight, cachepath) != 0)
+        {
+            fprintf(stderr, "load_probe_net failed pass %d\n", i);
+            return -1;
+        }
+
+        // the first pass creates the pipeline, the second one takes it from the cache
+        const int expect_create = i == 0 ? 1 : 0;
+        const int expect_load = i == 0 ? 0 : 1;
+        if (g_create_pipeline_count != expect_create || g_load_pipeline_count != expect_load)
+        {
+            fprintf(stderr, "pass %d create_pipeline %d load_pipeline %d\n", i, g_create_pipeline_count, g_load_pipeline_count);
+            return -1;
+        }
+
+        if (i == 0 && net.save_pipeline_cache(cachepath) != 0)
+        {
+            fprintf(stderr, "save_pipeline_cache failed\n");
+            return -1;
+        }
+
+        // the loaded layers alias the mapped cache
+        if (i == 1 && net.load_pipeline_cache(cachepath) == 0)
+        {
+            fprintf(stderr, "load_pipeline_cache accepted after load_model\n");
+            return -1;
+        }
+
+        ncnn::Extractor ex = net.create_extractor();
+        ex.input("in", in);
+        ex.extract("out", outs[i]);
+    }
+
+    remove(cachepath);
+
+    if (CompareMat(outs[0], outs[1], 0.f) != 0)
+    {
+        fprintf(stderr, "cached pipeline output differs\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int main()
+{
+    SRAND(7767517);
+
+    return test_pipeline_cache_0();
+}
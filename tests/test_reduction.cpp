@@ -361,6 +361,22 @@ static int test_reduction_3()
            || test_reduction(RandomMat(127), 1.f, 1, IntArrayMat(0));
 }
 
+static int test_reduction_4()
+{
+    return 0
+           || test_reduction(RandomMat(9, 11, 32), 1.f, 0)
+           || test_reduction(RandomMat(9, 11, 32), 2.f, 0, IntArrayMat(0))
+           || test_reduction(RandomMat(9, 11, 32), 1.f, 1, IntArrayMat(1, 2))
+           || test_reduction(RandomMat(9, 11, 32), 2.f, 0, IntArrayMat(2))
+           || test_reduction(RandomMat(9, 11, 32), 1.f, 1, IntArrayMat(0, 1))
+           || test_reduction(RandomMat(17, 48), 1.f, 0, IntArrayMat(0))
+           || test_reduction(RandomMat(17, 48), 2.f, 1, IntArrayMat(1))
+           || test_reduction(RandomMat(4, 5, 6, 32), 1.f, 0, IntArrayMat(0))
+           || test_reduction(RandomMat(4, 5, 6, 32), 2.f, 1, IntArrayMat(1, 3))
+           || test_reduction(RandomMat(4, 5, 6, 32), 1.f, 0, IntArrayMat(2, 3))
+           || test_reduction(RandomMat(64), 1.f, 0, IntArrayMat(0));
+}
+
 int main()
 {
     SRAND(7767517);
@@ -371,7 +387,8 @@ int main()
                   || test_reduction_0()
                   || test_reduction_1()
                   || test_reduction_2()
-                  || test_reduction_3();
+                  || test_reduction_3()
+                  || test_reduction_4();
 
         if (ret != 0)
             return ret;
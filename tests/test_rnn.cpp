@@ -15,6 +15,8 @@
 #include "layer/rnn.h"
 #include "testutil.h"
 
+#include "net.h"
+
 static int test_rnn(const ncnn::Mat& a, int outch, int direction)
 {
     int input_size = a.w;
@@ -249,8 +251,125 @@ static int test_rnn_3()
            || test_rnn(RandomMat(2, 5), 17, 1);
 }
 
+// hidden carried by the extractor across chunks
+static int test_rnn_streaming(int input_size, int outch)
+{
+    const int T = 11;
+    const int chunks[3] = {2, 6, 3};
+
+    std::vector<ncnn::Mat> weights(3);
+    weights[0] = RandomMat(outch * input_size);
+    weights[1] = RandomMat(outch);
+    weights[2] = RandomMat(outch * outch);
+
+    ncnn::Net net;
+    net.opt.use_fp16_storage = false;
+    net.opt.use_bf16_storage = false;
+
+    char parambuf[256];
+    sprintf(parambuf, "7767517\n2 2\nInput in 0 1 in\nRNN rnn 1 1 in out 0=%d 1=%d 2=0 10=1\n", outch, outch * input_size);
+    net.load_param_mem(parambuf);
+
+    DataReaderFromMatArray dr(weights.data());
+    net.load_model(dr);
+
+    ncnn::ParamDict pd;
+    pd.set(0, outch);
+    pd.set(1, outch * input_size);
+    pd.set(2, 0);
+
+    ncnn::Option opt;
+    opt.num_threads = 1;
+    opt.use_fp16_storage = false;
+    opt.use_bf16_storage = false;
+
+    ncnn::Layer* ref = ncnn::create_layer("RNN");
+    ref->load_param(pd);
+    ref->load_model(ncnn::ModelBinFromMatArray(weights.data()));
+    ref->create_pipeline(opt);
+
+    ncnn::Mat x = RandomMat(input_size, T);
+    ncnn::Mat y;
+    ref->forward(x, y, opt);
+
+    int ret = 0;
+
+    ncnn::Extractor ex = net.create_extractor();
+
+    int t0 = 0;
+    for (int s = 0; s < 3 && ret == 0; s++)
+    {
+        ex.clear_blobs();
+        ex.input("in", x.row_range(t0, chunks[s]).clone());
+
+        ncnn::Mat out;
+        ex.extract("out", out);
+
+        if (CompareMat(out, y.row_range(t0, chunks[s]), 0.001) != 0)
+        {
+            fprintf(stderr, "test_rnn_streaming failed input_size=%d outch=%d at chunk %d\n", input_size, outch, s);
+            ret = -1;
+        }
+
+        t0 += chunks[s];
+    }
+
+    // a reset stream starts from zero hidden again
+    if (ret == 0)
+    {
+        ex.reset_states();
+        ex.clear_blobs();
+        ex.input("in", x);
+
+        ncnn::Mat out;
+        ex.extract("out", out);
+
+        if (CompareMat(out, y, 0.001) != 0)
+        {
+            fprintf(stderr, "test_rnn_streaming failed input_size=%d outch=%d after reset\n", input_size, outch);
+            ret = -1;
+        }
+    }
+
+    ref->destroy_pipeline(opt);
+    delete ref;
+
+    return ret;
+}
+
+// streaming is forward only
+static int test_rnn_streaming_direction(int direction)
+{
+    ncnn::ParamDict pd;
+    pd.set(0, 4);
+    pd.set(1, 4 * 4 * 2);
+    pd.set(2, direction);
+    pd.set(10, 1);
+
+    ncnn::Layer* op = ncnn::create_layer("RNN");
+    int ret = op->load_param(pd);
+    delete op;
+
+    if (ret == 0)
+    {
+        fprintf(stderr, "test_rnn_streaming_direction failed direction=%d\n", direction);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_rnn_4()
+{
+    return 0
+           || test_rnn_streaming(8, 16)
+           || test_rnn_streaming(13, 7)
+           || test_rnn_streaming_direction(1)
+           || test_rnn_streaming_direction(2);
+}
+
 int main()
 {
     SRAND(7767517);
-    return test_rnn_0() || test_rnn_1() || test_rnn_2() || test_rnn_3();
+    return test_rnn_0() || test_rnn_1() || test_rnn_2() || test_rnn_3() || test_rnn_4();
 }
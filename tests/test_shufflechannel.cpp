@@ -80,9 +80,27 @@ static int test_shufflechannel_1()
            || test_shufflechannel(3, 7, 64, 4, 1);
 }
 
+static int test_shufflechannel_2()
+{
+    return 0
+           || test_shufflechannel(8, 8, 64, 16, 0)
+           || test_shufflechannel(8, 8, 64, 16, 1)
+           || test_shufflechannel(7, 5, 128, 32, 0)
+           || test_shufflechannel(7, 5, 128, 2, 1)
+           || test_shufflechannel(6, 6, 96, 8, 0)
+           || test_shufflechannel(6, 6, 96, 6, 1)
+           || test_shufflechannel(7, 5, 116, 2, 0)
+           || test_shufflechannel(3, 3, 232, 2, 0)
+           || test_shufflechannel(4, 3, 48, 4, 0)
+           || test_shufflechannel(4, 3, 48, 12, 1);
+}
+
 int main()
 {
     SRAND(7767517);
 
-    return test_shufflechannel_0() || test_shufflechannel_1();
+    return 0
+           || test_shufflechannel_0()
+           || test_shufflechannel_1()
+           || test_shufflechannel_2();
 }
@@ -0,0 +1,132 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2024 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "cpu.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int test_simpleomp_back_to_back(int num_threads)
+{
+    const int n = 1000;
+
+    int a[n];
+    int tid[n];
+
+    for (int r = 0; r < 100; r++)
+    {
+        memset(a, 0, sizeof(a));
+
+        #pragma omp parallel for num_threads(num_threads)
+        for (int i = 0; i < n; i++)
+        {
+            a[i] = i * 2 + r;
+            tid[i] = ncnn::get_omp_thread_num();
+        }
+
+        // the next region must see every write of the previous one
+        #pragma omp parallel for num_threads(num_threads)
+        for (int i = 0; i < n; i++)
+        {
+            a[i] += 1;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            if (a[i] != i * 2 + r + 1)
+            {
+                fprintf(stderr, "test_simpleomp_back_to_back failed num_threads=%d round=%d a[%d]=%d\n", num_threads, r, i, a[i]);
+                return -1;
+            }
+
+            if (tid[i] < 0 || tid[i] >= num_threads)
+            {
+                fprintf(stderr, "test_simpleomp_back_to_back failed num_threads=%d round=%d thread_num=%d\n", num_threads, r, tid[i]);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int test_simpleomp_nested(int num_threads)
+{
+    const int m = 16;
+    const int n = 256;
+
+    int a[m][n];
+
+    for (int r = 0; r < 20; r++)
+    {
+        memset(a, 0, sizeof(a));
+
+        #pragma omp parallel for num_threads(num_threads)
+        for (int i = 0; i < m; i++)
+        {
+            #pragma omp parallel for num_threads(num_threads)
+            for (int j = 0; j < n; j++)
+            {
+                a[i][j] = i * n + j + r;
+            }
+
+            // the inner region has joined, its writes are visible here
+            int sum = 0;
+            for (int j = 0; j < n; j++)
+            {
+                sum += a[i][j] - r;
+            }
+
+            a[i][0] = sum;
+        }
+
+        for (int i = 0; i < m; i++)
+        {
+            const int expect_sum = i * n * n + n * (n - 1) / 2;
+            if (a[i][0] != expect_sum)
+            {
+                fprintf(stderr, "test_simpleomp_nested failed num_threads=%d round=%d sum[%d]=%d expect %d\n", num_threads, r, i, a[i][0], expect_sum);
+                return -1;
+            }
+
+            for (int j = 1; j < n; j++)
+            {
+                if (a[i][j] != i * n + j + r)
+                {
+                    fprintf(stderr, "test_simpleomp_nested failed num_threads=%d round=%d a[%d][%d]=%d\n", num_threads, r, i, j, a[i][j]);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+int main()
+{
+    const int num_threads[] = {1, 2, 3, ncnn::get_cpu_count(), ncnn::get_cpu_count() * 2};
+
+    for (int i = 0; i < (int)(sizeof(num_threads) / sizeof(num_threads[0])); i++)
+    {
+        int ret = 0
+                  || test_simpleomp_back_to_back(num_threads[i])
+                  || test_simpleomp_nested(num_threads[i]);
+
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
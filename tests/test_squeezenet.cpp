@@ -12,6 +12,8 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
+#include "benchmark.h"
+#include "datareader.h"
 #include "platform.h"
 #include "net.h"
 #include "testutil.h"
@@ -66,15 +68,15 @@ struct compare_score_index
     }
 };
 
-static int check_top2(const std::vector<float>& cls_scores, float epsilon = 0.001)
+static int check_top2(const ncnn::Mat& out, float epsilon = 0.001)
 {
     // partial sort topk with index
-    int size = cls_scores.size();
+    int size = out.w;
     std::vector<std::pair<float, int> > vec;
     vec.resize(size);
     for (int i = 0; i < size; i++)
     {
-        vec[i] = std::make_pair(cls_scores[i], i);
+        vec[i] = std::make_pair(out[i], i);
     }
 
     std::partial_sort(vec.begin(), vec.begin() + 2, vec.end(), compare_score_index());
@@ -158,18 +160,48 @@ static ncnn::Mat read_file_content(const char* filepath)
     return m;
 }
 
-static int test_squeezenet(const ncnn::Option& opt, int load_model_type, float epsilon = 0.001)
-{
-    ncnn::Net squeezenet;
-
-    squeezenet.opt = opt;
-
 #ifdef __EMSCRIPTEN__
 #define MODEL_DIR "/working"
 #else
 #define MODEL_DIR "../../examples"
 #endif
 
+// the logo with mean subtracted, the input every squeezenet test checks against
+static ncnn::Mat squeezenet_input()
+{
+    ncnn::Mat in = generate_ncnn_logo(ncnn::Mat::PIXEL_BGR, 227, 227);
+
+    const float mean_vals[3] = {104.f, 117.f, 123.f};
+    in.substract_mean_normalize(mean_vals, 0);
+
+    return in;
+}
+
+static void load_squeezenet(ncnn::Net& squeezenet, const ncnn::Option& opt)
+{
+    squeezenet.opt = opt;
+
+    squeezenet.load_param(MODEL_DIR "/squeezenet_v1.1.param");
+    squeezenet.load_model(MODEL_DIR "/squeezenet_v1.1.bin");
+}
+
+// extract prob for the input already fed to ex and check its top2
+static int check_prob(ncnn::Extractor& ex, float epsilon)
+{
+    ncnn::Mat out;
+    int ret = ex.extract("prob", out);
+    if (ret != 0)
+        return ret;
+
+    return check_top2(out, epsilon);
+}
+
+static int test_squeezenet(const ncnn::Option& opt, int load_model_type, float epsilon = 0.001)
+{
+    ncnn::Net squeezenet;
+
+    squeezenet.opt = opt;
+
     std::string param_str;
     ncnn::Mat param_data;
     ncnn::Mat model_data;
@@ -202,33 +234,393 @@ static int test_squeezenet(const ncnn::Option& opt, int load_model_type, float e
         squeezenet.load_model((const unsigned char*)model_data);
     }
 
-    ncnn::Mat in = generate_ncnn_logo(ncnn::Mat::PIXEL_BGR, 227, 227);
+    ncnn::Extractor ex = squeezenet.create_extractor();
 
-    const float mean_vals[3] = {104.f, 117.f, 123.f};
-    in.substract_mean_normalize(mean_vals, 0);
+    if (load_model_type == 0 || load_model_type == 1)
+    {
+        ex.input("data", squeezenet_input());
+        return check_prob(ex, epsilon);
+    }
+
+    ncnn::Mat out;
+    ex.input(0, squeezenet_input());
+    ex.extract(82, out);
+
+    return check_top2(out, epsilon);
+}
+
+// single-threaded sequential inference, the baseline for the concurrent modes
+// compare the pool10 logits, the softmax output is too flat for absolute tolerance
+static int forward_squeezenet_reference(const ncnn::Option& opt, const ncnn::Mat& in, ncnn::Mat& logits)
+{
+    ncnn::Option opt_ref = opt;
+    opt_ref.num_threads = 1;
+    opt_ref.use_parallel_pipeline = false;
+
+    ncnn::Net squeezenet;
+    load_squeezenet(squeezenet, opt_ref);
 
     ncnn::Extractor ex = squeezenet.create_extractor();
 
-    ncnn::Mat out;
-    if (load_model_type == 0 || load_model_type == 1)
+    ex.input("data", in);
+    return ex.extract("pool10", logits);
+}
+
+static int test_squeezenet_mmap(const ncnn::Option& opt, float epsilon = 0.001)
+{
+    // weights reference the mapping, so the reader outlives the net
+    ncnn::DataReaderFromMmap dr(MODEL_DIR "/squeezenet_v1.1.bin");
+    if (!dr.mapped())
+        return -1;
+
+    ncnn::Net squeezenet;
+
+    squeezenet.opt = opt;
+
+    squeezenet.load_param(MODEL_DIR "/squeezenet_v1.1.param");
+    squeezenet.load_model(dr);
+
+    ncnn::Extractor ex = squeezenet.create_extractor();
+
+    ex.input("data", squeezenet_input());
+
+    return check_prob(ex, epsilon);
+}
+
+static int test_squeezenet_parallel_pipeline(const ncnn::Option& opt, float epsilon = 0.001)
+{
+    // unlocked pool allocators are the common user setup,
+    // the pipeline workers must not share them
+    ncnn::UnlockedPoolAllocator blob_pool_allocator;
+    ncnn::UnlockedPoolAllocator workspace_pool_allocator;
+
+    ncnn::Option opt_pp = opt;
+    opt_pp.num_threads = 4;
+    opt_pp.use_parallel_pipeline = true;
+    opt_pp.blob_allocator = &blob_pool_allocator;
+    opt_pp.workspace_allocator = &workspace_pool_allocator;
+
+    ncnn::Net squeezenet;
+    load_squeezenet(squeezenet, opt_pp);
+
+    ncnn::Mat in = squeezenet_input();
+
+    ncnn::Mat logits;
     {
+        ncnn::Extractor ex = squeezenet.create_extractor();
+
         ex.input("data", in);
-        ex.extract("prob", out);
+        ex.extract("pool10", logits);
+
+        int ret = check_prob(ex, epsilon);
+        if (ret != 0)
+            return ret;
     }
-    if (load_model_type == 2 || load_model_type == 3)
+
+    ncnn::Mat logits_ref;
+    if (forward_squeezenet_reference(opt, in, logits_ref) != 0)
+        return -1;
+
+    if (CompareMat(logits, logits_ref, epsilon) != 0)
+    {
+        fprintf(stderr, "parallel pipeline output differs from sequential pipeline\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_squeezenet_pipeline_cache(const ncnn::Option& opt, float epsilon = 0.001)
+{
+    const char* cachepath = "test_squeezenet_pipeline.cache";
+
+    // the first pass populates the cache, the second pass loads from it
+    for (int i = 0; i < 2; i++)
     {
-        ex.input(0, in);
-        ex.extract(82, out);
+        ncnn::Net squeezenet;
+
+        squeezenet.opt = opt;
+
+        squeezenet.load_param(MODEL_DIR "/squeezenet_v1.1.param");
+        if (i == 0)
+            remove(cachepath);
+        if (squeezenet.load_pipeline_cache(cachepath) != 0)
+            return -1;
+        squeezenet.load_model(MODEL_DIR "/squeezenet_v1.1.bin");
+        if (i == 0 && squeezenet.save_pipeline_cache(cachepath) != 0)
+            return -1;
+
+        ncnn::Extractor ex = squeezenet.create_extractor();
+
+        ex.input("data", squeezenet_input());
+
+        int ret = check_prob(ex, epsilon);
+        if (ret != 0)
+            return ret;
     }
 
-    std::vector<float> cls_scores;
-    cls_scores.resize(out.w);
-    for (int j = 0; j < out.w; j++)
+    // the cache is written aside and renamed into place
+    FILE* fp = fopen("test_squeezenet_pipeline.cache.tmp", "rb");
+    if (fp)
     {
-        cls_scores[j] = out[j];
+        fclose(fp);
+        fprintf(stderr, "pipeline cache temporary file left behind\n");
+        return -1;
     }
 
-    return check_top2(cls_scores, epsilon);
+    // a truncated or corrupted cache is rejected
+    std::string cache = read_file_string(cachepath);
+    if (cache.size() < 2)
+        return -1;
+
+    // drop the terminator appended by read_file_string
+    cache.resize(cache.size() - 1);
+
+    for (int i = 0; i < 2; i++)
+    {
+        std::string broken = cache;
+        if (i == 0)
+            broken.resize(broken.size() - 1);
+        if (i == 1)
+            broken[broken.size() - 1] ^= 0x55;
+
+        fp = fopen(cachepath, "wb");
+        if (!fp)
+            return -1;
+        fwrite(broken.data(), 1, broken.size(), fp);
+        fclose(fp);
+
+        ncnn::Net squeezenet;
+
+        squeezenet.opt = opt;
+
+        squeezenet.load_param(MODEL_DIR "/squeezenet_v1.1.param");
+        if (squeezenet.load_pipeline_cache(cachepath) == 0)
+        {
+            fprintf(stderr, "%s pipeline cache accepted\n", i == 0 ? "truncated" : "corrupted");
+            return -1;
+        }
+    }
+
+    remove(cachepath);
+
+    return 0;
+}
+
+static int test_squeezenet_plan_memory(const ncnn::Option& opt, float epsilon = 0.001)
+{
+    // the planned arena replaces the blob allocator
+    ncnn::Option opt_planned = opt;
+    opt_planned.blob_allocator = 0;
+
+    ncnn::Net squeezenet;
+    load_squeezenet(squeezenet, opt_planned);
+
+    ncnn::Mat in = squeezenet_input();
+
+    ncnn::Mat logits_ref;
+    if (forward_squeezenet_reference(opt, in, logits_ref) != 0)
+        return -1;
+
+    std::vector<ncnn::Mat> in_shapes(1, in.shape());
+    int ret = squeezenet.plan_memory(in_shapes);
+    if (ret != 0 || squeezenet.planned_memory_size() == 0)
+    {
+        fprintf(stderr, "plan_memory failed\n");
+        return -1;
+    }
+
+    // run three times to reuse the planned arena
+    // the net is planned again while the first extractor still holds its arena
+    ncnn::Extractor* ex_held = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        ncnn::Extractor ex = squeezenet.create_extractor();
+
+        ncnn::Mat logits;
+        ex.input("data", in);
+        ex.extract("pool10", logits);
+
+        ret = check_prob(ex, epsilon);
+        if (ret != 0)
+        {
+            delete ex_held;
+            return ret;
+        }
+
+        // every blob comes from the arena
+        if (ex.planned_memory_hits() == 0 || ex.planned_memory_misses() != 0)
+        {
+            fprintf(stderr, "run %d planned arena hits %d misses %d\n", i, (int)ex.planned_memory_hits(), (int)ex.planned_memory_misses());
+            delete ex_held;
+            return -1;
+        }
+
+        if (CompareMat(logits, logits_ref, epsilon) != 0)
+        {
+            fprintf(stderr, "run %d planned memory output differs from unplanned run\n", i);
+            delete ex_held;
+            return -1;
+        }
+
+        if (i == 0)
+        {
+            ncnn::Mat out;
+            ex_held = new ncnn::Extractor(squeezenet.create_extractor());
+            ex_held->input("data", in);
+            ex_held->extract("prob", out);
+
+            ret = squeezenet.plan_memory(in_shapes);
+            if (ret != 0)
+            {
+                delete ex_held;
+                return ret;
+            }
+        }
+        if (i == 1)
+        {
+            // hand the arena of the dropped plan back
+            delete ex_held;
+            ex_held = 0;
+        }
+    }
+
+    return 0;
+}
+
+static int test_squeezenet_parallel_branches(const ncnn::Option& opt, float epsilon = 0.001)
+{
+    ncnn::Net squeezenet;
+    load_squeezenet(squeezenet, opt);
+
+    ncnn::Mat in = squeezenet_input();
+
+    ncnn::Mat logits_ref;
+    if (forward_squeezenet_reference(opt, in, logits_ref) != 0)
+        return -1;
+
+    ncnn::Extractor ex = squeezenet.create_extractor();
+    ex.set_parallel_branches(2);
+
+    // the shared unlocked pool allocator is not thread-safe
+    ex.set_blob_allocator(0);
+
+    // the second run reuses the worker threads of the first
+    for (int i = 0; i < 2; i++)
+    {
+        ex.clear_blobs();
+
+        ex.input("data", in);
+
+        ncnn::Mat logits;
+        ex.extract("pool10", logits);
+
+        int ret = check_prob(ex, epsilon);
+        if (ret != 0)
+            return ret;
+
+        if (CompareMat(logits, logits_ref, epsilon) != 0)
+        {
+            fprintf(stderr, "parallel branches run %d differs from sequential run\n", i);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int test_squeezenet_batch(const ncnn::Option& opt, float epsilon = 0.001)
+{
+    ncnn::Net squeezenet;
+    load_squeezenet(squeezenet, opt);
+
+    // distinct samples so that a mixed up or misplaced sample is caught
+    // the first one is the reference logo
+    std::vector<ncnn::Mat> ins(4);
+    for (int i = 0; i < 4; i++)
+    {
+        ins[i] = generate_ncnn_logo(ncnn::Mat::PIXEL_BGR, 227, 227);
+
+        const float mean_vals[3] = {104.f + i * 37, 117.f - i * 23, 123.f + i * 11};
+        const float norm_vals[3] = {1.f, 1.f - i * 0.2f, 1.f + i * 0.3f};
+        ins[i].substract_mean_normalize(mean_vals, norm_vals);
+    }
+
+    std::vector<ncnn::Mat> logits;
+    std::vector<ncnn::Mat> outs;
+    {
+        ncnn::Extractor ex = squeezenet.create_extractor();
+
+        ex.input("data", ins);
+        int ret = ex.extract("pool10", logits);
+        if (ret == 0)
+            ret = ex.extract("prob", outs);
+        if (ret != 0 || logits.size() != ins.size() || outs.size() != ins.size())
+            return -1;
+    }
+
+    // every sample matches its own single sample inference
+    for (size_t i = 0; i < ins.size(); i++)
+    {
+        ncnn::Extractor ex = squeezenet.create_extractor();
+
+        ncnn::Mat logits_ref;
+        ex.input("data", ins[i]);
+        ex.extract("pool10", logits_ref);
+
+        if (CompareMat(logits[i], logits_ref, epsilon) != 0)
+        {
+            fprintf(stderr, "batch sample %d differs from single sample inference\n", (int)i);
+            return -1;
+        }
+    }
+
+    return check_top2(outs[0], epsilon);
+}
+
+static int test_squeezenet_profiler(const ncnn::Option& opt, float epsilon = 0.001)
+{
+    ncnn::Net squeezenet;
+    load_squeezenet(squeezenet, opt);
+
+    ncnn::Profiler profiler;
+
+    ncnn::Extractor ex = squeezenet.create_extractor();
+    ex.set_profiler(&profiler);
+
+    ex.input("data", squeezenet_input());
+
+    int ret = check_prob(ex, epsilon);
+    if (ret != 0)
+        return ret;
+
+    // every layer except the input runs once
+    std::vector<ncnn::LayerProfile> records = profiler.records();
+    if ((int)records.size() != (int)squeezenet.layers().size() - 1)
+    {
+        fprintf(stderr, "profiler recorded %d layers, expect %d\n", (int)records.size(), (int)squeezenet.layers().size() - 1);
+        return -1;
+    }
+
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const ncnn::LayerProfile& p = records[i];
+        if (p.end < p.start || p.top_shapes.empty() || p.top_shapes[0].dims == 0)
+        {
+            fprintf(stderr, "profiler record %d malformed\n", (int)i);
+            return -1;
+        }
+    }
+
+#if NCNN_STDIO
+    if (profiler.save_json("test_squeezenet_profile.json") != 0 || profiler.save_chrome_trace("test_squeezenet_trace.json") != 0)
+        return -1;
+
+    remove("test_squeezenet_profile.json");
+    remove("test_squeezenet_trace.json");
+#endif // NCNN_STDIO
+
+    return 0;
 }
 
 int main()
@@ -322,6 +714,55 @@ int main()
             return ret;
         }
 #endif // NCNN_VULKAN
+
+        ret = test_squeezenet_mmap(opt_cpu, epsilon);
+        if (ret != 0)
+        {
+            fprintf(stderr, "test_squeezenet_mmap failed use_packing_layout=%d use_bf16_storage=%d\n", opt.use_packing_layout, opt.use_bf16_storage);
+            return ret;
+        }
+
+        ret = test_squeezenet_parallel_pipeline(opt_cpu, epsilon);
+        if (ret != 0)
+        {
+            fprintf(stderr, "test_squeezenet_parallel_pipeline failed use_packing_layout=%d use_bf16_storage=%d\n", opt.use_packing_layout, opt.use_bf16_storage);
+            return ret;
+        }
+
+        ret = test_squeezenet_pipeline_cache(opt_cpu, epsilon);
+        if (ret != 0)
+        {
+            fprintf(stderr, "test_squeezenet_pipeline_cache failed use_packing_layout=%d use_bf16_storage=%d\n", opt.use_packing_layout, opt.use_bf16_storage);
+            return ret;
+        }
+
+        ret = test_squeezenet_plan_memory(opt_cpu, epsilon);
+        if (ret != 0)
+        {
+            fprintf(stderr, "test_squeezenet_plan_memory failed use_packing_layout=%d use_bf16_storage=%d\n", opt.use_packing_layout, opt.use_bf16_storage);
+            return ret;
+        }
+
+        ret = test_squeezenet_parallel_branches(opt_cpu, epsilon);
+        if (ret != 0)
+        {
+            fprintf(stderr, "test_squeezenet_parallel_branches failed use_packing_layout=%d use_bf16_storage=%d\n", opt.use_packing_layout, opt.use_bf16_storage);
+            return ret;
+        }
+
+        ret = test_squeezenet_batch(opt_cpu, epsilon);
+        if (ret != 0)
+        {
+            fprintf(stderr, "test_squeezenet_batch failed use_packing_layout=%d use_bf16_storage=%d\n", opt.use_packing_layout, opt.use_bf16_storage);
+            return ret;
+        }
+
+        ret = test_squeezenet_profiler(opt_cpu, epsilon);
+        if (ret != 0)
+        {
+            fprintf(stderr, "test_squeezenet_profiler failed use_packing_layout=%d use_bf16_storage=%d\n", opt.use_packing_layout, opt.use_bf16_storage);
+            return ret;
+        }
     }
 
     return 0;
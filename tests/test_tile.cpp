@@ -128,6 +128,9 @@ static int test_tile_0()
            || test_tile(b, IntArrayMat(4, 1, 4))
            || test_tile(b, IntArrayMat(2, 2, 2, 1))
            || test_tile(b, IntArrayMat(3, 2, 1))
+           || test_tile(a, IntArrayMat(1, 2, 1, 1))
+           || test_tile(b, IntArrayMat(1, 2, 1, 1))
+           || test_tile(c, IntArrayMat(1, 2, 1, 1))
            || test_tile(c, IntArrayMat(3))
            || test_tile(c, IntArrayMat(1, 1, 4))
            || test_tile(c, IntArrayMat(2, 2, 5))
@@ -16,6 +16,7 @@
 #define TESTUTIL_H
 
 #include "cpu.h"
+#include "datareader.h"
 #include "layer.h"
 #include "mat.h"
 #include "prng.h"
@@ -342,6 +343,38 @@ static int CompareMat(const std::vector<ncnn::Mat>& a, const std::vector<ncnn::M
     return 0;
 }
 
+// feed weights to Net::load_model(const DataReader&) in the model bin layout
+// weights loaded with type 0 come with a float32 tag, type 1 weights are raw
+// types defaults to every weight being type 0
+class DataReaderFromMatArray : public ncnn::DataReader
+{
+public:
+    DataReaderFromMatArray(const ncnn::Mat* _weights, const int* _types = 0)
+        : weights(_weights), types(_types), index(0), tag_read(false)
+    {
+    }
+
+    virtual size_t read(void* buf, size_t size) const
+    {
+        if ((!types || types[index] == 0) && !tag_read)
+        {
+            memset(buf, 0, size);
+            tag_read = true;
+            return size;
+        }
+
+        memcpy(buf, weights[index], size);
+        index++;
+        tag_read = false;
+        return size;
+    }
+
+    const ncnn::Mat* weights;
+    const int* types;
+    mutable size_t index;
+    mutable bool tag_read;
+};
+
 template<typename T>
 int test_layer_naive(int typeindex, const ncnn::ParamDict& pd, const std::vector<ncnn::Mat>& weights, const std::vector<ncnn::Mat>& a, int top_blob_count, std::vector<ncnn::Mat>& b, void (*func)(T*), int flag)
 {
@@ -1243,6 +1276,7 @@ int test_layer(const char* layer_type, const ncnn::ParamDict& pd, const std::vec
     opts[4].use_bf16_storage = false;
     opts[4].use_shader_pack8 = true;
     opts[4].use_image_storage = true;
+    opts[4].use_fp16_weight_storage = true;
 
     opts[5].use_packing_layout = true;
     opts[5].use_fp16_packed = false;
@@ -1391,6 +1425,7 @@ int test_layer(const char* layer_type, const ncnn::ParamDict& pd, const std::vec
     opts[4].use_bf16_storage = false;
     opts[4].use_shader_pack8 = true;
     opts[4].use_image_storage = true;
+    opts[4].use_fp16_weight_storage = true;
 
     opts[5].use_packing_layout = true;
     opts[5].use_fp16_packed = false;
@@ -1487,4 +1522,107 @@ int test_layer(const char* layer_type, const ncnn::ParamDict& pd, const std::vec
     return 0;
 }
 
+// compare forward_batch against forward on each sample, fp32 only
+static int test_layer_batch(const char* layer_type, const ncnn::ParamDict& pd, const std::vector<ncnn::Mat>& weights, const std::vector<ncnn::Mat>& a, float epsilon = 0.001)
+{
+    ncnn::Option opts[3];
+
+    opts[0].use_packing_layout = false;
+
+    opts[1].use_packing_layout = true;
+
+    opts[2].use_packing_layout = true;
+    opts[2].use_sgemm_convolution = false;
+    opts[2].use_winograd_convolution = false;
+
+    for (int i = 0; i < 3; i++)
+    {
+        ncnn::Option& opt = opts[i];
+        opt.num_threads = 1;
+        opt.use_vulkan_compute = false;
+        opt.use_fp16_packed = false;
+        opt.use_fp16_storage = false;
+        opt.use_fp16_arithmetic = false;
+        opt.use_bf16_storage = false;
+
+        ncnn::Layer* op = ncnn::create_layer(layer_type);
+
+        op->load_param(pd);
+
+        ncnn::ModelBinFromMatArray mb(weights.data());
+
+        op->load_model(mb);
+
+        op->create_pipeline(opt);
+
+        std::vector<ncnn::Mat> a4(a.size());
+        for (size_t j = 0; j < a.size(); j++)
+        {
+            a4[j] = a[j];
+
+            if (opt.use_packing_layout && op->support_packing)
+            {
+                int dims = a[j].dims;
+                int elemcount = 0;
+                if (dims == 1) elemcount = a[j].w;
+                if (dims == 2) elemcount = a[j].h;
+                if (dims == 3 || dims == 4) elemcount = a[j].c;
+
+                int dst_elempack = 1;
+#if NCNN_AVX512
+                if (elemcount % 16 == 0 && ncnn::cpu_support_x86_avx512())
+                    dst_elempack = 16;
+                else if (elemcount % 8 == 0 && ncnn::cpu_support_x86_avx())
+                    dst_elempack = 8;
+                else if (elemcount % 4 == 0)
+                    dst_elempack = 4;
+#elif NCNN_AVX
+                if (elemcount % 8 == 0 && ncnn::cpu_support_x86_avx())
+                    dst_elempack = 8;
+                else if (elemcount % 4 == 0)
+                    dst_elempack = 4;
+#elif NCNN_RVV
+                const int packn = ncnn::cpu_riscv_vlenb() / 4;
+                if (elemcount % packn == 0)
+                    dst_elempack = packn;
+#else
+                if (elemcount % 4 == 0)
+                    dst_elempack = 4;
+#endif
+
+                ncnn::convert_packing(a[j], a4[j], dst_elempack, opt);
+            }
+        }
+
+        std::vector<ncnn::Mat> b;
+        int ret = op->forward_batch(a4, b, opt);
+        if (ret != 0 || b.size() != a.size())
+        {
+            fprintf(stderr, "test_layer_batch forward_batch failed\n");
+            op->destroy_pipeline(opt);
+            delete op;
+            return -1;
+        }
+
+        for (size_t j = 0; j < a.size(); j++)
+        {
+            ncnn::Mat c;
+            ret = op->forward(a4[j], c, opt);
+            if (ret != 0 || CompareMat(b[j], c, epsilon) != 0)
+            {
+                fprintf(stderr, "test_layer_batch sample %d not match use_packing_layout=%d use_sgemm_convolution=%d\n", (int)j, opt.use_packing_layout, opt.use_sgemm_convolution);
+                op->destroy_pipeline(opt);
+                delete op;
+                return -1;
+            }
+        }
+
+        op->destroy_pipeline(opt);
+
+        delete op;
+    }
+
+    return 0;
+}
+
 #endif // TESTUTIL_H